@@ -129,7 +129,7 @@ void freeSUnitCommand(void* sCommandData, int sCommandId) {
 	FREE(sCommandData);
 }
 
-static float* allocFloatArr3(const std::vector<float>& from, const size_t firstValIndex = 0) {
+static float* allocFloatArr3(const CommandParams& from, const size_t firstValIndex = 0) {
 
 	float* to = (float*) calloc(3, sizeof(float));
 
@@ -3667,7 +3667,7 @@ EXPORT(int) skirmishAiCallback_Unit_CurrentCommand_getParams(int skirmishAIId,
 		return -1;
 	}
 
-	const std::vector<float>& ps = q->at(commandId).params;
+	const CommandParams& ps = q->at(commandId).params;
 	const size_t params_sizeReal = ps.size();
 
 	size_t params_size = params_sizeReal;
@@ -5003,7 +5003,7 @@ EXPORT(int) skirmishAiCallback_Group_OrderPreview_getParams(int skirmishAIId,
 
 	if (!isControlledByLocalPlayer(skirmishAIId)) { return 0; }
 
-	const std::vector<float>& ps = guihandler->GetOrderPreview().params;
+	const CommandParams& ps = guihandler->GetOrderPreview().params;
 	const size_t params_sizeReal = ps.size();
 
 	size_t params_size = params_sizeReal;
@@ -0,0 +1,228 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "DemoAnalysis.h"
+
+#include "Game.h"
+#include "GlobalUnsynced.h"
+#include "UI/GuiHandler.h"
+#include "Net/GameServer.h"
+#include "Sim/Misc/GlobalSynced.h"
+#include "Sim/Misc/Team.h"
+#include "Sim/Misc/TeamHandler.h"
+#include "System/Util.h"
+#include "System/FileSystem/FileSystem.h"
+#include "System/FileSystem/FileSystemAbstraction.h"
+#include "System/Log/ILog.h"
+#include "System/Platform/Misc.h"
+#include "System/Sync/SyncChecker.h"
+
+std::string CDemoAnalysis::outputFile;
+
+
+CDemoAnalysis::CDemoAnalysis()
+	: CEventClient("[CDemoAnalysis]", 271991, false)
+	, finished(false)
+{
+	eventHandler.AddClient(this);
+}
+
+CDemoAnalysis::~CDemoAnalysis()
+{
+	eventHandler.RemoveClient(this);
+}
+
+void CDemoAnalysis::GameFrame(int gameFrame)
+{
+	if (gameFrame != 0)
+		return;
+
+	std::vector<std::string> cmds;
+	cmds.push_back("@@setmaxspeed 100");
+	cmds.push_back("@@setminspeed 100");
+	guihandler->RunCustomCommands(cmds, false);
+}
+
+void CDemoAnalysis::DbgTimingInfo(DbgTimingInfoType type, const spring_time start, const spring_time end)
+{
+	if (type != TIMING_SIM)
+		return;
+
+	FrameInfo info;
+	info.frameNum = gs->frameNum;
+	info.simTime = (end - start).toMilliSecsf();
+#ifdef SYNCCHECK
+	info.checksum = CSyncChecker::GetChecksum();
+#else
+	info.checksum = 0;
+#endif
+
+	frames.push_back(info);
+}
+
+void CDemoAnalysis::Update()
+{
+	if (finished)
+		return;
+
+	// the server drops its reader after sending the last demo packet,
+	// the demo is done once we have simulated all frames it contained
+	if (gameServer == NULL || gameServer->GetDemoReader())
+		return;
+	if (game->GetNumQueuedSimFrameMessages(1) > 0)
+		return;
+
+	finished = true;
+
+	Write();
+	gu->globalQuit = true;
+}
+
+void CDemoAnalysis::Write() const
+{
+	FILE* file = fopen(outputFile.c_str(), "w");
+
+	if (file == NULL) {
+		LOG_L(L_ERROR, "[DemoAnalysis::%s] can not write to %s", __FUNCTION__, outputFile.c_str());
+		return;
+	}
+
+	fprintf(file, "# frame FRAME SIM_MSECS SYNC_CHECKSUM\n");
+	fprintf(file, "# teamstat TEAM FRAME metalUsed energyUsed metalProduced energyProduced metalExcess energyExcess metalReceived energyReceived metalSent energySent damageDealt damageReceived unitsProduced unitsDied unitsReceived unitsSent unitsCaptured unitsOutCaptured unitsKilled\n");
+
+	for (const FrameInfo& info: frames) {
+		fprintf(file, "frame %d %.4f %08x\n", info.frameNum, info.simTime, info.checksum);
+	}
+
+	for (int teamNum = 0; teamNum < teamHandler->ActiveTeams(); ++teamNum) {
+		for (const TeamStatistics& stats: teamHandler->Team(teamNum)->statHistory) {
+			fprintf(file, "teamstat %d %d %f %f %f %f %f %f %f %f %f %f %f %f %d %d %d %d %d %d %d\n",
+				teamNum, stats.frame,
+				stats.metalUsed, stats.energyUsed, stats.metalProduced, stats.energyProduced,
+				stats.metalExcess, stats.energyExcess, stats.metalReceived, stats.energyReceived,
+				stats.metalSent, stats.energySent, stats.damageDealt, stats.damageReceived,
+				stats.unitsProduced, stats.unitsDied, stats.unitsReceived, stats.unitsSent,
+				stats.unitsCaptured, stats.unitsOutCaptured, stats.unitsKilled);
+		}
+	}
+
+	fclose(file);
+
+	LOG("[DemoAnalysis::%s] wrote %u frames to %s", __FUNCTION__, unsigned(frames.size()), outputFile.c_str());
+}
+
+
+
+int CDemoAnalysis::RunBatch(const std::string& listFile, unsigned int numJobs, const std::vector<std::string>& childArgs)
+{
+	const std::string origCWD = Platform::GetOrigCWD();
+	const std::string outDir = origCWD + "demo-batch/";
+
+	std::vector<std::string> demos;
+	std::ifstream list(listFile.c_str());
+	std::string line;
+
+	while (std::getline(list, line)) {
+		line = StringStrip(line, " \t\r\n");
+
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		demos.push_back(FileSystemAbstraction::IsAbsolutePath(line)? line: (origCWD + line));
+	}
+
+	if (demos.empty()) {
+		LOG_L(L_ERROR, "[DemoAnalysis::%s] no demos listed in \"%s\"", __FUNCTION__, listFile.c_str());
+		return EXIT_FAILURE;
+	}
+	if (!FileSystem::CreateDirectory(outDir)) {
+		LOG_L(L_ERROR, "[DemoAnalysis::%s] can not create %s", __FUNCTION__, outDir.c_str());
+		return EXIT_FAILURE;
+	}
+
+	struct Result {
+		int exitCode;
+		float wallTime;
+	};
+
+	const std::string binary = Platform::GetProcessExecutableFile();
+
+	std::vector<Result> results(demos.size());
+	boost::mutex demosMutex;
+	size_t nextDemo = 0;
+
+	numJobs = std::max(1u, std::min(numJobs, unsigned(demos.size())));
+
+	LOG("[DemoAnalysis::%s] analysing %u demos, %u at once", __FUNCTION__, unsigned(demos.size()), numJobs);
+
+	// one scheduler thread per concurrent child, each with its own write-dir
+	const auto RunDemos = [&](unsigned int slot) {
+		const std::string writeDir = outDir + "slot" + IntToString(slot);
+
+		FileSystem::CreateDirectory(writeDir);
+
+		while (true) {
+			size_t n = 0;
+
+			{
+				boost::mutex::scoped_lock lock(demosMutex);
+
+				if ((n = nextDemo++) >= demos.size())
+					break;
+			}
+
+			std::vector<std::string> args(childArgs);
+			args.push_back("--write-dir");
+			args.push_back(writeDir);
+			args.push_back("--demo-analysis");
+			args.push_back(outDir + IntToString(n) + ".txt");
+			args.push_back(demos[n]);
+
+			const spring_time startTime = spring_gettime();
+			const intptr_t process = Platform::SpawnProcess(binary, args);
+
+			results[n].exitCode = (process == -1)? -1: Platform::WaitForProcess(process);
+			results[n].wallTime = (spring_gettime() - startTime).toSecsf();
+
+			LOG("[DemoAnalysis] %s: exit code %d after %.1fs", demos[n].c_str(), results[n].exitCode, results[n].wallTime);
+		}
+	};
+
+	boost::thread_group schedulers;
+
+	for (unsigned int slot = 0; slot < numJobs; ++slot) {
+		schedulers.create_thread([&RunDemos, slot]() { RunDemos(slot); });
+	}
+
+	schedulers.join_all();
+
+	FILE* file = fopen((outDir + "results.txt").c_str(), "w");
+	int numFailed = 0;
+
+	if (file != NULL)
+		fprintf(file, "# INDEX EXIT_CODE WALL_SECS ANALYSIS DEMO\n");
+
+	for (size_t n = 0; n < demos.size(); ++n) {
+		const std::string analysisFile = outDir + IntToString(n) + ".txt";
+		const bool failed = (results[n].exitCode != 0 || !FileSystem::FileExists(analysisFile));
+
+		numFailed += failed;
+
+		if (file != NULL)
+			fprintf(file, "%u %d %.1f %s %s\n", unsigned(n), results[n].exitCode, results[n].wallTime, (failed? "-": analysisFile.c_str()), demos[n].c_str());
+	}
+
+	if (file != NULL)
+		fclose(file);
+
+	LOG("[DemoAnalysis::%s] %d of %u demos failed, see %sresults.txt", __FUNCTION__, numFailed, unsigned(demos.size()), outDir.c_str());
+
+	return ((numFailed == 0)? EXIT_SUCCESS: EXIT_FAILURE);
+}
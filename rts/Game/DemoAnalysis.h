@@ -0,0 +1,73 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _DEMO_ANALYSIS_H_
+#define _DEMO_ANALYSIS_H_
+
+#include <string>
+#include <vector>
+
+#include "System/EventHandler.h"
+
+
+/**
+ * @brief replays a demo as fast as possible and records how it simulated
+ *
+ * Once the demo has ended, per-frame sim timings, sync checksums and the
+ * team statistics are written to outputFile and the engine quits. Each line
+ * of the file is one record:
+ *
+ *   frame <frame> <sim msecs> <sync checksum>
+ *   teamstat <team> <TeamStatistics fields, in declaration order>
+ */
+class CDemoAnalysis : public CEventClient
+{
+public:
+	/// where to write the analysis, empty if disabled
+	static std::string outputFile;
+
+	/**
+	 * @brief analyse each demo listed in <listFile> (one path per line) in
+	 *   a child process of this binary, running <numJobs> of them at once
+	 * Everything goes to demo-batch/ in the current directory: the analysis
+	 * of demo <n> to <n>.txt, an overview to results.txt; each concurrent
+	 * child has its own write-dir there.
+	 * @param childArgs passed on to each child
+	 * @return EXIT_SUCCESS if all demos were analysed
+	 */
+	static int RunBatch(const std::string& listFile, unsigned int numJobs, const std::vector<std::string>& childArgs);
+
+public:
+	CDemoAnalysis();
+	~CDemoAnalysis();
+
+	void ResetState() {
+		frames.clear();
+		finished = false;
+	}
+
+	// CEventClient interface
+	bool WantsEvent(const std::string& eventName) {
+		return (eventName == "GameFrame") || (eventName == "Update") || (eventName == "DbgTimingInfo");
+	}
+	bool GetFullRead() const { return true; }
+	int  GetReadAllyTeam() const { return AllAccessTeam; }
+
+	void GameFrame(int gameFrame);
+	void Update();
+	void DbgTimingInfo(DbgTimingInfoType type, const spring_time start, const spring_time end);
+
+private:
+	void Write() const;
+
+private:
+	struct FrameInfo {
+		int frameNum;
+		float simTime;
+		unsigned int checksum;
+	};
+
+	std::vector<FrameInfo> frames;
+	bool finished;
+};
+
+#endif // _DEMO_ANALYSIS_H_
@@ -9,12 +9,14 @@
 #include <fstream>
 #include <stdexcept>
 #include <functional> // C++11
+#include <atomic>
 
 #include <SDL_keyboard.h>
 
 #include "Game.h"
 #include "GameJobDispatcher.h"
 #include "Benchmark.h"
+#include "DemoAnalysis.h"
 #include "Camera.h"
 #include "CameraHandler.h"
 #include "ChatMessage.h"
@@ -24,6 +26,7 @@
 #include "GameVersion.h"
 #include "GameSetup.h"
 #include "GlobalUnsynced.h"
+#include "LoadPipeline.h"
 #include "LoadScreen.h"
 #include "SelectedUnitsHandler.h"
 #include "WaitCommandsAI.h"
@@ -145,6 +148,7 @@
 #include "System/FileSystem/FileSystem.h"
 #include "System/FileSystem/VFSHandler.h"
 #include "System/LoadSave/LoadSaveHandler.h"
+#include "System/LoadSave/CregLoadSaveHandler.h"
 #include "System/LoadSave/DemoRecorder.h"
 #include "System/Log/ILog.h"
 #include "System/Net/PackPacket.h"
@@ -155,6 +159,7 @@
 #include "System/Sync/DumpState.h"
 #include "System/Sync/SyncedPrimitiveIO.h"
 #include "System/Sync/SyncTracer.h"
+#include "System/ThreadPool.h"
 #include "System/TimeProfiler.h"
 
 #include <boost/cstdint.hpp>
@@ -171,6 +176,7 @@ CONFIG(int, ShowPlayerInfo).defaultValue(1).headlessValue(0);
 CONFIG(float, GuiOpacity).defaultValue(0.8f).minimumValue(0.0f).maximumValue(1.0f).description("Sets the opacity of the built-in Spring UI. Generally has no effect on LuaUI widgets. Can be set in-game using shift+, to decrease and shift+. to increase.");
 CONFIG(std::string, InputTextGeo).defaultValue("");
 CONFIG(bool, LuaModUICtrl).defaultValue(true).headlessValue(false);
+CONFIG(bool, SyncSectionChecksums).defaultValue(false).description("Also sends the checksums of the sim frame phases (units, projectiles, ...) to the server, so it can tell which one desynced. Costs ~900 bytes/s of upload.");
 
 
 CGame* game = NULL;
@@ -207,6 +213,7 @@ CR_REG_METADATA(CGame, (
 	CR_IGNORED(curKeyChain),
 	CR_IGNORED(playerTraffic),
 	CR_MEMBER(noSpectatorChat),
+	CR_IGNORED(sendSyncSections),
 	CR_MEMBER(gameID),
 	//CR_MEMBER(infoConsole),
 	//CR_MEMBER(consoleHistory),
@@ -270,6 +277,7 @@ CGame::CGame(const std::string& mapName, const std::string& modName, ILoadSaveHa
 	, playing(false)
 	, chatting(false)
 	, noSpectatorChat(false)
+	, sendSyncSections(false)
 	, msgProcTimeLeft(0.0f)
 	, consumeSpeedMult(1.0f)
 	, skipStartFrame(0)
@@ -305,6 +313,8 @@ CGame::CGame(const std::string& mapName, const std::string& modName, ILoadSaveHa
 	showClock = configHandler->GetBool("ShowClock");
 	showSpeed = configHandler->GetBool("ShowSpeed");
 
+	sendSyncSections = configHandler->GetBool("SyncSectionChecksums");
+
 	speedControl = configHandler->GetInt("SpeedControl");
 
 	playerRoster.SetSortTypeByCode((PlayerRoster::SortType)configHandler->GetInt("ShowPlayerInfo"));
@@ -415,12 +425,23 @@ void CGame::LoadGame(const std::string& mapName, bool threaded)
 	Threading::SetGameLoadThread();
 	Watchdog::RegisterThread(WDT_LOAD);
 
-	if (!gu->globalQuit) LoadMap(mapName);
-	if (!gu->globalQuit) LoadDefs();
-	if (!gu->globalQuit) PreLoadSimulation();
-	if (!gu->globalQuit) PreLoadRendering();
-	if (!gu->globalQuit) PostLoadSimulation();
-	if (!gu->globalQuit) PostLoadRendering();
+	{
+		// the defs are parsed while the map loads, GL and synced code stay on this thread
+		CLoadPipeline pipeline;
+		const auto stage = [](const CLoadPipeline::StageFunc& f) {
+			return [f]() { if (!gu->globalQuit) f(); };
+		};
+
+		pipeline.AddStage("Map", stage([&]() { LoadMap(mapName); }), {}, true);
+		pipeline.AddStage("GameData Definitions", stage([this]() { LoadDefs(); }), {}, false);
+		pipeline.AddStage("Sound Definitions", stage([this]() { LoadSoundDefs(); }), {}, false);
+		pipeline.AddStage("Rendering", stage([this]() { PreLoadRendering(); }), {"Map"}, true);
+		// unit and weapon defs look up their sounds by name (CommonDefHandler::LoadSoundFile)
+		pipeline.AddStage("Simulation", stage([this]() { PreLoadSimulation(); PostLoadSimulation(); }), {"Map", "GameData Definitions", "Sound Definitions", "Rendering"}, true);
+		pipeline.AddStage("World Drawer", stage([this]() { PostLoadRendering(); }), {"Simulation"}, true);
+		pipeline.Run();
+	}
+
 	if (!gu->globalQuit) LoadInterface();
 	if (!gu->globalQuit) LoadLua();
 	if (!gu->globalQuit) LoadFinalize();
@@ -458,60 +479,53 @@ void CGame::LoadMap(const std::string& mapName)
 
 void CGame::LoadDefs()
 {
-	ENTER_SYNCED_CODE();
-
-	{
-		loadscreen->SetLoadMessage("Loading Radar Icons");
-		icon::iconHandler = new icon::CIconHandler();
-	}
+	// runs on the thread pool (see LoadGame), so no GL and no synced code here
 
-	{
-		ScopedOnceTimer timer("Game::LoadDefs (GameData)");
-		loadscreen->SetLoadMessage("Loading GameData Definitions");
-
-		defsParser = new LuaParser("gamedata/defs.lua", SPRING_VFS_MOD_BASE, SPRING_VFS_ZIP);
-		// customize the defs environment
-		defsParser->GetTable("Spring");
-		defsParser->AddFunc("GetModOptions", LuaSyncedRead::GetModOptions);
-		defsParser->AddFunc("GetMapOptions", LuaSyncedRead::GetMapOptions);
-		defsParser->EndTable();
-
-		// run the parser
-		if (!defsParser->Execute()) {
-			throw content_error("Defs-Parser: " + defsParser->GetErrorLog());
-		}
-		const LuaTable root = defsParser->GetRoot();
-		if (!root.IsValid()) {
-			throw content_error("Error loading gamedata definitions");
-		}
-		// bail now if any of these tables in invalid
-		// (makes searching for errors that much easier
-		if (!root.SubTable("UnitDefs").IsValid()) {
-			throw content_error("Error loading UnitDefs");
-		}
-		if (!root.SubTable("FeatureDefs").IsValid()) {
-			throw content_error("Error loading FeatureDefs");
-		}
-		if (!root.SubTable("WeaponDefs").IsValid()) {
-			throw content_error("Error loading WeaponDefs");
-		}
-		if (!root.SubTable("ArmorDefs").IsValid()) {
-			throw content_error("Error loading ArmorDefs");
-		}
-		if (!root.SubTable("MoveDefs").IsValid()) {
-			throw content_error("Error loading MoveDefs");
-		}
-	}
+	// defs.lua reads all of these, decode them up-front in parallel
+	vfsHandler->PrefetchDir("gamedata/");
+	vfsHandler->PrefetchDir("units/");
+	vfsHandler->PrefetchDir("weapons/");
+	vfsHandler->PrefetchDir("features/");
 
-	{
-		ScopedOnceTimer timer("Game::LoadDefs (Sound)");
-		loadscreen->SetLoadMessage("Loading Sound Definitions");
+	defsParser = new LuaParser("gamedata/defs.lua", SPRING_VFS_MOD_BASE, SPRING_VFS_ZIP);
+	// customize the defs environment
+	defsParser->GetTable("Spring");
+	defsParser->AddFunc("GetModOptions", LuaSyncedRead::GetModOptions);
+	defsParser->AddFunc("GetMapOptions", LuaSyncedRead::GetMapOptions);
+	defsParser->EndTable();
 
-		sound->LoadSoundDefs("gamedata/sounds.lua");
-		chatSound = sound->GetSoundId("IncomingChat");
+	// run the parser
+	if (!defsParser->Execute()) {
+		throw content_error("Defs-Parser: " + defsParser->GetErrorLog());
 	}
+	const LuaTable root = defsParser->GetRoot();
+	if (!root.IsValid()) {
+		throw content_error("Error loading gamedata definitions");
+	}
+	// bail now if any of these tables in invalid
+	// (makes searching for errors that much easier
+	if (!root.SubTable("UnitDefs").IsValid()) {
+		throw content_error("Error loading UnitDefs");
+	}
+	if (!root.SubTable("FeatureDefs").IsValid()) {
+		throw content_error("Error loading FeatureDefs");
+	}
+	if (!root.SubTable("WeaponDefs").IsValid()) {
+		throw content_error("Error loading WeaponDefs");
+	}
+	if (!root.SubTable("ArmorDefs").IsValid()) {
+		throw content_error("Error loading ArmorDefs");
+	}
+	if (!root.SubTable("MoveDefs").IsValid()) {
+		throw content_error("Error loading MoveDefs");
+	}
+}
 
-	LEAVE_SYNCED_CODE();
+void CGame::LoadSoundDefs()
+{
+	// runs on the thread pool, see LoadGame
+	sound->LoadSoundDefs("gamedata/sounds.lua");
+	chatSound = sound->GetSoundId("IncomingChat");
 }
 
 void CGame::PreLoadSimulation()
@@ -585,6 +599,9 @@ void CGame::PostLoadSimulation()
 
 void CGame::PreLoadRendering()
 {
+	loadscreen->SetLoadMessage("Loading Radar Icons");
+	icon::iconHandler = new icon::CIconHandler();
+
 	geometricObjects = new CGeometricObjects();
 
 	//! these need to be loaded before featureHandler
@@ -699,17 +716,24 @@ void CGame::LoadLua()
 {
 	// Lua components
 	ENTER_SYNCED_CODE();
-	loadscreen->SetLoadMessage("Loading LuaRules");
-	CLuaRules::LoadHandler();
+	{
+		ScopedOnceTimer timer("Game::LoadLua (LuaRules)");
+		loadscreen->SetLoadMessage("Loading LuaRules");
+		CLuaRules::LoadHandler();
+	}
 
 	if (gs->useLuaGaia) {
+		ScopedOnceTimer timer("Game::LoadLua (LuaGaia)");
 		loadscreen->SetLoadMessage("Loading LuaGaia");
 		CLuaGaia::LoadHandler();
 	}
 	LEAVE_SYNCED_CODE();
 
-	loadscreen->SetLoadMessage("Loading LuaUI");
-	CLuaUI::LoadHandler();
+	{
+		ScopedOnceTimer timer("Game::LoadLua (LuaUI)");
+		loadscreen->SetLoadMessage("Loading LuaUI");
+		CLuaUI::LoadHandler();
+	}
 
 	// last in, first served
 	luaInputReceiver = new LuaInputReceiver();
@@ -764,6 +788,12 @@ void CGame::LoadFinalize()
 		benchmark.ResetState();
 	}
 
+	if (!CDemoAnalysis::outputFile.empty()) {
+		static CDemoAnalysis demoAnalysis;
+
+		demoAnalysis.ResetState();
+	}
+
 	lastReadNetTime = spring_gettime();
 	lastSimFrameTime = lastReadNetTime;
 	lastDrawFrameTime = lastReadNetTime;
@@ -871,7 +901,7 @@ void CGame::KillSimulation()
 		teamHandler->Team(t)->Died(false);
 	}
 
-	LOG("[%s][2]", __FUNCTION__);
+	LOG("[%s][2] command-queue reallocations: %u, command-param allocations: %u", __FUNCTION__, CCommandQueue::GetNumReallocs(), CommandParams::GetNumHeapAllocs());
 	SafeDelete(featureHandler); // depends on unitHandler (via ~CFeature)
 	SafeDelete(unitHandler); // depends on modelParser (via ~CUnit)
 	SafeDelete(projectileHandler);
@@ -1010,6 +1040,7 @@ bool CGame::Update()
 
 	jobDispatcher->Update();
 	clientNet->Update();
+	UpdateStateSnapshot();
 
 	// When video recording do step by step simulation, so each simframe gets a corresponding videoframe
 	// FIXME: SERVER ALREADY DOES THIS BY ITSELF
@@ -1568,19 +1599,38 @@ void CGame::SimFrame() {
 	// everything from here is simulation
 	{
 		SCOPED_TIMER("EventHandler::GameFrame");
+		SCOPED_SYNC_SECTION(SECTION_LUA);
 		eventHandler.GameFrame(gs->frameNum);
 	}
 	SCOPED_TIMER("SimFrame");
 	helper->Update();
 	mapDamage->Update();
-	pathManager->Update();
-	unitHandler->Update();
-	projectileHandler->Update();
-	featureHandler->Update();
-	GCobEngine.Tick(33);
-	GUnitScriptEngine.Tick(33);
+	{
+		SCOPED_SYNC_SECTION(SECTION_PATHING);
+		pathManager->Update();
+	}
+	{
+		SCOPED_SYNC_SECTION(SECTION_UNITS);
+		unitHandler->Update();
+	}
+	{
+		SCOPED_SYNC_SECTION(SECTION_PROJECTILES);
+		projectileHandler->Update();
+	}
+	{
+		SCOPED_SYNC_SECTION(SECTION_FEATURES);
+		featureHandler->Update();
+	}
+	{
+		SCOPED_SYNC_SECTION(SECTION_UNITS);
+		GCobEngine.Tick(33);
+		GUnitScriptEngine.Tick(33);
+	}
 	wind.Update();
-	losHandler->Update();
+	{
+		SCOPED_SYNC_SECTION(SECTION_LOS);
+		losHandler->Update();
+	}
 	interceptHandler.Update(false);
 
 	teamHandler->GameFrame(gs->frameNum);
@@ -1976,6 +2026,71 @@ void CGame::SaveGame(const std::string& filename, bool overwrite)
 }
 
 
+struct CGame::StateSnapshotUpload {
+	StateSnapshotUpload(int frameNum): frameNum(frameNum), compressed(false), finished(false) {}
+
+	int frameNum;
+	std::string state;
+	std::vector<boost::uint8_t> data;
+	bool compressed;
+	std::atomic<bool> finished;
+};
+
+void CGame::SendStateSnapshot()
+{
+	// the server asks again later if this one is still being compressed
+	if (snapshotUpload)
+		return;
+
+	if (!CCregLoadSaveHandler::CanSaveSnapshot()) {
+		// an empty snapshot tells the server midgame joiners need the whole game
+		clientNet->Send(CBaseNetProtocol::Get().SendSnapshot(gu->myPlayerNum, gs->frameNum, 0, 0, std::vector<boost::uint8_t>()));
+		return;
+	}
+
+	const spring_time startTime = spring_gettime();
+	const std::shared_ptr<StateSnapshotUpload> upload(new StateSnapshotUpload(gs->frameNum));
+
+	if (!CCregLoadSaveHandler::SaveSnapshot(upload->state))
+		return;
+
+	LOG("[Game::%s] saved the state of frame %d in %.0fms", __FUNCTION__, gs->frameNum, (spring_gettime() - startTime).toMilliSecsf());
+
+	// only serializing has to happen between two sim frames, compression
+	// runs on the pool and UpdateStateSnapshot sends the result
+	snapshotUpload = upload;
+
+	ThreadPool::enqueue([upload]() {
+		upload->compressed = CCregLoadSaveHandler::CompressSnapshot(upload->state, upload->data);
+		std::string().swap(upload->state);
+		upload->finished = true;
+	});
+}
+
+void CGame::UpdateStateSnapshot()
+{
+	// keeps each message well below the 64K limit
+	static const unsigned int chunkSize = 32 * 1024;
+
+	if (!snapshotUpload || !snapshotUpload->finished)
+		return;
+
+	std::shared_ptr<StateSnapshotUpload> upload;
+	upload.swap(snapshotUpload);
+
+	if (!upload->compressed)
+		return;
+
+	const std::vector<boost::uint8_t>& data = upload->data;
+	std::vector<boost::uint8_t> chunk;
+
+	for (unsigned int offset = 0; offset < data.size(); offset += chunkSize) {
+		chunk.assign(data.begin() + offset, data.begin() + std::min<size_t>(offset + chunkSize, data.size()));
+		clientNet->Send(CBaseNetProtocol::Get().SendSnapshot(gu->myPlayerNum, upload->frameNum, data.size(), offset, chunk));
+	}
+}
+
+
 void CGame::ReloadGame()
 {
 	if (saveFile) {
@@ -5,6 +5,7 @@
 
 #include <string>
 #include <map>
+#include <memory>
 
 #include "GameController.h"
 #include "Game/UI/KeySet.h"
@@ -57,6 +58,7 @@ private:
 
 	void LoadMap(const std::string& mapName);
 	void LoadDefs();
+	void LoadSoundDefs();
 	void PreLoadSimulation();
 	void PostLoadSimulation();
 	void PreLoadRendering();
@@ -99,6 +101,10 @@ public:
 
 	void ReloadGame();
 	void SaveGame(const std::string& filename, bool overwrite);
+	/// upload a snapshot of the current game state for midgame joiners
+	void SendStateSnapshot();
+	/// send the snapshot once it is compressed
+	void UpdateStateSnapshot();
 
 	void ResizeEvent();
 	void SetupRenderingParams();
@@ -106,6 +112,8 @@ public:
 	void SetDrawMode(GameDrawMode mode) { gameDrawMode = mode; }
 	GameDrawMode GetDrawMode() const { return gameDrawMode; }
 
+	unsigned int GetNumQueuedSimFrameMessages(unsigned int maxFrames) const;
+
 private:
 	bool Draw();
 	bool UpdateUnsynced(const spring_time currentTime);
@@ -129,7 +137,6 @@ private:
 
 	void ReColorTeams();
 
-	unsigned int GetNumQueuedSimFrameMessages(unsigned int maxFrames) const;
 	float GetNetMessageProcessingTimeLimit() const;
 
 	void SendClientProcUsage();
@@ -185,6 +192,8 @@ public:
 
 	/// Prevents spectator msgs from being seen by players
 	bool noSpectatorChat;
+	/// send NETMSG_SYNCSECTIONS along with each sync checksum
+	bool sendSyncSections;
 
 	CTimedKeyChain curKeyChain;
 	std::string userInputPrefix;
@@ -223,6 +232,10 @@ private:
 	/// for reloading the savefile
 	ILoadSaveHandler* saveFile;
 
+	struct StateSnapshotUpload;
+	/// game state being compressed on the thread pool, see SendStateSnapshot
+	std::shared_ptr<StateSnapshotUpload> snapshotUpload;
+
 	volatile bool finishedLoading;
 	bool gameOver;
 };
@@ -0,0 +1,158 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "LoadPipeline.h"
+#include "LoadScreen.h"
+#include "System/Log/ILog.h"
+#include "System/ThreadPool.h"
+#include "System/Util.h"
+#include "System/Platform/Watchdog.h"
+
+#include <cassert>
+#include <utility>
+
+
+CLoadPipeline::CLoadPipeline()
+	: numFinished(0)
+	, numRunning(0)
+{
+}
+
+
+void CLoadPipeline::AddStage(const std::string& name, const StageFunc& func, const std::vector<std::string>& deps, bool onLoadThread)
+{
+	Stage stage;
+	stage.name = name;
+	stage.func = func;
+	stage.onLoadThread = onLoadThread;
+	stage.state = STAGE_WAITING;
+	stage.reported = false;
+
+	for (const std::string& dep: deps) {
+		size_t n = 0;
+
+		while (n < stages.size() && stages[n].name != dep)
+			++n;
+
+		// stages can only depend on earlier ones, so there are no cycles
+		assert(n < stages.size());
+		stage.deps.push_back(n);
+	}
+
+	stages.push_back(stage);
+}
+
+
+bool CLoadPipeline::IsReady(const Stage& stage) const
+{
+	for (const size_t dep: stage.deps) {
+		if (stages[dep].state != STAGE_FINISHED)
+			return false;
+	}
+
+	return true;
+}
+
+
+void CLoadPipeline::RunStage(Stage& stage)
+{
+	const spring_time startTime = spring_gettime();
+	std::exception_ptr stageException;
+
+	try {
+		stage.func();
+	} catch (...) {
+		stageException = std::current_exception();
+	}
+
+	boost::mutex::scoped_lock lck(mutex);
+
+	stage.duration = spring_gettime() - startTime;
+	stage.state = STAGE_FINISHED;
+
+	// drop this thread's reference while locked, Run rethrows it once we unlock
+	if (stageException && !exception)
+		std::swap(exception, stageException);
+
+	stageException = std::exception_ptr();
+
+	numFinished++;
+	numRunning--;
+	stageFinished.notify_all();
+}
+
+
+void CLoadPipeline::Run()
+{
+	for (;;) {
+		std::vector<Stage*> finished;
+		std::vector<Stage*> started;
+		Stage* next = NULL;
+
+		{
+			boost::unique_lock<boost::mutex> lck(mutex);
+
+			for (Stage& stage: stages) {
+				if (stage.state == STAGE_FINISHED && !stage.reported) {
+					stage.reported = true;
+					finished.push_back(&stage);
+					continue;
+				}
+
+				if (stage.state != STAGE_WAITING || exception || !IsReady(stage))
+					continue;
+
+				if (stage.onLoadThread) {
+					if (next == NULL)
+						next = &stage;
+
+					continue;
+				}
+
+				stage.state = STAGE_RUNNING;
+				numRunning++;
+				started.push_back(&stage);
+			}
+
+			if (next != NULL) {
+				next->state = STAGE_RUNNING;
+				numRunning++;
+			}
+
+			if (finished.empty() && started.empty() && next == NULL) {
+				if (numRunning == 0)
+					break;
+
+				// only stages on the thread pool left, wait for one of them;
+				// pool threads are not watched, so keep our own timer alive
+				// for as long as they take
+				Watchdog::ClearTimer(WDT_LOAD);
+
+			#ifndef BOOST_THREAD_USES_CHRONO
+				stageFinished.timed_wait(lck, boost::get_system_time() + boost::posix_time::seconds(1));
+			#else
+				stageFinished.wait_for(lck, boost::chrono::seconds(1));
+			#endif
+				continue;
+			}
+		}
+
+		// the loading screen is only updated from this thread
+		for (const Stage* stage: finished) {
+			loadscreen->SetLoadMessage(stage->name + ": " + IntToString(stage->duration.toMilliSecsi()) + " ms");
+		}
+
+		for (Stage* stage: started) {
+			loadscreen->SetLoadMessage("Loading " + stage->name);
+			ThreadPool::enqueue([this, stage]() { RunStage(*stage); });
+		}
+
+		if (next != NULL) {
+			RunStage(*next);
+		}
+	}
+
+	if (exception)
+		std::rethrow_exception(exception);
+
+	assert(numFinished == stages.size());
+}
@@ -0,0 +1,77 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _LOAD_PIPELINE_H_
+#define _LOAD_PIPELINE_H_
+
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "System/Misc/SpringTime.h"
+
+/**
+ * @brief runs the stages of loading a game, independent ones concurrently
+ *
+ * A stage starts once all stages it depends on have finished. Stages that
+ * touch GL (or anything else bound to the loading thread) run on the thread
+ * calling Run, which owns the offscreen GL context when loading threaded;
+ * the others go to the thread pool and must not use GL nor synced code.
+ * The duration of each stage is shown on the loading screen.
+ */
+class CLoadPipeline
+{
+public:
+	typedef std::function<void()> StageFunc;
+
+	CLoadPipeline();
+
+	/**
+	 * @param deps names of previously added stages that have to finish first
+	 * @param onLoadThread whether the stage has to run on the loading thread
+	 */
+	void AddStage(const std::string& name, const StageFunc& func, const std::vector<std::string>& deps, bool onLoadThread);
+
+	/**
+	 * Runs all stages. If a stage throws, no more stages are started and
+	 * the exception is rethrown once the running ones have finished.
+	 */
+	void Run();
+
+private:
+	enum StageState {
+		STAGE_WAITING,
+		STAGE_RUNNING,
+		STAGE_FINISHED,
+	};
+
+	struct Stage {
+		std::string name;
+		StageFunc func;
+		std::vector<size_t> deps;
+		bool onLoadThread;
+
+		/// guarded by mutex
+		StageState state;
+		bool reported;
+		spring_time duration;
+	};
+
+	bool IsReady(const Stage& stage) const;
+	void RunStage(Stage& stage);
+
+private:
+	std::vector<Stage> stages;
+
+	boost::mutex mutex;
+	/// signaled whenever a stage finished
+	boost::condition_variable stageFinished;
+
+	size_t numFinished;
+	size_t numRunning;
+	std::exception_ptr exception;
+};
+
+#endif // _LOAD_PIPELINE_H_
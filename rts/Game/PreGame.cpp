@@ -40,6 +40,7 @@
 #include "System/LoadSave/DemoRecorder.h"
 #include "System/LoadSave/DemoReader.h"
 #include "System/LoadSave/LoadSaveHandler.h"
+#include "System/LoadSave/CregLoadSaveHandler.h"
 #include "System/Log/ILog.h"
 #include "System/Net/RawPacket.h"
 #include "System/Net/UnpackPacket.h"
@@ -61,6 +62,7 @@ CPreGame* pregame = NULL;
 CPreGame::CPreGame(boost::shared_ptr<ClientSetup> setup)
 	: clientSetup(setup)
 	, savefile(NULL)
+	, snapshotSize(0)
 	, timer(spring_gettime())
 	, wantDemo(true)
 {
@@ -319,6 +321,13 @@ void CPreGame::UpdateClientNet()
 				break;
 			}
 
+			case NETMSG_SNAPSHOT: {
+				// server sends this between gamedata and our player number
+				// if we join midgame, packets before it will not be resent
+				SnapshotReceived(packet);
+				break;
+			}
+
 			case NETMSG_SETPLAYERNUM: {
 				// this is sent after NETMSG_GAMEDATA, to let us know which
 				// player number we have (server assigns them based on order
@@ -335,6 +344,19 @@ void CPreGame::UpdateClientNet()
 
 				LOG("[PreGame::%s] user number %i (team %i, allyteam %i)", __FUNCTION__, gu->myPlayerNum, gu->myTeam, gu->myAllyTeam);
 
+				if (!snapshot.empty()) {
+					CCregLoadSaveHandler* snapshotLoader = new CCregLoadSaveHandler();
+
+					if (snapshot.size() != snapshotSize || !snapshotLoader->LoadSnapshotStartInfo(snapshot)) {
+						delete snapshotLoader;
+						throw content_error("Received an invalid game state snapshot from server");
+					}
+
+					assert(savefile == NULL);
+					savefile = snapshotLoader;
+					snapshot.clear();
+				}
+
 				CLoadScreen::CreateInstance(gameSetup->MapFile(), modArchive, savefile);
 
 				pregame = NULL;
@@ -351,6 +373,34 @@ void CPreGame::UpdateClientNet()
 }
 
 
+void CPreGame::SnapshotReceived(boost::shared_ptr<const netcode::RawPacket> packet)
+{
+	try {
+		netcode::UnpackPacket pckt(packet, 1);
+
+		boost::uint16_t msgSize; pckt >> msgSize;
+		unsigned char playerNum; pckt >> playerNum;
+		int frameNum; pckt >> frameNum;
+		unsigned int totalSize; pckt >> totalSize;
+		unsigned int offset; pckt >> offset;
+
+		if (offset != snapshot.size() || msgSize <= 16)
+			throw netcode::UnpackPacketException("unexpected snapshot piece");
+
+		std::vector<boost::uint8_t> data(msgSize - 16);
+		pckt >> data;
+
+		snapshot.insert(snapshot.end(), data.begin(), data.end());
+		snapshotSize = totalSize;
+
+		if (snapshot.size() == snapshotSize)
+			LOG("[PreGame::%s] received the game state of frame %d (%u bytes)", __FUNCTION__, frameNum, snapshotSize);
+	} catch (const netcode::UnpackPacketException& ex) {
+		LOG_L(L_ERROR, "[PreGame::%s] got invalid NETMSG_SNAPSHOT: %s", __FUNCTION__, ex.what());
+	}
+}
+
+
 void CPreGame::StartServerForDemo(const std::string& demoName)
 {
 	TdfParser script((gameData->GetSetupText()).c_str(), (gameData->GetSetupText()).size());
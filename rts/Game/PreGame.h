@@ -4,7 +4,9 @@
 #define PREGAME_H
 
 #include <string>
+#include <vector>
 #include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
 
 #include "GameController.h"
 #include "System/Misc/SpringTime.h"
@@ -60,6 +62,7 @@ private:
 	void UpdateClientNet();
 
 	void GameDataReceived(boost::shared_ptr<const netcode::RawPacket> packet);
+	void SnapshotReceived(boost::shared_ptr<const netcode::RawPacket> packet);
 
 	/**
 	@brief GameData we received from server
@@ -72,6 +75,10 @@ private:
 	std::string modArchive;
 	ILoadSaveHandler* savefile;
 
+	/// game state to continue from when joining midgame, see NETMSG_SNAPSHOT
+	std::vector<boost::uint8_t> snapshot;
+	unsigned int snapshotSize;
+
 	spring_time timer;
 	bool wantDemo;
 };
@@ -931,7 +931,7 @@ void CSelectedUnitsHandler::SendCommand(const Command& c)
 		selectionChanged = false;
 	}
 
-	clientNet->Send(CBaseNetProtocol::Get().SendCommand(gu->myPlayerNum, c.GetID(), c.options, c.params));
+	clientNet->Send(CBaseNetProtocol::Get().SendCommand(gu->myPlayerNum, c.GetID(), c.options, c.params.data(), c.params.size()));
 }
 
 
@@ -1005,7 +1005,7 @@ void CSelectedUnitsHandler::SendCommandsToUnits(const std::vector<int>& unitIDs,
 			*packet << cmd.options;
 		if (sameCmdParamSize == 0xFFFF)
 			*packet << static_cast<unsigned short>(cmd.params.size());
-		*packet << cmd.params;
+		packet->WriteArray(cmd.params.data(), cmd.params.size());
 	}
 
 	clientNet->Send(boost::shared_ptr<netcode::RawPacket>(packet));
@@ -25,7 +25,12 @@
 #include "System/ScopedFPUSettings.h"
 #include "System/Util.h"
 
-LuaParser* LuaParser::currentParser = NULL;
+// per thread, parsers may run concurrently while loading
+#if defined(_MSC_VER)
+static __declspec(thread) LuaParser* currentParser = NULL;
+#else
+static __thread LuaParser* currentParser = NULL;
+#endif
 
 
 /******************************************************************************/
@@ -203,9 +203,6 @@ class LuaParser {
 		static int Include(lua_State* L);
 		static int LoadFile(lua_State* L);
 		static int FileExists(lua_State* L);
-
-	private:
-		static LuaParser* currentParser;
 };
 
 
@@ -60,6 +60,7 @@ bool LuaPathFinder::PushEntries(lua_State* L)
 	REGISTER_LUA_CFUNC(GetPathNodeCosts);
 	REGISTER_LUA_CFUNC(SetPathNodeCost);
 	REGISTER_LUA_CFUNC(GetPathNodeCost);
+	REGISTER_LUA_CFUNC(GetPathQueuedUpdates);
 
 	return true;
 }
@@ -372,5 +373,16 @@ int LuaPathFinder::GetPathNodeCost(lua_State* L)
 	return 1;
 }
 
+
+int LuaPathFinder::GetPathQueuedUpdates(lua_State* L)
+{
+	// default PFS: {med, low}-res estimator blocks awaiting re-estimation
+	const int2 numUpdates = pathManager->GetNumQueuedUpdates();
+
+	lua_pushnumber(L, numUpdates.x);
+	lua_pushnumber(L, numUpdates.y);
+	return 2;
+}
+
 /******************************************************************************/
 /******************************************************************************/
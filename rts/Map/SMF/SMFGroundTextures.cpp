@@ -164,6 +164,10 @@ void CSMFGroundTextures::LoadTiles(CSMFMapFile& file)
 void CSMFGroundTextures::LoadSquareTextures(const int mipLevel)
 {
 	loadscreen->SetLoadMessage("Loading Square Textures");
+	ScopedOnceTimer timer("CSMFGroundTextures::LoadSquareTextures");
+
+	std::vector<SquareLoad> loads;
+	loads.reserve(squares.size());
 
 	for (int y = 0; y < smfMap->numBigTexY; ++y) {
 		for (int x = 0; x < smfMap->numBigTexX; ++x) {
@@ -174,9 +178,12 @@ void CSMFGroundTextures::LoadSquareTextures(const int mipLevel)
 			square->luaTexture     = false;
 
 			// start at the lowest mip-level
-			LoadSquareTexture(x, y, mipLevel);
+			const SquareLoad load = {x, y, mipLevel};
+			loads.push_back(load);
 		}
 	}
+
+	LoadSquareTextures(loads);
 }
 
 void CSMFGroundTextures::ConvolveHeightMap(const int mapWidth, const int mipLevel)
@@ -197,7 +204,8 @@ void CSMFGroundTextures::ConvolveHeightMap(const int mapWidth, const int mipLeve
 	heightMinima.resize(nb, readMap->GetCurrMaxHeight());
 	stretchFactors.resize(nb, 0.0f);
 
-	for (int y = 0; y < nby; ++y) {
+	// squares are independent
+	for_mt(0, nby, [&](const int y) {
 		for (int x = 0; x < nbx; ++x) {
 
 			// NOTE: we leave out the borders on sampling because it is easier to do the Sobel kernel convolution
@@ -240,7 +248,7 @@ void CSMFGroundTextures::ConvolveHeightMap(const int mapWidth, const int mipLeve
 
 			stretchFactors[y * nbx + x] += 1.0f;
 		}
-	}
+	});
 }
 
 #if defined(USE_LIBSQUISH) && !defined(HEADLESS) && defined(GLEW_ARB_ES3_compatibility)
@@ -299,6 +307,9 @@ void CSMFGroundTextures::DrawUpdate()
 	const float vsySq = globalRendering->viewSizeY * globalRendering->viewSizeY;
 	const float vdiag = fastmath::apxsqrt(vsxSq + vsySq);
 
+	// squares to (re)load, uploaded together at the end
+	std::vector<SquareLoad> loads;
+
 	for (int y = 0; y < smfMap->numBigTexY; ++y) {
 		float dz = cam2->GetPos().z - (y * smfMap->bigSquareSize * SQUARE_SIZE);
 		dz -= (SQUARE_SIZE << 6);
@@ -317,7 +328,9 @@ void CSMFGroundTextures::DrawUpdate()
 					// `unload` texture (load lowest mip-map) if
 					// the square wasn't visible for 120 vframes
 					glDeleteTextures(1, &square->textureID);
-					LoadSquareTexture(x, y, 3);
+
+					const SquareLoad load = {x, y, 3};
+					loads.push_back(load);
 				}
 				continue;
 			}
@@ -374,10 +387,14 @@ void CSMFGroundTextures::DrawUpdate()
 
 			if (square->texLevel != wantedLevel) {
 				glDeleteTextures(1, &square->textureID);
-				LoadSquareTexture(x, y, wantedLevel);
+
+				const SquareLoad load = {x, y, wantedLevel};
+				loads.push_back(load);
 			}
 		}
 	}
+
+	LoadSquareTextures(loads);
 }
 
 
@@ -477,39 +494,62 @@ void CSMFGroundTextures::ExtractSquareTiles(
 
 void CSMFGroundTextures::LoadSquareTexture(int x, int y, int level)
 {
+	const SquareLoad load = {x, y, level};
+	LoadSquareTextures(std::vector<SquareLoad>(1, load));
+}
+
+void CSMFGroundTextures::LoadSquareTextures(const std::vector<SquareLoad>& loads)
+{
+	if (loads.empty())
+		return;
+
 	static const GLenum ttarget = GL_TEXTURE_2D;
 
-	const int mipSqSize = smfMap->bigTexSize >> level;
-	const int numSqBytes = (mipSqSize * mipSqSize) / 2;
+	// byte offsets of the squares in the PBO
+	std::vector<int> offsets(loads.size() + 1, 0);
 
-	GroundSquare* square = &squares[y * smfMap->numBigTexX + x];
-	square->texLevel = level;
+	for (size_t n = 0; n < loads.size(); n++) {
+		const int mipSqSize = smfMap->bigTexSize >> loads[n].level;
+		offsets[n + 1] = offsets[n] + (mipSqSize * mipSqSize) / 2;
+	}
 
 	pbo.Bind();
-	pbo.New(numSqBytes);
-	ExtractSquareTiles(x, y, level, (GLint*) pbo.MapBuffer());
+	pbo.New(offsets.back());
+
+	GLubyte* tileBuf = pbo.MapBuffer();
+	for_mt(0, loads.size(), [&](const int n) {
+		ExtractSquareTiles(loads[n].x, loads[n].y, loads[n].level, (GLint*) (tileBuf + offsets[n]));
+	});
 	pbo.UnmapBuffer();
 
-	glGenTextures(1, &square->textureID);
-	glBindTexture(ttarget, square->textureID);
-	glTexParameteri(ttarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(ttarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	for (size_t n = 0; n < loads.size(); n++) {
+		const int level = loads[n].level;
+		const int mipSqSize = smfMap->bigTexSize >> level;
 
-	if (GLEW_EXT_texture_edge_clamp) {
-		glTexParameteri(ttarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(ttarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	}
+		GroundSquare* square = &squares[loads[n].y * smfMap->numBigTexX + loads[n].x];
+		square->texLevel = level;
 
-	if (smfMap->GetAnisotropy() != 0.0f)
-		glTexParameterf(ttarget, GL_TEXTURE_MAX_ANISOTROPY_EXT, smfMap->GetAnisotropy());
+		glGenTextures(1, &square->textureID);
+		glBindTexture(ttarget, square->textureID);
+		glTexParameteri(ttarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(ttarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
-	if (level < 2) {
-		glTexParameteri(ttarget, GL_TEXTURE_PRIORITY, 1);
-	} else {
-		glTexParameterf(ttarget, GL_TEXTURE_PRIORITY, 0.5f);
-	}
+		if (GLEW_EXT_texture_edge_clamp) {
+			glTexParameteri(ttarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(ttarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		}
+
+		if (smfMap->GetAnisotropy() != 0.0f)
+			glTexParameterf(ttarget, GL_TEXTURE_MAX_ANISOTROPY_EXT, smfMap->GetAnisotropy());
+
+		if (level < 2) {
+			glTexParameteri(ttarget, GL_TEXTURE_PRIORITY, 1);
+		} else {
+			glTexParameterf(ttarget, GL_TEXTURE_PRIORITY, 0.5f);
+		}
 
-	glCompressedTexImage2D(ttarget, 0, tileTexFormat, mipSqSize, mipSqSize, 0, numSqBytes, pbo.GetPtr());
+		glCompressedTexImage2D(ttarget, 0, tileTexFormat, mipSqSize, mipSqSize, 0, offsets[n + 1] - offsets[n], pbo.GetPtr(offsets[n]));
+	}
 
 	pbo.Invalidate();
 	pbo.Unbind();
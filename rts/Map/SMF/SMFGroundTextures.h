@@ -21,8 +21,16 @@ public:
 	void BindSquareTexture(int texSquareX, int texSquareY);
 
 protected:
+	struct SquareLoad {
+		int x;
+		int y;
+		int level;
+	};
+
 	void LoadTiles(CSMFMapFile& file);
 	void LoadSquareTextures(const int mipLevel);
+	/// extracts the tiles of all squares in parallel, then uploads them from one PBO
+	void LoadSquareTextures(const std::vector<SquareLoad>& loads);
 	void ConvolveHeightMap(const int mapWidth, const int mipLevel);
 	bool RecompressTilesIfNeeded();
 	void ExtractSquareTiles(const int texSquareX, const int texSquareY, const int mipLevel, GLint* tileBuf) const;
@@ -131,7 +131,7 @@ const char* CSMFMapFile::GetFeatureTypeName(int typeID) const
 }
 
 
-void CSMFMapFile::GetInfoMapSize(const string& name, MapBitmapInfo* info) const
+void CSMFMapFile::GetInfoMapSize(const SMFHeader& header, const string& name, MapBitmapInfo* info)
 {
 	if (name == "height") {
 		*info = MapBitmapInfo(header.mapx + 1, header.mapy + 1);
@@ -25,7 +25,8 @@ public:
 	void ReadHeightmap(float* sHeightMap, float* uHeightMap, float base, float mod);
 	void ReadFeatureInfo();
 	void ReadFeatureInfo(MapFeatureInfo* f);
-	void GetInfoMapSize(const std::string& name, MapBitmapInfo*) const;
+	void GetInfoMapSize(const std::string& name, MapBitmapInfo* info) const { GetInfoMapSize(header, name, info); }
+	static void GetInfoMapSize(const SMFHeader& header, const std::string& name, MapBitmapInfo*);
 	bool ReadInfoMap(const std::string& name, void* data);
 
 	int GetNumFeatures()     const { return featureHeader.numFeatures; }
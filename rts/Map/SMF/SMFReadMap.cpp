@@ -19,6 +19,7 @@
 #include "System/Exceptions.h"
 #include "System/FileSystem/FileHandler.h"
 #include "System/ThreadPool.h"
+#include "System/TimeProfiler.h"
 #include "System/myMath.h"
 #include "System/Util.h"
 
@@ -32,6 +33,29 @@ CONFIG(float, SMFTexAniso).defaultValue(4.0f).minimumValue(0.0f);
 CR_BIND_DERIVED(CSMFReadMap, CReadMap, (""))
 
 
+// map textures, decoded by LoadTexBitmaps and released once uploaded
+struct CSMFReadMap::TexBitmaps {
+	enum {
+		MINIMAP,
+		SPECULAR,
+		SKY_REFLECT_MOD,
+		DETAIL_NORMAL,
+		LIGHT_EMISSION,
+		PARALLAX_HEIGHT,
+		SPLAT_DETAIL,
+		SPLAT_DISTR,
+		GRASS_SHADING,
+		DETAIL,
+		COUNT
+	};
+
+	void Release(int i) { bitmaps[i] = CBitmap(); }
+
+	CBitmap bitmaps[COUNT];
+	bool loaded[COUNT];
+};
+
+
 CSMFReadMap::CSMFReadMap(std::string mapname)
 	: CEventClient("[CSMFReadMap]", 271950, false)
 	, file(mapname)
@@ -59,15 +83,25 @@ CSMFReadMap::CSMFReadMap(std::string mapname)
 	LoadHeightMap();
 	CReadMap::Initialize();
 
-	LoadMinimap();
+	{
+		// decoded in two groups, so at most six full-size bitmaps are held at once
+		TexBitmaps texBMs;
+		LoadTexBitmaps(texBMs, TexBitmaps::MINIMAP, TexBitmaps::PARALLAX_HEIGHT);
+
+		LoadMinimap(texBMs);
 
-	ConfigureAnisotropy();
-	InitializeWaterHeightColors();
+		ConfigureAnisotropy();
+		InitializeWaterHeightColors();
+
+		CreateSpecularTex(texBMs);
+
+		LoadTexBitmaps(texBMs, TexBitmaps::SPLAT_DETAIL, TexBitmaps::DETAIL);
+
+		CreateSplatDetailTextures(texBMs);
+		CreateGrassTex(texBMs);
+		CreateDetailTex(texBMs);
+	}
 
-	CreateSpecularTex();
-	CreateSplatDetailTextures();
-	CreateGrassTex();
-	CreateDetailTex();
 	CreateShadingTex();
 	CreateNormalTex();
 
@@ -140,11 +174,43 @@ void CSMFReadMap::LoadHeightMap()
 }
 
 
-void CSMFReadMap::LoadMinimap()
+void CSMFReadMap::LoadTexBitmaps(TexBitmaps& texBMs, int firstTex, int lastTex)
 {
-	CBitmap minimapTexBM;
-	if (minimapTexBM.Load(mapInfo->smf.minimapTexName)) {
+	ScopedOnceTimer timer("CSMFReadMap::LoadTexBitmaps");
+
+	// textures the map does not use are left empty and not loaded
+	std::string texNames[TexBitmaps::COUNT];
+
+	texNames[TexBitmaps::MINIMAP] = mapInfo->smf.minimapTexName;
+
+	if (haveSpecularTexture) {
+		texNames[TexBitmaps::SPECULAR       ] = mapInfo->smf.specularTexName;
+		texNames[TexBitmaps::SKY_REFLECT_MOD] = mapInfo->smf.skyReflectModTexName;
+		texNames[TexBitmaps::DETAIL_NORMAL  ] = mapInfo->smf.detailNormalTexName;
+		texNames[TexBitmaps::LIGHT_EMISSION ] = mapInfo->smf.lightEmissionTexName;
+		texNames[TexBitmaps::PARALLAX_HEIGHT] = mapInfo->smf.parallaxHeightTexName;
+	}
+	if (haveSplatTexture) {
+		texNames[TexBitmaps::SPLAT_DETAIL] = mapInfo->smf.splatDetailTexName;
+		texNames[TexBitmaps::SPLAT_DISTR ] = mapInfo->smf.splatDistrTexName;
+	}
+
+	texNames[TexBitmaps::GRASS_SHADING] = mapInfo->smf.grassShadingTexName;
+	texNames[TexBitmaps::DETAIL       ] = mapInfo->smf.detailTexName;
+
+	// decoding is independent per texture, only the GL uploads need this thread
+	for_mt(firstTex, lastTex + 1, [&](const int i) {
+		texBMs.loaded[i] = (!texNames[i].empty() && texBMs.bitmaps[i].Load(texNames[i]));
+	});
+}
+
+
+void CSMFReadMap::LoadMinimap(TexBitmaps& texBMs)
+{
+	CBitmap& minimapTexBM = texBMs.bitmaps[TexBitmaps::MINIMAP];
+	if (texBMs.loaded[TexBitmaps::MINIMAP]) {
 		minimapTex = minimapTexBM.CreateTexture(false);
+		texBMs.Release(TexBitmaps::MINIMAP);
 		return;
 	}
 
@@ -180,90 +246,100 @@ void CSMFReadMap::InitializeWaterHeightColors()
 }
 
 
-void CSMFReadMap::CreateSpecularTex()
+void CSMFReadMap::CreateSpecularTex(TexBitmaps& texBMs)
 {
 	if (!haveSpecularTexture) {
 		return;
 	}
 
-	CBitmap specularTexBM;
-	CBitmap skyReflectModTexBM;
-	CBitmap detailNormalTexBM;
-	CBitmap lightEmissionTexBM;
-	CBitmap parallaxHeightTexBM;
+	CBitmap& specularTexBM = texBMs.bitmaps[TexBitmaps::SPECULAR];
+	CBitmap& skyReflectModTexBM = texBMs.bitmaps[TexBitmaps::SKY_REFLECT_MOD];
+	CBitmap& detailNormalTexBM = texBMs.bitmaps[TexBitmaps::DETAIL_NORMAL];
+	CBitmap& lightEmissionTexBM = texBMs.bitmaps[TexBitmaps::LIGHT_EMISSION];
+	CBitmap& parallaxHeightTexBM = texBMs.bitmaps[TexBitmaps::PARALLAX_HEIGHT];
 
-	if (!specularTexBM.Load(mapInfo->smf.specularTexName)) {
+	if (!texBMs.loaded[TexBitmaps::SPECULAR]) {
 		// maps wants specular lighting, but no moderation
 		specularTexBM.channels = 4;
 		specularTexBM.AllocDummy(SColor(255,255,255,255));
 	}
 
 	specularTex = specularTexBM.CreateTexture(false);
+	texBMs.Release(TexBitmaps::SPECULAR);
 
 	// no default 1x1 textures for these
-	if (skyReflectModTexBM.Load(mapInfo->smf.skyReflectModTexName)) {
+	if (texBMs.loaded[TexBitmaps::SKY_REFLECT_MOD]) {
 		skyReflectModTex = skyReflectModTexBM.CreateTexture(false);
+		texBMs.Release(TexBitmaps::SKY_REFLECT_MOD);
 	}
 
-	if (detailNormalTexBM.Load(mapInfo->smf.detailNormalTexName)) {
+	if (texBMs.loaded[TexBitmaps::DETAIL_NORMAL]) {
 		detailNormalTex = detailNormalTexBM.CreateTexture(false);
+		texBMs.Release(TexBitmaps::DETAIL_NORMAL);
 	}
 
-	if (lightEmissionTexBM.Load(mapInfo->smf.lightEmissionTexName)) {
+	if (texBMs.loaded[TexBitmaps::LIGHT_EMISSION]) {
 		lightEmissionTex = lightEmissionTexBM.CreateTexture(false);
+		texBMs.Release(TexBitmaps::LIGHT_EMISSION);
 	}
 
-	if (parallaxHeightTexBM.Load(mapInfo->smf.parallaxHeightTexName)) {
+	if (texBMs.loaded[TexBitmaps::PARALLAX_HEIGHT]) {
 		parallaxHeightTex = parallaxHeightTexBM.CreateTexture(false);
+		texBMs.Release(TexBitmaps::PARALLAX_HEIGHT);
 	}
 }
 
-void CSMFReadMap::CreateSplatDetailTextures()
+void CSMFReadMap::CreateSplatDetailTextures(TexBitmaps& texBMs)
 {
 	if (!haveSplatTexture) {
 		return;
 	}
 
-	CBitmap splatDistrTexBM;
-	CBitmap splatDetailTexBM;
+	CBitmap& splatDistrTexBM = texBMs.bitmaps[TexBitmaps::SPLAT_DISTR];
+	CBitmap& splatDetailTexBM = texBMs.bitmaps[TexBitmaps::SPLAT_DETAIL];
 
 	// if the map supplies an intensity- AND a distribution-texture for
 	// detail-splat blending, the regular detail-texture is not used
-	if (!splatDetailTexBM.Load(mapInfo->smf.splatDetailTexName)) {
+	if (!texBMs.loaded[TexBitmaps::SPLAT_DETAIL]) {
 		// default detail-texture should be all-grey
 		splatDetailTexBM.channels = 4;
 		splatDetailTexBM.AllocDummy(SColor(127,127,127,127));
 	}
 
-	if (!splatDistrTexBM.Load(mapInfo->smf.splatDistrTexName)) {
+	if (!texBMs.loaded[TexBitmaps::SPLAT_DISTR]) {
 		splatDistrTexBM.channels = 4;
 		splatDistrTexBM.AllocDummy(SColor(255,0,0,0));
 	}
 
 	splatDetailTex = splatDetailTexBM.CreateTexture(true);
+	texBMs.Release(TexBitmaps::SPLAT_DETAIL);
 	splatDistrTex = splatDistrTexBM.CreateTexture(true);
+	texBMs.Release(TexBitmaps::SPLAT_DISTR);
 }
 
 
-void CSMFReadMap::CreateGrassTex()
+void CSMFReadMap::CreateGrassTex(TexBitmaps& texBMs)
 {
 	grassShadingTex = minimapTex;
 
-	CBitmap grassShadingTexBM;
-	if (grassShadingTexBM.Load(mapInfo->smf.grassShadingTexName)) {
+	CBitmap& grassShadingTexBM = texBMs.bitmaps[TexBitmaps::GRASS_SHADING];
+	if (texBMs.loaded[TexBitmaps::GRASS_SHADING]) {
 		grassShadingTex = grassShadingTexBM.CreateTexture(true);
+		texBMs.Release(TexBitmaps::GRASS_SHADING);
 	}
 }
 
 
-void CSMFReadMap::CreateDetailTex()
+void CSMFReadMap::CreateDetailTex(TexBitmaps& texBMs)
 {
-	CBitmap detailTexBM;
-	if (!detailTexBM.Load(mapInfo->smf.detailTexName)) {
+	CBitmap& detailTexBM = texBMs.bitmaps[TexBitmaps::DETAIL];
+	if (!texBMs.loaded[TexBitmaps::DETAIL]) {
 		throw content_error("Could not load detail texture from file " + mapInfo->smf.detailTexName);
 	}
 
 	detailTex = detailTexBM.CreateTexture(true);
+	texBMs.Release(TexBitmaps::DETAIL);
+
 	if (anisotropy != 0.0f) {
 		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);
 	}
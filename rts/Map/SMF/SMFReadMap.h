@@ -69,14 +69,18 @@ public:
 	bool HaveSplatTexture() const { return haveSplatTexture; }
 
 private:
+	struct TexBitmaps;
+
 	void ParseHeader();
 	void LoadHeightMap();
-	void LoadMinimap();
+	/// decodes the map texture bitmaps [firstTex, lastTex] in parallel, GL textures are created from them afterwards
+	void LoadTexBitmaps(TexBitmaps& texBMs, int firstTex, int lastTex);
+	void LoadMinimap(TexBitmaps& texBMs);
 	void InitializeWaterHeightColors();
-	void CreateSpecularTex();
-	void CreateSplatDetailTextures();
-	void CreateGrassTex();
-	void CreateDetailTex();
+	void CreateSpecularTex(TexBitmaps& texBMs);
+	void CreateSplatDetailTextures(TexBitmaps& texBMs);
+	void CreateGrassTex(TexBitmaps& texBMs);
+	void CreateDetailTex(TexBitmaps& texBMs);
 	void CreateShadingTex();
 	void CreateNormalTex();
 
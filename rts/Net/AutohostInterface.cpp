@@ -48,6 +48,14 @@ enum EVENT
 	/// Server gave out a warning (string warningmessage)
 	SERVER_WARNING = 5,
 
+	/**
+	 * Histogram of the server's receive -> relay latency for client messages
+	 * (uchar numbuckets, uint32_t[numbuckets] counts); bucket i counts the
+	 * messages which took [2^i, 2^(i+1)) microseconds, the first bucket
+	 * starts at 0 and the last one is open-ended
+	 */
+	SERVER_NETLATENCY = 6,
+
 	/// Player has joined the game (uchar playernumber, string name)
 	PLAYER_JOINED = 10,
 
@@ -308,6 +316,16 @@ void AutohostInterface::Warning(const std::string& message)
 	}
 }
 
+void AutohostInterface::SendNetLatency(const boost::uint32_t* buckets, unsigned int numBuckets)
+{
+	std::vector<boost::uint8_t> buffer(2 + numBuckets * sizeof(boost::uint32_t));
+	buffer[0] = SERVER_NETLATENCY;
+	buffer[1] = numBuckets;
+
+	memcpy(&buffer[2], buckets, numBuckets * sizeof(boost::uint32_t));
+	Send(boost::asio::buffer(buffer));
+}
+
 void AutohostInterface::SendLuaMsg(const boost::uint8_t* msg, size_t msgSize)
 {
 	if (autohost.is_open()) {
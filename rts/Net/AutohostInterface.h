@@ -45,6 +45,7 @@ public:
 
 	void Message(const std::string& message);
 	void Warning(const std::string& message);
+	void SendNetLatency(const boost::uint32_t* buckets, unsigned int numBuckets);
 
 	void SendLuaMsg(const boost::uint8_t* msg, size_t msgSize);
 	void Send(const boost::uint8_t* msg, size_t msgSize);
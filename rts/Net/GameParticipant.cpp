@@ -1,6 +1,7 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include "GameParticipant.h"
+#include "GameServer.h"
 
 #include "Net/Protocol/BaseNetProtocol.h"
 #include "Sim/Misc/GlobalConstants.h"
@@ -14,14 +15,25 @@ GameParticipant::GameParticipant()
 , isLocal(false)
 , isReconn(false)
 , isMidgameJoin(false)
+, useFrameBundles(false)
+#ifdef SYNCCHECK
+, snapshotCheckFrame(-1)
+, snapshotChecksum(0)
+#endif
 {
 	linkData[MAX_AIS] = PlayerLinkData(false);
 }
 
 void GameParticipant::SendData(boost::shared_ptr<const netcode::RawPacket> packet)
 {
-	if (link)
-		link->SendData(packet);
+	if (!link)
+		return;
+
+	// broadcasts still waiting in the server's bundle were sent before <packet>
+	if (useFrameBundles && gameServer != NULL)
+		gameServer->FlushFrameBundle();
+
+	link->SendData(packet);
 }
 
 void GameParticipant::Connected(boost::shared_ptr<netcode::CConnection> _link, bool local)
@@ -36,7 +48,7 @@ void GameParticipant::Connected(boost::shared_ptr<netcode::CConnection> _link, b
 void GameParticipant::Kill(const std::string& reason, const bool flush)
 {
 	if (link) {
-		link->SendData(CBaseNetProtocol::Get().SendQuit(reason));
+		SendData(CBaseNetProtocol::Get().SendQuit(reason));
 
 		// make sure the Flush() performed by Close() has effect (forced flushes are undesirable)
 		// it will cause a slight lag in the game server during kick, but not a big deal
@@ -49,6 +61,7 @@ void GameParticipant::Kill(const std::string& reason, const bool flush)
 	linkData[MAX_AIS].link.reset();
 #ifdef SYNCCHECK
 	syncResponse.clear();
+	syncSections.clear();
 #endif
 	myState = DISCONNECTED;
 }
@@ -41,6 +41,8 @@ public:
 	bool isLocal;
 	bool isReconn;
 	bool isMidgameJoin;
+	/// the client unpacks NETMSG_FRAMEBUNDLE, broadcasts reach it via CGameServer::FlushFrameBundle
+	bool useFrameBundles;
 	boost::shared_ptr<netcode::CConnection> link;
 	PlayerStatistics lastStats;
 
@@ -53,6 +55,11 @@ public:
 
 #ifdef SYNCCHECK
 	std::map<int, unsigned> syncResponse; // syncResponse[frameNum] = checksum
+	std::map<int, std::vector<unsigned> > syncSections; // syncSections[frameNum] = section checksums, see NETMSG_SYNCSECTIONS
+
+	/// first frame simulated after joining from a state snapshot (-1 if not) and its expected checksum
+	int snapshotCheckFrame;
+	unsigned snapshotChecksum;
 #endif
 };
 
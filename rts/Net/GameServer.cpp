@@ -2,6 +2,7 @@
 
 #include "System/Net/UDPListener.h"
 #include "System/Net/UDPConnection.h"
+#include "System/Net/Socket.h"
 
 #include <boost/bind.hpp>
 #include <boost/format.hpp>
@@ -55,6 +56,7 @@
 #include "System/Log/ILog.h"
 #include "System/Platform/errorhandler.h"
 #include "System/Platform/Threading.h"
+#include "System/Sync/SyncChecker.h"
 
 #ifndef DEDICATED
 #include "lib/luasocket/src/restrictions.h"
@@ -75,7 +77,11 @@ CONFIG(bool, WhiteListAdditionalPlayers).defaultValue(true);
 CONFIG(bool, ServerRecordDemos).defaultValue(false).dedicatedValue(true);
 CONFIG(bool, ServerLogInfoMessages).defaultValue(false);
 CONFIG(bool, ServerLogDebugMessages).defaultValue(false);
+CONFIG(bool, ServerFrameBundles).defaultValue(true)
+	.description("Send the messages of each server update to remote clients as one compressed bundle (if the client supports it).");
 CONFIG(std::string, AutohostIP).defaultValue("127.0.0.1");
+CONFIG(int, ServerStateSnapshotInterval).defaultValue(0).minimumValue(0)
+	.description("Experimental: every this many frames a client uploads its game state, which midgame joiners then load instead of simulating the whole game so far. 0 disables. Only games without LuaRules, without LuaGaia and without skirmish AIs can be saved, which rules out nearly every real game; for all others joiners still simulate the whole game.");
 
 
 // use the specific section for all LOG*() calls in this source file
@@ -110,6 +116,11 @@ static const unsigned gameProgressFrameInterval = GAME_SPEED * 10;
 
 static const unsigned syncResponseEchoInterval = GAME_SPEED * 2;
 
+/// longest time the server thread waits for network events, Update() does some periodic work
+static const spring_time maxNetWaitTime = spring_msecs(1000 / GAME_SPEED);
+/// wait-time while links have data to flush or resend (they only do that in Update)
+static const spring_time pendingNetWaitTime = spring_msecs(5);
+
 
 //FIXME remodularize server commands, so they get registered in word completion etc.
 static const std::string SERVER_COMMANDS[] = {
@@ -119,7 +130,7 @@ static const std::string SERVER_COMMANDS[] = {
 	"nopause", "nohelp", "cheat", "godmode", "globallos",
 	"nocost", "forcestart", "nospectatorchat", "nospecdraw",
 	"skip", "reloadcob", "reloadcegs", "devlua", "editdefs",
-	"singlestep", "spec", "specbynum"
+	"singlestep", "spec", "specbynum", "netlatency"
 };
 
 
@@ -162,12 +173,19 @@ CGameServer::CGameServer(
 , canReconnect(false)
 , allowSpecDraw(true)
 
+, snapshotInterval(0)
+
+, allowFrameBundles(false)
+, collectFrameBundle(false)
+
 , syncErrorFrame(0)
 , syncWarningFrame(0)
 
 , hasLocalClient(false)
 , localClientNumber(0)
 
+, lockWaitTime(0)
+
 , gameHasStarted(false)
 , generatedGameID(false)
 , reloadingServer(false)
@@ -182,6 +200,7 @@ CGameServer::CGameServer(
 CGameServer::~CGameServer()
 {
 	quitServer = true;
+	netcode::WakeupNetService();
 
 	LOG_L(L_INFO, "[%s][1]", __FUNCTION__);
 	thread->join();
@@ -203,6 +222,13 @@ void CGameServer::Initialize()
 	logInfoMessages = configHandler->GetBool("ServerLogInfoMessages");
 	logDebugMessages = configHandler->GetBool("ServerLogDebugMessages");
 
+	allowFrameBundles = configHandler->GetBool("ServerFrameBundles");
+	snapshotInterval = configHandler->GetInt("ServerStateSnapshotInterval");
+#ifndef SYNCCHECK
+	// joiners could not be checked against the game they load
+	snapshotInterval = 0;
+#endif
+
 	if (!myGameSetup->onlyLocal) {
 		UDPNet.reset(new netcode::UDPListener(myClientSetup->hostPort, myClientSetup->hostIP));
 	}
@@ -213,6 +239,9 @@ void CGameServer::Initialize()
 	Message(str(format(ServerStart) %myClientSetup->hostPort), false);
 
 	lastNewFrameTick = spring_gettime();
+	lastNetEventTime = lastNewFrameTick;
+
+	std::fill(relayLatencyHist, relayLatencyHist + NUM_LATENCY_BUCKETS, 0);
 
 	maxUserSpeed = myGameSetup->maxSpeed;
 	minUserSpeed = myGameSetup->minSpeed;
@@ -431,6 +460,12 @@ void CGameServer::SkipTo(int targetFrameNum)
 	//
 	// note that we must maintain <modGameTime> ourselves
 	// since we do we NOT go through ::Update when skipping
+	//
+	// NOTE:
+	//   every skipped frame still has to be sent, clients simulate them
+	//   all to reach the target state; the demo seek index can not be
+	//   used here (CDemoReader::SeekToFrame) as long as there are no
+	//   savestate snapshots to resume the simulation from
 	while (SendDemoData(targetFrameNum)) {
 		gameTime = GetDemoTime();
 		modGameTime = demoReader->GetModGameTime() + 0.001f;
@@ -648,8 +683,18 @@ bool CGameServer::SendDemoData(int targetFrameNum)
 
 void CGameServer::Broadcast(boost::shared_ptr<const netcode::RawPacket> packet)
 {
-	for (size_t p = 0; p < players.size(); ++p)
-		players[p].SendData(packet);
+	bool bundled = false;
+
+	for (size_t p = 0; p < players.size(); ++p) {
+		if (collectFrameBundle && players[p].useFrameBundles && players[p].link) {
+			bundled = true;
+		} else {
+			players[p].SendData(packet);
+		}
+	}
+
+	if (bundled)
+		frameBundle.Add(packet);
 
 	if (canReconnect || allowSpecJoin || !gameHasStarted)
 		AddToPacketCache(packet);
@@ -658,6 +703,24 @@ void CGameServer::Broadcast(boost::shared_ptr<const netcode::RawPacket> packet)
 		demoRecorder->SaveToDemo(packet->data, packet->length, GetDemoTime());
 }
 
+void CGameServer::FlushFrameBundle()
+{
+	if (frameBundle.Empty())
+		return;
+
+	std::vector< boost::shared_ptr<const netcode::RawPacket> > packets;
+	frameBundle.Flush(packets);
+
+	for (GameParticipant& p: players) {
+		if (!p.useFrameBundles || !p.link)
+			continue;
+
+		for (auto it = packets.begin(); it != packets.end(); ++it) {
+			p.link->SendData(*it);
+		}
+	}
+}
+
 void CGameServer::Message(const std::string& message, bool broadcast)
 {
 	if (broadcast) {
@@ -729,6 +792,17 @@ void CGameServer::CheckSync()
 			bGotCorrectChecksum = (checkMaxCount > 0);
 		}
 
+		if (bGotCorrectChecksum) {
+			// what a joiner loading a snapshot has to arrive at, see BindConnection
+			for (StateSnapshot* snapshot: {&pendingSnapshot, &stateSnapshot}) {
+				if (snapshot->frameNum < 0 || *f != (snapshot->frameNum + 1))
+					continue;
+
+				snapshot->nextChecksum = correctChecksum;
+				snapshot->hasNextChecksum = true;
+			}
+		}
+
 		std::vector<int> noSyncResponse;
 		// maps incorrect checksum to players with that checksum
 		std::map<unsigned, std::vector<int> > desyncGroups;
@@ -791,6 +865,11 @@ void CGameServer::CheckSync()
 				for (; g != desyncGroups.end(); ++g) {
 					std::string playernames = GetPlayerNames(g->second);
 					Message(str(format(SyncError) %playernames %(*f) %g->first %correctChecksum));
+
+					const std::string sections = GetDesyncedSections(*f, correctChecksum, g->second[0]);
+
+					if (!sections.empty())
+						Message(str(format(SyncErrorSections) %playernames %(*f) %sections));
 				}
 
 				// send spectator desyncs as private messages to reduce spam
@@ -800,6 +879,11 @@ void CGameServer::CheckSync()
 					LOG_L(L_ERROR, "%s", str(format(SyncError) %players[playerNum].name %(*f) %s->second %correctChecksum).c_str());
 					Message(str(format(SyncError) %players[playerNum].name %(*f) %s->second %correctChecksum));
 
+					const std::string sections = GetDesyncedSections(*f, correctChecksum, playerNum);
+
+					if (!sections.empty())
+						Message(str(format(SyncErrorSections) %players[playerNum].name %(*f) %sections));
+
 					PrivateMessage(playerNum, str(format(SyncError) %players[playerNum].name %(*f) %s->second %correctChecksum));
 				}
 			}
@@ -810,8 +894,10 @@ void CGameServer::CheckSync()
 		if (bComplete) {
 			// Message(str (format("Succesfully purged outstanding sync frame %d from the deque") %(*f)));
 			for (size_t a = 0; a < players.size(); ++a) {
-				if (players[a].myState < GameParticipant::DISCONNECTED)
+				if (players[a].myState < GameParticipant::DISCONNECTED) {
 					players[a].syncResponse.erase(*f);
+					players[a].syncSections.erase(*f);
+				}
 			}
 			f = set_erase(outstandingSyncFrames, f);
 		} else
@@ -827,6 +913,44 @@ void CGameServer::CheckSync()
 }
 
 
+#ifdef SYNCCHECK
+std::string CGameServer::GetDesyncedSections(int frameNum, unsigned correctChecksum, int playerNum) const
+{
+	const std::map<int, std::vector<unsigned> >::const_iterator desynced = players[playerNum].syncSections.find(frameNum);
+
+	if (desynced == players[playerNum].syncSections.end())
+		return "";
+
+	// compare with any client that sent the correct checksum and its sections
+	for (size_t a = 0; a < players.size(); ++a) {
+		const std::map<int, unsigned>::const_iterator response = players[a].syncResponse.find(frameNum);
+		const std::map<int, std::vector<unsigned> >::const_iterator correct = players[a].syncSections.find(frameNum);
+
+		if (response == players[a].syncResponse.end() || response->second != correctChecksum)
+			continue;
+		if (correct == players[a].syncSections.end() || correct->second.size() != desynced->second.size())
+			continue;
+
+		std::string sections;
+
+		for (size_t n = 0; n < correct->second.size(); ++n) {
+			if (correct->second[n] == desynced->second[n])
+				continue;
+
+			if (!sections.empty())
+				sections += ", ";
+
+			sections += CSyncChecker::GetSectionName(n);
+		}
+
+		return sections;
+	}
+
+	return "";
+}
+#endif
+
+
 float CGameServer::GetDemoTime() const {
 	if (!gameHasStarted) return gameTime;
 	return (startTime + serverFrameNum / float(GAME_SPEED));
@@ -1318,6 +1442,17 @@ void CGameServer::ProcessPacket(const unsigned playerNum, boost::shared_ptr<cons
 			if (outstandingSyncFrames.find(frameNum) != outstandingSyncFrames.end())
 				players[a].syncResponse[frameNum] = checkSum;
 
+			// long gone from outstandingSyncFrames, so checked here
+			if (frameNum == players[a].snapshotCheckFrame) {
+				players[a].snapshotCheckFrame = -1;
+
+				if (checkSum != players[a].snapshotChecksum) {
+					players[a].desynced = true;
+					PrivateMessage(a, str(format(SyncError) %players[a].name %frameNum %checkSum %players[a].snapshotChecksum));
+					DisableStateSnapshots(str(format("%s desynced after loading the game state of frame %d") %players[a].name %(frameNum - 1)));
+				}
+			}
+
 			// update player's ping (if !defined(SYNCCHECK) this is done in NETMSG_KEYFRAME)
 			if (frameNum <= serverFrameNum && frameNum > players[a].lastFrameResponse)
 				players[a].lastFrameResponse = frameNum;
@@ -1331,6 +1466,78 @@ void CGameServer::ProcessPacket(const unsigned playerNum, boost::shared_ptr<cons
 #endif
 		} break;
 
+		case NETMSG_SYNCSECTIONS: {
+#ifdef SYNCCHECK
+			try {
+				netcode::UnpackPacket pckt(packet, 1);
+
+				unsigned char msgSize; pckt >> msgSize;
+				unsigned char playerNum; pckt >> playerNum;
+				          int  frameNum; pckt >> frameNum;
+
+				if (playerNum != a) {
+					Message(str(format(WrongPlayer) %msgCode %a %(unsigned)playerNum));
+					break;
+				}
+
+				if (msgSize < (7 + sizeof(unsigned)))
+					throw netcode::UnpackPacketException("no sections");
+
+				std::vector<unsigned> sectionChecksums((msgSize - 7) / sizeof(unsigned));
+				pckt >> sectionChecksums;
+
+				if (outstandingSyncFrames.find(frameNum) != outstandingSyncFrames.end())
+					players[a].syncSections[frameNum] = sectionChecksums;
+			} catch (const netcode::UnpackPacketException& ex) {
+				Message(str(format("Player %s sent invalid SyncSections: %s") %players[a].name %ex.what()));
+			}
+#endif
+		} break;
+
+		case NETMSG_SNAPSHOT: {
+			try {
+				netcode::UnpackPacket pckt(packet, 1);
+
+				boost::uint16_t msgSize; pckt >> msgSize;
+				unsigned char playerNum; pckt >> playerNum;
+				int frameNum; pckt >> frameNum;
+				unsigned int totalSize; pckt >> totalSize;
+				unsigned int offset; pckt >> offset;
+
+				if (playerNum != a) {
+					Message(str(format(WrongPlayer) %msgCode %a %(unsigned)playerNum));
+					break;
+				}
+
+				// late answers to an older request are dropped
+				if (frameNum != pendingSnapshot.frameNum || playerNum != pendingSnapshot.playerNum || offset != pendingSnapshot.data.size())
+					break;
+				if (totalSize == 0) {
+					DisableStateSnapshots(str(format("%s can not save this game's state (synced Lua or AIs)") %players[a].name));
+					break;
+				}
+				if (msgSize <= 16)
+					throw netcode::UnpackPacketException("no data");
+
+				std::vector<boost::uint8_t> data(msgSize - 16);
+				pckt >> data;
+
+				pendingSnapshot.totalSize = totalSize;
+				pendingSnapshot.data.insert(pendingSnapshot.data.end(), data.begin(), data.end());
+
+				if (pendingSnapshot.data.size() > totalSize)
+					throw netcode::UnpackPacketException("too much data");
+
+				if (pendingSnapshot.IsComplete()) {
+					std::swap(stateSnapshot, pendingSnapshot);
+					pendingSnapshot = StateSnapshot();
+				}
+			} catch (const netcode::UnpackPacketException& ex) {
+				pendingSnapshot = StateSnapshot();
+				Message(str(format("Player %s sent invalid Snapshot: %s") %players[a].name %ex.what()));
+			}
+		} break;
+
 		case NETMSG_SHARE:
 			if (inbuf[1] != a) {
 				Message(str(format(WrongPlayer) %msgCode %a %(unsigned)inbuf[1]));
@@ -1772,6 +1979,10 @@ void CGameServer::ProcessPacket(const unsigned playerNum, boost::shared_ptr<cons
 			Broadcast(packet);
 			break;
 #endif
+		case NETMSG_FRAMEBUNDLE: {
+			// only sent by the server, client links pass these on unpacked
+			Message(str(format(UnknownNetmsg) %msgCode %a));
+		} break;
 		// CGameServer should never get these messages
 		//case NETMSG_GAMEID:
 		//case NETMSG_INTERNAL_SPEED:
@@ -1796,7 +2007,7 @@ void CGameServer::ServerReadNet()
 			try {
 				netcode::UnpackPacket msg(packet, 3);
 				std::string name, passwd, version;
-				unsigned char reconnect, netloss;
+				unsigned char reconnect, netloss, netcaps = 0;
 				unsigned short netversion;
 				msg >> netversion;
 				if (netversion != NETWORK_VERSION)
@@ -1806,7 +2017,9 @@ void CGameServer::ServerReadNet()
 				msg >> version;
 				msg >> reconnect;
 				msg >> netloss;
-				BindConnection(name, passwd, version, false, UDPNet->AcceptConnection(), reconnect, netloss);
+				if (msg.GetRemaining() > 0) // older clients do not send this
+					msg >> netcaps;
+				BindConnection(name, passwd, version, false, UDPNet->AcceptConnection(), reconnect, netloss, netcaps);
 			} catch (const netcode::UnpackPacketException& ex) {
 				Message(str(format(ConnectionReject) %ex.what() %packet->data[0] %packet->data[2] %packet->length));
 				UDPNet->RejectConnection();
@@ -1890,6 +2103,7 @@ void CGameServer::ServerReadNet()
 					++numDropped;
 				else if (!bwLimitIsReached || !droppablePacket) {
 					ProcessPacket(a, packet); // non droppable packets may be processed more than once, but this does no harm
+					AddRelayLatencySample(spring_gettime() - lastNetEventTime);
 					if (globalConfig->linkIncomingPeakBandwidth > 0 && droppablePacket) {
 						bandwidthUsage += std::max((unsigned)linkMinPacketSize, packet->length);
 						if (!bwLimitIsReached)
@@ -2315,6 +2529,13 @@ void CGameServer::PushAction(const Action& action, bool fromAutoHost)
 		LOG("Server killed!!!");
 		quitServer = true;
 	}
+	else if (action.command == "netlatency") {
+		if (hostif)
+			hostif->SendNetLatency(relayLatencyHist, NUM_LATENCY_BUCKETS);
+
+		if (action.extra == "reset")
+			std::fill(relayLatencyHist, relayLatencyHist + NUM_LATENCY_BUCKETS, 0);
+	}
 	else if (action.command == "pause") {
 		if (gameHasStarted) {
 			// action can originate from autohost prior to start
@@ -2354,7 +2575,7 @@ void CGameServer::CreateNewFrame(bool fromServerThread, bool fixedFrameTime)
 		return;
 	}
 
-	Threading::RecursiveScopedLock(gameServerMutex, !fromServerThread);
+	Threading::RecursiveScopedLock scoped_lock(gameServerMutex, !fromServerThread);
 	CheckSync();
 
 	const bool vidRecording = videoCapturing->IsCapturing();
@@ -2436,6 +2657,9 @@ void CGameServer::CreateNewFrame(bool fromServerThread, bool fixedFrameTime)
 				Broadcast(CBaseNetProtocol::Get().SendNewFrame());
 			}
 
+			if (snapshotInterval > 0 && (serverFrameNum % snapshotInterval) == 0)
+				RequestStateSnapshot();
+
 			// every gameProgressFrameInterval, we broadcast current frame in a
 			// special message (that doesn't get cached and skips normal queue)
 			// to let players know their loading %
@@ -2482,16 +2706,27 @@ void CGameServer::UpdateLoop()
 		Threading::SetThreadName("netcode");
 		Threading::SetAffinity(~0);
 
-		//FIXME use async callback funcs in boost udp sockets and so get rid of any latency & remove netcode thread
 		while (!quitServer) {
-			spring_sleep(spring_msecs(5));
-
-			if (UDPNet)
+			// sleep until a datagram arrives or the next frame is due (local clients
+			// are served once per pass, which is at least once per frame interval)
+			if (UDPNet) {
+				UDPNet->Wait(GetNetWaitTime());
+				lastNetEventTime = spring_gettime();
 				UDPNet->Update();
+			} else {
+				netcode::WaitForNetEvents(NULL, GetNetWaitTime());
+				lastNetEventTime = spring_gettime();
+			}
 
+			const spring_time lockTime = spring_gettime();
 			Threading::RecursiveScopedLock scoped_lock(gameServerMutex);
+			lockWaitTime += (spring_gettime() - lockTime).toNanoSecsi();
+
+			collectFrameBundle = true;
 			ServerReadNet();
 			Update();
+			collectFrameBundle = false;
+			FlushFrameBundle();
 		}
 
 		if (hostif)
@@ -2521,6 +2756,45 @@ void CGameServer::UpdateLoop()
 }
 
 
+spring_time CGameServer::GetNetWaitTime() const
+{
+	Threading::RecursiveScopedLock scoped_lock(gameServerMutex);
+
+	spring_time waitTime = maxNetWaitTime;
+
+	if (UDPNet && UDPNet->HasPendingOutgoingData())
+		waitTime = pendingNetWaitTime;
+
+	if (demoReader != NULL) {
+		// demo data is sent based on modGameTime
+		waitTime = pendingNetWaitTime;
+	} else if (gameHasStarted && !isPaused && internalSpeed > 0.0f) {
+		// CreateNewFrame adds a frame as soon as frameTimeLeft becomes positive
+		const float framesPerMilliSec = (GAME_SPEED * 0.001f) * internalSpeed;
+		const spring_time nextFrameTime = lastNewFrameTick + spring_time::fromMicroSecs((-frameTimeLeft / framesPerMilliSec) * 1000.0f);
+		const spring_time curTime = spring_gettime();
+
+		if (nextFrameTime <= curTime)
+			return spring_notime;
+		if ((nextFrameTime - curTime) < waitTime)
+			waitTime = nextFrameTime - curTime;
+	}
+
+	return waitTime;
+}
+
+void CGameServer::AddRelayLatencySample(spring_time latency)
+{
+	unsigned int bucket = 0;
+
+	for (boost::int64_t us = latency.toMicroSecsi(); us > 1 && bucket < (NUM_LATENCY_BUCKETS - 1); us >>= 1) {
+		bucket++;
+	}
+
+	relayLatencyHist[bucket]++;
+}
+
+
 void CGameServer::KickPlayer(const int playerNum)
 {
 	if (!players[playerNum].link) { // only kick connected players
@@ -2632,7 +2906,7 @@ void CGameServer::AddAdditionalUser(const std::string& name, const std::string&
 }
 
 
-unsigned CGameServer::BindConnection(std::string name, const std::string& passwd, const std::string& version, bool isLocal, boost::shared_ptr<netcode::CConnection> link, bool reconnect, int netloss)
+unsigned CGameServer::BindConnection(std::string name, const std::string& passwd, const std::string& version, bool isLocal, boost::shared_ptr<netcode::CConnection> link, bool reconnect, int netloss, int netcaps)
 {
 	Message(str(format("%s attempt from %s") %(reconnect ? "Reconnection" : "Connection") %name));
 	Message(str(format(" -> Version: %s") %version));
@@ -2704,6 +2978,9 @@ unsigned CGameServer::BindConnection(std::string name, const std::string& passwd
 	GameParticipant& newPlayer = players[newPlayerNumber];
 	newPlayer.isReconn = gameHasStarted;
 
+	// the pending broadcasts are also in the packet cache, do not send them twice
+	FlushFrameBundle();
+
 	// there is a running link already -> terminate it
 	if (terminate) {
 		Message(str(format(PlayerLeft) %newPlayer.GetType() %newPlayer.name %" terminating existing connection"));
@@ -2726,17 +3003,65 @@ unsigned CGameServer::BindConnection(std::string name, const std::string& passwd
 		Message(str(format(" -> Connection reestablished (id %i)") %newPlayerNumber));
 		newPlayer.link->SetLossFactor(netloss);
 		newPlayer.link->Flush(!gameHasStarted);
+		newPlayer.useFrameBundles = (allowFrameBundles && (netcaps & NETCAP_FRAMEBUNDLES) != 0);
 		return newPlayerNumber;
 	}
 
 	newPlayer.Connected(link, isLocal);
+	newPlayer.useFrameBundles = (allowFrameBundles && !isLocal && (netcaps & NETCAP_FRAMEBUNDLES) != 0);
 	newPlayer.SendData(boost::shared_ptr<const RawPacket>(myGameData->Pack()));
+
+	// a midgame join loads the newest game state and only catches up from there
+	unsigned int numSkippedPackets = 0;
+
+#ifdef SYNCCHECK
+	newPlayer.snapshotCheckFrame = -1;
+#endif
+
+	if (!isLocal && stateSnapshot.IsUsable() && stateSnapshot.numCachedPackets <= GetPacketCacheSize()) {
+		static const unsigned int chunkSize = 32 * 1024;
+
+		for (unsigned int offset = 0; offset < stateSnapshot.totalSize; offset += chunkSize) {
+			const unsigned int size = std::min(chunkSize, stateSnapshot.totalSize - offset);
+			const std::vector<boost::uint8_t> chunk(stateSnapshot.data.begin() + offset, stateSnapshot.data.begin() + offset + size);
+
+			newPlayer.SendData(CBaseNetProtocol::Get().SendSnapshot(stateSnapshot.playerNum, stateSnapshot.frameNum, stateSnapshot.totalSize, offset, chunk));
+		}
+
+		numSkippedPackets = stateSnapshot.numCachedPackets;
+	#ifdef SYNCCHECK
+		newPlayer.snapshotCheckFrame = stateSnapshot.frameNum + 1;
+		newPlayer.snapshotChecksum = stateSnapshot.nextChecksum;
+	#endif
+		Message(str(format(" -> Sending game state of frame %i (%u KB) to %s") %stateSnapshot.frameNum %(stateSnapshot.totalSize / 1024) %name), false);
+	}
+
 	newPlayer.SendData(CBaseNetProtocol::Get().SendSetPlayerNum((unsigned char)newPlayerNumber));
 
 	// after gamedata and playerNum, the player can start loading
-	for (std::list< std::vector<boost::shared_ptr<const netcode::RawPacket> > >::const_iterator lit = packetCache.begin(); lit != packetCache.end(); ++lit)
-		for (std::vector<boost::shared_ptr<const netcode::RawPacket> >::const_iterator vit = lit->begin(); vit != lit->end(); ++vit)
-			newPlayer.SendData(*vit); // throw at him all stuff he missed until now
+	if (newPlayer.useFrameBundles) {
+		// the cache is mostly NEWFRAMEs, bundling it shrinks a midgame join's catch-up considerably
+		netcode::FrameBundleWriter cacheBundle;
+		std::vector< boost::shared_ptr<const netcode::RawPacket> > packets;
+		unsigned int numPackets = 0;
+
+		for (auto lit = packetCache.begin(); lit != packetCache.end(); ++lit)
+			for (auto vit = lit->begin(); vit != lit->end(); ++vit)
+				if ((numPackets++) >= numSkippedPackets)
+					cacheBundle.Add(*vit);
+
+		cacheBundle.Flush(packets);
+
+		for (auto it = packets.begin(); it != packets.end(); ++it)
+			newPlayer.SendData(*it);
+	} else {
+		unsigned int numPackets = 0;
+
+		for (std::list< std::vector<boost::shared_ptr<const netcode::RawPacket> > >::const_iterator lit = packetCache.begin(); lit != packetCache.end(); ++lit)
+			for (std::vector<boost::shared_ptr<const netcode::RawPacket> >::const_iterator vit = lit->begin(); vit != lit->end(); ++vit)
+				if ((numPackets++) >= numSkippedPackets)
+					newPlayer.SendData(*vit); // throw at him all stuff he missed until now
+	}
 
 	if (demoReader == NULL || myGameSetup->demoName.empty()) { // gamesetup from demo?
 		if (!newPlayer.spectator) {
@@ -2826,3 +3151,57 @@ void CGameServer::AddToPacketCache(boost::shared_ptr<const netcode::RawPacket> &
 	}
 	packetCache.back().push_back(pckt);
 }
+
+unsigned int CGameServer::GetPacketCacheSize() const
+{
+	if (packetCache.empty())
+		return 0;
+
+	return ((packetCache.size() - 1) * PKTCACHE_VECSIZE + packetCache.back().size());
+}
+
+
+void CGameServer::RequestStateSnapshot()
+{
+	// nobody could use it
+	if (demoReader != NULL || !(canReconnect || allowSpecJoin))
+		return;
+	// AI state lives on the clients hosting them, the snapshot would miss it
+	if (!ais.empty())
+		return;
+
+	// prefer the host, it has the lowest latency and sends it over memory
+	int snapshotPlayer = -1;
+
+	if (hasLocalClient && players[localClientNumber].myState == GameParticipant::INGAME) {
+		snapshotPlayer = localClientNumber;
+	} else {
+		for (size_t p = 0; p < players.size(); ++p) {
+			if (players[p].myState != GameParticipant::INGAME || !players[p].link)
+				continue;
+
+			snapshotPlayer = p;
+			break;
+		}
+	}
+
+	if (snapshotPlayer < 0)
+		return;
+
+	pendingSnapshot = StateSnapshot();
+	pendingSnapshot.frameNum = serverFrameNum;
+	pendingSnapshot.playerNum = snapshotPlayer;
+	pendingSnapshot.numCachedPackets = GetPacketCacheSize();
+
+	// sent directly after the NEWFRAME, so the client gets it right after simulating serverFrameNum
+	players[snapshotPlayer].SendData(CBaseNetProtocol::Get().SendSnapshotRequest(serverFrameNum));
+}
+
+void CGameServer::DisableStateSnapshots(const std::string& reason)
+{
+	snapshotInterval = 0;
+	stateSnapshot = StateSnapshot();
+	pendingSnapshot = StateSnapshot();
+
+	Message(str(format(" -> %s, midgame joiners get the whole game from now on") %reason));
+}
@@ -5,7 +5,9 @@
 
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/cstdint.hpp>
 
+#include <atomic>
 #include <string>
 #include <map>
 #include <deque>
@@ -17,6 +19,7 @@
 #include "Sim/Misc/TeamBase.h"
 #include "System/UnsyncedRNG.h"
 #include "System/float3.h"
+#include "System/Net/FrameBundle.h"
 #include "System/Misc/SpringTime.h"
 #include "System/Platform/RecursiveScopedLock.h"
 
@@ -114,6 +117,17 @@ public:
 	const boost::scoped_ptr<CDemoReader>& GetDemoReader() const { return demoReader; }
 	const boost::scoped_ptr<CDemoRecorder>& GetDemoRecorder() const { return demoRecorder; }
 
+	/**
+	 * @brief send the broadcasts collected since the last call to the
+	 *   clients receiving frame bundles
+	 * Must happen before anything is sent to such a client directly, which
+	 * GameParticipant::SendData takes care of.
+	 */
+	void FlushFrameBundle();
+
+	/// time the server thread spent waiting for its lock since the last call
+	spring_time PopLockWaitTime() { return spring_time::fromNanoSecs(lockWaitTime.exchange(0)); }
+
 private:
 	/**
 	 * @brief relay chat messages to players / autohost
@@ -141,14 +155,21 @@ private:
 
 	bool CheckPlayersPassword(const int playerNum, const std::string& pw) const;
 
-	unsigned BindConnection(std::string name, const std::string& passwd, const std::string& version, bool isLocal, boost::shared_ptr<netcode::CConnection> link, bool reconnect = false, int netloss = 0);
+	unsigned BindConnection(std::string name, const std::string& passwd, const std::string& version, bool isLocal, boost::shared_ptr<netcode::CConnection> link, bool reconnect = false, int netloss = 0, int netcaps = 0);
 
 	void CheckForGameStart(bool forced = false);
 	void StartGame(bool forced);
 	void UpdateLoop();
 	void Update();
+	/// how long the server thread may wait for network events before Update() has work to do
+	spring_time GetNetWaitTime() const;
+	void AddRelayLatencySample(spring_time latency);
 	void ProcessPacket(const unsigned playerNum, boost::shared_ptr<const netcode::RawPacket> packet);
 	void CheckSync();
+#ifdef SYNCCHECK
+	/// names of the sync sections in which <playerNum> differs from <correctChecksum>, if known
+	std::string GetDesyncedSections(int frameNum, unsigned correctChecksum, int playerNum) const;
+#endif
 	void ServerReadNet();
 
 	void LagProtection();
@@ -174,6 +195,12 @@ private:
 	void PrivateMessage(int playerNum, const std::string& message);
 
 	void AddToPacketCache(boost::shared_ptr<const netcode::RawPacket>& pckt);
+	unsigned int GetPacketCacheSize() const;
+
+	/// ask one client for its game state at serverFrameNum, see NETMSG_SNAPSHOT_REQUEST
+	void RequestStateSnapshot();
+	/// stop using snapshots, midgame joiners get the whole packet cache again
+	void DisableStateSnapshots(const std::string& reason);
 
 	bool AdjustPlayerNumber(netcode::RawPacket* buf, int pos, int val = -1);
 	void UpdatePlayerNumberMap();
@@ -199,6 +226,8 @@ private:
 	spring_time lastPlayerInfo;
 	spring_time lastUpdate;
 	spring_time lastBandwidthUpdate;
+	/// when the server thread last woke up for network events
+	spring_time lastNetEventTime;
 
 	float modGameTime;
 	float gameTime;
@@ -243,6 +272,47 @@ private:
 
 	std::list< std::vector<boost::shared_ptr<const netcode::RawPacket> > > packetCache;
 
+	struct StateSnapshot {
+		StateSnapshot(): frameNum(-1), playerNum(-1), numCachedPackets(0), totalSize(0), nextChecksum(0), hasNextChecksum(false) {}
+
+		bool IsComplete() const { return (frameNum >= 0 && !data.empty() && data.size() == totalSize); }
+		/// joiners can only be checked (and thus sent it) once the checksum after it is agreed on
+		bool IsUsable() const { return (IsComplete() && hasNextChecksum); }
+
+		int frameNum;
+		int playerNum;
+		/// packets in packetCache when it was requested, a midgame join gets only those after it
+		unsigned int numCachedPackets;
+		unsigned int totalSize;
+		std::vector<boost::uint8_t> data;
+
+		/// sync checksum of frameNum + 1, the first frame a joiner simulates after loading it
+		unsigned int nextChecksum;
+		bool hasNextChecksum;
+	};
+
+	/// frames between two snapshot requests, 0 if disabled (or the game can not be snapshotted)
+	int snapshotInterval;
+	/// newest complete game state, sent to midgame joiners instead of the start of packetCache
+	StateSnapshot stateSnapshot;
+	/// the one currently being uploaded
+	StateSnapshot pendingSnapshot;
+
+	/// whether remote clients announcing NETCAP_FRAMEBUNDLES get them
+	bool allowFrameBundles;
+	/// true while the server thread handles an update, broadcasts are then bundled
+	bool collectFrameBundle;
+	/// broadcasts of the current update, for all players with GameParticipant::useFrameBundles
+	netcode::FrameBundleWriter frameBundle;
+
+	static const unsigned int NUM_LATENCY_BUCKETS = 20;
+	/**
+	 * receive -> relay latency histogram of client messages, bucket i counts
+	 * messages that took [2^i, 2^(i+1)) microseconds (the first one covers
+	 * [0, 2), the last one is open-ended); sent to the autohost on request
+	 */
+	boost::uint32_t relayLatencyHist[NUM_LATENCY_BUCKETS];
+
 	/////////////////// sync stuff ///////////////////
 #ifdef SYNCCHECK
 	std::set<int> outstandingSyncFrames;
@@ -273,6 +343,8 @@ private:
 	boost::thread* thread;
 
 	mutable Threading::RecursiveMutex gameServerMutex;
+	/// nanoseconds, see PopLockWaitTime
+	std::atomic<boost::int64_t> lockWaitTime;
 
 	volatile bool gameHasStarted;
 	volatile bool generatedGameID;
@@ -212,6 +212,12 @@ float CGame::GetNetMessageProcessingTimeLimit() const
 
 void CGame::ClientReadNet()
 {
+	// export how far behind we are and how much the server thread blocks
+	profiler.SetCounter("Net::ServerQueueDepth", clientNet->GetNumWaitingServerPackets());
+
+	if (gameServer != NULL)
+		profiler.AddTime("GameServer::LockWait", gameServer->PopLockWaitTime());
+
 	// look ahead so we can adapt consumeSpeedMult to network fluctuations
 	UpdateNumQueuedSimFrames();
 
@@ -512,6 +518,16 @@ void CGame::ClientReadNet()
 				ASSERT_SYNCED(CSyncChecker::GetChecksum());
 				clientNet->Send(CBaseNetProtocol::Get().SendSyncResponse(gu->myPlayerNum, gs->frameNum, CSyncChecker::GetChecksum()));
 
+				if (sendSyncSections) {
+					std::vector<unsigned int> sectionChecksums(CSyncChecker::SECTION_COUNT);
+
+					for (unsigned int n = 0; n < CSyncChecker::SECTION_COUNT; ++n) {
+						sectionChecksums[n] = CSyncChecker::GetSectionChecksum(CSyncChecker::Section(n));
+					}
+
+					clientNet->Send(CBaseNetProtocol::Get().SendSyncSections(gu->myPlayerNum, gs->frameNum, sectionChecksums));
+				}
+
 				if (gameServer != NULL && gameServer->GetDemoReader() != NULL) {
 					// buffer all checksums, so we can check sync later between demo & local
 					mySyncChecksums[gs->frameNum] = CSyncChecker::GetChecksum();
@@ -561,6 +577,18 @@ void CGame::ClientReadNet()
 			} break;
 
 
+			case NETMSG_SNAPSHOT_REQUEST: {
+				const int frameNum = *reinterpret_cast<const int*>(inbuf + 1);
+
+				// the server expects the state right after <frameNum>,
+				// it will ask again later if we are not there (anymore)
+				if (frameNum == gs->frameNum)
+					SendStateSnapshot();
+
+				AddTraffic(-1, packetCode, dataLength);
+			} break;
+
+
 			case NETMSG_COMMAND: {
 				try {
 					netcode::UnpackPacket pckt(packet, 1);
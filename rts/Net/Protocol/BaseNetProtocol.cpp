@@ -85,11 +85,12 @@ PacketType CBaseNetProtocol::SendPathCheckSum(uchar myPlayerNum, boost::uint32_t
 }
 
 
-PacketType CBaseNetProtocol::SendCommand(uchar myPlayerNum, int id, uchar options, const std::vector<float>& params)
+PacketType CBaseNetProtocol::SendCommand(uchar myPlayerNum, int id, uchar options, const float* params, size_t numParams)
 {
-	unsigned size = 9 + params.size() * sizeof(float);
+	unsigned size = 9 + numParams * sizeof(float);
 	PackPacket* packet = new PackPacket(size, NETMSG_COMMAND);
-	*packet << static_cast<unsigned short>(size) << myPlayerNum << id << options << params;
+	*packet << static_cast<unsigned short>(size) << myPlayerNum << id << options;
+	packet->WriteArray(params, numParams);
 	return PacketType(packet);
 }
 
@@ -111,10 +112,10 @@ PacketType CBaseNetProtocol::SendPause(uchar myPlayerNum, uchar bPaused)
 
 
 
-PacketType CBaseNetProtocol::SendAICommand(uchar myPlayerNum, unsigned char aiID, short unitID, int id, int aiCommandId, uchar options, const std::vector<float>& params)
+PacketType CBaseNetProtocol::SendAICommand(uchar myPlayerNum, unsigned char aiID, short unitID, int id, int aiCommandId, uchar options, const float* params, size_t numParams)
 {
 	int cmdTypeId = NETMSG_AICOMMAND;
-	unsigned size = 12 + (params.size() * sizeof(float));
+	unsigned size = 12 + (numParams * sizeof(float));
 	if (aiCommandId != -1) {
 		cmdTypeId = NETMSG_AICOMMAND_TRACKED;
 		size += 4;
@@ -124,7 +125,7 @@ PacketType CBaseNetProtocol::SendAICommand(uchar myPlayerNum, unsigned char aiID
 	if (cmdTypeId == NETMSG_AICOMMAND_TRACKED) {
 		*packet << aiCommandId;
 	}
-	*packet << params;
+	packet->WriteArray(params, numParams);
 	return PacketType(packet);
 }
 
@@ -175,9 +176,9 @@ PacketType CBaseNetProtocol::SendDirectControlUpdate(uchar myPlayerNum, uchar st
 
 PacketType CBaseNetProtocol::SendAttemptConnect(const std::string& name, const std::string& passwd, const std::string& version, int netloss, bool reconnect)
 {
-	boost::uint16_t size = 10 + name.size() + passwd.size() + version.size();
+	boost::uint16_t size = 11 + name.size() + passwd.size() + version.size();
 	PackPacket* packet = new PackPacket(size , NETMSG_ATTEMPTCONNECT);
-	*packet << size << NETWORK_VERSION << name << passwd << version << uchar(reconnect) << uchar(netloss);
+	*packet << size << NETWORK_VERSION << name << passwd << version << uchar(reconnect) << uchar(netloss) << uchar(NETCAP_FRAMEBUNDLES);
 	return PacketType(packet);
 }
 
@@ -259,6 +260,31 @@ PacketType CBaseNetProtocol::SendSyncResponse(uchar myPlayerNum, int frameNum, u
 	return PacketType(packet);
 }
 
+PacketType CBaseNetProtocol::SendSyncSections(uchar myPlayerNum, int frameNum, const std::vector<uint>& sectionChecksums)
+{
+	const unsigned size = (3 * sizeof(uchar)) + sizeof(int) + (sectionChecksums.size() * sizeof(uint));
+	PackPacket* packet = new PackPacket(size, NETMSG_SYNCSECTIONS);
+	*packet << static_cast<uchar>(size) << myPlayerNum << frameNum << sectionChecksums;
+	return PacketType(packet);
+}
+
+PacketType CBaseNetProtocol::SendSnapshotRequest(int frameNum)
+{
+	PackPacket* packet = new PackPacket(5, NETMSG_SNAPSHOT_REQUEST);
+	*packet << frameNum;
+	return PacketType(packet);
+}
+
+PacketType CBaseNetProtocol::SendSnapshot(uchar playerNum, int frameNum, uint totalSize, uint offset, const std::vector<boost::uint8_t>& data)
+{
+	if ((16 + data.size()) >= (1 << (sizeof(boost::uint16_t) * 8)))
+		throw netcode::PackPacketException("Maximum size exceeded");
+	boost::uint16_t size = 16 + data.size();
+	PackPacket* packet = new PackPacket(size, NETMSG_SNAPSHOT);
+	*packet << size << playerNum << frameNum << totalSize << offset << data;
+	return PacketType(packet);
+}
+
 PacketType CBaseNetProtocol::SendSystemMessage(uchar myPlayerNum, std::string message)
 {
 	if (message.size() > 65000)
@@ -481,6 +507,10 @@ CBaseNetProtocol::CBaseNetProtocol()
 	proto->AddType(NETMSG_AI_CREATED, -1);
 	proto->AddType(NETMSG_AI_STATE_CHANGED, 4);
 	proto->AddType(NETMSG_GAME_FRAME_PROGRESS,5);
+	proto->AddType(NETMSG_FRAMEBUNDLE, -2);
+	proto->AddType(NETMSG_SYNCSECTIONS, -1);
+	proto->AddType(NETMSG_SNAPSHOT_REQUEST, 5);
+	proto->AddType(NETMSG_SNAPSHOT, -2);
 
 #ifdef SYNCDEBUG
 	proto->AddType(NETMSG_SD_CHKREQUEST, 5);
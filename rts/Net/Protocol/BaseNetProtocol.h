@@ -92,7 +92,7 @@ enum NETMSG {
 	NETMSG_CCOMMAND         = 54, // /* short! messageSize */, int! myPlayerNum, std::string command, std::string extra (each string ends with \0)
 	NETMSG_TEAMSTAT         = 60, // uchar teamNum, struct TeamStatistics statistics      # used by LadderBot #
 
-	NETMSG_ATTEMPTCONNECT   = 65, // ushort msgsize, ushort netversion, string playername, string passwd, string VERSION_STRING_DETAILED
+	NETMSG_ATTEMPTCONNECT   = 65, // ushort msgsize, ushort netversion, string playername, string passwd, string VERSION_STRING_DETAILED, uchar reconnect, uchar netloss, uchar netcaps (optional, NETCAP_* flags)
 
 	NETMSG_AI_CREATED       = 70, // /* uchar messageSize */, uchar myPlayerNum, uchar whichSkirmishAI, uchar team, std::string name (ends with \0)
 	NETMSG_AI_STATE_CHANGED = 71, // uchar myPlayerNum, uchar whichSkirmishAI, uchar newState
@@ -105,11 +105,24 @@ enum NETMSG {
 
 	NETMSG_GAME_FRAME_PROGRESS= 77, // int frameNum # this special packet skips queue & cache entirely, indicates current game progress for clients fast-forwarding to current point the game #
 
+	NETMSG_FRAMEBUNDLE      = 78, // ushort msgsize, bundle entries # several server messages packed into one, only sent to clients announcing NETCAP_FRAMEBUNDLES; unpacked by the connection, see netcode::FrameBundleReader #
+
+	NETMSG_SYNCSECTIONS     = 79, // uchar messageSize, uchar myPlayerNum, int frameNum, uint sectionChecksums[] # sent after NETMSG_SYNCRESPONSE by clients with SyncSectionChecksums enabled, see CSyncChecker::Section #
+
+	NETMSG_SNAPSHOT_REQUEST = 80, // int frameNum # sent by the server to one client, which answers with its game state after <frameNum> in NETMSG_SNAPSHOTs #
+	NETMSG_SNAPSHOT         = 81, // ushort msgsize, uchar playerNum, int frameNum, uint totalSize, uint offset, uchar data[] # a piece of a compressed game state (see CCregLoadSaveHandler::SaveSnapshot), sent to the server and by it to midgame joiners; totalSize 0 (no data) means the client can not make one #
+
 
 	NETMSG_LAST //max types of netmessages, internal only
 };
 
 
+/// optional protocol features a client announces in NETMSG_ATTEMPTCONNECT
+enum NETCAPS {
+	NETCAP_FRAMEBUNDLES = 1, // client unpacks NETMSG_FRAMEBUNDLE
+};
+
+
 /// sub-action-types of NETMSG_TEAM
 enum TEAMMSG {
 //	TEAMMSG_NAME            = number    parameter1, ...
@@ -152,11 +165,11 @@ public:
 	PacketType SendRandSeed(uint randSeed);
 	PacketType SendGameID(const uchar* buf);
 	PacketType SendPathCheckSum(uchar myPlayerNum, boost::uint32_t checksum);
-	PacketType SendCommand(uchar myPlayerNum, int id, uchar options, const std::vector<float>& params);
+	PacketType SendCommand(uchar myPlayerNum, int id, uchar options, const float* params, size_t numParams);
 	PacketType SendSelect(uchar myPlayerNum, const std::vector<short>& selectedUnitIDs);
 	PacketType SendPause(uchar myPlayerNum, uchar bPaused);
 
-	PacketType SendAICommand(uchar myPlayerNum, unsigned char aiID, short unitID, int id, int aiCommandId, uchar options, const std::vector<float>& params);
+	PacketType SendAICommand(uchar myPlayerNum, unsigned char aiID, short unitID, int id, int aiCommandId, uchar options, const float* params, size_t numParams);
 	PacketType SendAIShare(uchar myPlayerNum, unsigned char aiID, uchar sourceTeam, uchar destTeam, float metal, float energy, const std::vector<short>& unitIDs);
 
 	PacketType SendUserSpeed(uchar myPlayerNum, float userSpeed);
@@ -175,6 +188,9 @@ public:
 	PacketType SendMapDrawLine(uchar myPlayerNum, short x1, short z1, short x2, short z2, bool);
 	PacketType SendMapDrawPoint(uchar myPlayerNum, short x, short z, const std::string& label, bool);
 	PacketType SendSyncResponse(uchar myPlayerNum, int frameNum, uint checksum);
+	PacketType SendSyncSections(uchar myPlayerNum, int frameNum, const std::vector<uint>& sectionChecksums);
+	PacketType SendSnapshotRequest(int frameNum);
+	PacketType SendSnapshot(uchar playerNum, int frameNum, uint totalSize, uint offset, const std::vector<boost::uint8_t>& data);
 	PacketType SendSystemMessage(uchar myPlayerNum, std::string message);
 	PacketType SendStartPos(uchar myPlayerNum, uchar teamNum, uchar readyState, float x, float y, float z);
 	PacketType SendPlayerInfo(uchar myPlayerNum, float cpuUsage, int ping);
@@ -49,6 +49,7 @@ void CNetProtocol::InitClient(const char* server_addr, unsigned portnum, const s
 
 	netcode::UDPConnection* conn = new netcode::UDPConnection(configHandler->GetInt("SourcePort"), server_addr, portnum);
 	conn->Unmute();
+	conn->SetUnpackFrameBundles(true);
 	serverConn.reset(conn);
 	serverConn->SendData(CBaseNetProtocol::Get().SendAttemptConnect(userName, userPasswd, myVersion, globalConfig->networkLossFactor));
 	serverConn->Flush(true);
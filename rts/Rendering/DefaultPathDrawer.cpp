@@ -93,6 +93,10 @@ void DefaultPathDrawer::DrawInMiniMap()
 	glColor4f(1.0f, 1.0f, 0.0f, 0.7f);
 
 	for (const int2& sb: pe->updatedBlocks) {
+		// already updated out of order (block on an active path)
+		if ((pe->blockStates.nodeMask[pe->BlockPosToIdx(sb)] & PATHOPT_OBSOLETE) == 0)
+			continue;
+
 		const int blockIdxX = sb.x * pe->GetBlockSize();
 		const int blockIdxY = sb.y * pe->GetBlockSize();
 		glRectf(blockIdxX, blockIdxY, blockIdxX + pe->GetBlockSize(), blockIdxY + pe->GetBlockSize());
@@ -238,7 +242,8 @@ void DefaultPathDrawer::UpdateExtraTexture(int extraTex, int starty, int endy, i
 		} break;
 
 		case CLegacyInfoTextureHandler::drawPathCost: {
-			const PathNodeStateBuffer& maxResStates = pm->maxResPF->blockStates;
+			const CPathFinder* maxResPF = pm->maxResPF;
+			const PathNodeStateBuffer& maxResStates = maxResPF->blockStates;
 			const PathNodeStateBuffer& medResStates = pm->medResPE->blockStates;
 			const PathNodeStateBuffer& lowResStates = pm->lowResPE->blockStates;
 
@@ -261,7 +266,7 @@ void DefaultPathDrawer::UpdateExtraTexture(int extraTex, int starty, int endy, i
 					const unsigned int hy = ty << 1;
 
 					float gCost[3] = {
-						maxResStates.gCost[hy * mapDims.mapx + hx],
+						maxResPF->GetNodeCost(hy * mapDims.mapx + hx, NODE_COST_G),
 						medResStates.gCost[(hy / medResBlockSize) * medResBlocksX + (hx / medResBlockSize)],
 						lowResStates.gCost[(hy / lowResBlockSize) * lowResBlocksX + (hx / lowResBlockSize)],
 					};
@@ -358,7 +363,7 @@ void DefaultPathDrawer::Draw(const CPathFinder* pf) const {
 			p1.z = sqr.y * SQUARE_SIZE;
 			p1.y = CGround::GetHeightAboveWater(p1.x, p1.z, false) + 15.0f;
 
-		const unsigned int dir = pf->blockStates.nodeMask[square] & PATHOPT_CARDINALS;
+		const unsigned int dir = pf->GetNodeMask(square) & PATHOPT_CARDINALS;
 		const int2 obp = sqr - (CPathFinder::GetDirectionVectorsTable2D())[dir];
 		float3 p2;
 			p2.x = obp.x * SQUARE_SIZE;
@@ -11,6 +11,7 @@
 #include "S3OParser.h"
 #include "OBJParser.h"
 #include "AssParser.h"
+#include "ModelCache.h"
 #include "Sim/Misc/CollisionVolume.h"
 #include "System/FileSystem/FileHandler.h"
 #include "System/FileSystem/FileSystem.h"
@@ -208,11 +209,20 @@ S3DModel* C3DModelLoader::Load3DModel(std::string modelName)
 		S3DModel* model = NULL;
 		S3DModelPiece* root = NULL;
 
-		try {
-			model = p->Load(modelPath);
-		} catch (const content_error& ex) {
-			LOG_L(L_WARNING, "could not load model \"%s\" (reason: %s)", modelName.c_str(), ex.what());
-			goto dummy;
+		const bool cacheable = CModelCache::IsCacheable(p->GetType());
+
+		if (!cacheable || (model = CModelCache::Load(modelPath)) == NULL) {
+			try {
+				model = p->Load(modelPath);
+			} catch (const content_error& ex) {
+				LOG_L(L_WARNING, "could not load model \"%s\" (reason: %s)", modelName.c_str(), ex.what());
+				goto dummy;
+			}
+
+			// before the VBOs are created from it
+			if (cacheable) {
+				CModelCache::Save(model, modelPath);
+			}
 		}
 
 		if ((root = model->GetRootPiece()) != NULL) {
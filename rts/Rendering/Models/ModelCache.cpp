@@ -0,0 +1,486 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "ModelCache.h"
+#include "3DModelLog.h"
+#include "AssParser.h"
+#include "OBJParser.h"
+#include "S3OParser.h"
+#include "Game/GameVersion.h"
+#include "Rendering/Textures/S3OTextureHandler.h"
+#include "Sim/Misc/CollisionVolume.h"
+#include "System/CRC.h"
+#include "System/FileSystem/ArchiveScanner.h"
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/FileSystem/FileHandler.h"
+#include "System/FileSystem/FileQueryFlags.h"
+#include "System/FileSystem/FileSystem.h"
+#include "System/FileSystem/FileSystemAbstraction.h"
+#include "System/FileSystem/VFSHandler.h"
+#include "System/Log/ILog.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+/*
+ * cache entry layout (native byte order, it never leaves this machine)
+ *
+ *   char[8] magic, uint32 format version, string model path, uint32 content checksum
+ *   (which also covers the engine version and the vertex struct sizes)
+ *   model fields, root piece
+ *
+ * a piece is its common fields, the fields of its type (vertex arrays are
+ * stored as they are uploaded) and uint32 numChildren followed by those;
+ * strings are stored as uint32 length + chars, arrays as uint32 count + items
+ */
+static const char CACHE_MAGIC[8] = {'S', 'P', 'R', 'I', 'N', 'G', 'M', 'C'};
+static const boost::uint32_t CACHE_FORMAT_VER = 1;
+// versions of one model path that are kept, older ones are removed on save
+static const size_t MAX_ENTRIES_PER_MODEL = 4;
+
+
+class CModelCache::CacheWriter {
+public:
+	template<typename T> void Write(const T& value) {
+		const boost::uint8_t* p = reinterpret_cast<const boost::uint8_t*>(&value);
+		data.insert(data.end(), p, p + sizeof(T));
+	}
+	template<typename T> void Write(const std::vector<T>& values) {
+		Write<boost::uint32_t>(values.size());
+
+		if (values.empty())
+			return;
+
+		const boost::uint8_t* p = reinterpret_cast<const boost::uint8_t*>(&values[0]);
+		data.insert(data.end(), p, p + values.size() * sizeof(T));
+	}
+	void Write(const std::string& str) {
+		Write<boost::uint32_t>(str.size());
+		data.insert(data.end(), str.begin(), str.end());
+	}
+	void Write(const CMatrix44f& mat) {
+		for (const float f: mat.m) {
+			Write(f);
+		}
+	}
+
+	std::vector<boost::uint8_t> data;
+};
+
+class CModelCache::CacheReader {
+public:
+	CacheReader(const void* data, size_t size)
+		: pos(reinterpret_cast<const boost::uint8_t*>(data))
+		, end(pos + size)
+		, valid(true)
+	{}
+
+	template<typename T> T Read() {
+		T value = T();
+		if ((valid = valid && (size_t(end - pos) >= sizeof(T)))) {
+			memcpy(&value, pos, sizeof(T));
+			pos += sizeof(T);
+		}
+		return value;
+	}
+	template<typename T> void Read(std::vector<T>& values) {
+		const boost::uint32_t count = Read<boost::uint32_t>();
+
+		if (!(valid = valid && (size_t(end - pos) / sizeof(T) >= count)))
+			return;
+
+		values.resize(count);
+
+		if (count == 0)
+			return;
+
+		memcpy(&values[0], pos, count * sizeof(T));
+		pos += count * sizeof(T);
+	}
+	std::string ReadString() {
+		const boost::uint32_t size = Read<boost::uint32_t>();
+		if (!(valid = valid && (size_t(end - pos) >= size)))
+			return "";
+		pos += size;
+		return std::string(reinterpret_cast<const char*>(pos - size), size);
+	}
+	// CMatrix44f is not trivially copyable, so it is read element-wise
+	void Read(CMatrix44f& mat) {
+		for (float& f: mat.m) {
+			f = Read<float>();
+		}
+	}
+
+	bool IsValid() const { return valid; }
+	bool AtEnd() const { return (pos == end); }
+
+private:
+	const boost::uint8_t* pos;
+	const boost::uint8_t* end;
+	bool valid;
+};
+
+
+
+bool CModelCache::IsCacheable(ModelType type)
+{
+	// 3DO pieces reference the 3DO texture atlas, and the format is already
+	// binary, so there is little to gain for them
+	return (type == MODELTYPE_S3O || type == MODELTYPE_OBJ || type == MODELTYPE_ASS);
+}
+
+
+unsigned int CModelCache::GetContentChecksum(const std::string& modelPath)
+{
+	// the model, and the meta-files the OBJ and Assimp parsers read
+	const std::string filePaths[] = {
+		modelPath,
+		modelPath + ".lua",
+		FileSystem::GetDirectory(modelPath) + FileSystem::GetBasename(modelPath) + ".lua",
+	};
+
+	CRC crc;
+	crc << CACHE_FORMAT_VER;
+
+	// the vertex structs are stored as they are in memory, so entries
+	// written by another build are not trusted to share their layout
+	crc.Update(SpringVersion::GetSync().data(), SpringVersion::GetSync().size());
+	crc << unsigned(sizeof(SS3OVertex));
+	crc << unsigned(sizeof(SOBJTriangle));
+	crc << unsigned(sizeof(SAssVertex));
+
+	for (const std::string& filePath: filePaths) {
+		// the parsers prefer the raw filesystem, which has no checksums
+		if (CFileHandler::FileExists(filePath, SPRING_VFS_RAW))
+			return 0;
+
+		const std::string archiveName = vfsHandler->GetFileArchiveName(filePath);
+
+		if (archiveName.empty()) {
+			if (&filePath == &filePaths[0])
+				return 0;
+
+			// a missing meta-file counts too, adding one changes the model
+			crc << 0u;
+			continue;
+		}
+
+		const unsigned int archiveChecksum = archiveScanner->GetSingleArchiveChecksum(archiveName);
+
+		if (archiveChecksum == 0)
+			return 0;
+
+		crc << archiveChecksum;
+	}
+
+	return crc.GetDigest();
+}
+
+std::string CModelCache::GetCacheDir()
+{
+	static const std::string cacheDir = dataDirsAccess.LocateDir(FileSystem::GetCacheDir() + "/models/", FileQueryFlags::WRITE | FileQueryFlags::CREATE_DIRS);
+	return cacheDir;
+}
+
+std::string CModelCache::GetEntryFileName(const std::string& modelPath, unsigned int checksum)
+{
+	const std::string& cacheDir = GetCacheDir();
+
+	if (cacheDir.empty())
+		return "";
+
+	// games can ship different models under the same path, each version of
+	// a model gets its own entry so they do not keep replacing one another
+	char fileName[32];
+	SNPRINTF(fileName, sizeof(fileName), "%08x-%08x.smc", CRC::GetCRC(modelPath.data(), modelPath.size()), checksum);
+
+	return (cacheDir + fileName);
+}
+
+void CModelCache::PruneEntries(const std::string& modelPath)
+{
+	const std::string& cacheDir = GetCacheDir();
+
+	char pattern[32];
+	SNPRINTF(pattern, sizeof(pattern), "%08x-[0-9a-f]{8}\\.smc", CRC::GetCRC(modelPath.data(), modelPath.size()));
+
+	std::vector<std::string> entries;
+	FileSystemAbstraction::FindFiles(entries, cacheDir, "", pattern, 0);
+
+	if (entries.size() <= MAX_ENTRIES_PER_MODEL)
+		return;
+
+	// keep the most recently written versions, the dates sort as strings
+	std::vector< std::pair<std::string, std::string> > datedEntries;
+	datedEntries.reserve(entries.size());
+
+	for (const std::string& entry: entries) {
+		datedEntries.push_back(std::make_pair(FileSystemAbstraction::GetFileModificationDate(cacheDir + entry), entry));
+	}
+
+	std::sort(datedEntries.begin(), datedEntries.end());
+
+	for (size_t n = 0; n < datedEntries.size() - MAX_ENTRIES_PER_MODEL; n++) {
+		FileSystem::Remove(cacheDir + datedEntries[n].second);
+	}
+}
+
+
+
+S3DModel* CModelCache::Load(const std::string& modelPath)
+{
+	namespace bi = boost::interprocess;
+
+	const unsigned int checksum = GetContentChecksum(modelPath);
+	const std::string fileName = GetEntryFileName(modelPath, checksum);
+
+	if (checksum == 0 || fileName.empty() || !FileSystem::FileExists(fileName))
+		return NULL;
+
+	S3DModel* model = NULL;
+
+	try {
+		const bi::file_mapping mapping(fileName.c_str(), bi::read_only);
+		const bi::mapped_region region(mapping, bi::read_only);
+
+		CacheReader reader(region.get_address(), region.get_size());
+		char magic[sizeof(CACHE_MAGIC)];
+
+		for (char& c: magic) {
+			c = reader.Read<char>();
+		}
+
+		if (memcmp(magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || reader.Read<boost::uint32_t>() != CACHE_FORMAT_VER)
+			return NULL;
+		// a CRC collision of the path or the content checksum
+		if (reader.ReadString() != modelPath || reader.Read<boost::uint32_t>() != checksum)
+			return NULL;
+
+		model = new S3DModel();
+		model->name = modelPath;
+		model->type = ModelType(reader.Read<boost::uint32_t>());
+		model->tex1 = reader.ReadString();
+		model->tex2 = reader.ReadString();
+		model->numPieces = reader.Read<boost::int32_t>();
+		model->invertTexYAxis = reader.Read<boost::uint8_t>();
+		model->invertTexAlpha = reader.Read<boost::uint8_t>();
+		model->radius = reader.Read<float>();
+		model->height = reader.Read<float>();
+		model->drawRadius = reader.Read<float>();
+		model->mins = reader.Read<float3>();
+		model->maxs = reader.Read<float3>();
+		model->relMidPos = reader.Read<float3>();
+
+		if (reader.IsValid() && IsCacheable(model->type))
+			model->SetRootPiece(ReadPiece(reader, model, NULL));
+
+		if (!reader.IsValid() || !reader.AtEnd() || model->GetRootPiece() == NULL) {
+			LOG_SL(LOG_SECTION_MODEL, L_WARNING, "model cache entry \"%s\" of \"%s\" is not valid", fileName.c_str(), modelPath.c_str());
+
+			if (model->GetRootPiece() != NULL)
+				model->DeletePieces(model->GetRootPiece());
+
+			delete model;
+			return NULL;
+		}
+	} catch (const bi::interprocess_exception&) {
+		delete model;
+		return NULL;
+	}
+
+	texturehandlerS3O->LoadS3OTexture(model);
+	return model;
+}
+
+S3DModelPiece* CModelCache::ReadPiece(CacheReader& reader, S3DModel* model, S3DModelPiece* parent)
+{
+	S3DModelPiece* piece = NULL;
+
+	switch (model->type) {
+		case MODELTYPE_S3O: { piece = new SS3OPiece(); } break;
+		case MODELTYPE_OBJ: { piece = new SOBJPiece(); } break;
+		case MODELTYPE_ASS: { piece = new SAssPiece(); } break;
+		default: { assert(false); } break;
+	}
+
+	piece->parent = parent;
+	piece->name = reader.ReadString();
+	piece->parentName = reader.ReadString();
+	piece->axisMapType = AxisMappingType(reader.Read<boost::uint32_t>());
+	piece->hasGeometryData = reader.Read<boost::uint8_t>();
+	piece->hasIdentityRot = reader.Read<boost::uint8_t>();
+	reader.Read(piece->bakedRotMatrix);
+	piece->offset = reader.Read<float3>();
+	piece->goffset = reader.Read<float3>();
+	piece->scales = reader.Read<float3>();
+	piece->mins = reader.Read<float3>();
+	piece->maxs = reader.Read<float3>();
+	piece->rotAxisSigns = reader.Read<float3>();
+
+	if (reader.Read<boost::uint8_t>())
+		model->pieceMap[piece->name] = piece;
+
+	switch (model->type) {
+		case MODELTYPE_S3O: {
+			SS3OPiece* s3oPiece = static_cast<SS3OPiece*>(piece);
+			s3oPiece->primType = reader.Read<boost::int32_t>();
+			reader.Read(s3oPiece->vertices);
+			reader.Read(s3oPiece->vertexDrawIndices);
+		} break;
+		case MODELTYPE_OBJ: {
+			SOBJPiece* objPiece = static_cast<SOBJPiece*>(piece);
+			reader.Read(objPiece->vertices);
+			reader.Read(objPiece->vnormals);
+			reader.Read(objPiece->texcoors);
+			reader.Read(objPiece->triangles);
+			reader.Read(objPiece->sTangents);
+			reader.Read(objPiece->tTangents);
+		} break;
+		case MODELTYPE_ASS: {
+			SAssPiece* assPiece = static_cast<SAssPiece*>(piece);
+			assPiece->numTexCoorChannels = reader.Read<boost::uint32_t>();
+			reader.Read(assPiece->vertices);
+			reader.Read(assPiece->vertexDrawIndices);
+		} break;
+		default: {
+		} break;
+	}
+
+	// every parser sets up the same volume
+	piece->SetCollisionVolume(new CollisionVolume("box", piece->maxs - piece->mins, (piece->maxs + piece->mins) * 0.5f));
+
+	const boost::uint32_t numChildren = reader.Read<boost::uint32_t>();
+
+	for (boost::uint32_t n = 0; n < numChildren && reader.IsValid(); n++) {
+		piece->children.push_back(ReadPiece(reader, model, piece));
+	}
+
+	return piece;
+}
+
+
+
+void CModelCache::Save(const S3DModel* model, const std::string& modelPath)
+{
+	assert(IsCacheable(model->type));
+
+	const unsigned int checksum = GetContentChecksum(modelPath);
+	const std::string fileName = GetEntryFileName(modelPath, checksum);
+
+	if (checksum == 0 || fileName.empty() || model->GetRootPiece() == NULL)
+		return;
+
+	CacheWriter writer;
+
+	for (const char c: CACHE_MAGIC) {
+		writer.Write(c);
+	}
+
+	writer.Write(CACHE_FORMAT_VER);
+	writer.Write(modelPath);
+	writer.Write<boost::uint32_t>(checksum);
+
+	writer.Write<boost::uint32_t>(model->type);
+	writer.Write(model->tex1);
+	writer.Write(model->tex2);
+	writer.Write<boost::int32_t>(model->numPieces);
+	writer.Write<boost::uint8_t>(model->invertTexYAxis);
+	writer.Write<boost::uint8_t>(model->invertTexAlpha);
+	writer.Write(model->radius);
+	writer.Write(model->height);
+	writer.Write(model->drawRadius);
+	writer.Write(model->mins);
+	writer.Write(model->maxs);
+	writer.Write(model->relMidPos);
+
+	WritePiece(writer, model, model->GetRootPiece());
+
+	// write to a temporary first, an interrupted write must not leave a partial entry behind
+	const std::string tmpFileName = fileName + ".tmp";
+
+	FILE* out = fopen(tmpFileName.c_str(), "wb");
+	if (!out) {
+		LOG_SL(LOG_SECTION_MODEL, L_WARNING, "failed to write model cache entry \"%s\"", tmpFileName.c_str());
+		return;
+	}
+
+	const bool written = (fwrite(&writer.data[0], writer.data.size(), 1, out) == 1);
+
+	if ((fclose(out) == EOF) || !written) {
+		LOG_SL(LOG_SECTION_MODEL, L_WARNING, "failed to write model cache entry \"%s\"", tmpFileName.c_str());
+		remove(tmpFileName.c_str());
+		return;
+	}
+
+#ifdef _WIN32
+	// rename does not replace existing files there
+	remove(fileName.c_str());
+#endif
+
+	if (rename(tmpFileName.c_str(), fileName.c_str()) != 0) {
+		LOG_SL(LOG_SECTION_MODEL, L_WARNING, "failed to write model cache entry \"%s\"", fileName.c_str());
+		remove(tmpFileName.c_str());
+		return;
+	}
+
+	PruneEntries(modelPath);
+}
+
+void CModelCache::WritePiece(CacheWriter& writer, const S3DModel* model, const S3DModelPiece* piece)
+{
+	const ModelPieceMap::const_iterator it = model->pieceMap.find(piece->name);
+
+	writer.Write(piece->name);
+	writer.Write(piece->parentName);
+	writer.Write<boost::uint32_t>(piece->axisMapType);
+	writer.Write<boost::uint8_t>(piece->hasGeometryData);
+	writer.Write<boost::uint8_t>(piece->hasIdentityRot);
+	writer.Write(piece->bakedRotMatrix);
+	writer.Write(piece->offset);
+	writer.Write(piece->goffset);
+	writer.Write(piece->scales);
+	writer.Write(piece->mins);
+	writer.Write(piece->maxs);
+	writer.Write(piece->rotAxisSigns);
+
+	// not every parser fills the piece map
+	writer.Write<boost::uint8_t>(it != model->pieceMap.end() && it->second == piece);
+
+	switch (model->type) {
+		case MODELTYPE_S3O: {
+			const SS3OPiece* s3oPiece = static_cast<const SS3OPiece*>(piece);
+			writer.Write<boost::int32_t>(s3oPiece->primType);
+			writer.Write(s3oPiece->vertices);
+			writer.Write(s3oPiece->vertexDrawIndices);
+		} break;
+		case MODELTYPE_OBJ: {
+			const SOBJPiece* objPiece = static_cast<const SOBJPiece*>(piece);
+			writer.Write(objPiece->vertices);
+			writer.Write(objPiece->vnormals);
+			writer.Write(objPiece->texcoors);
+			writer.Write(objPiece->triangles);
+			writer.Write(objPiece->sTangents);
+			writer.Write(objPiece->tTangents);
+		} break;
+		case MODELTYPE_ASS: {
+			const SAssPiece* assPiece = static_cast<const SAssPiece*>(piece);
+			writer.Write<boost::uint32_t>(assPiece->numTexCoorChannels);
+			writer.Write(assPiece->vertices);
+			writer.Write(assPiece->vertexDrawIndices);
+		} break;
+		default: {
+		} break;
+	}
+
+	writer.Write<boost::uint32_t>(piece->GetChildCount());
+
+	for (unsigned int n = 0; n < piece->GetChildCount(); n++) {
+		WritePiece(writer, model, piece->GetChild(n));
+	}
+}
@@ -0,0 +1,46 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef MODEL_CACHE_H
+#define MODEL_CACHE_H
+
+#include <string>
+
+#include "3DModel.h"
+
+/**
+ * Keeps parsed S3O, OBJ and Assimp models in the cache-dir, with the vertex
+ * arrays in the layout their VBOs are created from, so loading a model again
+ * maps one file and copies those arrays instead of running the parser.
+ *
+ * An entry is only used while the archives providing the model and its
+ * meta-file have the checksums they had when it was written; models read
+ * from the raw filesystem are never cached.
+ */
+class CModelCache
+{
+public:
+	static bool IsCacheable(ModelType type);
+
+	/**
+	 * @return the model as it was saved (with its S3O textures loaded),
+	 *   NULL if there is no valid entry for the current content
+	 */
+	static S3DModel* Load(const std::string& modelPath);
+	static void Save(const S3DModel* model, const std::string& modelPath);
+
+private:
+	class CacheWriter;
+	class CacheReader;
+
+	/// @return 0 if the model can not be cached
+	static unsigned int GetContentChecksum(const std::string& modelPath);
+	static std::string GetCacheDir();
+	static std::string GetEntryFileName(const std::string& modelPath, unsigned int checksum);
+	/// removes all but the newest MAX_ENTRIES_PER_MODEL entries of the model
+	static void PruneEntries(const std::string& modelPath);
+
+	static void WritePiece(CacheWriter& writer, const S3DModel* model, const S3DModelPiece* piece);
+	static S3DModelPiece* ReadPiece(CacheReader& reader, S3DModel* model, S3DModelPiece* parent);
+};
+
+#endif /* MODEL_CACHE_H */
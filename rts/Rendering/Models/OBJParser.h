@@ -51,6 +51,9 @@ public:
 	void AddTxCoor(const float2& v) { texcoors.push_back(v); }
 
 private:
+	// reads and writes the geometry as a whole
+	friend class CModelCache;
+
 	VBO vboPositions;
 	VBO vboNormals;
 	VBO vboTexcoords;
@@ -48,6 +48,9 @@ struct SS3OPiece: public S3DModelPiece {
 	int primType;
 
 private:
+	// reads and writes the geometry as a whole
+	friend class CModelCache;
+
 	std::vector<SS3OVertex> vertices;
 	std::vector<unsigned int> vertexDrawIndices;
 };
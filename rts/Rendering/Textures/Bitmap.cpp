@@ -174,15 +174,22 @@ CBitmap& CBitmap::operator=(const CBitmap& bm)
 
 CBitmap& CBitmap::operator=(CBitmap&& bm)
 {
+	if (this == &bm)
+		return *this;
+
 	xsize = bm.xsize;
 	ysize = bm.ysize;
 	channels = bm.channels;
 	compressed = bm.compressed;
+
+	// our own contents must not leak
+	delete[] mem;
 	mem = bm.mem;
 	bm.mem = NULL;
 
 #ifndef BITMAP_NO_OPENGL
 	textype = bm.textype;
+	delete ddsimage;
 	ddsimage = bm.ddsimage;
 	bm.ddsimage = NULL;
 #endif // !BITMAP_NO_OPENGL
@@ -220,7 +227,8 @@ void CBitmap::AllocDummy(const SColor fill)
 bool CBitmap::Load(std::string const& filename, unsigned char defaultAlpha)
 {
 #ifndef BITMAP_NO_OPENGL
-	ScopedTimer timer("Textures::CBitmap::Load");
+	// bitmaps may be loaded from the thread pool
+	ScopedMtTimer timer("Textures::CBitmap::Load");
 #endif
 
 	bool noAlpha = true;
@@ -280,7 +288,8 @@ bool CBitmap::Load(std::string const& filename, unsigned char defaultAlpha)
 	unsigned char* buffer = new unsigned char[file.FileSize() + 2];
 	file.Read(buffer, file.FileSize());
 
-	boost::mutex::scoped_lock lck(devilMutex);
+	// only the DevIL part is serialized, file reads and post-processing are not
+	boost::unique_lock<boost::mutex> lck(devilMutex);
 	ilOriginFunc(IL_ORIGIN_UPPER_LEFT);
 	ilEnable(IL_ORIGIN_SET);
 
@@ -319,6 +328,7 @@ bool CBitmap::Load(std::string const& filename, unsigned char defaultAlpha)
 	memcpy(mem, ilGetData(), xsize * ysize * 4);
 
 	ilDeleteImages(1, &ImageName);
+	lck.unlock();
 
 	if (noAlpha) {
 		for (int y=0; y < ysize; ++y) {
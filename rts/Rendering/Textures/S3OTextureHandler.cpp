@@ -13,6 +13,7 @@
 #include "System/Exceptions.h"
 #include "System/Log/ILog.h"
 #include "System/Platform/Threading.h"
+#include "System/ThreadPool.h"
 
 #include <algorithm>
 #include <cctype>
@@ -73,22 +74,34 @@ int CS3OTextureHandler::LoadS3OTextureNow(const S3DModel* model)
 	};
 	TextureTableIt texTableIter;
 
-	if (texCacheIters[0] == textureCache.end()) {
-		if (!texBitMaps[0].Load(model->tex1)) {
-			if (!texBitMaps[0].Load("unittextures/" + model->tex1)) {
-				LOG_L(L_WARNING, "[%s] could not load texture \"%s\" from model \"%s\"",
-					__FUNCTION__, model->tex1.c_str(), model->name.c_str());
+	// decode both textures in parallel, the GL uploads below stay on this thread
+	for_mt(0, 2, [&](const int i) {
+		if (texCacheIters[i] != textureCache.end())
+			return;
+
+		const std::string& texName = (i == 0)? model->tex1: model->tex2;
+
+		if (!texBitMaps[i].Load(texName)) {
+			if (!texBitMaps[i].Load("unittextures/" + texName)) {
+				if (i == 0) {
+					LOG_L(L_WARNING, "[%s] could not load texture \"%s\" from model \"%s\"",
+						__FUNCTION__, texName.c_str(), model->name.c_str());
 
-				// file not found (or headless build), set single pixel to red so unit is visible
-				texBitMaps[0].AllocDummy(SColor(255, 0, 0, 255));
+					// file not found (or headless build), set single pixel to red so unit is visible
+					texBitMaps[i].AllocDummy(SColor(255, 0, 0, 255));
+				} else {
+					texBitMaps[i].AllocDummy(SColor(0, 0, 0, 255));
+				}
 			}
 		}
 
-		if (model->invertTexAlpha)
-			texBitMaps[0].InvertAlpha();
+		if (i == 0 && model->invertTexAlpha)
+			texBitMaps[i].InvertAlpha();
 		if (model->invertTexYAxis)
-			texBitMaps[0].ReverseYAxis();
+			texBitMaps[i].ReverseYAxis();
+	});
 
+	if (texCacheIters[0] == textureCache.end()) {
 		textureCache[model->tex1] = {
 			texBitMaps[0].CreateTexture(true),
 			static_cast<unsigned int>(texBitMaps[0].xsize),
@@ -97,15 +110,6 @@ int CS3OTextureHandler::LoadS3OTextureNow(const S3DModel* model)
 	}
 
 	if (texCacheIters[1] == textureCache.end()) {
-		if (!texBitMaps[1].Load(model->tex2)) {
-			if (!texBitMaps[1].Load("unittextures/" + model->tex2)) {
-				texBitMaps[1].AllocDummy(SColor(0, 0, 0, 255));
-			}
-		}
-
-		if (model->invertTexYAxis)
-			texBitMaps[1].ReverseYAxis();
-
 		textureCache[model->tex2] = {
 			texBitMaps[1].CreateTexture(true),
 			static_cast<unsigned int>(texBitMaps[1].xsize),
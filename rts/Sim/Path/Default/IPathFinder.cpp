@@ -148,23 +148,8 @@ IPath::SearchResult IPathFinder::GetPath(
 }
 
 
-// set up the starting point of the search
-IPath::SearchResult IPathFinder::InitSearch(const MoveDef& moveDef, const CPathFinderDef& pfDef, const CSolidObject* owner)
+void IPathFinder::InitStartBlock()
 {
-	int2 square = mStartBlock;
-	if (isEstimator) {
-		square = blockStates.peNodeOffsets[moveDef.pathType][mStartBlockIdx];
-	}
-	const bool isStartGoal = pfDef.IsGoal(square.x, square.y);
-
-	// although our starting square may be inside the goal radius, the starting coordinate may be outside.
-	// in this case we do not want to return CantGetCloser, but instead a path to our starting square.
-	if (isStartGoal && pfDef.startInGoalRadius)
-		return IPath::CantGetCloser;
-
-	// no, clean the system from last search
-	ResetSearch();
-
 	// mark and store the start-block
 	blockStates.nodeMask[mStartBlockIdx] &= PATHOPT_OBSOLETE; // clear all except PATHOPT_OBSOLETE
 	blockStates.nodeMask[mStartBlockIdx] |= PATHOPT_OPEN;
@@ -184,6 +169,27 @@ IPath::SearchResult IPathFinder::InitSearch(const MoveDef& moveDef, const CPathF
 		ob->nodePos = mStartBlock;
 		ob->nodeNum = mStartBlockIdx;
 	openBlocks.push(ob);
+}
+
+
+// set up the starting point of the search
+IPath::SearchResult IPathFinder::InitSearch(const MoveDef& moveDef, const CPathFinderDef& pfDef, const CSolidObject* owner)
+{
+	int2 square = mStartBlock;
+	if (isEstimator) {
+		square = blockStates.peNodeOffsets[moveDef.pathType][mStartBlockIdx];
+	}
+	const bool isStartGoal = pfDef.IsGoal(square.x, square.y);
+
+	// although our starting square may be inside the goal radius, the starting coordinate may be outside.
+	// in this case we do not want to return CantGetCloser, but instead a path to our starting square.
+	if (isStartGoal && pfDef.startInGoalRadius)
+		return IPath::CantGetCloser;
+
+	// no, clean the system from last search
+	ResetSearch();
+
+	InitStartBlock();
 
 	// mark starting point as best found position
 	mGoalBlockIdx  = mStartBlockIdx;
@@ -24,7 +24,7 @@ public:
 
 	// size of the memory-region we hold allocated (excluding sizeof(*this))
 	// (PathManager stores HeatMap and FlowMap, so we do not need to add them)
-	size_t GetMemFootPrint() const { return (blockStates.GetMemFootPrint()); }
+	virtual size_t GetMemFootPrint() const { return (blockStates.GetMemFootPrint()); }
 
 	PathNodeStateBuffer& GetNodeStateBuffer() { return blockStates; }
 
@@ -70,7 +70,10 @@ protected:
 	IPath::SearchResult InitSearch(const MoveDef&, const CPathFinderDef&, const CSolidObject* owner);
 
 	/// Clear things up from last search.
-	void ResetSearch();
+	virtual void ResetSearch();
+
+	/// Mark the start-block and add it to the queue of open blocks.
+	virtual void InitStartBlock();
 
 protected: // pure virtuals
 	virtual IPath::SearchResult DoSearch(const MoveDef&, const CPathFinderDef&, const CSolidObject* owner) = 0;
@@ -25,7 +25,15 @@ static const float MIN_MAXRES_SEARCH_DISTANCE = 12.0f;
 // how many recursive refinement attempts NextWayPoint should make
 static const unsigned int MAX_PATH_REFINEMENT_DEPTH = 4;
 
-static const unsigned int PATHESTIMATOR_VERSION = 72;
+// NOTE: bump when the PF or PE search changes the costs or tie-order of results
+static const unsigned int PATHESTIMATOR_VERSION = 73;
+
+// f-cost range of one PathBucketQueue bucket; a max-res step costs at
+// least 1.0 (times the speed-mod), so with a quarter of that successors
+// of the popped node almost always land in one of the next few buckets
+// while every bucket stays small enough for its heap to be cheap; the
+// 512 buckets then cover 128 cost units before the queue has to re-base
+static const float PATH_BUCKET_WIDTH = 0.25f;
 
 static const unsigned int MEDRES_PE_BLOCKSIZE =  8;
 static const unsigned int LOWRES_PE_BLOCKSIZE = 32;
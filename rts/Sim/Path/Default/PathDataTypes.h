@@ -6,6 +6,8 @@
 #include <queue>
 #include <vector>
 #include <algorithm> // for std::fill
+#include <cassert>
+#include <limits>
 
 #include "PathConstants.h"
 #include "System/type2.h"
@@ -54,6 +56,8 @@ public:
 	const PathNode* GetNode(unsigned int i) const { return &buffer[i]; }
 	      PathNode* GetNode(unsigned int i)       { return &buffer[i]; }
 
+	unsigned int GetNodeIdx(const PathNode* n) const { return (n - &buffer[0]); }
+
 private:
 	/// index of the most recently added node
 	unsigned int idx;
@@ -70,9 +74,12 @@ struct PathNodeStateBuffer {
 		, br(bufRes)
 		, mr(mapRes)
 	{
-		fCost.resize(br.x * br.y, PATHCOST_INFINITY);
-		gCost.resize(br.x * br.y, PATHCOST_INFINITY);
-		nodeMask.resize(br.x * br.y, 0);
+		// the PF keeps its per-square search state in a PathSearchStateBuffer
+		if (bufRes != mapRes) {
+			fCost.resize(br.x * br.y, PATHCOST_INFINITY);
+			gCost.resize(br.x * br.y, PATHCOST_INFINITY);
+			nodeMask.resize(br.x * br.y, 0);
+		}
 
 		// create on-demand
 		//extraCostSynced.resize(br.x * br.y, 0.0f);
@@ -88,7 +95,7 @@ struct PathNodeStateBuffer {
 		maxCosts[NODE_COST_H] = 0.0f;
 	}
 
-	unsigned int GetSize() const { return fCost.size(); }
+	unsigned int GetSize() const { return (br.x * br.y); }
 
 	void ClearSquare(int idx) {
 		//assert(idx>=0 && idx<fCost.size());
@@ -222,6 +229,72 @@ private:
 
 
 
+/// compact per-square search state of the max-res PF
+///
+/// entries are stamped with the generation of the search that last wrote
+/// them, so starting a new search only has to bump the generation instead
+/// of resetting every square touched by the previous one; costs are kept
+/// in the PathNodeBuffer and referenced by a 16-bit index (they are not
+/// stored per square, so narrowing them to 16 bits would not shrink this
+/// map-sized state but only quantize the synced path costs)
+struct PathSearchStateBuffer {
+public:
+	struct NodeState {
+		NodeState(): searchGen(0), nodeIdx(0), nodeMask(0) {}
+
+		boost::uint16_t searchGen;
+		/// index of the most recent PathNode pushed for this square
+		boost::uint16_t nodeIdx;
+		/// bitmask of PATHOPT_{OPEN, ..., OBSOLETE} flags
+		boost::uint8_t nodeMask;
+	};
+
+	PathSearchStateBuffer(unsigned int size): searchGen(0) {
+		nodeStates.resize(size);
+	}
+
+	void NextSearch() {
+		if ((++searchGen) != 0)
+			return;
+
+		// generation wrapped around, stale entries would alias the new one
+		std::fill(nodeStates.begin(), nodeStates.end(), NodeState());
+		searchGen = 1;
+	}
+
+	boost::uint8_t GetNodeMask(unsigned int idx) const {
+		const NodeState& ns = nodeStates[idx];
+		return ((ns.searchGen == searchGen)? ns.nodeMask: 0);
+	}
+
+	/// only meaningful if GetNodeMask(idx) has PATHOPT_OPEN or PATHOPT_CLOSED set
+	unsigned int GetNodeIdx(unsigned int idx) const { return nodeStates[idx].nodeIdx; }
+
+	NodeState& GetNodeState(unsigned int idx) {
+		NodeState& ns = nodeStates[idx];
+
+		if (ns.searchGen != searchGen) {
+			ns.searchGen = searchGen;
+			ns.nodeIdx = 0;
+			ns.nodeMask = 0;
+		}
+
+		return ns;
+	}
+
+	unsigned int GetSize() const { return nodeStates.size(); }
+	unsigned int GetMemFootPrint() const { return (nodeStates.size() * sizeof(NodeState)); }
+
+private:
+	std::vector<NodeState> nodeStates;
+
+	boost::uint16_t searchGen;
+};
+
+static_assert(MAX_SEARCHED_NODES_PF <= (1 << 16), "PathSearchStateBuffer::NodeState::nodeIdx too small to index MAX_SEARCHED_NODES_PF nodes");
+
+
+
 // looks like a std::vector, but holds a fixed-size buffer
 // used as a backing array for the PathPriorityQueue dtype
 class PathVector {
@@ -295,4 +368,112 @@ public:
 	void Clear() { c.clear(); }
 };
 
+
+
+/// open-list of the max-res PF
+///
+/// nodes are binned by f-cost into buckets of fixed width and only the
+/// lowest non-empty bucket is kept heap-ordered; since f-costs along an
+/// A* search are (nearly) non-decreasing most pushes become an append.
+/// Nodes cheaper than the active bucket go straight into the heap, so
+/// pops are still exact when the heuristic is not consistent.
+class PathBucketQueue {
+public:
+	static const unsigned int NUM_BUCKETS = 512;
+
+	PathBucketQueue(float bucketWidth = PATH_BUCKET_WIDTH)
+		: invBucketWidth(1.0f / bucketWidth)
+		, baseCost(0.0f)
+		, curBucket(0)
+		, numNodes(0)
+	{
+		activeNodes.reserve(1024);
+	}
+
+	bool empty() const { return (numNodes == 0); }
+	unsigned int size() const { return numNodes; }
+
+	PathNode* top() const { return activeNodes.front(); }
+
+	void push(PathNode* n) {
+		if (numNodes++ == 0) {
+			baseCost = n->fCost;
+			curBucket = 0;
+		}
+
+		const float bucket = (n->fCost - baseCost) * invBucketWidth;
+
+		if (bucket < (curBucket + 1)) {
+			activeNodes.push_back(n);
+			std::push_heap(activeNodes.begin(), activeNodes.end(), lessCost());
+			return;
+		}
+
+		if (bucket >= NUM_BUCKETS) {
+			overflowNodes.push_back(n);
+			return;
+		}
+
+		buckets[static_cast<unsigned int>(bucket)].push_back(n);
+	}
+
+	void pop() {
+		std::pop_heap(activeNodes.begin(), activeNodes.end(), lessCost());
+		activeNodes.pop_back();
+
+		if ((--numNodes) == 0 || !activeNodes.empty())
+			return;
+
+		NextBucket();
+	}
+
+	void Clear() {
+		for (unsigned int i = curBucket; i < NUM_BUCKETS; i++) {
+			buckets[i].clear();
+		}
+
+		activeNodes.clear();
+		overflowNodes.clear();
+
+		baseCost = 0.0f;
+		curBucket = 0;
+		numNodes = 0;
+	}
+
+private:
+	void NextBucket() {
+		// buckets below curBucket are always empty
+		for (curBucket += 1; curBucket < NUM_BUCKETS; curBucket++) {
+			if (buckets[curBucket].empty())
+				continue;
+
+			activeNodes.swap(buckets[curBucket]);
+			std::make_heap(activeNodes.begin(), activeNodes.end(), lessCost());
+			return;
+		}
+
+		// all buckets drained, re-base on the overflowed nodes
+		std::vector<PathNode*> nodes;
+		nodes.swap(overflowNodes);
+
+		assert(nodes.size() == numNodes);
+		numNodes = 0;
+
+		for (PathNode* n: nodes) {
+			push(n);
+		}
+	}
+
+private:
+	std::vector<PathNode*> activeNodes;
+	std::vector<PathNode*> overflowNodes;
+	std::vector<PathNode*> buckets[NUM_BUCKETS];
+
+	float invBucketWidth;
+	float baseCost;
+
+	unsigned int curBucket;
+	unsigned int numNodes;
+};
+
 #endif // PATH_DATATYPES_H
@@ -4,7 +4,9 @@
 
 #include "PathEstimator.h"
 
+#include <algorithm>
 #include <fstream>
+#include <functional>
 #include <boost/bind.hpp>
 #include <boost/thread/barrier.hpp>
 #include <boost/thread/thread.hpp>
@@ -58,6 +60,7 @@ CPathEstimator::CPathEstimator(IPathFinder* pf, unsigned int BLOCK_SIZE, const s
 	, costBlockNum(nbrOfBlocks.x * nbrOfBlocks.y)
 	, pathFinder(pf)
 	, nextPathEstimator(nullptr)
+	, numQueuedBlocks(0)
 	, blockUpdatePenalty(0)
 {
 	vertexCosts.resize(moveDefHandler->GetNumMoveDefs() * blockStates.GetSize() * PATH_DIRECTION_VERTICES, PATHCOST_INFINITY);
@@ -90,6 +93,11 @@ CPathEstimator::CPathEstimator(IPathFinder* pf, unsigned int BLOCK_SIZE, const s
 
 CPathEstimator::~CPathEstimator()
 {
+	// slot 0 is the runtime IPathFinder, owned by CPathManager
+	for (unsigned int i = 1; i < pathFinders.size(); i++) {
+		delete pathFinders[i];
+	}
+
 	delete pathCache[0]; pathCache[0] = NULL;
 	delete pathCache[1]; pathCache[1] = NULL;
 }
@@ -148,6 +156,7 @@ void CPathEstimator::InitEstimator(const std::string& cacheFileName, const std::
 			threads[i]->join();
 			delete threads[i];
 			delete pathFinders[i];
+			pathFinders[i] = nullptr;
 		}
 
 		delete pathBarrier;
@@ -416,21 +425,76 @@ void CPathEstimator::MapChanged(unsigned int x1, unsigned int z1, unsigned int x
 
 			updatedBlocks.emplace_back(x, z);
 			blockStates.nodeMask[idx] |= PATHOPT_OBSOLETE;
+			numQueuedBlocks++;
 		}
 	}
 }
 
 
+void CPathEstimator::PrioritizeBlocks(const IPath::path_list_type& waypoints)
+{
+	for (const float3& wp: waypoints) {
+		const int2 blockPos = int2(wp.x / BLOCK_PIXEL_SIZE, wp.z / BLOCK_PIXEL_SIZE);
+
+		if ((unsigned)blockPos.x >= nbrOfBlocks.x || (unsigned)blockPos.y >= nbrOfBlocks.y)
+			continue;
+
+		const int idx = BlockPosToIdx(blockPos);
+
+		if ((blockStates.nodeMask[idx] & PATHOPT_OBSOLETE) == 0)
+			continue;
+
+		priorityBlocks.push_back(idx);
+	}
+}
+
+
+/**
+ * Create the private CPathFinder instances used to recalculate vertices
+ * in parallel; the estimators layered on top of another PE stay serial
+ * since the PE's own search state and cache are not thread-safe.
+ * Returns the number of usable instances.
+ */
+unsigned int CPathEstimator::InitUpdateFinders(unsigned int numBlocks)
+{
+	CPathFinder* maxResPF = dynamic_cast<CPathFinder*>(pathFinder);
+
+	if (maxResPF == nullptr || numBlocks <= 1)
+		return 1;
+
+	const unsigned int minMemFootPrint = sizeof(CPathFinder) + maxResPF->GetMemFootPrint();
+	const unsigned int maxMemFootPrint = configHandler->GetInt("MaxPathCostsMemoryFootPrint") * 1024 * 1024;
+	const unsigned int maxNumFinders = Clamp(int(maxMemFootPrint / minMemFootPrint), 1, ThreadPool::GetMaxThreads());
+	const unsigned int numFinders = std::min(numBlocks, std::min(maxNumFinders, unsigned(pathFinders.size())));
+
+	for (unsigned int i = 1; i < numFinders; i++) {
+		if (pathFinders[i] != nullptr)
+			continue;
+
+		// share the node extra-costs of the runtime PF so results do not depend on the instance
+		pathFinders[i] = new CPathFinder(&maxResPF->GetNodeStateBuffer());
+	}
+
+	return numFinders;
+}
+
+
 /**
- * Update some obsolete blocks using the FIFO-principle
+ * Update some obsolete blocks, those on active paths first and
+ * the rest using the FIFO-principle
  */
 void CPathEstimator::Update()
 {
 	pathCache[0]->Update();
 	pathCache[1]->Update();
 
+	// blocks can be on several paths, keep the upper-to-lower order of MapChanged
+	std::sort(priorityBlocks.begin(), priorityBlocks.end(), std::greater<unsigned int>());
+	priorityBlocks.erase(std::unique(priorityBlocks.begin(), priorityBlocks.end()), priorityBlocks.end());
+
 	const auto numMoveDefs = moveDefHandler->GetNumMoveDefs();
 	if (numMoveDefs == 0) {
+		priorityBlocks.clear();
 		return;
 	}
 
@@ -438,9 +502,9 @@ void CPathEstimator::Update()
 	int blocksToUpdate = 0;
 	int consumeBlocks = 0;
 	{
-		const int progressiveUpdates = updatedBlocks.size() * numMoveDefs * modInfo.pfUpdateRate;
+		const int progressiveUpdates = numQueuedBlocks * numMoveDefs * modInfo.pfUpdateRate;
 		const int MIN_BLOCKS_TO_UPDATE = std::max<int>(BLOCKS_TO_UPDATE >> 1, 4U);
-		const int MAX_BLOCKS_TO_UPDATE = std::max<int>(BLOCKS_TO_UPDATE << 1, MIN_BLOCKS_TO_UPDATE);
+		const int MAX_BLOCKS_TO_UPDATE = std::max<int>(BLOCKS_TO_UPDATE << 2, MIN_BLOCKS_TO_UPDATE);
 		blocksToUpdate = Clamp(progressiveUpdates, MIN_BLOCKS_TO_UPDATE, MAX_BLOCKS_TO_UPDATE);
 
 		blockUpdatePenalty = std::max(0, blockUpdatePenalty - blocksToUpdate);
@@ -454,11 +518,10 @@ void CPathEstimator::Update()
 		blockUpdatePenalty += consumeBlocks;
 	}
 
-	if (blocksToUpdate == 0)
-		return;
-
-	if (updatedBlocks.empty())
+	if (blocksToUpdate == 0 || numQueuedBlocks == 0) {
+		priorityBlocks.clear();
 		return;
+	}
 
 	struct SingleBlock {
 		int2 blockPos;
@@ -468,20 +531,7 @@ void CPathEstimator::Update()
 	std::vector<SingleBlock> consumedBlocks;
 	consumedBlocks.reserve(consumeBlocks);
 
-	// get blocks to update
-	while (!updatedBlocks.empty()) {
-		int2& pos = updatedBlocks.front();
-		const int idx = BlockPosToIdx(pos);
-
-		if ((blockStates.nodeMask[idx] & PATHOPT_OBSOLETE) == 0) {
-			updatedBlocks.pop_front();
-			continue;
-		}
-
-		if (consumedBlocks.size() >= blocksToUpdate) {
-			break;
-		}
-
+	const auto ConsumeBlock = [&](const int2 pos, const int idx) {
 		// issue repathing for all active movedefs
 		for (unsigned int i = 0; i < numMoveDefs; i++) {
 			const MoveDef* md = moveDefHandler->GetMoveDefByPathType(i);
@@ -493,8 +543,41 @@ void CPathEstimator::Update()
 		if (nextPathEstimator)
 			nextPathEstimator->MapChanged(pos.x * BLOCK_SIZE, pos.y * BLOCK_SIZE, pos.x * BLOCK_SIZE, pos.y * BLOCK_SIZE);
 
-		updatedBlocks.pop_front(); // must happen _after_ last usage of the `pos` reference!
+		// its entry in updatedBlocks (if still queued) is skipped once reached
 		blockStates.nodeMask[idx] &= ~PATHOPT_OBSOLETE;
+		numQueuedBlocks--;
+	};
+
+	// get blocks to update, those on active paths first
+	for (unsigned int n = 0; n < priorityBlocks.size(); n++) {
+		const int idx = priorityBlocks[n];
+
+		if ((blockStates.nodeMask[idx] & PATHOPT_OBSOLETE) == 0)
+			continue;
+
+		if (consumedBlocks.size() >= blocksToUpdate)
+			break;
+
+		ConsumeBlock(BlockIdxToPos(idx), idx);
+	}
+
+	priorityBlocks.clear();
+
+	while (!updatedBlocks.empty()) {
+		const int2 pos = updatedBlocks.front();
+		const int idx = BlockPosToIdx(pos);
+
+		if ((blockStates.nodeMask[idx] & PATHOPT_OBSOLETE) == 0) {
+			updatedBlocks.pop_front();
+			continue;
+		}
+
+		if (consumedBlocks.size() >= blocksToUpdate) {
+			break;
+		}
+
+		ConsumeBlock(pos, idx);
+		updatedBlocks.pop_front();
 	}
 
 	// FindOffset (threadsafe)
@@ -509,14 +592,21 @@ void CPathEstimator::Update()
 		});
 	}
 
-	// CalculateVertices (not threadsafe)
+	// CalculateVertices (threadsafe as long as each task has its own pathfinder)
+	//
+	// every block only writes the vertices it owns, and since each search is
+	// independent of which CPathFinder instance runs it the results are the
+	// same regardless of the number of threads
 	{
 		SCOPED_TIMER("CPathEstimator::CalculateVertices");
-		for (unsigned int n = 0; n < consumedBlocks.size(); ++n) {
-			// copy the next block in line
-			const SingleBlock sb = consumedBlocks[n];
-			CalculateVertices(*sb.moveDef, sb.blockPos);
-		}
+		const unsigned int numFinders = InitUpdateFinders(consumedBlocks.size());
+
+		for_mt(0, numFinders, [&](const int i) {
+			for (unsigned int n = i; n < consumedBlocks.size(); n += numFinders) {
+				const SingleBlock& sb = consumedBlocks[n];
+				CalculateVertices(*sb.moveDef, sb.blockPos, i);
+			}
+		});
 	}
 }
 
@@ -57,11 +57,21 @@ public:
 	 */
 	void MapChanged(unsigned int x1, unsigned int z1, unsigned int x2, unsigned int z2);
 
+	/**
+	 * Moves obsolete blocks under the given (synced) path's waypoints to
+	 * the front of the update-queue for the next Update() call, so paths
+	 * in use are re-estimated before the rest of a changed area.
+	 */
+	void PrioritizeBlocks(const IPath::path_list_type& waypoints);
+
 	/**
 	 * called every frame
 	 */
 	void Update();
 
+	/// number of distinct blocks waiting for their vertices to be updated
+	unsigned int GetNumQueuedBlocks() const { return numQueuedBlocks; }
+
 	/**
 	 * Returns a checksum that can be used to check if every player has the same
 	 * path data.
@@ -111,6 +121,7 @@ private:
 	int2 FindOffset(const MoveDef&, unsigned int, unsigned int) const;
 	void CalculateVertices(const MoveDef&, int2, unsigned int threadNum = 0);
 	void CalculateVertex(const MoveDef&, int2, unsigned int, unsigned int threadNum = 0);
+	unsigned int InitUpdateFinders(unsigned int numBlocks);
 
 	bool ReadFile(const std::string& cacheFileName, const std::string& map);
 	void WriteFile(const std::string& cacheFileName, const std::string& map);
@@ -142,7 +153,9 @@ private:
 
 	std::vector<float> vertexCosts;	
 	std::deque<int2> updatedBlocks;       /// Blocks that may need an update due to map changes.
+	std::vector<unsigned int> priorityBlocks; /// Obsolete blocks on active paths, consumed first.
 
+	unsigned int numQueuedBlocks;
 	int blockUpdatePenalty;
 
 	struct SOffsetBlock {
@@ -30,8 +30,10 @@ static  float PF_DIRECTION_COSTS[PATH_DIRECTIONS << 1];
 
 
 
-CPathFinder::CPathFinder()
+CPathFinder::CPathFinder(const PathNodeStateBuffer* _extraCostStates)
 	: IPathFinder(1)
+	, extraCostStates((_extraCostStates != nullptr)? _extraCostStates: &blockStates)
+	, searchStates(nbrOfBlocks.x * nbrOfBlocks.y)
 {
 }
 
@@ -60,6 +62,51 @@ const   int2* CPathFinder::GetDirectionVectorsTable2D() { return (&PF_DIRECTION_
 const float3* CPathFinder::GetDirectionVectorsTable3D() { return (&PF_DIRECTION_VECTORS_3D[0]); }
 
 
+float CPathFinder::GetNodeCost(unsigned int sqrIdx, unsigned int costType) const {
+	if ((searchStates.GetNodeMask(sqrIdx) & (PATHOPT_OPEN | PATHOPT_CLOSED)) == 0)
+		return PATHCOST_INFINITY;
+
+	const PathNode* node = openBlockBuffer.GetNode(searchStates.GetNodeIdx(sqrIdx));
+
+	switch (costType) {
+		case NODE_COST_F: { return (node->fCost); } break;
+		case NODE_COST_G: { return (node->gCost); } break;
+		case NODE_COST_H: { return (node->fCost - node->gCost); } break;
+	}
+
+	return PATHCOST_INFINITY;
+}
+
+
+
+void CPathFinder::ResetSearch()
+{
+	// squares touched by the previous search are invalidated lazily
+	searchStates.NextSearch();
+	openSquares.Clear();
+
+	testedBlocks = 0;
+}
+
+void CPathFinder::InitStartBlock()
+{
+	PathSearchStateBuffer::NodeState& ns = searchStates.GetNodeState(mStartBlockIdx);
+	ns.nodeMask = PATHOPT_OPEN;
+	ns.nodeIdx = 0;
+
+	blockStates.SetMaxCost(NODE_COST_F, 0.0f);
+	blockStates.SetMaxCost(NODE_COST_G, 0.0f);
+
+	openBlockBuffer.SetSize(0);
+	PathNode* os = openBlockBuffer.GetNode(openBlockBuffer.GetSize());
+		os->fCost   = 0.0f;
+		os->gCost   = 0.0f;
+		os->nodePos = mStartBlock;
+		os->nodeNum = mStartBlockIdx;
+	openSquares.push(os);
+}
+
+
 
 IPath::SearchResult CPathFinder::DoSearch(
 	const MoveDef& moveDef,
@@ -68,13 +115,13 @@ IPath::SearchResult CPathFinder::DoSearch(
 ) {
 	bool foundGoal = false;
 
-	while (!openBlocks.empty() && (openBlockBuffer.GetSize() < maxBlocksToBeSearched)) {
+	while (!openSquares.empty() && (openBlockBuffer.GetSize() < maxBlocksToBeSearched)) {
 		// Get the open square with lowest expected path-cost.
-		PathNode* openSquare = const_cast<PathNode*>(openBlocks.top());
-		openBlocks.pop();
+		PathNode* openSquare = openSquares.top();
+		openSquares.pop();
 
-		// check if this PathNode has become obsolete
-		if (blockStates.fCost[openSquare->nodeNum] != openSquare->fCost)
+		// check if this PathNode has become obsolete (superseded by a cheaper one)
+		if (searchStates.GetNodeIdx(openSquare->nodeNum) != openBlockBuffer.GetNodeIdx(openSquare))
 			continue;
 
 		// Check if the goal is reached.
@@ -96,7 +143,7 @@ IPath::SearchResult CPathFinder::DoSearch(
 		return IPath::GoalOutOfRange;
 
 	// could not reach goal from this starting position if nothing to left to explore
-	if (openBlocks.empty())
+	if (openSquares.empty())
 		return IPath::GoalOutOfRange;
 
 	// should be unreachable
@@ -111,8 +158,7 @@ void CPathFinder::TestNeighborSquares(
 ) {
 	// early out
 	if (!pfDef.WithinConstraints(square->nodePos.x, square->nodePos.y)) {
-		blockStates.nodeMask[square->nodeNum] |= PATHOPT_CLOSED;
-		dirtyBlocks.push_back(square->nodeNum);
+		searchStates.GetNodeState(square->nodeNum).nodeMask |= PATHOPT_CLOSED;
 		return;
 	}
 
@@ -132,14 +178,13 @@ void CPathFinder::TestNeighborSquares(
 		if ((unsigned)ngbSquareCoors.x >= nbrOfBlocks.x || (unsigned)ngbSquareCoors.y >= nbrOfBlocks.y)
 			continue;
 
-		if (blockStates.nodeMask[BlockPosToIdx(ngbSquareCoors)] & (PATHOPT_CLOSED | PATHOPT_BLOCKED)) //FIXME
+		if (searchStates.GetNodeMask(BlockPosToIdx(ngbSquareCoors)) & (PATHOPT_CLOSED | PATHOPT_BLOCKED)) //FIXME
 			continue;
 
 		// very time expensive call
 		sqState.blockedState = CMoveMath::IsBlockedNoSpeedModCheck(moveDef, ngbSquareCoors.x, ngbSquareCoors.y, owner);
 		if (sqState.blockedState & CMoveMath::BLOCK_STRUCTURE) {
-			blockStates.nodeMask[square->nodeNum] |= PATHOPT_CLOSED;
-			dirtyBlocks.push_back(square->nodeNum);
+			searchStates.GetNodeState(square->nodeNum).nodeMask |= PATHOPT_CLOSED;
 			continue; // early-out (20% chance)
 		}
 
@@ -151,8 +196,7 @@ void CPathFinder::TestNeighborSquares(
 			sqState.speedMod = CMoveMath::GetPosSpeedMod(moveDef, ngbSquareCoors.x, ngbSquareCoors.y);
 		}
 		if (sqState.speedMod == 0.f) {
-			blockStates.nodeMask[square->nodeNum] |= PATHOPT_CLOSED;
-			dirtyBlocks.push_back(square->nodeNum);
+			searchStates.GetNodeState(square->nodeNum).nodeMask |= PATHOPT_CLOSED;
 		}
 	}
 
@@ -186,8 +230,7 @@ void CPathFinder::TestNeighborSquares(
 	TEST_DIAG_SQUARE(PATHDIR_RIGHT, PATHDIR_DOWN, PATHDIR_RIGHT_DOWN);
 
 	// mark this square as closed
-	blockStates.nodeMask[square->nodeNum] |= PATHOPT_CLOSED;
-	dirtyBlocks.push_back(square->nodeNum);
+	searchStates.GetNodeState(square->nodeNum).nodeMask |= PATHOPT_CLOSED;
 }
 
 bool CPathFinder::TestBlock(
@@ -208,7 +251,7 @@ bool CPathFinder::TestBlock(
 	// bounds-check
 	assert((unsigned)square.x < nbrOfBlocks.x);
 	assert((unsigned)square.y < nbrOfBlocks.y);
-	assert((blockStates.nodeMask[sqrIdx] & (PATHOPT_CLOSED | PATHOPT_BLOCKED)) == 0);
+	assert((searchStates.GetNodeMask(sqrIdx) & (PATHOPT_CLOSED | PATHOPT_BLOCKED)) == 0);
 	assert((blockStatus & CMoveMath::BLOCK_STRUCTURE) == 0);
 	assert(speedMod != 0.0f);
 
@@ -224,7 +267,7 @@ bool CPathFinder::TestBlock(
 
 	const float heatCost  = (pfDef.testMobile) ? (PathHeatMap::GetInstance())->GetHeatCost(square.x, square.y, moveDef, ((owner != NULL)? owner->id: -1U)) : 0.0f;
 	const float flowCost  = (pfDef.testMobile) ? (PathFlowMap::GetInstance())->GetFlowCost(square.x, square.y, moveDef, pathOptDir) : 0.0f;
-	const float extraCost = blockStates.GetNodeExtraCost(square.x, square.y, pfDef.synced);
+	const float extraCost = extraCostStates->GetNodeExtraCost(square.x, square.y, pfDef.synced);
 
 	const float dirMoveCost = (1.0f + heatCost + flowCost) * PF_DIRECTION_COSTS[pathOptDir];
 	const float nodeCost = (dirMoveCost / speedMod) + extraCost;
@@ -233,12 +276,14 @@ bool CPathFinder::TestBlock(
 	const float hCost = pfDef.Heuristic(square.x, square.y); // h
 	const float fCost = gCost + hCost;                       // f
 
-	if (blockStates.nodeMask[sqrIdx] & PATHOPT_OPEN) {
+	PathSearchStateBuffer::NodeState& ns = searchStates.GetNodeState(sqrIdx);
+
+	if (ns.nodeMask & PATHOPT_OPEN) {
 		// already in the open set, look for a cost-improvement
-		if (blockStates.fCost[sqrIdx] <= fCost)
+		if (openBlockBuffer.GetNode(ns.nodeIdx)->fCost <= fCost)
 			return true;
 
-		blockStates.nodeMask[sqrIdx] &= ~PATHOPT_CARDINALS;
+		ns.nodeMask &= ~PATHOPT_CARDINALS;
 	}
 
 	// if heuristic says this node is closer to goal than previous h-estimate, keep it
@@ -256,16 +301,13 @@ bool CPathFinder::TestBlock(
 		os->gCost   = gCost;
 		os->nodePos = square;
 		os->nodeNum = sqrIdx;
-	openBlocks.push(os);
+	openSquares.push(os);
 
 	blockStates.SetMaxCost(NODE_COST_F, std::max(blockStates.GetMaxCost(NODE_COST_F), fCost));
 	blockStates.SetMaxCost(NODE_COST_G, std::max(blockStates.GetMaxCost(NODE_COST_G), gCost));
 
-	blockStates.fCost[sqrIdx] = os->fCost;
-	blockStates.gCost[sqrIdx] = os->gCost;
-	blockStates.nodeMask[sqrIdx] |= (PATHOPT_OPEN | pathOptDir);
-
-	dirtyBlocks.push_back(sqrIdx);
+	ns.nodeIdx = openBlockBuffer.GetSize();
+	ns.nodeMask |= (PATHOPT_OPEN | pathOptDir);
 	return true;
 }
 
@@ -300,7 +342,7 @@ IPath::SearchResult CPathFinder::FinishSearch(const MoveDef& moveDef, const CPat
 			if (blockIdx == mStartBlockIdx)
 				break;
 
-			square -= PF_DIRECTION_VECTORS_2D[blockStates.nodeMask[blockIdx] & PATHOPT_CARDINALS];
+			square -= PF_DIRECTION_VECTORS_2D[searchStates.GetNodeMask(blockIdx) & PATHOPT_CARDINALS];
 			blockIdx = BlockPosToIdx(square);
 		}
 
@@ -310,7 +352,7 @@ IPath::SearchResult CPathFinder::FinishSearch(const MoveDef& moveDef, const CPat
 	}
 
 	// Adds the cost of the path.
-	foundPath.pathCost = blockStates.fCost[mGoalBlockIdx];
+	foundPath.pathCost = GetNodeCost(mGoalBlockIdx, NODE_COST_F);
 
 	return IPath::Ok;
 }
@@ -337,8 +379,8 @@ void CPathFinder::SmoothMidWaypoint(const int2 testsqr, const int2 prevsqr, cons
 	const int tstsqr = BlockPosToIdx(testsqr);
 	const int prvsqr = BlockPosToIdx(prevsqr);
 	if (
-		   ((blockStates.nodeMask[tstsqr] & PATHOPT_BLOCKED) == 0)
-		&& (blockStates.fCost[tstsqr] <= COSTMOD * blockStates.fCost[prvsqr])
+		   ((searchStates.GetNodeMask(tstsqr) & PATHOPT_BLOCKED) == 0)
+		&& (GetNodeCost(tstsqr, NODE_COST_F) <= COSTMOD * GetNodeCost(prvsqr, NODE_COST_F))
 	) {
 		const float3& p2 = foundPath.path[foundPath.path.size() - 2];
 		      float3& p1 = foundPath.path.back();
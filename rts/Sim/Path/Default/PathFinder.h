@@ -19,7 +19,8 @@ class CPathFinderDef;
 
 class CPathFinder: public IPathFinder {
 public:
-	CPathFinder();
+	/// @param extraCostStates source of node extra-costs (if not our own blockStates)
+	CPathFinder(const PathNodeStateBuffer* extraCostStates = nullptr);
 
 	static void InitDirectionVectorsTable();
 	static void InitDirectionCostsTable();
@@ -27,7 +28,16 @@ public:
 	static const   int2* GetDirectionVectorsTable2D();
 	static const float3* GetDirectionVectorsTable3D();
 
+	size_t GetMemFootPrint() const { return (IPathFinder::GetMemFootPrint() + searchStates.GetMemFootPrint()); }
+
+	/// state of a square during the last search; costs are infinite for unvisited squares
+	boost::uint8_t GetNodeMask(unsigned int sqrIdx) const { return (searchStates.GetNodeMask(sqrIdx)); }
+	float GetNodeCost(unsigned int sqrIdx, unsigned int costType) const;
+
 protected: // IPathFinder impl
+	void ResetSearch();
+	void InitStartBlock();
+
 	/// Performs the actual search.
 	IPath::SearchResult DoSearch(const MoveDef& moveDef, const CPathFinderDef& pfDef, const CSolidObject* owner);
 
@@ -99,6 +109,12 @@ private:
 		IPath::Path& foundPath,
 		const float3 nextPoint
 	) const;
+
+private:
+	const PathNodeStateBuffer* extraCostStates;
+
+	PathSearchStateBuffer searchStates;
+	PathBucketQueue openSquares;
 };
 
 #endif // PATH_FINDER_H
@@ -13,10 +13,18 @@
 #include "Sim/Misc/GlobalSynced.h"
 #include "Sim/Objects/SolidObjectDef.h"
 #include "Sim/MoveTypes/MoveDefHandler.h"
+#include "System/Config/ConfigHandler.h"
 #include "System/Log/ILog.h"
 #include "System/myMath.h"
 #include "System/TimeProfiler.h"
 
+// set to 1 to be able to record the path requests of a game for PathBenchmarkFile
+#define PATH_RECORD_REQUESTS 0
+
+#if PATH_RECORD_REQUESTS
+CONFIG(std::string, PathRecordFile).defaultValue("").description("Append the start and goal of every path request to this file (for PathBenchmarkFile).");
+#endif
+CONFIG(std::string, PathBenchmarkFile).defaultValue("").description("After loading, run the path requests recorded in this file through the max-res pathfinder and log the timings.");
 
 
 CPathManager::CPathManager()
@@ -26,6 +34,7 @@ CPathManager::CPathManager()
 , pathFlowMap(nullptr)
 , pathHeatMap(nullptr)
 , nextPathID(0)
+, pathRecordFile(NULL)
 {
 	CPathFinder::InitDirectionVectorsTable();
 	CPathFinder::InitDirectionCostsTable();
@@ -44,6 +53,10 @@ CPathManager::~CPathManager()
 	delete medResPE; medResPE = NULL;
 	delete maxResPF; maxResPF = NULL;
 
+	if (pathRecordFile != NULL) {
+		fclose(pathRecordFile);
+	}
+
 	PathHeatMap::FreeInstance(pathHeatMap);
 	PathFlowMap::FreeInstance(pathFlowMap);
 }
@@ -63,10 +76,75 @@ boost::int64_t CPathManager::Finalize() {
 	}
 
 	const spring_time dt = spring_gettime() - t0;
+
+	{
+		const std::string benchFileName = configHandler->GetString("PathBenchmarkFile");
+
+		if (!benchFileName.empty())
+			RunPathFinderBenchmark(benchFileName);
+
+	#if PATH_RECORD_REQUESTS
+		const std::string recordFileName = configHandler->GetString("PathRecordFile");
+
+		if (!recordFileName.empty() && (pathRecordFile = fopen(recordFileName.c_str(), "a")) == NULL)
+			LOG_L(L_WARNING, "[PathManager] could not open path record file \"%s\"", recordFileName.c_str());
+	#endif
+	}
+
 	return (dt.toMilliSecsi());
 }
 
 
+void CPathManager::RunPathFinderBenchmark(const std::string& fileName) const
+{
+	FILE* file = fopen(fileName.c_str(), "r");
+
+	if (file == NULL) {
+		LOG_L(L_WARNING, "[PathManager] could not open path benchmark file \"%s\"", fileName.c_str());
+		return;
+	}
+
+	// one request per line, as written by RequestPath: "moveDefName sx sz gx gz goalRadius"
+	char moveDefName[256];
+	float3 startPos;
+	float3 goalPos;
+	float goalRadius;
+
+	unsigned int numSearches = 0;
+	unsigned int numResults[IPath::Error + 1] = {0};
+
+	spring_time searchTime = spring_notime;
+
+	while (fscanf(file, "%255s %f %f %f %f %f", moveDefName, &startPos.x, &startPos.z, &goalPos.x, &goalPos.z, &goalRadius) == 6) {
+		const MoveDef* moveDef = moveDefHandler->GetMoveDefByName(moveDefName);
+
+		if (moveDef == NULL)
+			continue;
+
+		startPos.ClampInBounds();
+		goalPos.ClampInBounds();
+
+		// same constraint and node-limit as an unrefined max-res request
+		const CCircularSearchConstraint pfDef(startPos, goalPos, goalRadius, 3.0f, 2000);
+
+		IPath::Path path;
+
+		const spring_time t0 = spring_gettime();
+		const IPath::SearchResult result = maxResPF->GetPath(*moveDef, pfDef, NULL, startPos, path, MAX_SEARCHED_NODES_PF >> 3);
+		searchTime += (spring_gettime() - t0);
+
+		numSearches += 1;
+		numResults[result] += 1;
+	}
+
+	fclose(file);
+
+	LOG("[PathManager] benchmark \"%s\": %u max-res searches in %.3fms (%.3fms avg; %u ok, %u goal out of range, %u can't get closer, %u failed)",
+		fileName.c_str(), numSearches, searchTime.toMilliSecsf(), searchTime.toMilliSecsf() / std::max(1u, numSearches),
+		numResults[IPath::Ok], numResults[IPath::GoalOutOfRange], numResults[IPath::CantGetCloser], numResults[IPath::Error]);
+}
+
+
 void CPathManager::FinalizePath(MultiPath* path, const float3 startPos, const float3 goalPos, const bool cantGetCloser)
 {
 	IPath::Path* sp = &path->lowResPath;
@@ -241,6 +319,11 @@ unsigned int CPathManager::RequestPath(
 	float3 sp(startPos); sp.ClampInBounds();
 	float3 gp(goalPos); gp.ClampInBounds();
 
+#if PATH_RECORD_REQUESTS
+	if (pathRecordFile != NULL)
+		fprintf(pathRecordFile, "%s %f %f %f %f %f\n", moveDef->name.c_str(), sp.x, sp.z, gp.x, gp.z, goalRadius);
+#endif
+
 	// Create an estimator definition.
 	CCircularSearchConstraint* pfDef = new CCircularSearchConstraint(sp, gp, goalRadius, 3.0f, 2000);
 
@@ -541,10 +624,29 @@ void CPathManager::Update()
 	pathFlowMap->Update();
 	pathHeatMap->Update();
 
+	PrioritizeActivePaths();
+
 	medResPE->Update();
 	lowResPE->Update();
 }
 
+void CPathManager::PrioritizeActivePaths()
+{
+	if (medResPE->GetNumQueuedBlocks() == 0 && lowResPE->GetNumQueuedBlocks() == 0)
+		return;
+
+	for (const auto& p: pathMap) {
+		const MultiPath* multiPath = p.second;
+
+		// unsynced (eg. Lua) paths must not influence the synced update order
+		if (!multiPath->peDef->synced)
+			continue;
+
+		medResPE->PrioritizeBlocks(multiPath->medResPath.path);
+		lowResPE->PrioritizeBlocks(multiPath->lowResPath.path);
+	}
+}
+
 // used to deposit heat on the heat-map as a unit moves along its path
 void CPathManager::UpdatePath(const CSolidObject* owner, unsigned int pathID)
 {
@@ -704,8 +806,8 @@ int2 CPathManager::GetNumQueuedUpdates() const {
 	int2 data;
 
 	if (IsFinalized()) {
-		data.x = medResPE->updatedBlocks.size();
-		data.y = lowResPE->updatedBlocks.size();
+		data.x = medResPE->GetNumQueuedBlocks();
+		data.y = lowResPE->GetNumQueuedBlocks();
 	}
 
 	return data;
@@ -3,6 +3,7 @@
 #ifndef PATHMANAGER_H
 #define PATHMANAGER_H
 
+#include <cstdio>
 #include <map>
 #include <boost/cstdint.hpp> /* Replace with <stdint.h> if appropriate */
 
@@ -135,6 +136,12 @@ private:
 	void LowRes2MedRes(MultiPath& path, const float3& startPos, const CSolidObject* owner, bool synced) const;
 	void MedRes2MaxRes(MultiPath& path, const float3& startPos, const CSolidObject* owner, bool synced) const;
 
+	/// lets the estimators update blocks on active paths before all others
+	void PrioritizeActivePaths();
+
+	/// replays recorded path requests through the max-res PF and logs the timings
+	void RunPathFinderBenchmark(const std::string& fileName) const;
+
 	bool IsFinalized() const { return (maxResPF != NULL); }
 
 private:
@@ -147,6 +154,10 @@ private:
 
 	std::map<unsigned int, MultiPath*> pathMap;
 	unsigned int nextPathID;
+
+	// receives the start/goal pairs of all requests if PathRecordFile is set
+	// (only in builds with PATH_RECORD_REQUESTS enabled, see PathManager.cpp)
+	FILE* pathRecordFile;
 };
 
 inline CPathManager::MultiPath* CPathManager::GetMultiPath(int pathID) const {
@@ -20,43 +20,6 @@ unsigned int QTPFS::QTNode::MAX_DEPTH;
 
 
 
-void QTPFS::INode::SetPathCost(unsigned int type, float cost) {
-	#ifndef QTPFS_ENABLE_MICRO_OPTIMIZATION_HACKS
-	switch (type) {
-		case NODE_PATH_COST_F: { fCost = cost; return; } break;
-		case NODE_PATH_COST_G: { gCost = cost; return; } break;
-		case NODE_PATH_COST_H: { hCost = cost; return; } break;
-	}
-
-	assert(false);
-	#else
-	assert(&gCost == &fCost + 1);
-	assert(&hCost == &gCost + 1);
-	assert(type <= NODE_PATH_COST_H);
-
-	*(&fCost + type) = cost;
-	#endif
-}
-
-float QTPFS::INode::GetPathCost(unsigned int type) const {
-	#ifndef QTPFS_ENABLE_MICRO_OPTIMIZATION_HACKS
-	switch (type) {
-		case NODE_PATH_COST_F: { return fCost; } break;
-		case NODE_PATH_COST_G: { return gCost; } break;
-		case NODE_PATH_COST_H: { return hCost; } break;
-	}
-
-	assert(false);
-	return 0.0f;
-	#else
-	assert(&gCost == &fCost + 1);
-	assert(&hCost == &gCost + 1);
-	assert(type <= NODE_PATH_COST_H);
-
-	return *(&fCost + type);
-	#endif
-}
-
 float QTPFS::INode::GetDistance(const INode* n, unsigned int type) const {
 	const float dx = float(xmid() * SQUARE_SIZE) - float(n->xmid() * SQUARE_SIZE);
 	const float dz = float(zmid() * SQUARE_SIZE) - float(n->zmid() * SQUARE_SIZE);
@@ -198,9 +161,9 @@ QTPFS::QTNode::QTNode(
 	assert(MIN_SIZE_Z > 0);
 
 	nodeNumber = nn;
-	heapIndex = -1u;
+	// the root starts out as the only leaf of its layer
+	leafIndex = 0;
 
-	searchState  =   0;
 	currMagicNum =   0;
 	prevMagicNum = -1u;
 
@@ -213,16 +176,10 @@ QTPFS::QTNode::QTNode(
 	assert(xsize() != 0);
 	assert(zsize() != 0);
 
-	fCost = 0.0f;
-	gCost = 0.0f;
-	hCost = 0.0f;
-
 	speedModSum =  0.0f;
 	speedModAvg =  0.0f;
 	moveCostAvg = -1.0f;
 
-	prevNode = NULL;
-
 	// for leafs, all children remain NULL
 	children.fill(NULL);
 }
@@ -261,7 +218,7 @@ boost::uint64_t QTPFS::QTNode::GetCheckSum() const {
 
 	{
 		const unsigned char* minByte = reinterpret_cast<const unsigned char*>(&nodeNumber);
-		const unsigned char* maxByte = reinterpret_cast<const unsigned char*>(&hCost) + sizeof(hCost);
+		const unsigned char* maxByte = reinterpret_cast<const unsigned char*>(&nodeNumber) + sizeof(nodeNumber);
 
 		assert(minByte < maxByte);
 
@@ -344,6 +301,12 @@ bool QTPFS::QTNode::Split(NodeLayer& nl, bool forced) {
 	children[NODE_IDX_BR] = new QTNode(this, GetChildID(NODE_IDX_BR),  xmid(), zmid(),  xmax(), zmax());
 	children[NODE_IDX_BL] = new QTNode(this, GetChildID(NODE_IDX_BL),  xmin(), zmid(),  xmid(), zmax());
 
+	// the first child inherits our leaf-index
+	children[NODE_IDX_TL]->SetLeafIndex(leafIndex);
+	children[NODE_IDX_TR]->SetLeafIndex(nl.AllocLeafIndex());
+	children[NODE_IDX_BR]->SetLeafIndex(nl.AllocLeafIndex());
+	children[NODE_IDX_BL]->SetLeafIndex(nl.AllocLeafIndex());
+
 	nl.SetNumLeafNodes(nl.GetNumLeafNodes() + (4 - 1));
 	assert(!IsLeaf());
 	return true;
@@ -356,8 +319,19 @@ bool QTPFS::QTNode::Merge(NodeLayer& nl) {
 
 	neighbors.clear();
 
+	// collapse deeper subtrees first so their leaf-indices are returned
+	for (unsigned int i = 0; i < children.size(); i++) {
+		children[i]->Merge(nl);
+	}
+
+	// take back the leaf-index handed to our first child
+	leafIndex = children[NODE_IDX_TL]->GetLeafIndex();
+
 	// get rid of our children completely, but not of <this>!
 	for (unsigned int i = 0; i < children.size(); i++) {
+		if (i != NODE_IDX_TL)
+			nl.FreeLeafIndex(children[i]->GetLeafIndex());
+
 		children[i]->Delete(); children[i] = NULL;
 	}
 
@@ -25,16 +25,11 @@ namespace QTPFS {
 	struct INode {
 	public:
 		void SetNodeNumber(unsigned int n) { nodeNumber = n; }
-		void SetHeapIndex(unsigned int n) { heapIndex = n; }
 		unsigned int GetNodeNumber() const { return nodeNumber; }
-		unsigned int GetHeapIndex() const { return heapIndex; }
-		float GetHeapPriority() const { return GetPathCost(NODE_PATH_COST_F); }
 
-		bool operator <  (const INode* n) const { return (fCost <  n->fCost); }
-		bool operator >  (const INode* n) const { return (fCost >  n->fCost); }
-		bool operator == (const INode* n) const { return (fCost == n->fCost); }
-		bool operator <= (const INode* n) const { return (fCost <= n->fCost); }
-		bool operator >= (const INode* n) const { return (fCost >= n->fCost); }
+		// dense per-layer index of a leaf, see NodeLayer::AllocLeafIndex
+		void SetLeafIndex(unsigned int i) { leafIndex = i; }
+		unsigned int GetLeafIndex() const { return leafIndex; }
 
 		#ifdef QTPFS_VIRTUAL_NODE_FUNCTIONS
 		virtual void Serialize(std::fstream&, NodeLayer&, unsigned int*, bool) = 0;
@@ -69,34 +64,17 @@ namespace QTPFS {
 		virtual void SetMoveCost(float cost) = 0;
 		virtual float GetMoveCost() const = 0;
 
-		virtual void SetSearchState(unsigned int) = 0;
-		virtual unsigned int GetSearchState() const = 0;
-
 		virtual void SetMagicNumber(unsigned int) = 0;
 		virtual unsigned int GetMagicNumber() const = 0;
 		#endif
 
-		void SetPathCosts(float g, float h) { fCost = g + h; gCost = g; hCost = h; }
-		void SetPathCost(unsigned int type, float cost);
-		const float* GetPathCosts() const { return &fCost; }
-		float GetPathCost(unsigned int type) const;
-
-		void SetPrevNode(INode* n) { prevNode = n; }
-		INode* GetPrevNode() { return prevNode; }
-
 	protected:
 		// NOTE:
-		//     storing the heap-index is an *UGLY* break of abstraction,
-		//     but the only way to keep the cost of resorting acceptable
+		//     all per-search state (costs, heap-index, back-pointer)
+		//     lives in SearchNode, which allows concurrent searches
+		//     on the same layer
 		unsigned int nodeNumber;
-		unsigned int heapIndex;
-
-		float fCost;
-		float gCost;
-		float hCost;
-
-		// points back to previous node in path
-		INode* prevNode;
+		unsigned int leafIndex;
 
 	#ifdef QTPFS_VIRTUAL_NODE_FUNCTIONS
 	};
@@ -163,9 +141,6 @@ namespace QTPFS {
 		void SetMoveCost(float cost) { moveCostAvg = cost; }
 		float GetMoveCost() const { return moveCostAvg; }
 
-		void SetSearchState(unsigned int state) { searchState = state; }
-		unsigned int GetSearchState() const { return searchState; }
-
 		void SetMagicNumber(unsigned int number) { currMagicNum = number; }
 		unsigned int GetMagicNumber() const { return currMagicNum; }
 
@@ -195,7 +170,6 @@ namespace QTPFS {
 		float speedModAvg;
 		float moveCostAvg;
 
-		unsigned int searchState;
 		unsigned int currMagicNum;
 		unsigned int prevMagicNum;
 
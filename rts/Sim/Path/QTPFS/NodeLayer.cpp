@@ -21,6 +21,7 @@ float        QTPFS::NodeLayer::MAX_SPEEDMOD_VALUE;
 QTPFS::NodeLayer::NodeLayer()
 	: layerNumber(0)
 	, numLeafNodes(0)
+	, numLeafIndices(0)
 	, updateCounter(0)
 	, xsize(0)
 	, zsize(0)
@@ -46,8 +47,10 @@ void QTPFS::NodeLayer::RegisterNode(INode* n) {
 void QTPFS::NodeLayer::Init(unsigned int layerNum) {
 	assert((QTPFS::NodeLayer::NUM_SPEEDMOD_BINS + 1) <= MaxSpeedBinTypeValue());
 
-	// pre-count the root
+	// pre-count the root (which has leaf-index 0)
 	numLeafNodes = 1;
+	numLeafIndices = 1;
+	freeLeafIndices.clear();
 	layerNumber = layerNum;
 
 	xsize = mapDims.mapx;
@@ -77,6 +77,19 @@ namespace QTPFS {
 		void SetNumLeafNodes(unsigned int n) { numLeafNodes = n; }
 		unsigned int GetNumLeafNodes() const { return numLeafNodes; }
 
+		// leaf-indices stay below GetNumLeafIndices, which is the
+		// highest number of leaves this layer has had at once
+		unsigned int AllocLeafIndex() {
+			if (freeLeafIndices.empty())
+				return numLeafIndices++;
+
+			const unsigned int i = freeLeafIndices.back();
+			freeLeafIndices.pop_back();
+			return i;
+		}
+		void FreeLeafIndex(unsigned int i) { freeLeafIndices.push_back(i); }
+		unsigned int GetNumLeafIndices() const { return numLeafIndices; }
+
 		float GetMaxRelSpeedMod() const { return maxRelSpeedMod; }
 		float GetAvgRelSpeedMod() const { return avgRelSpeedMod; }
 
@@ -100,6 +113,8 @@ namespace QTPFS {
 		std::vector<SpeedBinType> curSpeedBins;
 		std::vector<SpeedBinType> oldSpeedBins;
 
+		std::vector<unsigned int> freeLeafIndices;
+
 		#ifdef QTPFS_STAGGERED_LAYER_UPDATES
 		std::list<LayerUpdate> layerUpdates;
 		#endif
@@ -114,6 +129,7 @@ namespace QTPFS {
 
 		unsigned int layerNumber;
 		unsigned int numLeafNodes;
+		unsigned int numLeafIndices;
 		unsigned int updateCounter;
 
 		unsigned int xsize;
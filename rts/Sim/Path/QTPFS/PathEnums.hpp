@@ -17,9 +17,9 @@ namespace QTPFS {
 		REL_NGB_EDGE_L = 8, // left-edge neighbor
 	};
 	enum {
-		NODE_STATE_OPEN   = 0,
-		NODE_STATE_CLOSED = 1,
-		NODE_STATE_OFFSET = 2,
+		NODE_STATE_UNSEEN = 0,
+		NODE_STATE_OPEN   = 1,
+		NODE_STATE_CLOSED = 2,
 	};
 	enum {
 		NODE_DIST_EUCLIDEAN = 0,
@@ -128,7 +128,11 @@ QTPFS::PathManager::~PathManager() {
 	numCurrExecutedSearches.clear();
 	numPrevExecutedSearches.clear();
 
-	PathSearch::FreeGlobalQueue();
+	for (unsigned int threadNum = 0; threadNum < searchThreadData.size(); threadNum++) {
+		searchThreadData[threadNum].Kill();
+	}
+
+	searchThreadData.clear();
 
 	#ifdef QTPFS_ENABLE_THREADED_UPDATE
 	// at this point the thread is waiting, so notify it
@@ -174,8 +178,6 @@ void QTPFS::PathManager::InitStatic() {
 void QTPFS::PathManager::Load() {
 	pmLoadScreen.SetLoading(true);
 
-	// NOTE: offset *must* start at a non-zero value
-	searchStateOffset = NODE_STATE_OFFSET;
 	numTerrainChanges = 0;
 	numPathRequests   = 0;
 	maxNumLeafNodes   = 0;
@@ -231,7 +233,13 @@ void QTPFS::PathManager::Load() {
 
 		{ SyncedUint tmp(pfsCheckSum); }
 
-		PathSearch::InitGlobalQueue(maxNumLeafNodes);
+		// one scratch-buffer for every pool thread that can execute searches,
+		// plus one for the (non-pool) update-thread which also reports as #0
+		searchThreadData.resize(ThreadPool::GetMaxThreads() + 1);
+
+		for (unsigned int threadNum = 0; threadNum < searchThreadData.size(); threadNum++) {
+			searchThreadData[threadNum].Init(maxNumLeafNodes);
+		}
 	}
 
 	{
@@ -717,10 +725,12 @@ void QTPFS::PathManager::ThreadUpdate() {
 			// NOTE: *must* be called between QueueDeadPathSearches and ExecuteQueuedSearches
 			ExecQueuedNodeLayerUpdates(pathTypeUpdate, !pathSearches[pathTypeUpdate].empty());
 			#endif
-
-			ExecuteQueuedSearches(pathTypeUpdate);
 		}
 
+		// layers are not modified while searches execute, so
+		// all searches on [min, max) can be run concurrently
+		ExecuteQueuedSearches(minPathTypeUpdate, maxPathTypeUpdate);
+
 		std::copy(numCurrExecutedSearches.begin(), numCurrExecutedSearches.end(), numPrevExecutedSearches.begin());
 
 		minPathTypeUpdate = (minPathTypeUpdate + numPathTypeUpdates);
@@ -743,25 +753,60 @@ void QTPFS::PathManager::ThreadUpdate() {
 
 
 
-void QTPFS::PathManager::ExecuteQueuedSearches(unsigned int pathType) {
-	NodeLayer& nodeLayer = nodeLayers[pathType];
-	PathCache& pathCache = pathCaches[pathType];
+void QTPFS::PathManager::ExecuteQueuedSearches(unsigned int minPathType, unsigned int maxPathType) {
+	// execute pending searches collected via RequestPath
+	// and QueueDeadPathSearches, in rounds: each round the
+	// searches are selected and finalized in queue order
+	// (which keeps the outcome independent of thread timing)
+	// but executed concurrently
+	//
+	// searches whose hash matches that of an earlier search
+	// selected in the same round are deferred to the next
+	// round so they can still share its path
+	while (SelectSearches(minPathType, maxPathType)) {
+		#ifdef QTPFS_CONSERVATIVE_NEIGHBOR_CACHE_UPDATES
+		// neighbor-caches are lazily updated during searches,
+		// so searches on the same layer must not run in parallel
+		for_mt(minPathType, maxPathType, [&](const int pathType) {
+			for (unsigned int n = 0; n < selectedSearches.size(); n++) {
+				if (selectedSearches[n].pathType != static_cast<unsigned int>(pathType))
+					continue;
+
+				ExecuteSearch(selectedSearches[n]);
+			}
+		});
+		#else
+		for_mt(0, selectedSearches.size(), [&](const int n) {
+			ExecuteSearch(selectedSearches[n]);
+		});
+		#endif
+
+		for (unsigned int n = 0; n < selectedSearches.size(); n++) {
+			FinalizeSearch(selectedSearches[n]);
+		}
+	}
+}
+
+bool QTPFS::PathManager::SelectSearches(unsigned int minPathType, unsigned int maxPathType) {
+	selectedSearches.clear();
+	selectedHashes.clear();
+
+	for (unsigned int pathType = minPathType; pathType < maxPathType; pathType++) {
+		NodeLayer& nodeLayer = nodeLayers[pathType];
+		PathCache& pathCache = pathCaches[pathType];
 
-	std::list<IPathSearch*>& searches = pathSearches[pathType];
-	std::list<IPathSearch*>::iterator searchesIt = searches.begin();
+		std::list<IPathSearch*>& searches = pathSearches[pathType];
+		std::list<IPathSearch*>::iterator searchesIt = searches.begin();
 
-	if (!searches.empty()) {
-		// execute pending searches collected via
-		// RequestPath and QueueDeadPathSearches
 		while (searchesIt != searches.end()) {
-			if (ExecuteSearch(searches, searchesIt, nodeLayer, pathCache, pathType)) {
-				searchStateOffset += NODE_STATE_OFFSET;
-			}
+			SelectSearch(searches, searchesIt, nodeLayer, pathCache, pathType);
 		}
 	}
+
+	return (!selectedSearches.empty());
 }
 
-bool QTPFS::PathManager::ExecuteSearch(
+bool QTPFS::PathManager::SelectSearch(
 	PathSearchList& searches,
 	PathSearchListIt& searchesIt,
 	NodeLayer& nodeLayer,
@@ -795,6 +840,10 @@ bool QTPFS::PathManager::ExecuteSearch(
 
 	{
 		#ifdef QTPFS_SEARCH_SHARED_PATHS
+		if (selectedHashes.find(path->GetHash()) != selectedHashes.end()) {
+			++searchesIt; return false;
+		}
+
 		SharedPathMap::const_iterator sharedPathsIt = sharedPaths.find(path->GetHash());
 
 		if (sharedPathsIt != sharedPaths.end()) {
@@ -817,9 +866,34 @@ bool QTPFS::PathManager::ExecuteSearch(
 		#endif
 	}
 
-	// removes path from temp-paths, adds it to live-paths
-	if (search->Execute(searchStateOffset, numTerrainChanges)) {
-		search->Finalize(path);
+	#undef DeleteSearch
+
+	selectedHashes.insert(path->GetHash());
+	selectedSearches.push_back(PathSearchItem(search, path, searchesIt++, pathType));
+	return true;
+}
+
+void QTPFS::PathManager::ExecuteSearch(PathSearchItem& item) {
+	// NOTE:
+	//   can run on any thread; must not touch any state shared
+	//   between searches (the path-caches, sharedPaths, etc)
+	const int threadNum = ThreadPool::GetThreadNum();
+	const bool poolThread = (threadNum != 0 || Threading::IsMainThread());
+
+	SearchThreadData* threadData = &searchThreadData[poolThread? threadNum: (searchThreadData.size() - 1)];
+
+	if ((item.haveResult = item.search->Execute(threadData, numTerrainChanges))) {
+		item.search->Finalize(item.path);
+	}
+}
+
+void QTPFS::PathManager::FinalizeSearch(PathSearchItem& item) {
+	IPathSearch* search = item.search;
+	IPath* path = item.path;
+
+	if (item.haveResult) {
+		// removes path from temp-paths, adds it to live-paths
+		pathCaches[item.pathType].AddLivePath(path);
 
 		#ifdef QTPFS_SEARCH_SHARED_PATHS
 		sharedPaths[path->GetHash()] = path;
@@ -832,8 +906,9 @@ bool QTPFS::PathManager::ExecuteSearch(
 		DeletePath(path->GetID());
 	}
 
-	DeleteSearch(search, searchesIt);
-	return true;
+	*(item.searchIt) = NULL;
+	pathSearches[item.pathType].erase(item.searchIt);
+	delete search;
 }
 
 void QTPFS::PathManager::QueueDeadPathSearches(unsigned int pathType) {
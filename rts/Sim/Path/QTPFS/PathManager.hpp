@@ -4,6 +4,7 @@
 #define QTPFS_PATHMANAGER_HDR
 
 #include <map>
+#include <set>
 #include <list>
 #include <vector>
 
@@ -91,6 +92,25 @@ namespace QTPFS {
 		typedef std::list<IPathSearch*> PathSearchList;
 		typedef std::list<IPathSearch*>::iterator PathSearchListIt;
 
+		// a search selected for (possibly concurrent) execution
+		struct PathSearchItem {
+			PathSearchItem(IPathSearch* s, IPath* p, PathSearchListIt it, unsigned int t)
+				: search(s)
+				, path(p)
+				, searchIt(it)
+				, pathType(t)
+				, haveResult(false)
+				{}
+
+			IPathSearch* search;
+			IPath* path;
+
+			PathSearchListIt searchIt;
+
+			unsigned int pathType;
+			bool haveResult;
+		};
+
 		void SpawnBoostThreads(MemberFunc f, const SRectangle& r);
 
 		void InitNodeLayersThreaded(const SRectangle& rect);
@@ -113,7 +133,7 @@ namespace QTPFS {
 		void ExecQueuedNodeLayerUpdates(unsigned int layerNum, bool flushQueue);
 		#endif
 
-		void ExecuteQueuedSearches(unsigned int pathType);
+		void ExecuteQueuedSearches(unsigned int minPathType, unsigned int maxPathType);
 		void QueueDeadPathSearches(unsigned int pathType);
 
 		unsigned int QueueSearch(
@@ -126,13 +146,16 @@ namespace QTPFS {
 			const bool synced
 		);
 
-		bool ExecuteSearch(
+		bool SelectSearches(unsigned int minPathType, unsigned int maxPathType);
+		bool SelectSearch(
 			PathSearchList& searches,
 			PathSearchListIt& searchesIt,
 			NodeLayer& nodeLayer,
 			PathCache& pathCache,
 			unsigned int pathType
 		);
+		void ExecuteSearch(PathSearchItem& item);
+		void FinalizeSearch(PathSearchItem& item);
 
 		bool IsFinalized() const { return (!nodeTrees.empty()); }
 
@@ -150,13 +173,21 @@ namespace QTPFS {
 		// maps "hashes" of executed searches to the found paths
 		std::map<boost::uint64_t, IPath*> sharedPaths;
 
+		// searches executed concurrently in the current round
+		std::vector<PathSearchItem> selectedSearches;
+		// "hashes" of selected searches; a search with the same
+		// hash is deferred s.t. it can share the path once found
+		std::set<boost::uint64_t> selectedHashes;
+
+		// per-thread scratch memory used by PathSearch::Execute
+		std::vector<SearchThreadData> searchThreadData;
+
 		std::vector<unsigned int> numCurrExecutedSearches;
 		std::vector<unsigned int> numPrevExecutedSearches;
 
 		static unsigned int LAYERS_PER_UPDATE;
 		static unsigned int MAX_TEAM_SEARCHES;
 
-		unsigned int searchStateOffset;
 		unsigned int numTerrainChanges;
 		unsigned int numPathRequests;
 		unsigned int maxNumLeafNodes;
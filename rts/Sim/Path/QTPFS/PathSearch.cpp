@@ -16,8 +16,6 @@
 
 #include "System/float3.h"
 
-QTPFS::binary_heap<QTPFS::INode*> QTPFS::PathSearch::openNodes;
-
 
 
 void QTPFS::PathSearch::Initialize(
@@ -40,16 +38,25 @@ void QTPFS::PathSearch::Initialize(
 	tgtNode = nodeLayer->GetNode(tgtPoint.x / SQUARE_SIZE, tgtPoint.z / SQUARE_SIZE);
 	curNode = NULL;
 	nxtNode = NULL;
-	minNode = srcNode;
+	minNode = NULL;
+
+	srcSearchNode = NULL;
+	tgtSearchNode = NULL;
 }
 
 bool QTPFS::PathSearch::Execute(
-	unsigned int searchStateOffset,
+	SearchThreadData* searchThreadData,
 	unsigned int searchMagicNumber
 ) {
-	searchState = searchStateOffset; // starts at NODE_STATE_OFFSET
+	threadData = searchThreadData;
+	threadData->Reset(nodeLayer->GetNumLeafNodes(), nodeLayer->GetNumLeafIndices());
+
 	searchMagic = searchMagicNumber; // starts at numTerrainChanges
 
+	srcSearchNode = threadData->GetNode(srcNode);
+	tgtSearchNode = srcSearchNode;
+	minNode = srcSearchNode;
+
 	haveFullPath = (srcNode == tgtNode);
 	havePartPath = false;
 
@@ -75,13 +82,14 @@ bool QTPFS::PathSearch::Execute(
 	// allow the search to start from an impassable node (because single
 	// nodes can represent many terrain squares, some of which can still
 	// be passable and allow a unit to move within a node)
-	// NOTE: we need to make sure such paths do not have infinite cost!
-	if (srcNode->GetMoveCost() == QTPFS_POSITIVE_INFINITY) {
-		srcNode->SetMoveCost(0.0f);
-	}
+	// NOTE:
+	//   we need to make sure such paths do not have infinite cost, but
+	//   must not modify srcNode (other searches may be reading it) so
+	//   GetNodeMoveCost and IsNodeImpassable take care of this
+	ResetState(srcSearchNode);
+	UpdateNode(srcSearchNode, NULL, 0);
 
-	ResetState(srcNode);
-	UpdateNode(srcNode, NULL, 0);
+	binary_heap<SearchNode*>& openNodes = threadData->openNodes;
 
 	while (!openNodes.empty()) {
 		IterateNodes(nodeLayer->GetNodes());
@@ -91,19 +99,15 @@ bool QTPFS::PathSearch::Execute(
 		searchIter.Clear();
 		#endif
 
-		haveFullPath = (curNode == tgtNode);
-		havePartPath = (minNode != srcNode);
+		haveFullPath = (curNode->GetNode() == tgtNode);
+		havePartPath = (minNode != srcSearchNode);
 
 		if (haveFullPath) {
+			tgtSearchNode = curNode;
 			openNodes.reset();
 		}
 	}
 
-	if (srcNode->GetMoveCost() == 0.0f) {
-		srcNode->SetMoveCost(QTPFS_POSITIVE_INFINITY);
-	}
-		
-
 	#ifdef QTPFS_SUPPORT_PARTIAL_SEARCHES
 	// adjust the target-point if we only got a partial result
 	// NOTE:
@@ -111,9 +115,11 @@ bool QTPFS::PathSearch::Execute(
 	//   units will end up spinning in-place over the last
 	//   waypoint (since "atGoal" can never become true)
 	if (!haveFullPath && havePartPath) {
-		tgtNode    = minNode;
-		tgtPoint.x = minNode->xmid() * SQUARE_SIZE;
-		tgtPoint.z = minNode->zmid() * SQUARE_SIZE;
+		tgtNode    = minNode->GetNode();
+		tgtPoint.x = tgtNode->xmid() * SQUARE_SIZE;
+		tgtPoint.z = tgtNode->zmid() * SQUARE_SIZE;
+
+		tgtSearchNode = minNode;
 	}
 	#endif
 
@@ -122,7 +128,7 @@ bool QTPFS::PathSearch::Execute(
 
 
 
-void QTPFS::PathSearch::ResetState(INode* node) {
+void QTPFS::PathSearch::ResetState(SearchNode* node) {
 	// will be copied into srcNode by UpdateNode()
 	netPoints[0] = srcPoint;
 
@@ -140,11 +146,10 @@ void QTPFS::PathSearch::ResetState(INode* node) {
 		hCosts[i] = 0.0f;
 	}
 
-	openNodes.reset();
-	openNodes.push(node);
+	threadData->openNodes.push(node);
 }
 
-void QTPFS::PathSearch::UpdateNode(INode* nextNode, INode* prevNode, unsigned int netPointIdx) {
+void QTPFS::PathSearch::UpdateNode(SearchNode* nextNode, SearchNode* prevNode, unsigned int netPointIdx) {
 	// NOTE:
 	//   the heuristic must never over-estimate the distance,
 	//   but this is *impossible* to achieve on a non-regular
@@ -152,35 +157,40 @@ void QTPFS::PathSearch::UpdateNode(INode* nextNode, INode* prevNode, unsigned in
 	//   associated with it --> paths will be "nearly optimal"
 	nextNode->SetPrevNode(prevNode);
 	nextNode->SetPathCosts(gCosts[netPointIdx], hCosts[netPointIdx]);
-	nextNode->SetSearchState(searchState | NODE_STATE_OPEN);
-	nextNode->SetNeighborEdgeTransitionPoint(0, netPoints[netPointIdx]);
+	nextNode->SetNodeState(NODE_STATE_OPEN);
+	nextNode->SetTransitionPoint(netPoints[netPointIdx]);
 }
 
 void QTPFS::PathSearch::IterateNodes(const std::vector<INode*>& allNodes) {
+	binary_heap<SearchNode*>& openNodes = threadData->openNodes;
+
 	curNode = openNodes.top();
-	curNode->SetSearchState(searchState | NODE_STATE_CLOSED);
+	curNode->SetNodeState(NODE_STATE_CLOSED);
+
+	INode* curQTNode = curNode->GetNode();
+
 	#ifdef QTPFS_CONSERVATIVE_NEIGHBOR_CACHE_UPDATES
 	// in the non-conservative case, this is done from
 	// NodeLayer::ExecNodeNeighborCacheUpdates instead
-	curNode->SetMagicNumber(searchMagic);
+	curQTNode->SetMagicNumber(searchMagic);
 	#endif
 
 	openNodes.pop();
 	openNodes.check_heap_property(0);
 
 	#ifdef QTPFS_TRACE_PATH_SEARCHES
-	searchIter.SetPoppedNodeIdx(curNode->zmin() * mapDims.mapx + curNode->xmin());
+	searchIter.SetPoppedNodeIdx(curQTNode->zmin() * mapDims.mapx + curQTNode->xmin());
 	#endif
 
-	if (curNode == tgtNode)
+	if (curQTNode == tgtNode)
 		return;
-	if (curNode->AllSquaresImpassable())
+	if (IsNodeImpassable(curQTNode))
 		return;
 
-	if (curNode->xmid() < searchRect.x1) return;
-	if (curNode->zmid() < searchRect.z1) return;
-	if (curNode->xmid() > searchRect.x2) return;
-	if (curNode->zmid() > searchRect.z2) return;
+	if (curQTNode->xmid() < searchRect.x1) return;
+	if (curQTNode->zmid() < searchRect.z1) return;
+	if (curQTNode->xmid() > searchRect.x2) return;
+	if (curQTNode->zmid() > searchRect.z2) return;
 
 	#ifdef QTPFS_SUPPORT_PARTIAL_SEARCHES
 	// remember the node with lowest h-cost in case the search fails to reach tgtNode
@@ -188,12 +198,16 @@ void QTPFS::PathSearch::IterateNodes(const std::vector<INode*>& allNodes) {
 		minNode = curNode;
 	#endif
 
-	IterateNodeNeighbors(curNode->GetNeighbors(allNodes));
+	IterateNodeNeighbors(curQTNode->GetNeighbors(allNodes));
 }
 
 void QTPFS::PathSearch::IterateNodeNeighbors(const std::vector<INode*>& nxtNodes) {
+	binary_heap<SearchNode*>& openNodes = threadData->openNodes;
+
+	INode* curQTNode = curNode->GetNode();
+
 	// if curNode equals srcNode, this is just the original srcPoint
-	const float3 curPoint = curNode->GetNeighborEdgeTransitionPoint(0);
+	const float3 curPoint = curNode->GetTransitionPoint();
 
 	for (unsigned int i = 0; i < nxtNodes.size(); i++) {
 		// NOTE:
@@ -213,14 +227,16 @@ void QTPFS::PathSearch::IterateNodeNeighbors(const std::vector<INode*>& nxtNodes
 		//   in the first case we would explore many more nodes than necessary (CPU
 		//   nightmare), while in the second we would get low-quality paths (player
 		//   nightmare)
-		nxtNode = nxtNodes[i];
+		INode* nxtQTNode = nxtNodes[i];
 
-		if (nxtNode->AllSquaresImpassable())
+		if (IsNodeImpassable(nxtQTNode))
 			continue;
 
-		const bool isCurrent = (nxtNode->GetSearchState() >= searchState);
-		const bool isClosed = ((nxtNode->GetSearchState() & 1) == NODE_STATE_CLOSED);
-		const bool isTarget = (nxtNode == tgtNode);
+		nxtNode = threadData->GetNode(nxtQTNode);
+
+		const bool isCurrent = (nxtNode->GetNodeState() != NODE_STATE_UNSEEN);
+		const bool isClosed = (nxtNode->GetNodeState() == NODE_STATE_CLOSED);
+		const bool isTarget = (nxtQTNode == tgtNode);
 
 		unsigned int netPointIdx = 0;
 
@@ -231,7 +247,7 @@ void QTPFS::PathSearch::IterateNodeNeighbors(const std::vector<INode*>& nxtNodes
 			// to be fancy (note that this is not always the best
 			// option, it causes local and global sub-optimalities
 			// which SmoothPath can only partially address)
-			netPoints[0] = curNode->GetNeighborEdgeTransitionPoint(1 + i);
+			netPoints[0] = curQTNode->GetNeighborEdgeTransitionPoint(1 + i);
 
 			// cannot use squared-distances because that will bias paths
 			// towards smaller nodes (eg. 1^2 + 1^2 + 1^2 + 1^2 != 4^2)
@@ -239,8 +255,8 @@ void QTPFS::PathSearch::IterateNodeNeighbors(const std::vector<INode*>& nxtNodes
 			hDists[0] = tgtPoint.distance(netPoints[0]);
 			gCosts[0] =
 				curNode->GetPathCost(NODE_PATH_COST_G) +
-				curNode->GetMoveCost() * gDists[0] +
-				nxtNode->GetMoveCost() * hDists[0] * int(isTarget);
+				GetNodeMoveCost(curQTNode) * gDists[0] +
+				GetNodeMoveCost(nxtQTNode) * hDists[0] * int(isTarget);
 			hCosts[0] = hDists[0] * hCostMult * int(!isTarget);
 		}
 		#else
@@ -251,14 +267,14 @@ void QTPFS::PathSearch::IterateNodeNeighbors(const std::vector<INode*>& nxtNodes
 		// not handle; more points means a greater degree
 		// of non-cardinality (but gets expensive quickly)
 		for (unsigned int j = 0; j < QTPFS_MAX_NETPOINTS_PER_NODE_EDGE; j++) {
-			netPoints[j] = curNode->GetNeighborEdgeTransitionPoint(1 + i * QTPFS_MAX_NETPOINTS_PER_NODE_EDGE + j);
+			netPoints[j] = curQTNode->GetNeighborEdgeTransitionPoint(1 + i * QTPFS_MAX_NETPOINTS_PER_NODE_EDGE + j);
 
 			gDists[j] = curPoint.distance(netPoints[j]);
 			hDists[j] = tgtPoint.distance(netPoints[j]);
 			gCosts[j] =
 				curNode->GetPathCost(NODE_PATH_COST_G) +
-				curNode->GetMoveCost() * gDists[j] +
-				nxtNode->GetMoveCost() * hDists[j] * int(isTarget);
+				GetNodeMoveCost(curQTNode) * gDists[j] +
+				GetNodeMoveCost(nxtQTNode) * hDists[j] * int(isTarget);
 			hCosts[j] = hDists[j] * hCostMult * int(!isTarget);
 
 			if ((gCosts[j] + hCosts[j]) < (gCosts[netPointIdx] + hCosts[netPointIdx])) {
@@ -274,7 +290,7 @@ void QTPFS::PathSearch::IterateNodeNeighbors(const std::vector<INode*>& nxtNodes
 			openNodes.check_heap_property(0);
 
 			#ifdef QTPFS_TRACE_PATH_SEARCHES
-			searchIter.AddPushedNodeIdx(nxtNode->zmin() * mapDims.mapx + nxtNode->xmin());
+			searchIter.AddPushedNodeIdx(nxtQTNode->zmin() * mapDims.mapx + nxtQTNode->xmin());
 			#endif
 
 			continue;
@@ -304,8 +320,11 @@ void QTPFS::PathSearch::Finalize(IPath* path) {
 
 	path->SetBoundingBox();
 
-	// path remains in live-cache until DeletePath is called
-	pathCache->AddLivePath(path);
+	// NOTE:
+	//   the path is NOT added to the live-cache here, Finalize can run
+	//   concurrently with other searches on the same layer; the manager
+	//   does this afterwards
+	threadData = NULL;
 }
 
 void QTPFS::PathSearch::TracePath(IPath* path) {
@@ -313,13 +332,13 @@ void QTPFS::PathSearch::TracePath(IPath* path) {
 //	std::list<float3>::const_iterator pointsIt;
 
 	if (srcNode != tgtNode) {
-		INode* tmpNode = tgtNode;
-		INode* prvNode = tmpNode->GetPrevNode();
+		SearchNode* tmpNode = tgtSearchNode;
+		SearchNode* prvNode = tmpNode->GetPrevNode();
 
 		float3 prvPoint = tgtPoint;
 
-		while ((prvNode != NULL) && (tmpNode != srcNode)) {
-			const float3& tmpPoint = tmpNode->GetNeighborEdgeTransitionPoint(0);
+		while ((prvNode != NULL) && (tmpNode != srcSearchNode)) {
+			const float3& tmpPoint = tmpNode->GetTransitionPoint();
 
 			assert(!math::isinf(tmpPoint.x) && !math::isinf(tmpPoint.z));
 			assert(!math::isnan(tmpPoint.x) && !math::isnan(tmpPoint.z));
@@ -328,19 +347,12 @@ void QTPFS::PathSearch::TracePath(IPath* path) {
 			//   one exception: tgtPoint can legitimately coincide
 			//   with first transition-point, which we must ignore
 			assert(tmpNode != prvNode);
-			assert(tmpPoint != prvPoint || tmpNode == tgtNode);
+			assert(tmpPoint != prvPoint || tmpNode == tgtSearchNode);
 
 			if (tmpPoint != prvPoint) {
 				points.push_front(tmpPoint);
 			}
 
-			#ifndef QTPFS_SMOOTH_PATHS
-			// make sure the back-pointers can never become dangling
-			// (if smoothing IS enabled, we delay this until we reach
-			// SmoothPath() because we still need them there)
-			tmpNode->SetPrevNode(NULL);
-			#endif
-
 			prvPoint = tmpPoint;
 			tmpNode = prvNode;
 			prvNode = tmpNode->GetPrevNode();
@@ -369,7 +381,7 @@ void QTPFS::PathSearch::SmoothPath(IPath* path) const {
 	if (path->NumPoints() == 2)
 		return;
 
-	assert(srcNode->GetPrevNode() == NULL);
+	assert(srcSearchNode->GetPrevNode() == NULL);
 
 	for (unsigned int k = 0; k < QTPFS_MAX_SMOOTHING_ITERATIONS; k++) {
 		if (!SmoothPathIter(path)) {
@@ -377,17 +389,6 @@ void QTPFS::PathSearch::SmoothPath(IPath* path) const {
 			break;
 		}
 	}
-
-	INode* n0 = tgtNode;
-	INode* n1 = tgtNode;
-
-	while (n1 != srcNode) {
-		n0 = n1;
-		n1 = n0->GetPrevNode();
-
-		// reset back-pointers
-		n0->SetPrevNode(NULL);
-	}
 }
 
 bool QTPFS::PathSearch::SmoothPathIter(IPath* path) const {
@@ -398,14 +399,17 @@ bool QTPFS::PathSearch::SmoothPathIter(IPath* path) const {
 	unsigned int ni = path->NumPoints();
 	unsigned int nm = 0;
 
-	INode* n0 = tgtNode;
-	INode* n1 = tgtNode;
+	SearchNode* sn0 = tgtSearchNode;
+	SearchNode* sn1 = tgtSearchNode;
 
-	while (n1 != srcNode) {
-		n0 = n1;
-		n1 = n0->GetPrevNode();
+	while (sn1 != srcSearchNode) {
+		sn0 = sn1;
+		sn1 = sn0->GetPrevNode();
 		ni -= 1;
 
+		const INode* n0 = sn0->GetNode();
+		const INode* n1 = sn1->GetNode();
+
 		assert(n1->GetNeighborRelation(n0) != 0);
 		assert(n0->GetNeighborRelation(n1) != 0);
 		assert(ni < path->NumPoints());
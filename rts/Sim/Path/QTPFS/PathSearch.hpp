@@ -3,6 +3,7 @@
 #ifndef QTPFS_PATHSEARCH_HDR
 #define QTPFS_PATHSEARCH_HDR
 
+#include <algorithm>
 #include <map>
 #include <vector>
 
@@ -53,12 +54,141 @@ namespace QTPFS {
 	}
 
 
+	// per-search state of a node; these used to be INode members
+	// (which limited execution to one search per layer at a time)
+	struct SearchNode {
+	public:
+		SearchNode(INode* n = NULL)
+			: node(n)
+			, prevNode(NULL)
+			, heapIndex(-1u)
+			, nodeState(NODE_STATE_UNSEEN)
+			{ pathCosts[NODE_PATH_COST_F] = 0.0f; pathCosts[NODE_PATH_COST_G] = 0.0f; pathCosts[NODE_PATH_COST_H] = 0.0f; }
+
+		void SetHeapIndex(unsigned int n) { heapIndex = n; }
+		unsigned int GetHeapIndex() const { return heapIndex; }
+		float GetHeapPriority() const { return (GetPathCost(NODE_PATH_COST_F)); }
+
+		bool operator <  (const SearchNode* n) const { return (pathCosts[NODE_PATH_COST_F] <  n->pathCosts[NODE_PATH_COST_F]); }
+		bool operator >  (const SearchNode* n) const { return (pathCosts[NODE_PATH_COST_F] >  n->pathCosts[NODE_PATH_COST_F]); }
+		bool operator == (const SearchNode* n) const { return (pathCosts[NODE_PATH_COST_F] == n->pathCosts[NODE_PATH_COST_F]); }
+		bool operator <= (const SearchNode* n) const { return (pathCosts[NODE_PATH_COST_F] <= n->pathCosts[NODE_PATH_COST_F]); }
+		bool operator >= (const SearchNode* n) const { return (pathCosts[NODE_PATH_COST_F] >= n->pathCosts[NODE_PATH_COST_F]); }
+
+		void SetPathCosts(float g, float h) {
+			pathCosts[NODE_PATH_COST_F] = g + h;
+			pathCosts[NODE_PATH_COST_G] = g;
+			pathCosts[NODE_PATH_COST_H] = h;
+		}
+		float GetPathCost(unsigned int type) const { assert(type <= NODE_PATH_COST_H); return pathCosts[type]; }
+
+		void SetNodeState(unsigned int state) { nodeState = state; }
+		unsigned int GetNodeState() const { return nodeState; }
+
+		void SetPrevNode(SearchNode* n) { prevNode = n; }
+		SearchNode* GetPrevNode() { return prevNode; }
+
+		void SetTransitionPoint(const float3& p) { transitionPoint = p; }
+		const float3& GetTransitionPoint() const { return transitionPoint; }
+
+		INode* GetNode() { return node; }
+
+	private:
+		INode* node;
+
+		// points back to previous node in path
+		SearchNode* prevNode;
+
+		// edge transition-point through which this node was entered
+		float3 transitionPoint;
+
+		// NOTE:
+		//     storing the heap-index is an *UGLY* break of abstraction,
+		//     but the only way to keep the cost of resorting acceptable
+		unsigned int heapIndex;
+		unsigned int nodeState;
+
+		float pathCosts[NODE_PATH_COST_H + 1];
+	};
+
+	// scratch memory for searches, one instance per executing thread
+	// allocated once and re-used by all searches run on that thread
+	struct SearchThreadData {
+	public:
+		SearchThreadData(): generation(0) {}
+
+		void Init(unsigned int numNodes) {
+			openNodes.reserve(numNodes);
+			searchNodes.reserve(numNodes);
+		}
+		void Kill() {
+			openNodes.clear();
+			searchNodes.clear();
+			nodeSlots.clear();
+		}
+		void Reset(unsigned int numNodes, unsigned int numLeafIndices) {
+			openNodes.reset();
+			searchNodes.clear();
+
+			// a search visits every leaf at most once, so with room for all
+			// of them the pointers returned by GetNode can never be invalid
+			searchNodes.reserve(numNodes);
+
+			// slots only grow on the threads that actually run searches,
+			// and never beyond the peak leaf-count of the largest layer
+			if (nodeSlots.size() < numLeafIndices)
+				nodeSlots.resize(numLeafIndices, NodeSlot());
+
+			// bumping the generation discards all slots without clearing them
+			if ((++generation) == 0) {
+				std::fill(nodeSlots.begin(), nodeSlots.end(), NodeSlot());
+				generation = 1;
+			}
+		}
+
+		SearchNode* GetNode(INode* node) {
+			// leaf-indices are dense per layer (node numbers are tree-IDs
+			// and far too sparse to index by)
+			NodeSlot& slot = nodeSlots[node->GetLeafIndex()];
+
+			if (slot.generation != generation) {
+				assert(searchNodes.size() < searchNodes.capacity());
+
+				slot.generation = generation;
+				slot.index = searchNodes.size();
+
+				searchNodes.push_back(SearchNode(node));
+			}
+
+			assert(searchNodes[slot.index].GetNode() == node);
+			return &searchNodes[slot.index];
+		}
+
+		// relies on SearchNode::operator< to sort by increasing f-cost
+		binary_heap<SearchNode*> openNodes;
+
+	private:
+		struct NodeSlot {
+			NodeSlot(): generation(0), index(0) {}
+
+			unsigned int generation;
+			unsigned int index;
+		};
+
+		// state of the nodes visited by the current search, in visiting order
+		std::vector<SearchNode> searchNodes;
+		// per leaf-index index into searchNodes, valid if stamped with <generation>
+		std::vector<NodeSlot> nodeSlots;
+
+		unsigned int generation;
+	};
+
+
 	// NOTE:
-	//     we could support "time-sliced" execution, but we would have
-	//     to isolate each query from modifying another's INode members
-	//     (*Cost, nodeState, etc.) --> memory-intensive
-	//     also, terrain changes could invalidate partial paths without
-	//     buffering the *entire* heightmap each frame --> not efficient
+	//     we could support "time-sliced" execution now that no query
+	//     modifies INode members, but terrain changes could invalidate
+	//     partial paths without buffering the *entire* heightmap each
+	//     frame --> not efficient
 	// NOTE:
 	//     with time-sliced execution, {src,tgt,cur,nxt}Node can become
 	//     dangling
@@ -67,7 +197,6 @@ namespace QTPFS {
 			: searchID(0)
 			, searchTeam(0)
 			, searchType(pathSearchType)
-			, searchState(0)
 			, searchMagic(0)
 			{}
 		virtual ~IPathSearch() {}
@@ -79,8 +208,10 @@ namespace QTPFS {
 			const float3& targetPoint,
 			const SRectangle& searchArea
 		) = 0;
+		// Execute and Finalize must run back-to-back on the thread that
+		// owns <threadData>, the next search executed there reuses it
 		virtual bool Execute(
-			unsigned int searchStateOffset = 0,
+			SearchThreadData* threadData,
 			unsigned int searchMagicNumber = 0
 		) = 0;
 		virtual void Finalize(IPath* path) = 0;
@@ -99,7 +230,6 @@ namespace QTPFS {
 		unsigned int searchTeam;   // which team queued this search
 
 		unsigned int searchType;   // indicates if Dijkstra (h==0) or A* (h!=0) search is employed
-		unsigned int searchState;  // offset that identifies nodes as part of current search
 		unsigned int searchMagic;  // used to signal nodes they should update their neighbor-set
 	};
 
@@ -110,17 +240,19 @@ namespace QTPFS {
 			: IPathSearch(pathSearchType)
 			, nodeLayer(NULL)
 			, pathCache(NULL)
+			, threadData(NULL)
 			, searchExec(NULL)
 			, srcNode(NULL)
 			, tgtNode(NULL)
 			, curNode(NULL)
 			, nxtNode(NULL)
 			, minNode(NULL)
+			, srcSearchNode(NULL)
+			, tgtSearchNode(NULL)
 			, hCostMult(0.0f)
 			, haveFullPath(false)
 			, havePartPath(false)
 			{}
-		~PathSearch() { openNodes.reset(); }
 
 		void Initialize(
 			NodeLayer* layer,
@@ -130,7 +262,7 @@ namespace QTPFS {
 			const SRectangle& searchArea
 		);
 		bool Execute(
-			unsigned int searchStateOffset = 0,
+			SearchThreadData* threadData,
 			unsigned int searchMagicNumber = 0
 		);
 		void Finalize(IPath* path);
@@ -139,12 +271,17 @@ namespace QTPFS {
 
 		const boost::uint64_t GetHash(boost::uint64_t N, boost::uint32_t k) const;
 
-		static void InitGlobalQueue(unsigned int n) { openNodes.reserve(n); }
-		static void FreeGlobalQueue() { openNodes.clear(); }
-
 	private:
-		void ResetState(INode* node);
-		void UpdateNode(INode* nextNode, INode* prevNode, unsigned int netPointIdx);
+		void ResetState(SearchNode* node);
+		void UpdateNode(SearchNode* nextNode, SearchNode* prevNode, unsigned int netPointIdx);
+
+		// the source-node is never treated as impassable (see Execute)
+		float GetNodeMoveCost(const INode* node) const {
+			return ((node == srcNode && node->AllSquaresImpassable())? 0.0f: node->GetMoveCost());
+		}
+		bool IsNodeImpassable(const INode* node) const {
+			return (node != srcNode && node->AllSquaresImpassable());
+		}
 
 		void IterateNodes(const std::vector<INode*>& allNodes);
 		void IterateNodeNeighbors(const std::vector<INode*>& nxtNodes);
@@ -153,13 +290,12 @@ namespace QTPFS {
 		void SmoothPath(IPath* path) const;
 		bool SmoothPathIter(IPath* path) const;
 
-		// global queue: allocated once, re-used by all searches without clear()'s
-		// this relies on INode::operator< to sort the INode*'s by increasing f-cost
-		static binary_heap<INode*> openNodes;
-
 		NodeLayer* nodeLayer;
 		PathCache* pathCache;
 
+		// only valid between Execute and Finalize
+		SearchThreadData* threadData;
+
 		// not used unless QTPFS_TRACE_PATH_SEARCHES is defined
 		PathSearchTrace::Execution* searchExec;
 		PathSearchTrace::Iteration searchIter;
@@ -167,8 +303,9 @@ namespace QTPFS {
 		SRectangle searchRect;
 
 		INode *srcNode, *tgtNode;
-		INode *curNode, *nxtNode;
-		INode *minNode;
+		SearchNode *curNode, *nxtNode;
+		SearchNode *minNode;
+		SearchNode *srcSearchNode, *tgtSearchNode;
 
 		float3 srcPoint;
 		float3 tgtPoint;
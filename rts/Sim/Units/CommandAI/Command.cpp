@@ -1,6 +1,23 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include "Command.h"
+#include "System/Log/ILog.h"
+#include "System/Platform/CrashHandler.h"
+#include "System/maindefines.h"
+
+#include <algorithm>
+#include <cstring>
+#include <atomic>
+
+CR_BIND(CommandParams, )
+CR_REG_METADATA(CommandParams, (
+	CR_IGNORED(inlineParams),
+	CR_IGNORED(heapParams),
+	CR_IGNORED(numParams),
+	CR_IGNORED(maxParams),
+	CR_IGNORED(showError),
+	CR_SERIALIZER(Serialize)
+))
 
 CR_BIND(Command, )
 CR_REG_METADATA(Command, (
@@ -28,3 +45,75 @@ CR_REG_METADATA(CommandDescription, (
 	CR_MEMBER(params),
 	CR_RESERVED(32)
 ))
+
+
+
+static std::atomic<unsigned int> numHeapParamAllocs(0);
+
+unsigned int CommandParams::GetNumHeapAllocs() { return numHeapParamAllocs; }
+
+
+CommandParams& CommandParams::operator = (const CommandParams& p)
+{
+	if (this == &p)
+		return *this;
+
+	// reuses an existing heap buffer if it is large enough
+	reserve(p.numParams);
+	std::memcpy(data(), p.data(), p.numParams * sizeof(float));
+
+	numParams = p.numParams;
+	return *this;
+}
+
+void CommandParams::Grow(size_type n)
+{
+	float* newParams = new float[n];
+
+	std::memcpy(newParams, data(), numParams * sizeof(float));
+	delete[] heapParams;
+
+	heapParams = newParams;
+	maxParams = n;
+
+	numHeapParamAllocs += 1;
+}
+
+void CommandParams::Serialize(creg::ISerializer* s)
+{
+	unsigned int n = numParams;
+
+	s->SerializeInt(&n, sizeof(n));
+
+	if (!s->IsWriting())
+		resize(n);
+
+	for (unsigned int i = 0; i < n; i++) {
+		s->SerializeInt(&data()[i], sizeof(float));
+	}
+}
+
+
+const float& CommandParams::safe_element(size_type idx) const {
+	static const float def = 0.0f;
+
+	if (showError) {
+		showError = false;
+		LOG_L(L_ERROR, "[%s const] index " _STPF_ " out of bounds! (size " _STPF_ ")", __FUNCTION__, idx, size());
+		CrashHandler::OutputStacktrace();
+	}
+
+	return def;
+}
+
+float& CommandParams::safe_element(size_type idx) {
+	static float def = 0.0f;
+
+	if (showError) {
+		showError = false;
+		LOG_L(L_ERROR, "[%s] index " _STPF_ " out of bounds! (size " _STPF_ ")", __FUNCTION__, idx, size());
+		CrashHandler::OutputStacktrace();
+	}
+
+	return def;
+}
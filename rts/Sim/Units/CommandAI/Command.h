@@ -4,11 +4,12 @@
 #define COMMAND_H
 
 #include <string>
+#include <vector>
 #include <climits> // for INT_MAX
+#include <cstddef>
 
 #include "System/creg/creg_cond.h"
 #include "System/float3.h"
-#include "System/SafeVector.h"
 
 // ID's lower than 0 are reserved for build options (cmd -x = unitdefs[x])
 #define CMD_STOP                   0
@@ -117,6 +118,109 @@ enum {
 	FIRESTATE_FIREATNEUTRAL =  3,
 };
 
+/**
+ * Parameter storage for Command.
+ * The first INLINE_PARAMS values live inside the object itself so that the
+ * common (position / radius / object-id) commands never touch the heap; a
+ * larger buffer is only allocated when a command outgrows that and is reused
+ * when the slot is overwritten later (CCommandQueue recycles its slots).
+ * Out-of-bounds access is caught like it was with safe_vector<float>.
+ */
+class CommandParams
+{
+	CR_DECLARE_STRUCT(CommandParams)
+
+public:
+	typedef std::size_t size_type;
+
+	static const unsigned int INLINE_PARAMS = 8;
+
+	CommandParams()
+		: heapParams(nullptr)
+		, numParams(0)
+		, maxParams(INLINE_PARAMS)
+		, showError(true)
+	{}
+	CommandParams(const CommandParams& p)
+		: heapParams(nullptr)
+		, numParams(0)
+		, maxParams(INLINE_PARAMS)
+		, showError(true)
+	{
+		*this = p;
+	}
+	~CommandParams() { delete[] heapParams; }
+
+	CommandParams& operator = (const CommandParams& p);
+
+	bool empty() const { return (numParams == 0); }
+	size_type size() const { return numParams; }
+	size_type capacity() const { return maxParams; }
+
+	void clear() { numParams = 0; }
+	void reserve(size_type n) {
+		if (n > maxParams)
+			Grow(n);
+	}
+	void resize(size_type n, float value = 0.0f) {
+		reserve(n);
+
+		for (size_type i = numParams; i < n; i++)
+			data()[i] = value;
+
+		numParams = n;
+	}
+	void push_back(float value) {
+		if (numParams == maxParams)
+			Grow(maxParams * 2);
+
+		data()[numParams++] = value;
+	}
+
+	      float* data()       { return ((heapParams != nullptr)? heapParams: &inlineParams[0]); }
+	const float* data() const { return ((heapParams != nullptr)? heapParams: &inlineParams[0]); }
+
+	      float* begin()       { return (data()            ); }
+	const float* begin() const { return (data()            ); }
+	      float* end()         { return (data() + numParams); }
+	const float* end()   const { return (data() + numParams); }
+
+	const float& operator[] (const size_type i) const {
+		if (i >= numParams)
+			return safe_element(i);
+		return data()[i];
+	}
+	float& operator[] (const size_type i) {
+		if (i >= numParams)
+			return safe_element(i);
+		return data()[i];
+	}
+
+	const float& at(const size_type i) const { return (*this)[i]; }
+	      float& at(const size_type i)       { return (*this)[i]; }
+
+	void Serialize(creg::ISerializer* s);
+
+	/// number of heap buffers allocated by all instances so far
+	static unsigned int GetNumHeapAllocs();
+
+private:
+	void Grow(size_type n);
+
+	const float& safe_element(size_type idx) const;
+	      float& safe_element(size_type idx);
+
+private:
+	float inlineParams[INLINE_PARAMS];
+	float* heapParams;
+
+	unsigned int numParams;
+	unsigned int maxParams;
+
+	mutable bool showError;
+};
+
+
 struct Command
 {
 private:
@@ -279,7 +383,7 @@ public:
 	void PushParam(float par) { params.push_back(par); }
 	const float& GetParam(size_t idx) const { return params[idx]; }
 
-	/// const safe_vector<float>& GetParams() const { return params; }
+	/// const CommandParams& GetParams() const { return params; }
 	const size_t GetParamsCount() const { return params.size(); }
 
 	void SetID(int id) _deprecated { this->id = id; params.clear(); }
@@ -326,7 +430,7 @@ public:
 	unsigned char options;
 
 	/// command parameters
-	safe_vector<float> params;
+	CommandParams params;
 
 	/// unique id within a CCommandQueue
 	unsigned int tag;
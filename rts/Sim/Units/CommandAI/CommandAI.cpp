@@ -26,8 +26,10 @@
 #include "System/myMath.h"
 #include "System/Log/ILog.h"
 #include "System/Util.h"
-#include "System/creg/STL_Set.h"
 #include "System/creg/STL_Deque.h"
+#include "System/creg/STL_Set.h"
+
+#include <atomic>
 #include <assert.h>
 
 // number of SlowUpdate calls that a target (unit) must
@@ -45,10 +47,35 @@ static const float COMMAND_CANCEL_DIST = 17.0f;
 CR_BIND(CCommandQueue, )
 CR_REG_METADATA(CCommandQueue, (
 	CR_MEMBER(queue),
+	CR_MEMBER(commands),
+	CR_MEMBER(freeCommands),
+	CR_MEMBER(head),
+	CR_MEMBER(count),
 	CR_MEMBER(queueType),
 	CR_MEMBER(tagCounter)
 ))
 
+static std::atomic<unsigned int> numCommandQueueReallocs(0);
+
+unsigned int CCommandQueue::GetNumReallocs() { return numCommandQueueReallocs; }
+
+void CCommandQueue::Grow()
+{
+	const unsigned int newSize = std::max(queue.size() * 2, size_t(8));
+
+	// keep absolute positions (and thus iterators) the same; the
+	// commands themselves stay where they are, only indices move
+	std::vector<unsigned int> newQueue(newSize, 0);
+
+	for (unsigned int i = 0; i < count; i++) {
+		newQueue[(head + i) & (newSize - 1)] = index(head + i);
+	}
+
+	queue.swap(newQueue);
+
+	numCommandQueueReallocs += 1;
+}
+
 CR_BIND_DERIVED(CCommandAI, CObject, )
 CR_REG_METADATA(CCommandAI, (
 	CR_MEMBER(stockpileWeapon),
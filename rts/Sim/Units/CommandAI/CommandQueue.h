@@ -4,9 +4,24 @@
 #define _COMMAND_QUEUE_H
 
 #include <deque>
+#include <vector>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <cassert>
 #include "Command.h"
 
-/// A wrapper class for std::deque<Command> to keep track of commands
+/**
+ * Keeps track of commands in a ring-buffer of indices into stable storage.
+ *
+ * Commands are never moved once created: the ring-buffer only holds their
+ * indices and storage is recycled (Command keeps its parameter buffer when
+ * overwritten) so steady-state queueing does not allocate. A reference to a
+ * queued command thus stays valid across any push, insert or growth, like
+ * with std::deque (the CAI code relies on this for queue.front()), until
+ * that command itself is removed. Iterators address elements by an absolute
+ * position that only changes for the shifted side of an insert or erase.
+ */
 class CCommandQueue {
 
 	friend class CCommandAI;
@@ -28,17 +43,58 @@ class CCommandQueue {
 		/// limit to a float's integer range
 		static const int maxTagValue = (1 << 24); // 16777216
 
-		typedef std::deque<Command> basis;
-
-		typedef basis::size_type              size_type;
-		typedef basis::iterator               iterator;
-		typedef basis::const_iterator         const_iterator;
-		typedef basis::reverse_iterator       reverse_iterator;
-		typedef basis::const_reverse_iterator const_reverse_iterator;
+		template<typename Q, typename T> class basic_iterator;
+
+		typedef std::size_t size_type;
+		typedef basic_iterator<      CCommandQueue,       Command> iterator;
+		typedef basic_iterator<const CCommandQueue, const Command> const_iterator;
+		typedef std::reverse_iterator<iterator>                    reverse_iterator;
+		typedef std::reverse_iterator<const_iterator>              const_reverse_iterator;
+
+		template<typename Q, typename T> class basic_iterator: public std::iterator<std::random_access_iterator_tag, typename std::remove_const<T>::type, std::ptrdiff_t, T*, T&> {
+		public:
+			typedef std::ptrdiff_t difference_type;
+
+			basic_iterator(): q(nullptr), pos(0) {}
+			basic_iterator(Q* queue, unsigned int p): q(queue), pos(p) {}
+			// allows iterator -> const_iterator conversion
+			template<typename Q2, typename T2> basic_iterator(const basic_iterator<Q2, T2>& it): q(it.q), pos(it.pos) {}
+
+			T& operator * () const { return q->slot(pos); }
+			T* operator -> () const { return &q->slot(pos); }
+			T& operator [] (difference_type n) const { return q->slot(pos + n); }
+
+			basic_iterator& operator ++ () { ++pos; return *this; }
+			basic_iterator& operator -- () { --pos; return *this; }
+			basic_iterator  operator ++ (int) { basic_iterator it = *this; ++pos; return it; }
+			basic_iterator  operator -- (int) { basic_iterator it = *this; --pos; return it; }
+
+			basic_iterator& operator += (difference_type n) { pos += n; return *this; }
+			basic_iterator& operator -= (difference_type n) { pos -= n; return *this; }
+			basic_iterator  operator +  (difference_type n) const { return basic_iterator(q, pos + n); }
+			basic_iterator  operator -  (difference_type n) const { return basic_iterator(q, pos - n); }
+
+			// positions wrap around, compare their (signed) distance
+			template<typename Q2, typename T2> difference_type operator - (const basic_iterator<Q2, T2>& it) const { return int(pos - it.pos); }
+
+			template<typename Q2, typename T2> bool operator == (const basic_iterator<Q2, T2>& it) const { return (pos == it.pos); }
+			template<typename Q2, typename T2> bool operator != (const basic_iterator<Q2, T2>& it) const { return (pos != it.pos); }
+			template<typename Q2, typename T2> bool operator <  (const basic_iterator<Q2, T2>& it) const { return ((*this - it) <  0); }
+			template<typename Q2, typename T2> bool operator >  (const basic_iterator<Q2, T2>& it) const { return ((*this - it) >  0); }
+			template<typename Q2, typename T2> bool operator <= (const basic_iterator<Q2, T2>& it) const { return ((*this - it) <= 0); }
+			template<typename Q2, typename T2> bool operator >= (const basic_iterator<Q2, T2>& it) const { return ((*this - it) >= 0); }
+
+		private:
+			template<typename Q2, typename T2> friend class basic_iterator;
+			friend class CCommandQueue;
+
+			Q* q;
+			unsigned int pos;
+		};
 
-		inline bool empty() const { return queue.empty(); }
+		inline bool empty() const { return (count == 0); }
 
-		inline size_type size() const { return queue.size(); }
+		inline size_type size() const { return count; }
 
 		inline void push_back(const Command& cmd);
 		inline void push_front(const Command& cmd);
@@ -47,49 +103,58 @@ class CCommandQueue {
 
 		inline void pop_back()
 		{
-			queue.pop_back();
+			assert(!empty());
+			freeCommands.push_back(index(head + count - 1));
+			count--;
 		}
 		inline void pop_front()
 		{
-			queue.pop_front();
+			assert(!empty());
+			freeCommands.push_back(index(head));
+			head++;
+			count--;
 		}
 
 		inline iterator erase(iterator pos)
 		{
-			return queue.erase(pos);
-		}
-		inline iterator erase(iterator first, iterator last)
-		{
-			return queue.erase(first, last);
+			return erase(pos, pos + 1);
 		}
+		inline iterator erase(iterator first, iterator last);
 		inline void clear()
 		{
-			queue.clear();
+			for (unsigned int i = 0; i < count; i++) {
+				freeCommands.push_back(index(head + i));
+			}
+
+			count = 0;
 		}
 
-		inline iterator       end()         { return queue.end(); }
-		inline const_iterator end()   const { return queue.end(); }
-		inline iterator       begin()       { return queue.begin(); }
-		inline const_iterator begin() const { return queue.begin(); }
+		inline iterator       end()         { return iterator(this, head + count); }
+		inline const_iterator end()   const { return const_iterator(this, head + count); }
+		inline iterator       begin()       { return iterator(this, head); }
+		inline const_iterator begin() const { return const_iterator(this, head); }
+
+		inline reverse_iterator       rend()         { return reverse_iterator(begin()); }
+		inline const_reverse_iterator rend()   const { return const_reverse_iterator(begin()); }
+		inline reverse_iterator       rbegin()       { return reverse_iterator(end()); }
+		inline const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
 
-		inline reverse_iterator       rend()         { return queue.rend(); }
-		inline const_reverse_iterator rend()   const { return queue.rend(); }
-		inline reverse_iterator       rbegin()       { return queue.rbegin(); }
-		inline const_reverse_iterator rbegin() const { return queue.rbegin(); }
+		inline       Command& back()        { return slot(head + count - 1); }
+		inline const Command& back()  const { return slot(head + count - 1); }
+		inline       Command& front()       { return slot(head); }
+		inline const Command& front() const { return slot(head); }
 
-		inline       Command& back()        { return queue.back(); }
-		inline const Command& back()  const { return queue.back(); }
-		inline       Command& front()       { return queue.front(); }
-		inline const Command& front() const { return queue.front(); }
+		inline       Command& at(size_type i)       { CheckIndex(i); return slot(head + i); }
+		inline const Command& at(size_type i) const { CheckIndex(i); return slot(head + i); }
 
-		inline       Command& at(size_type i)       { return queue.at(i); }
-		inline const Command& at(size_type i) const { return queue.at(i); }
+		inline       Command& operator[](size_type i)       { return slot(head + i); }
+		inline const Command& operator[](size_type i) const { return slot(head + i); }
 
-		inline       Command& operator[](size_type i)       { return queue[i]; }
-		inline const Command& operator[](size_type i) const { return queue[i]; }
+		/// number of times any queue had to enlarge its buffer so far
+		static unsigned int GetNumReallocs();
 
 	private:
-		CCommandQueue() : queueType(CommandQueueType), tagCounter(0) {};
+		CCommandQueue() : head(0), count(0), queueType(CommandQueueType), tagCounter(0) {};
 		CCommandQueue(const CCommandQueue&);
 		CCommandQueue& operator=(const CCommandQueue&);
 
@@ -97,8 +162,33 @@ class CCommandQueue {
 		inline int GetNextTag();
 		inline void SetQueueType(QueueType type) { queueType = type; }
 
+		inline       unsigned int& index(unsigned int pos)       { return queue[pos & (queue.size() - 1)]; }
+		inline const unsigned int& index(unsigned int pos) const { return queue[pos & (queue.size() - 1)]; }
+
+		inline       Command& slot(unsigned int pos)       { return commands[index(pos)]; }
+		inline const Command& slot(unsigned int pos) const { return commands[index(pos)]; }
+
+		inline void CheckIndex(size_type i) const {
+			if (i >= count)
+				throw std::out_of_range("CCommandQueue::at");
+		}
+
+		void Grow();
+		/// returns the index of an unused (recycled or new) command
+		inline unsigned int AllocCommand();
+
 	private:
-		std::deque<Command> queue;
+		/// ring-buffer of indices into <commands>, size is always zero or a power of two
+		std::vector<unsigned int> queue;
+		/// storage of all queued and recycled commands, never moves its elements
+		std::deque<Command> commands;
+		/// indices of the <commands> that are not queued
+		std::vector<unsigned int> freeCommands;
+
+		/// absolute position of the front element
+		unsigned int head;
+		unsigned int count;
+
 		QueueType queueType;
 		int tagCounter;
 };
@@ -114,26 +204,109 @@ inline int CCommandQueue::GetNextTag()
 }
 
 
+inline unsigned int CCommandQueue::AllocCommand()
+{
+	if (freeCommands.empty()) {
+		// deque growth leaves references to existing commands (eg. <cmd>) intact
+		commands.emplace_back();
+		return (commands.size() - 1);
+	}
+
+	const unsigned int cmdIdx = freeCommands.back();
+	freeCommands.pop_back();
+	return cmdIdx;
+}
+
+
 inline void CCommandQueue::push_back(const Command& cmd)
 {
-	queue.push_back(cmd);
-	queue.back().tag = GetNextTag();
+	const unsigned int cmdIdx = AllocCommand();
+
+	// <cmd> can be a just popped command, in which case this is a self-assignment
+	Command& c = commands[cmdIdx];
+	c = cmd;
+	c.tag = GetNextTag();
+
+	if (count == queue.size())
+		Grow();
+
+	index(head + count) = cmdIdx;
+	count++;
 }
 
 
 inline void CCommandQueue::push_front(const Command& cmd)
 {
-	queue.push_front(cmd);
-	queue.front().tag = GetNextTag();
+	const unsigned int cmdIdx = AllocCommand();
+
+	Command& c = commands[cmdIdx];
+	c = cmd;
+	c.tag = GetNextTag();
+
+	if (count == queue.size())
+		Grow();
+
+	index(head - 1) = cmdIdx;
+	head--;
+	count++;
 }
 
 
 inline CCommandQueue::iterator CCommandQueue::insert(iterator pos,
                                                      const Command& cmd)
 {
-	Command tmpCmd = cmd;
-	tmpCmd.tag = GetNextTag();
-	return queue.insert(pos, tmpCmd);
+	const unsigned int cmdIdx = AllocCommand();
+
+	Command& c = commands[cmdIdx];
+	c = cmd;
+	c.tag = GetNextTag();
+
+	if (count == queue.size())
+		Grow();
+
+	const unsigned int idx = pos.pos - head;
+
+	// shift whichever side of <pos> is shorter; only indices move
+	if (idx < (count >> 1)) {
+		for (unsigned int i = 0; i < idx; i++) {
+			index(head + i - 1) = index(head + i);
+		}
+		head--;
+	} else {
+		for (unsigned int i = count; i > idx; i--) {
+			index(head + i) = index(head + i - 1);
+		}
+	}
+
+	count++;
+	index(head + idx) = cmdIdx;
+	return iterator(this, head + idx);
+}
+
+
+inline CCommandQueue::iterator CCommandQueue::erase(iterator first, iterator last)
+{
+	const unsigned int idx = first.pos - head;
+	const unsigned int num = last.pos - first.pos;
+	const unsigned int rem = count - idx - num;
+
+	for (unsigned int i = 0; i < num; i++) {
+		freeCommands.push_back(index(head + idx + i));
+	}
+
+	if (idx < rem) {
+		for (unsigned int i = idx; i > 0; i--) {
+			index(head + i - 1 + num) = index(head + i - 1);
+		}
+		head += num;
+	} else {
+		for (unsigned int i = 0; i < rem; i++) {
+			index(head + idx + i) = index(head + idx + num + i);
+		}
+	}
+
+	count -= num;
+	return iterator(this, head + idx);
 }
 
 
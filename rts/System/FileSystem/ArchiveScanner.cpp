@@ -3,15 +3,19 @@
 
 #include <list>
 #include <algorithm>
+#include <atomic>
+#include <exception>
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "ArchiveScanner.h"
 #include "ArchiveLoader.h"
 #include "DataDirLocater.h"
 #include "Archives/IArchive.h"
+#include "Archives/BufferedArchive.h"
 #include "FileFilter.h"
 #include "DataDirsAccess.h"
 #include "FileSystem.h"
@@ -342,11 +346,15 @@ CArchiveScanner::CArchiveScanner()
 {
 	// the "cache" dir is created in DataDirLocater
 	const std:: string cacheFolder = dataDirLocater.GetWriteDirPath() + FileSystem::EnsurePathSepAtEnd(FileSystem::GetCacheBaseDir());
-	cachefile = cacheFolder + IntToString(INTERNAL_VER, "ArchiveCache%i.lua");
-	ReadCacheData(GetFilepath());
-	if (archiveInfos.empty()) {
-		// when versioned ArchiveCache%i.lua is missing or empty, try old unversioned filename
-		ReadCacheData(cacheFolder + "ArchiveCache.lua");
+	cachefile = cacheFolder + IntToString(INTERNAL_VER, "ArchiveCache%i.bin");
+
+	if (!ReadCacheData(GetFilepath())) {
+		// carry over what older versions found, instead of rescanning everything
+		ReadLuaCacheData(cacheFolder + IntToString(INTERNAL_VER, "ArchiveCache%i.lua"));
+		if (archiveInfos.empty()) {
+			// when versioned ArchiveCache%i.lua is missing or empty, try old unversioned filename
+			ReadLuaCacheData(cacheFolder + "ArchiveCache.lua");
+		}
 	}
 
 	const std::vector<std::string>& datadirs = dataDirLocater.GetDataDirPaths();
@@ -379,6 +387,8 @@ const std::string& CArchiveScanner::GetFilepath() const
 
 void CArchiveScanner::ScanDirs(const std::vector<std::string>& scanDirs, bool doChecksum)
 {
+	// held while checksumming too, the workers do not touch archiveInfos
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
 	isDirty = true;
 
 	// scan for all archives
@@ -408,12 +418,16 @@ void CArchiveScanner::ScanDirs(const std::vector<std::string>& scanDirs, bool do
 
 	// Create archiveInfos etc. when not being in cache already
 	for (const std::string& archive: foundArchives) {
-		ScanArchive(archive, doChecksum);
+		ScanArchive(archive, false);
 	#if !defined(DEDICATED) && !defined(UNITSYNC)
 		Watchdog::ClearTimer(WDT_MAIN);
 	#endif
 	}
 
+	// checksumming dominates a cold scan, do it for all new archives at once
+	if (doChecksum)
+		UpdateChecksums();
+
 	// Now we'll have to parse the replaces-stuff found in the mods
 	for (auto& aii: archiveInfos) {
 		for (std::string& replaceName: aii.second.archiveData.GetReplaces()) {
@@ -428,6 +442,8 @@ void CArchiveScanner::ScanDirs(const std::vector<std::string>& scanDirs, bool do
 			ai.replaced = aii.first;
 		}
 	}
+
+	nameIndex.clear();
 }
 
 
@@ -519,6 +535,12 @@ std::string CArchiveScanner::SearchMapFile(const IArchive* ar, std::string& erro
 	return "";
 }
 
+/// archives read from the lua cache have no size, their mtime has to suffice
+static bool IsSameSize(boost::uint64_t cachedSize, boost::uint64_t size)
+{
+	return (cachedSize == 0 || cachedSize == size);
+}
+
 static bool IsBaseContent(const std::string& fileName)
 {
 	return ((fileName == "bitmaps.sdz")
@@ -529,6 +551,9 @@ static bool IsBaseContent(const std::string& fileName)
 
 void CArchiveScanner::ScanArchive(const std::string& fullName, bool doChecksum)
 {
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
+	nameIndex.clear();
+
 	const std::string fn    = FileSystem::GetFilename(fullName);
 	const std::string fpath = FileSystem::GetDirectory(fullName);
 	const std::string lcfn  = StringToLower(fn);
@@ -542,7 +567,8 @@ void CArchiveScanner::ScanArchive(const std::string& fullName, bool doChecksum)
 		// Determine whether this archive has earlier be found to be broken
 		std::map<std::string, BrokenArchive>::iterator bai = brokenArchives.find(lcfn);
 		if (bai != brokenArchives.end()) {
-			if ((unsigned)info.st_mtime == bai->second.modified && fpath == bai->second.path) {
+			if ((unsigned)info.st_mtime == bai->second.modified && IsSameSize(bai->second.size, info.st_size) && fpath == bai->second.path) {
+				bai->second.size = info.st_size;
 				bai->second.updated = true;
 				return;
 			}
@@ -556,8 +582,9 @@ void CArchiveScanner::ScanArchive(const std::string& fullName, bool doChecksum)
 				return;
 			}
 
-			if ((unsigned)info.st_mtime == aii->second.modified && fpath == aii->second.path) {
+			if ((unsigned)info.st_mtime == aii->second.modified && IsSameSize(aii->second.size, info.st_size) && fpath == aii->second.path) {
 				// cache found update checksum if wanted
+				aii->second.size = info.st_size;
 				aii->second.updated = true;
 				if (doChecksum && (aii->second.checksum == 0)) {
 					aii->second.checksum = GetCRC(fullName);
@@ -591,6 +618,7 @@ void CArchiveScanner::ScanArchive(const std::string& fullName, bool doChecksum)
 		BrokenArchive& ba = brokenArchives[lcfn];
 		ba.path = fpath;
 		ba.modified = info.st_mtime;
+		ba.size = info.st_size;
 		ba.updated = true;
 		ba.problem = "Unable to open archive";
 		return;
@@ -626,6 +654,7 @@ void CArchiveScanner::ScanArchive(const std::string& fullName, bool doChecksum)
 		BrokenArchive& ba = brokenArchives[lcfn];
 		ba.path = fpath;
 		ba.modified = info.st_mtime;
+		ba.size = info.st_size;
 		ba.updated = true;
 		ba.problem = error;
 		return;
@@ -660,6 +689,7 @@ void CArchiveScanner::ScanArchive(const std::string& fullName, bool doChecksum)
 
 	ai.path = fpath;
 	ai.modified = info.st_mtime;
+	ai.size = info.st_size;
 	ai.origName = fn;
 	ai.updated = true;
 	ai.checksum = (doChecksum) ? GetCRC(fullName) : 0;
@@ -763,9 +793,9 @@ unsigned int CArchiveScanner::GetCRC(const std::string& arcName)
 	// Compute CRCs of the files
 	// Hint: Multithreading only speedups `.sdd` loading. For those the CRC generation is extremely slow -
 	//       it has to load the full file to calc it! For the other formats (sd7, sdz, sdp) the CRC is saved
-	//       in the metainformation of the container and so the loading is much faster. Neither does any of our
-	//       current (2011) packing libraries support multithreading :/
-	for_mt(0, crcs.size(), [&](const int i) {
+	//       in the metainformation of the container and their reads are serialized by
+	//       CBufferedArchive::archiveLock anyway, so those are not worth the task overhead.
+	const auto CalcFileCRC = [&](const int i) {
 		CRCPair& crcp = crcs[i];
 		const unsigned int nameCRC = CRC::GetCRC(crcp.filename->data(), crcp.filename->size());
 		const unsigned fid = ar->FindFile(*crcp.filename);
@@ -775,15 +805,20 @@ unsigned int CArchiveScanner::GetCRC(const std::string& arcName)
 	#if !defined(DEDICATED) && !defined(UNITSYNC)
 		Watchdog::ClearTimer(WDT_MAIN);
 	#endif
-	});
+	};
+
+	if (dynamic_cast<CBufferedArchive*>(ar.get()) == NULL) {
+		for_mt(0, crcs.size(), CalcFileCRC);
+	} else {
+		for (size_t i = 0; i < crcs.size(); ++i) {
+			CalcFileCRC(i);
+		}
+	}
 
 	// Add file CRCs to the main archive CRC
 	for (CRCPair& crcp: crcs) {
 		crc.Update(crcp.nameCRC);
 		crc.Update(crcp.dataCRC);
-	#if !defined(DEDICATED) && !defined(UNITSYNC)
-		Watchdog::ClearTimer();
-	#endif
 	}
 
 	// A value of 0 is used to indicate no crc.. so never return that
@@ -793,8 +828,72 @@ unsigned int CArchiveScanner::GetCRC(const std::string& arcName)
 	return digest;
 }
 
-void CArchiveScanner::ReadCacheData(const std::string& filename)
+void CArchiveScanner::UpdateChecksums()
+{
+	std::vector<ArchiveInfo*> pending;
+
+	for (auto& aii: archiveInfos) {
+		ArchiveInfo& ai = aii.second;
+
+		if (ai.updated && ai.checksum == 0 && ai.replaced.empty() && !ai.path.empty())
+			pending.push_back(&ai);
+	}
+
+	if (pending.empty())
+		return;
+
+	LOG("Calculating checksums of " _STPF_ " archives", pending.size());
+
+	// archives are independent of each other; a failing one must not take
+	// down a worker, its exception is passed on once all others are done
+	boost::mutex errorMutex;
+	std::exception_ptr error;
+
+	const auto CalcChecksum = [&](const int i) {
+		ArchiveInfo& ai = *pending[i];
+
+		try {
+			ai.checksum = GetCRC(ai.path + ai.origName);
+		} catch (...) {
+			boost::mutex::scoped_lock lck(errorMutex);
+
+			if (!error)
+				error = std::current_exception();
+		}
+	};
+
+#ifdef UNITSYNC
+	// unitsync is built without the thread-pool (for_mt is serial there)
+	std::atomic<size_t> next(0);
+
+	const auto CalcChecksums = [&]() {
+		for (size_t i = next++; i < pending.size(); i = next++) {
+			CalcChecksum(i);
+		}
+	};
+
+	const size_t numThreads = std::min(size_t(std::max(boost::thread::hardware_concurrency(), 1u)), pending.size());
+	boost::thread_group workers;
+
+	for (size_t n = 1; n < numThreads; ++n) {
+		workers.create_thread(CalcChecksums);
+	}
+
+	CalcChecksums();
+	workers.join_all();
+#else
+	for_mt(0, pending.size(), CalcChecksum);
+#endif
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+
+void CArchiveScanner::ReadLuaCacheData(const std::string& filename)
 {
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
+
 	if (!FileSystem::FileExists(filename)) {
 		LOG_L(L_INFO, "Archive cache doesn't exist: %s", filename.c_str());
 		return;
@@ -854,16 +953,176 @@ void CArchiveScanner::ReadCacheData(const std::string& filename)
 	isDirty = false;
 }
 
-static inline void SafeStr(FILE* out, const char* prefix, const std::string& str)
+/*
+ * binary cache layout (native byte order, it never leaves this machine)
+ *
+ *   char[8] magic, uint32 format version, uint32 INTERNAL_VER
+ *   uint32 numArchives, ArchiveInfo[numArchives]
+ *   uint32 numBrokenArchives, BrokenArchive[numBrokenArchives]
+ *
+ * strings are stored as uint32 length + chars, lists as uint32 count + items
+ */
+static const char CACHE_MAGIC[8] = {'S', 'P', 'R', 'I', 'N', 'G', 'A', 'C'};
+static const boost::uint32_t CACHE_FORMAT_VER = 1;
+
+namespace {
+	class CacheWriter {
+	public:
+		template<typename T> void Write(T value) {
+			const boost::uint8_t* p = reinterpret_cast<const boost::uint8_t*>(&value);
+			data.insert(data.end(), p, p + sizeof(T));
+		}
+		void Write(const std::string& str) {
+			Write<boost::uint32_t>(str.size());
+			data.insert(data.end(), str.begin(), str.end());
+		}
+		void Write(const std::vector<std::string>& strs) {
+			Write<boost::uint32_t>(strs.size());
+			for (const std::string& str: strs) {
+				Write(str);
+			}
+		}
+
+		std::vector<boost::uint8_t> data;
+	};
+
+	class CacheReader {
+	public:
+		CacheReader(const std::vector<boost::uint8_t>& data)
+			: pos(data.empty()? NULL: &data[0])
+			, end(pos + data.size())
+			, valid(true)
+		{}
+
+		template<typename T> T Read() {
+			T value = T();
+			if ((valid = valid && (size_t(end - pos) >= sizeof(T)))) {
+				memcpy(&value, pos, sizeof(T));
+				pos += sizeof(T);
+			}
+			return value;
+		}
+		std::string ReadString() {
+			const boost::uint32_t size = Read<boost::uint32_t>();
+			if (!(valid = valid && (size_t(end - pos) >= size)))
+				return "";
+			pos += size;
+			return std::string(reinterpret_cast<const char*>(pos - size), size);
+		}
+		std::vector<std::string> ReadStrings() {
+			std::vector<std::string> strs(std::min<size_t>(Read<boost::uint32_t>(), end - pos));
+			for (std::string& str: strs) {
+				str = ReadString();
+			}
+			return strs;
+		}
+
+		bool IsValid() const { return valid; }
+		bool AtEnd() const { return (pos == end); }
+
+	private:
+		const boost::uint8_t* pos;
+		const boost::uint8_t* end;
+		bool valid;
+	};
+}
+
+bool CArchiveScanner::ReadCacheData(const std::string& filename)
 {
-	if (str.empty()) {
-		return;
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
+	std::vector<boost::uint8_t> data;
+
+	// one read, no parsing beyond the fixed layout above
+	FILE* in = fopen(filename.c_str(), "rb");
+	if (in == NULL) {
+		LOG_L(L_INFO, "Archive cache doesn't exist: %s", filename.c_str());
+		return false;
 	}
-	if ( (str.find_first_of("\\\"") != std::string::npos) || (str.find_first_of("\n") != std::string::npos )) {
-		fprintf(out, "%s[[%s]],\n", prefix, str.c_str());
-	} else {
-		fprintf(out, "%s\"%s\",\n", prefix, str.c_str());
+	if (fseek(in, 0, SEEK_END) == 0) {
+		const long size = ftell(in);
+		if (size > 0 && fseek(in, 0, SEEK_SET) == 0) {
+			data.resize(size);
+			data.resize(fread(&data[0], 1, size, in));
+		}
+	}
+	fclose(in);
+
+	CacheReader reader(data);
+	char magic[sizeof(CACHE_MAGIC)];
+
+	for (char& c: magic) {
+		c = reader.Read<char>();
+	}
+	if (!reader.IsValid() || memcmp(magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) {
+		LOG_L(L_ERROR, "Archive cache is not valid: %s", filename.c_str());
+		return false;
 	}
+
+	// Do not load old version caches
+	if (reader.Read<boost::uint32_t>() != CACHE_FORMAT_VER || reader.Read<boost::uint32_t>() != INTERNAL_VER)
+		return false;
+
+	std::map<std::string, ArchiveInfo> cachedInfos;
+	std::map<std::string, BrokenArchive> cachedBrokenArchives;
+
+	for (boost::uint32_t i = 0, n = reader.Read<boost::uint32_t>(); i < n && reader.IsValid(); ++i) {
+		const std::string name = reader.ReadString();
+
+		ArchiveInfo& ai = cachedInfos[StringToLower(name)];
+		ai.origName = name;
+		ai.path     = reader.ReadString();
+		ai.modified = reader.Read<boost::uint32_t>();
+		ai.size     = reader.Read<boost::uint64_t>();
+		ai.checksum = reader.Read<boost::uint32_t>();
+		ai.updated  = false;
+
+		ArchiveData& ad = ai.archiveData;
+
+		for (boost::uint32_t j = 0, m = reader.Read<boost::uint32_t>(); j < m && reader.IsValid(); ++j) {
+			const std::string key = reader.ReadString();
+
+			switch (reader.Read<boost::uint8_t>()) {
+				case INFO_VALUE_TYPE_STRING:  { ad.SetInfoItemValueString(key, reader.ReadString()); } break;
+				case INFO_VALUE_TYPE_INTEGER: { ad.SetInfoItemValueInteger(key, reader.Read<boost::int32_t>()); } break;
+				case INFO_VALUE_TYPE_FLOAT:   { ad.SetInfoItemValueFloat(key, reader.Read<float>()); } break;
+				case INFO_VALUE_TYPE_BOOL:    { ad.SetInfoItemValueBool(key, reader.Read<boost::uint8_t>() != 0); } break;
+				default: {
+					LOG_L(L_ERROR, "Archive cache is not valid: %s", filename.c_str());
+					return false;
+				}
+			}
+		}
+
+		ad.GetDependencies() = reader.ReadStrings();
+		ad.GetReplaces() = reader.ReadStrings();
+
+		if (ad.GetModType() == modtype::map) {
+			AddDependency(ad.GetDependencies(), "Map Helper v1");
+		} else if (ad.GetModType() == modtype::primary) {
+			AddDependency(ad.GetDependencies(), "Spring content v1");
+		}
+	}
+
+	for (boost::uint32_t i = 0, n = reader.Read<boost::uint32_t>(); i < n && reader.IsValid(); ++i) {
+		BrokenArchive& ba = cachedBrokenArchives[StringToLower(reader.ReadString())];
+		ba.path     = reader.ReadString();
+		ba.modified = reader.Read<boost::uint32_t>();
+		ba.size     = reader.Read<boost::uint64_t>();
+		ba.problem  = reader.ReadString();
+		ba.updated  = false;
+	}
+
+	// a truncated cache (e.g. after a crash while writing it) is dropped as a whole
+	if (!reader.IsValid() || !reader.AtEnd()) {
+		LOG_L(L_ERROR, "Archive cache is not valid: %s", filename.c_str());
+		return false;
+	}
+
+	archiveInfos.swap(cachedInfos);
+	brokenArchives.swap(cachedBrokenArchives);
+
+	isDirty = false;
+	return true;
 }
 
 void FilterDep(std::vector<std::string>& deps, const std::string& exclude)
@@ -874,13 +1133,9 @@ void FilterDep(std::vector<std::string>& deps, const std::string& exclude)
 
 void CArchiveScanner::WriteCacheData(const std::string& filename)
 {
-	if (!isDirty) {
-		return;
-	}
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
 
-	FILE* out = fopen(filename.c_str(), "wt");
-	if (!out) {
-		LOG_L(L_ERROR, "Failed to write to \"%s\"!", filename.c_str());
+	if (!isDirty) {
 		return;
 	}
 
@@ -901,88 +1156,100 @@ void CArchiveScanner::WriteCacheData(const std::string& filename)
 		}
 	}
 
-	fprintf(out, "local archiveCache = {\n\n");
-	fprintf(out, "\tinternalver = %i,\n\n", INTERNAL_VER);
-	fprintf(out, "\tarchives = {  -- count = " _STPF_ "\n", archiveInfos.size());
+	CacheWriter writer;
 
-	std::map<std::string, ArchiveInfo>::const_iterator arcIt;
-	for (arcIt = archiveInfos.begin(); arcIt != archiveInfos.end(); ++arcIt) {
-		const ArchiveInfo& arcInfo = arcIt->second;
+	for (char c: CACHE_MAGIC) {
+		writer.Write(c);
+	}
+	writer.Write<boost::uint32_t>(CACHE_FORMAT_VER);
+	writer.Write<boost::uint32_t>(INTERNAL_VER);
+
+	// replaced archives are not written, they are recreated from the replaces of the others
+	unsigned int numArchives = 0;
+	for (const auto& aii: archiveInfos) {
+		numArchives += aii.second.replaced.empty();
+	}
+	writer.Write<boost::uint32_t>(numArchives);
 
-		fprintf(out, "\t\t{\n");
-		SafeStr(out, "\t\t\tname = ",              arcInfo.origName);
-		SafeStr(out, "\t\t\tpath = ",              arcInfo.path);
-		fprintf(out, "\t\t\tmodified = \"%u\",\n", arcInfo.modified);
-		fprintf(out, "\t\t\tchecksum = \"%u\",\n", arcInfo.checksum);
-		SafeStr(out, "\t\t\treplaced = ",          arcInfo.replaced);
+	for (const auto& aii: archiveInfos) {
+		const ArchiveInfo& arcInfo = aii.second;
+
+		if (!arcInfo.replaced.empty())
+			continue;
+
+		writer.Write(arcInfo.origName);
+		writer.Write(arcInfo.path);
+		writer.Write<boost::uint32_t>(arcInfo.modified);
+		writer.Write<boost::uint64_t>(arcInfo.size);
+		writer.Write<boost::uint32_t>(arcInfo.checksum);
 
-		// mod info?
 		const ArchiveData& archData = arcInfo.archiveData;
-		if (!archData.GetName().empty()) {
-			fprintf(out, "\t\t\tarchivedata = {\n");
-
-			const std::map<std::string, InfoItem>& info = archData.GetInfo();
-			std::map<std::string, InfoItem>::const_iterator ii;
-			for (ii = info.begin(); ii != info.end(); ++ii) {
-				switch (ii->second.valueType) {
-					case INFO_VALUE_TYPE_STRING: {
-						SafeStr(out, std::string("\t\t\t\t" + ii->first + " = ").c_str(), ii->second.valueTypeString);
-					} break;
-					case INFO_VALUE_TYPE_INTEGER: {
-						fprintf(out, "\t\t\t\t%s = %d,\n", ii->first.c_str(), ii->second.value.typeInteger);
-					} break;
-					case INFO_VALUE_TYPE_FLOAT: {
-						fprintf(out, "\t\t\t\t%s = %f,\n", ii->first.c_str(), ii->second.value.typeFloat);
-					} break;
-					case INFO_VALUE_TYPE_BOOL: {
-						fprintf(out, "\t\t\t\t%s = %d,\n", ii->first.c_str(), (int)ii->second.value.typeBool);
-					} break;
-				}
-			}
+		const std::map<std::string, InfoItem>& info = archData.GetInfo();
 
-			std::vector<std::string> deps = archData.GetDependencies();
-			if (archData.GetModType() == modtype::map) {
-				FilterDep(deps, "Map Helper v1");
-			} else if (archData.GetModType() == modtype::primary) {
-				FilterDep(deps, "Spring content v1");
-			}
+		writer.Write<boost::uint32_t>(info.size());
 
-			if (!deps.empty()) {
-				fprintf(out, "\t\t\t\tdepend = {\n");
-				for (unsigned d = 0; d < deps.size(); d++) {
-					SafeStr(out, "\t\t\t\t\t", deps[d]);
-				}
-				fprintf(out, "\t\t\t\t},\n");
+		for (const auto& ii: info) {
+			writer.Write(ii.second.key);
+			writer.Write<boost::uint8_t>(ii.second.valueType);
+
+			switch (ii.second.valueType) {
+				case INFO_VALUE_TYPE_STRING:  { writer.Write(ii.second.valueTypeString); } break;
+				case INFO_VALUE_TYPE_INTEGER: { writer.Write<boost::int32_t>(ii.second.value.typeInteger); } break;
+				case INFO_VALUE_TYPE_FLOAT:   { writer.Write<float>(ii.second.value.typeFloat); } break;
+				case INFO_VALUE_TYPE_BOOL:    { writer.Write<boost::uint8_t>(ii.second.value.typeBool); } break;
 			}
-			fprintf(out, "\t\t\t},\n");
 		}
 
-		fprintf(out, "\t\t},\n");
+		std::vector<std::string> deps = archData.GetDependencies();
+		if (archData.GetModType() == modtype::map) {
+			FilterDep(deps, "Map Helper v1");
+		} else if (archData.GetModType() == modtype::primary) {
+			FilterDep(deps, "Spring content v1");
+		}
+
+		writer.Write(deps);
+		writer.Write(archData.GetReplaces());
 	}
 
-	fprintf(out, "\t},\n\n"); // close 'archives'
+	writer.Write<boost::uint32_t>(brokenArchives.size());
 
-	fprintf(out, "\tbrokenArchives = {  -- count = " _STPF_ "\n", brokenArchives.size());
+	for (const auto& bai: brokenArchives) {
+		const BrokenArchive& ba = bai.second;
 
-	std::map<std::string, BrokenArchive>::const_iterator bai;
-	for (bai = brokenArchives.begin(); bai != brokenArchives.end(); ++bai) {
-		const BrokenArchive& ba = bai->second;
+		writer.Write(bai.first);
+		writer.Write(ba.path);
+		writer.Write<boost::uint32_t>(ba.modified);
+		writer.Write<boost::uint64_t>(ba.size);
+		writer.Write(ba.problem);
+	}
+
+	// write to a temporary first, an interrupted write must not leave a partial cache behind
+	const std::string tmpFilename = filename + ".tmp";
 
-		fprintf(out, "\t\t{\n");
-		SafeStr(out, "\t\t\tname = ", bai->first);
-		SafeStr(out, "\t\t\tpath = ", ba.path);
-		fprintf(out, "\t\t\tmodified = \"%u\",\n", ba.modified);
-		SafeStr(out, "\t\t\tproblem = ", ba.problem);
-		fprintf(out, "\t\t},\n");
+	FILE* out = fopen(tmpFilename.c_str(), "wb");
+	if (!out) {
+		LOG_L(L_ERROR, "Failed to write to \"%s\"!", tmpFilename.c_str());
+		return;
 	}
 
-	fprintf(out, "\t},\n"); // close 'brokenArchives'
+	const bool written = (fwrite(&writer.data[0], writer.data.size(), 1, out) == 1);
 
-	fprintf(out, "}\n\n"); // close 'archiveCache'
-	fprintf(out, "return archiveCache\n");
+	if ((fclose(out) == EOF) || !written) {
+		LOG_L(L_ERROR, "Failed to write to \"%s\"!", tmpFilename.c_str());
+		remove(tmpFilename.c_str());
+		return;
+	}
+
+#ifdef _WIN32
+	// rename does not replace existing files there
+	remove(filename.c_str());
+#endif
 
-	if (fclose(out) == EOF)
+	if (rename(tmpFilename.c_str(), filename.c_str()) != 0) {
 		LOG_L(L_ERROR, "Failed to write to \"%s\"!", filename.c_str());
+		remove(tmpFilename.c_str());
+		return;
+	}
 
 	isDirty = false;
 }
@@ -999,6 +1266,7 @@ static void sortByName(std::vector<CArchiveScanner::ArchiveData>& data)
 
 std::vector<CArchiveScanner::ArchiveData> CArchiveScanner::GetPrimaryMods() const
 {
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
 	std::vector<ArchiveData> ret;
 
 	for (std::map<std::string, ArchiveInfo>::const_iterator i = archiveInfos.begin(); i != archiveInfos.end(); ++i) {
@@ -1018,6 +1286,7 @@ std::vector<CArchiveScanner::ArchiveData> CArchiveScanner::GetPrimaryMods() cons
 
 std::vector<CArchiveScanner::ArchiveData> CArchiveScanner::GetAllMods() const
 {
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
 	std::vector<ArchiveData> ret;
 
 	for (std::map<std::string, ArchiveInfo>::const_iterator i = archiveInfos.begin(); i != archiveInfos.end(); ++i) {
@@ -1037,6 +1306,7 @@ std::vector<CArchiveScanner::ArchiveData> CArchiveScanner::GetAllMods() const
 
 std::vector<CArchiveScanner::ArchiveData> CArchiveScanner::GetAllArchives() const
 {
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
 	std::vector<ArchiveData> ret;
 
 	for (const auto& pair: archiveInfos) {
@@ -1054,6 +1324,8 @@ std::vector<CArchiveScanner::ArchiveData> CArchiveScanner::GetAllArchives() cons
 
 std::vector<std::string> CArchiveScanner::GetAllArchivesUsedBy(const std::string& root, int depth) const
 {
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
+
 	LOG_S(LOG_SECTION_ARCHIVESCANNER, "GetArchives: %s (depth %u)", root.c_str(), depth);
 	// Protect against circular dependencies
 	// (worst case depth is if all archives form one huge dependency chain)
@@ -1104,6 +1376,7 @@ std::vector<std::string> CArchiveScanner::GetAllArchivesUsedBy(const std::string
 
 std::vector<std::string> CArchiveScanner::GetMaps() const
 {
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
 	std::vector<std::string> ret;
 
 	for (std::map<std::string, ArchiveInfo>::const_iterator aii = archiveInfos.begin(); aii != archiveInfos.end(); ++aii) {
@@ -1117,11 +1390,12 @@ std::vector<std::string> CArchiveScanner::GetMaps() const
 
 std::string CArchiveScanner::MapNameToMapFile(const std::string& s) const
 {
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
+
 	// Convert map name to map archive
-	for (std::map<std::string, ArchiveInfo>::const_iterator aii = archiveInfos.begin(); aii != archiveInfos.end(); ++aii) {
-		if (s == aii->second.archiveData.GetNameVersioned()) {
-			return aii->second.archiveData.GetMapFile();
-		}
+	const ArchiveInfo* ai = FindArchiveInfoByName(s);
+	if (ai != NULL) {
+		return ai->archiveData.GetMapFile();
 	}
 	LOG_SL(LOG_SECTION_ARCHIVESCANNER, L_WARNING, "map file of %s not found", s.c_str());
 	return s;
@@ -1129,6 +1403,7 @@ std::string CArchiveScanner::MapNameToMapFile(const std::string& s) const
 
 unsigned int CArchiveScanner::GetSingleArchiveChecksum(const std::string& name) const
 {
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
 	std::string lcname = FileSystem::GetFilename(name);
 	StringToLowerInPlace(lcname);
 
@@ -1144,6 +1419,7 @@ unsigned int CArchiveScanner::GetSingleArchiveChecksum(const std::string& name)
 
 unsigned int CArchiveScanner::GetArchiveCompleteChecksum(const std::string& name) const
 {
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
 	const std::vector<std::string>& ars = GetAllArchivesUsedBy(name);
 	unsigned int checksum = 0;
 
@@ -1174,6 +1450,7 @@ void CArchiveScanner::CheckArchive(const std::string& name, unsigned checksum) c
 
 std::string CArchiveScanner::GetArchivePath(const std::string& name) const
 {
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
 	const std::string lcname = StringToLower(FileSystem::GetFilename(name));
 	std::map<std::string, ArchiveInfo>::const_iterator aii = archiveInfos.find(lcname);
 	if (aii == archiveInfos.end()) {
@@ -1184,10 +1461,11 @@ std::string CArchiveScanner::GetArchivePath(const std::string& name) const
 
 std::string CArchiveScanner::ArchiveFromName(const std::string& name) const
 {
-	for (std::map<std::string, ArchiveInfo>::const_iterator it = archiveInfos.begin(); it != archiveInfos.end(); ++it) {
-		if (it->second.archiveData.GetNameVersioned() == name) {
-			return it->second.origName;
-		}
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
+
+	const ArchiveInfo* ai = FindArchiveInfoByName(name);
+	if (ai != NULL) {
+		return ai->origName;
 	}
 
 	return name;
@@ -1195,6 +1473,7 @@ std::string CArchiveScanner::ArchiveFromName(const std::string& name) const
 
 std::string CArchiveScanner::NameFromArchive(const std::string& archiveName) const
 {
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
 	const std::string lcArchiveName = StringToLower(archiveName);
 	std::map<std::string, ArchiveInfo>::const_iterator aii = archiveInfos.find(lcArchiveName);
 	if (aii != archiveInfos.end()) {
@@ -1205,20 +1484,37 @@ std::string CArchiveScanner::NameFromArchive(const std::string& archiveName) con
 
 CArchiveScanner::ArchiveData CArchiveScanner::GetArchiveData(const std::string& name) const
 {
-	for (std::map<std::string, ArchiveInfo>::const_iterator it = archiveInfos.begin(); it != archiveInfos.end(); ++it) {
-		const ArchiveData& md = it->second.archiveData;
-		if (md.GetNameVersioned() == name) {
-			return md;
-		}
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
+
+	const ArchiveInfo* ai = FindArchiveInfoByName(name);
+	if (ai != NULL) {
+		return ai->archiveData;
 	}
 	return ArchiveData();
 }
 
 CArchiveScanner::ArchiveData CArchiveScanner::GetArchiveDataByArchive(const std::string& archive) const
 {
+	boost::recursive_mutex::scoped_lock lck(scannerMutex);
 	return GetArchiveData(NameFromArchive(archive));
 }
 
+const CArchiveScanner::ArchiveInfo* CArchiveScanner::FindArchiveInfoByName(const std::string& name) const
+{
+	if (nameIndex.empty()) {
+		// keep the first archive of a name, as the linear search did
+		for (const auto& aii: archiveInfos) {
+			nameIndex.insert(std::make_pair(aii.second.archiveData.GetNameVersioned(), aii.first));
+		}
+	}
+
+	const std::map<std::string, std::string>::const_iterator it = nameIndex.find(name);
+	if (it == nameIndex.end())
+		return NULL;
+
+	return &(archiveInfos.find(it->second)->second);
+}
+
 unsigned char CArchiveScanner::GetMetaFileClass(const std::string& filePath)
 {
 
@@ -7,6 +7,8 @@
 #include <vector>
 #include <list>
 #include <map>
+#include <boost/cstdint.hpp>
+#include <boost/thread/recursive_mutex.hpp>
 #include "System/Info.h"
 
 class IArchive;
@@ -132,6 +134,7 @@ private:
 	{
 		ArchiveInfo()
 			: modified(0)
+			, size(0)
 			, checksum(0)
 			, updated(false)
 			{}
@@ -140,6 +143,7 @@ private:
 		std::string replaced;     ///< If not empty, use that archive instead
 		ArchiveData archiveData;
 		unsigned int modified;
+		boost::uint64_t size;     ///< 0 if unknown (read from an old cache)
 		unsigned int checksum;
 		bool updated;
 	};
@@ -147,10 +151,12 @@ private:
 	{
 		BrokenArchive()
 			: modified(0)
+			, size(0)
 			, updated(false)
 			{}
 		std::string path;
 		unsigned int modified;
+		boost::uint64_t size;
 		bool updated;
 		std::string problem;
 	};
@@ -169,9 +175,15 @@ private:
 	std::string SearchMapFile(const IArchive* ar, std::string& error);
 
 
-	void ReadCacheData(const std::string& filename);
+	/// @return false if there is no valid binary cache at filename
+	bool ReadCacheData(const std::string& filename);
+	/// reads the lua table cache written by older versions
+	void ReadLuaCacheData(const std::string& filename);
 	void WriteCacheData(const std::string& filename);
 
+	/// calculate the missing checksums of all found archives, in parallel
+	void UpdateChecksums();
+
 	IFileFilter* CreateIgnoreFilter(IArchive* ar);
 
 	/**
@@ -201,10 +213,19 @@ private:
 	static unsigned char GetMetaFileClass(const std::string& filePath);
 	static bool CheckCompression(const IArchive* ar,const std::string& fullName, std::string& error);
 
+	/// @return the archiveInfos entry with the given versioned name, or NULL
+	const ArchiveInfo* FindArchiveInfoByName(const std::string& name) const;
+
 private:
 	std::map<std::string, ArchiveInfo> archiveInfos;
 	std::map<std::string, BrokenArchive> brokenArchives;
 
+	/// versioned name -> key in archiveInfos, rebuilt on demand once cleared
+	mutable std::map<std::string, std::string> nameIndex;
+
+	/// the public methods lock this, so they can be called from any thread
+	mutable boost::recursive_mutex scannerMutex;
+
 	bool isDirty;
 	std::string cachefile;
 };
@@ -4,10 +4,12 @@
 #include "BufferedArchive.h"
 
 
-CBufferedArchive::CBufferedArchive(const std::string& name, bool cache)
+CBufferedArchive::CBufferedArchive(const std::string& name, bool cache, size_t cacheSize)
 	: IArchive(name)
+	, caching(cache)
+	, cachedBytes(0)
+	, maxCachedBytes(cacheSize)
 {
-	caching = cache;
 }
 
 CBufferedArchive::~CBufferedArchive()
@@ -16,22 +18,107 @@ CBufferedArchive::~CBufferedArchive()
 
 bool CBufferedArchive::GetFile(unsigned int fid, std::vector<boost::uint8_t>& buffer)
 {
-	boost::mutex::scoped_lock lck(archiveLock);
+	const FileViewPtr view = GetFileView(fid);
+
+	if (!view)
+		return false;
+
+	view->CopyTo(buffer);
+	return true;
+}
+
+FileViewPtr CBufferedArchive::GetFileView(unsigned int fid)
+{
 	assert(IsFileId(fid));
 
-	if (!caching) {
-		return GetFileImpl(fid,buffer);
+	FileViewPtr view = GetCachedView(fid);
+
+	if (view)
+		return view;
+
+	std::vector<boost::uint8_t> buffer;
+	bool exists = false;
+
+	if (IsThreadSafe()) {
+		exists = GetFileImpl(fid, buffer);
+	} else {
+		boost::mutex::scoped_lock lck(archiveLock);
+		exists = GetFileImpl(fid, buffer);
 	}
 
-	if (fid >= cache.size()) {
-		cache.resize(fid + 1);
+	if (!exists)
+		return view;
+
+	view.reset(new CFileView(buffer));
+	CacheView(fid, view);
+	return view;
+}
+
+
+void CBufferedArchive::PrefetchFile(unsigned int fid)
+{
+	assert(IsFileId(fid));
+
+	if (!caching || GetCachedView(fid))
+		return;
+
+	std::vector<boost::uint8_t> buffer;
+
+	if (IsThreadSafe()) {
+		if (!GetFileImpl(fid, buffer))
+			return;
+	} else {
+		boost::mutex::scoped_try_lock lck(archiveLock);
+
+		if (!lck.owns_lock() || !GetFileImpl(fid, buffer))
+			return;
 	}
-	
-	if (!cache[fid].populated) {
-		cache[fid].exists = GetFileImpl(fid, cache[fid].data);
-		cache[fid].populated = true;
+
+	CacheView(fid, FileViewPtr(new CFileView(buffer)));
+}
+
+
+FileViewPtr CBufferedArchive::GetCachedView(unsigned int fid)
+{
+	if (!caching)
+		return FileViewPtr();
+
+	boost::mutex::scoped_lock lck(cacheLock);
+
+	const std::map<unsigned int, CachedView>::iterator it = cachedViews.find(fid);
+
+	if (it == cachedViews.end())
+		return FileViewPtr();
+
+	lruFiles.splice(lruFiles.begin(), lruFiles, it->second.lruPos);
+	return it->second.view;
+}
+
+void CBufferedArchive::CacheView(unsigned int fid, const FileViewPtr& view)
+{
+	if (!caching || view->GetSize() > maxCachedBytes)
+		return;
+
+	boost::mutex::scoped_lock lck(cacheLock);
+
+	// another thread read it at the same time
+	if (cachedViews.find(fid) != cachedViews.end())
+		return;
+
+	// views still referenced elsewhere stay valid, they are just no longer found here
+	while (!lruFiles.empty() && (cachedBytes + view->GetSize()) > maxCachedBytes) {
+		const std::map<unsigned int, CachedView>::iterator it = cachedViews.find(lruFiles.back());
+
+		cachedBytes -= it->second.view->GetSize();
+		cachedViews.erase(it);
+		lruFiles.pop_back();
 	}
 
-	buffer = cache[fid].data;
-	return cache[fid].exists;
+	lruFiles.push_front(fid);
+
+	CachedView& cached = cachedViews[fid];
+	cached.view = view;
+	cached.lruPos = lruFiles.begin();
+
+	cachedBytes += view->GetSize();
 }
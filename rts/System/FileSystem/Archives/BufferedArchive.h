@@ -3,37 +3,59 @@
 #ifndef _BUFFERED_ARCHIVE_H
 #define _BUFFERED_ARCHIVE_H
 
+#include <list>
 #include <map>
 #include <boost/thread/mutex.hpp>
 
 #include "IArchive.h"
 
 /**
- * Provides a helper implementation for archive types that can only uncompress
- * one file to memory at a time.
+ * Provides a helper implementation for archive types that have to uncompress
+ * files to memory, keeping the most recently read ones around.
  */
 class CBufferedArchive : public IArchive
 {
 public:
-	CBufferedArchive(const std::string& name, bool cache = true);
+	/**
+	 * @param cache keep the contents of recently read files
+	 * @param cacheSize byte budget of the kept contents, files larger than
+	 *   it are never kept
+	 */
+	CBufferedArchive(const std::string& name, bool cache = true, size_t cacheSize = 64 * 1024 * 1024);
 	virtual ~CBufferedArchive();
 
 	virtual bool GetFile(unsigned int fid, std::vector<boost::uint8_t>& buffer);
+	virtual FileViewPtr GetFileView(unsigned int fid);
+	/// reads the file into the cache, unless that means waiting for another reader
+	virtual void PrefetchFile(unsigned int fid);
 
 protected:
 	virtual bool GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer) = 0;
+	/// whether GetFileImpl may run on several threads at once (no shared decompressor state)
+	virtual bool IsThreadSafe() const { return false; }
 
 	boost::mutex archiveLock; // neither 7zip nor zlib are threadsafe
-	struct FileBuffer
-	{
-		FileBuffer() : populated(false), exists(false) {};
-		bool populated; // cause a file may be 0 bytes big
-		bool exists;
-		std::vector<boost::uint8_t> data;
-	};
-	std::vector<FileBuffer> cache; // cache[fileId]
+
+private:
+	FileViewPtr GetCachedView(unsigned int fid);
+	void CacheView(unsigned int fid, const FileViewPtr& view);
+
 private:
 	bool caching;
+
+	/// guards the members below only, never held while reading a file
+	boost::mutex cacheLock;
+
+	struct CachedView {
+		FileViewPtr view;
+		std::list<unsigned int>::iterator lruPos;
+	};
+	std::map<unsigned int, CachedView> cachedViews;
+	/// file ids, most recently used first
+	std::list<unsigned int> lruFiles;
+
+	size_t cachedBytes;
+	size_t maxCachedBytes;
 };
 
 #endif // _BUFFERED_ARCHIVE_H
@@ -43,9 +43,9 @@ bool IArchive::HasLowReadingCost(unsigned int fid) const
 unsigned int IArchive::GetCrc32(unsigned int fid)
 {
 	CRC crc;
-	std::vector<boost::uint8_t> buffer;
-	if (GetFile(fid, buffer) && !buffer.empty()) {
-		crc.Update(&buffer[0], buffer.size());
+	const FileViewPtr view = GetFileView(fid);
+	if (view && !view->IsEmpty()) {
+		crc.Update(view->GetData(), view->GetSize());
 	}
 
 	return crc.GetDigest();
@@ -63,3 +63,23 @@ bool IArchive::GetFile(const std::string& name, std::vector<boost::uint8_t>& buf
 
 	return found;
 }
+
+FileViewPtr IArchive::GetFileView(unsigned int fid)
+{
+	std::vector<boost::uint8_t> buffer;
+
+	if (!GetFile(fid, buffer))
+		return FileViewPtr();
+
+	return FileViewPtr(new CFileView(buffer));
+}
+
+FileViewPtr IArchive::GetFileView(const std::string& name)
+{
+	const unsigned int fid = FindFile(name);
+
+	if (fid >= NumFiles())
+		return FileViewPtr();
+
+	return GetFileView(fid);
+}
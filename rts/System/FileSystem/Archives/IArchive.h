@@ -7,6 +7,51 @@
 #include <vector>
 #include <map>
 #include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+/**
+ * @brief read-only contents of one archived file
+ *
+ * Shared by everyone reading the file (also across threads) and valid for as
+ * long as a reference is held, independent of the archive it came from.
+ */
+class CFileView
+{
+public:
+	/// takes over the contents of buffer
+	explicit CFileView(std::vector<boost::uint8_t>& buffer)
+		: data(NULL)
+		, size(0)
+	{
+		contents.swap(buffer);
+		data = contents.empty()? NULL: &contents[0];
+		size = contents.size();
+	}
+	/// for memory owned by something else (e.g. a mapped file), owner is kept alive with the view
+	CFileView(const boost::shared_ptr<const void>& owner, const void* data, size_t size)
+		: owner(owner)
+		, data(static_cast<const boost::uint8_t*>(data))
+		, size(size)
+	{}
+
+	const boost::uint8_t* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+	bool IsEmpty() const { return (size == 0); }
+
+	void CopyTo(std::vector<boost::uint8_t>& buffer) const { buffer.assign(data, data + size); }
+
+private:
+	CFileView(const CFileView&);
+	CFileView& operator=(const CFileView&);
+
+	std::vector<boost::uint8_t> contents;
+	boost::shared_ptr<const void> owner;
+
+	const boost::uint8_t* data;
+	size_t size;
+};
+
+typedef boost::shared_ptr<const CFileView> FileViewPtr;
 
 /**
  * @brief Abstraction of different archive types
@@ -72,6 +117,25 @@ public:
 	 * @see GetFile(unsigned int fid, std::vector<boost::uint8_t>& buffer)
 	 */
 	bool GetFile(const std::string& name, std::vector<boost::uint8_t>& buffer);
+	/**
+	 * Fetches the content of a file by its ID without copying it for the
+	 * caller; the default implementation wraps GetFile.
+	 * @param fid file ID in [0, NumFiles())
+	 * @return the contents, NULL if the file could not be read
+	 */
+	virtual FileViewPtr GetFileView(unsigned int fid);
+	/**
+	 * Fetches the content of a file by its name without copying it.
+	 * @see GetFileView(unsigned int fid)
+	 */
+	FileViewPtr GetFileView(const std::string& name);
+	/**
+	 * Hint that the file will be read soon, so archives that cache decoded
+	 * data can prepare it. May be called from several threads at once and
+	 * returns without doing anything if that would block.
+	 * @param fid file ID in [0, NumFiles())
+	 */
+	virtual void PrefetchFile(unsigned int fid) {}
 	/**
 	 * Fetches the name and size in bytes of a file by its ID.
 	 */
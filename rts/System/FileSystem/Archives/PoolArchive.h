@@ -85,6 +85,8 @@ public:
 
 protected:
 	virtual bool GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer);
+	/// every file is a gzip of its own
+	virtual bool IsThreadSafe() const { return true; }
 
 	struct FileData {
 		std::string name;
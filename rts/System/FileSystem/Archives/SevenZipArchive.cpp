@@ -108,11 +108,17 @@ const char* CSevenZipArchive::GetErrorStr(int err)
 }
 
 
+static void FreeBlock(const Byte* data)
+{
+	SzFree(NULL, const_cast<Byte*>(data));
+}
+
+
+const size_t CSevenZipArchive::MAX_CACHED_BLOCK_BYTES = 128 * 1024 * 1024;
+
 CSevenZipArchive::CSevenZipArchive(const std::string& name):
 	CBufferedArchive(name, false),
-	blockIndex(0xFFFFFFFF),
-	outBuffer(NULL),
-	outBufferSize(0),
+	cachedBlockBytes(0),
 	tempBuf(NULL),
 	tempBufSize(0),
 	isOpen(false)
@@ -138,7 +144,9 @@ CSevenZipArchive::CSevenZipArchive(const std::string& name):
 	lookStream.realStream = &archiveStream.s;
 	LookToRead_Init(&lookStream);
 
-	CrcGenerateTable();
+	// the table is global and archives may be opened concurrently (CArchiveScanner::UpdateChecksums)
+	static const bool crcTableGenerated = (CrcGenerateTable(), true);
+	(void) crcTableGenerated;
 
 	SRes res = SzArEx_Open(&db, &lookStream.s, &allocImp, &allocTempImp);
 	if (res == SZ_OK) {
@@ -156,10 +164,25 @@ CSevenZipArchive::CSevenZipArchive(const std::string& name):
 		folderUnpackSizes[fi] = SzFolder_GetUnpackSize(db.db.Folders + fi);
 	}
 
+	blocks.reset(new SolidBlock[db.db.NumFolders]);
+	for (unsigned int fi = 0; fi < db.db.NumFolders; fi++) {
+		blocks[fi].size = folderUnpackSizes[fi];
+	}
+
+	// the files of a block follow each other in db order
+	std::vector<size_t> folderOffsets(db.db.NumFolders, 0);
+
 	// Get contents of archive and store name->int mapping
 	for (unsigned int i = 0; i < db.db.NumFiles; ++i) {
 		CSzFileItem* f = db.db.Files + i;
 		if (!f->IsDir) {
+			// advanced even for skipped files, later ones in the block depend on it
+			const UInt32 folderIndex = db.FileIndexToFolderIndexMap[i];
+			const size_t blockOffset = (folderIndex == ((UInt32)-1))? 0: folderOffsets[folderIndex];
+
+			if (folderIndex != ((UInt32)-1))
+				folderOffsets[folderIndex] += f->Size;
+
 			int written = GetFileName(&db, i);
 			if (written<=0) {
 				LOG_L(L_ERROR, "Error getting filename in Archive: %s %d, file skipped in %s", GetErrorStr(res), res, name.c_str());
@@ -178,7 +201,8 @@ CSevenZipArchive::CSevenZipArchive(const std::string& name):
 			fd.size = f->Size;
 			fd.crc = (f->Size > 0) ? f->Crc: 0;
 
-			const UInt32 folderIndex = db.FileIndexToFolderIndexMap[i];
+			fd.blockOffset = blockOffset;
+
 			if (folderIndex == ((UInt32)-1)) {
 				// file has no folder assigned
 				fd.unpackedSize = f->Size;
@@ -200,9 +224,6 @@ CSevenZipArchive::CSevenZipArchive(const std::string& name):
 
 CSevenZipArchive::~CSevenZipArchive()
 {
-	if (outBuffer) {
-		IAlloc_Free(&allocImp, outBuffer);
-	}
 	if (isOpen) {
 		File_Close(&archiveStream.file);
 	}
@@ -225,20 +246,106 @@ unsigned int CSevenZipArchive::NumFiles() const
 bool CSevenZipArchive::GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer)
 {
 	assert(IsFileId(fid));
-	
-	// Get 7zip to decompress it
-	size_t offset;
-	size_t outSizeProcessed;
-	SRes res;
 
-	res = SzArEx_Extract(&db, &lookStream.s, fileData[fid].fp, &blockIndex, &outBuffer, &outBufferSize, &offset, &outSizeProcessed, &allocImp, &allocTempImp);
-	if (res == SZ_OK) {
-		buffer.resize(outSizeProcessed);
-		memcpy(&buffer[0], (char*)outBuffer+offset, outSizeProcessed);
+	const FileData& fd = fileData[fid];
+	buffer.clear();
+
+	if (fd.size <= 0)
 		return true;
-	} else {
+
+	// the file is copied out, so it does not keep the whole block alive
+	const UInt32 folderIndex = db.FileIndexToFolderIndexMap[fd.fp];
+	const BlockData block = GetBlock(folderIndex, false);
+
+	if (!block)
 		return false;
+	if ((fd.blockOffset + fd.size) > blocks[folderIndex].size)
+		return false;
+
+	buffer.assign(block.get() + fd.blockOffset, block.get() + fd.blockOffset + fd.size);
+	return true;
+}
+
+void CSevenZipArchive::PrefetchFile(unsigned int fid)
+{
+	assert(IsFileId(fid));
+
+	const FileData& fd = fileData[fid];
+
+	if (fd.size <= 0)
+		return;
+
+	GetBlock(db.FileIndexToFolderIndexMap[fd.fp], true);
+}
+
+CSevenZipArchive::BlockData CSevenZipArchive::GetBlock(UInt32 folderIndex, bool prefetch)
+{
+	SolidBlock& block = blocks[folderIndex];
+	boost::mutex::scoped_lock decodeLck(block.decodeLock, boost::defer_lock);
+
+	if (!prefetch) {
+		decodeLck.lock();
+	} else if (!decodeLck.try_lock()) {
+		return BlockData();
+	}
+
+	{
+		boost::mutex::scoped_lock lck(blockCacheLock);
+
+		if (block.data) {
+			lruBlocks.splice(lruBlocks.begin(), lruBlocks, block.lruPos);
+			return block.data;
+		}
+	}
+
+	// a stream of our own, so other blocks can be decoded at the same time
+	CFileInStream fileStream;
+	CLookToRead blockStream;
+
+	if (InFile_Open(&fileStream.file, GetArchiveName().c_str())) {
+		LOG_L(L_ERROR, "Error reopening \"%s\"", GetArchiveName().c_str());
+		return BlockData();
 	}
+
+	FileInStream_CreateVTable(&fileStream);
+	LookToRead_CreateVTable(&blockStream, False);
+
+	blockStream.realStream = &fileStream.s;
+	LookToRead_Init(&blockStream);
+
+	UInt32 blockIndex = 0xFFFFFFFF;
+	Byte* outBuffer = NULL;
+	size_t outBufferSize = 0;
+	size_t offset;
+	size_t outSizeProcessed;
+
+	// any file of the block decodes all of it
+	const SRes res = SzArEx_Extract(&db, &blockStream.s, db.FolderStartFileIndex[folderIndex], &blockIndex, &outBuffer, &outBufferSize, &offset, &outSizeProcessed, &allocImp, &allocTempImp);
+	File_Close(&fileStream.file);
+
+	if (res != SZ_OK || outBufferSize != block.size) {
+		LOG_L(L_ERROR, "Error extracting from \"%s\": %s", GetArchiveName().c_str(), GetErrorStr(res));
+		FreeBlock(outBuffer);
+		return BlockData();
+	}
+
+	const BlockData data(outBuffer, FreeBlock);
+
+	boost::mutex::scoped_lock lck(blockCacheLock);
+
+	block.data = data;
+	block.lruPos = lruBlocks.insert(lruBlocks.begin(), folderIndex);
+	cachedBlockBytes += block.size;
+
+	while (cachedBlockBytes > MAX_CACHED_BLOCK_BYTES && lruBlocks.size() > 1) {
+		SolidBlock& evicted = blocks[lruBlocks.back()];
+
+		cachedBlockBytes -= evicted.size;
+		evicted.data.reset();
+		lruBlocks.pop_back();
+	}
+
+	return data;
 }
 
 void CSevenZipArchive::FileInfo(unsigned int fid, std::string& name, int& size) const
@@ -10,8 +10,12 @@ extern "C" {
 
 #include "ArchiveFactory.h"
 #include "BufferedArchive.h"
+#include <list>
 #include <vector>
 #include <string>
+#include <boost/scoped_array.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 #include "IArchive.h"
 
 /**
@@ -29,6 +33,10 @@ private:
 
 /**
  * An LZMA/7zip compressed, single-file archive.
+ *
+ * Solid blocks are decoded as a whole and kept in a bounded cache, so reading
+ * the files of a block in any order decodes it only once. Each decode opens
+ * the archive file again, so distinct blocks can be decoded in parallel.
  */
 class CSevenZipArchive : public CBufferedArchive
 {
@@ -43,11 +51,42 @@ public:
 	virtual void FileInfo(unsigned int fid, std::string& name, int& size) const;
 	virtual bool HasLowReadingCost(unsigned int fid) const;
 	virtual unsigned GetCrc32(unsigned int fid);
+	/// decodes the solid block of the file, unless another thread already does
+	virtual void PrefetchFile(unsigned int fid);
+
+protected:
+	virtual bool IsThreadSafe() const { return true; }
 
 private:
-	UInt32 blockIndex;
-	Byte* outBuffer;
-	size_t outBufferSize;
+	typedef boost::shared_ptr<const Byte> BlockData;
+
+	/// @param prefetch do not wait if another thread decodes the block
+	BlockData GetBlock(UInt32 folderIndex, bool prefetch);
+
+	/// a solid block (7zip folder) and its decoded contents, if cached
+	struct SolidBlock
+	{
+		SolidBlock() : size(0) {}
+
+		/// held while decoding, so every block is decoded by one thread at a time
+		boost::mutex decodeLock;
+		/// guarded by blockCacheLock
+		BlockData data;
+		/// position in lruBlocks while data is cached, guarded by blockCacheLock
+		std::list<UInt32>::iterator lruPos;
+		size_t size;
+	};
+
+	boost::scoped_array<SolidBlock> blocks;
+
+	/// guards the cached blocks, never held while decoding
+	boost::mutex blockCacheLock;
+	/// folder indices of the cached blocks, most recently used first
+	std::list<UInt32> lruBlocks;
+	size_t cachedBlockBytes;
+
+	/// byte budget of the decoded blocks, the most recently used one is always kept
+	static const size_t MAX_CACHED_BLOCK_BYTES;
 
 	/**
 	 * How much more unpacked data may be allowed in a solid block,
@@ -93,6 +132,10 @@ private:
 		 * @see #unpackedSize
 		 */
 		int packedSize;
+		/**
+		 * Where the file starts in the unpacked data of its solid block.
+		 */
+		size_t blockOffset;
 	};
 	int GetFileName(const CSzArEx* db, int i);
 	const char* GetErrorStr(int res);
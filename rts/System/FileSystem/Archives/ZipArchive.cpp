@@ -6,6 +6,8 @@
 #include <algorithm>
 #include <stdexcept>
 #include <assert.h>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 
 #include "System/Util.h"
 #include "System/Log/ILog.h"
@@ -53,6 +55,7 @@ CZipArchive::CZipArchive(const std::string& archiveName)
 		fd.size = info.uncompressed_size;
 		fd.origName = fName;
 		fd.crc = info.crc;
+		fd.stored = (info.compression_method == 0 && (info.flag & 1) == 0);
 		fileData.push_back(fd);
 		lcNameIndex[fLowerName] = fileData.size() - 1;
 	}
@@ -90,6 +93,49 @@ unsigned int CZipArchive::GetCrc32(unsigned int fid)
 	return fileData[fid].crc;
 }
 
+FileViewPtr CZipArchive::GetFileView(unsigned int fid)
+{
+	assert(IsFileId(fid));
+
+	// below this, mapping costs more than reading
+	static const int minMappedSize = 256 * 1024;
+
+	namespace bi = boost::interprocess;
+
+	const FileData& fd = fileData[fid];
+
+	if (!zip || !fd.stored || fd.size < minMappedSize)
+		return CBufferedArchive::GetFileView(fid);
+
+	ZPOS64_T dataPos = 0;
+
+	{
+		// the data follows the local header, which has to be read to find it
+		boost::mutex::scoped_lock lck(archiveLock);
+
+		unzGoToFilePos(zip, &fileData[fid].fp);
+
+		if (unzOpenCurrentFile(zip) != UNZ_OK)
+			return CBufferedArchive::GetFileView(fid);
+
+		dataPos = unzGetCurrentFileZStreamPos64(zip);
+		unzCloseCurrentFile(zip);
+	}
+
+	try {
+		// the archive is open for as long as we exist, mapping it does not lock it any further
+		const bi::file_mapping mapping(GetArchiveName().c_str(), bi::read_only);
+		const boost::shared_ptr<const bi::mapped_region> region(new bi::mapped_region(mapping, bi::read_only, dataPos, fd.size));
+
+		// the region stays valid after the mapping object is gone
+		return FileViewPtr(new CFileView(region, region->get_address(), region->get_size()));
+	} catch (const bi::interprocess_exception&) {
+		// fall back to reading it
+	}
+
+	return CBufferedArchive::GetFileView(fid);
+}
+
 // To simplify things, files are always read completely into memory from
 // the zip-file, since zlib does not provide any way of reading more
 // than one file at a time
@@ -37,6 +37,8 @@ public:
 	virtual unsigned int NumFiles() const;
 	virtual void FileInfo(unsigned int fid, std::string& name, int& size) const;
 	virtual unsigned int GetCrc32(unsigned int fid);
+	/// large stored (uncompressed) files are memory mapped instead of read
+	virtual FileViewPtr GetFileView(unsigned int fid);
 
 protected:
 	unzFile zip;
@@ -46,6 +48,8 @@ protected:
 		int size;
 		std::string origName;
 		unsigned int crc;
+		/// neither compressed nor encrypted, so its bytes can be used in place
+		bool stored;
 	};
 	std::vector<FileData> fileData;
 	
@@ -10,6 +10,7 @@
 #include <boost/cstdint.hpp>
 
 #include "VFSModes.h"
+#include "Archives/IArchive.h"
 
 /**
  * This is for direct VFS file content access.
@@ -72,7 +73,8 @@ private:
 
 	std::string fileName;
 	std::ifstream ifs;
-	std::vector<boost::uint8_t> fileBuffer;
+	/// contents of a file from the VFS, shared with other readers of it
+	FileViewPtr fileView;
 	int filePos;
 	int fileSize;
 };
@@ -13,6 +13,7 @@
 #include "ArchiveScanner.h"
 #include "System/Exceptions.h"
 #include "System/Log/ILog.h"
+#include "System/ThreadPool.h"
 #include "System/Util.h"
 
 
@@ -72,7 +73,13 @@ bool CVFSHandler::AddArchive(const std::string& archiveName, bool override, cons
 		FileData d;
 		d.ar = ar;
 		d.size = size;
-		files[name] = d;
+
+		const std::pair<boost::unordered_map<std::string, FileData>::iterator, bool> ins = files.insert(std::make_pair(name, d));
+		if (ins.second) {
+			InsertIntoTree(name);
+		} else {
+			ins.first->second = d;
+		}
 	}
 
 	return true;
@@ -112,9 +119,10 @@ bool CVFSHandler::RemoveArchive(const std::string& archiveName)
 	}
 
 	// remove the files loaded from the archive-to-remove
-	for (std::map<std::string, FileData>::iterator f = files.begin(); f != files.end();) {
+	for (boost::unordered_map<std::string, FileData>::iterator f = files.begin(); f != files.end();) {
 		if (f->second.ar == ar) {
 			LOG_L(L_DEBUG, "%s (removing)", f->first.c_str());
+			RemoveFromTree(f->first);
 			f = set_erase(files, f);
 		} else {
 			 ++f;
@@ -143,11 +151,23 @@ std::string CVFSHandler::GetNormalizedPath(const std::string& rawPath)
 	return path;
 }
 
+std::string CVFSHandler::GetNormalizedDir(const std::string& rawDir)
+{
+	std::string dir = GetNormalizedPath(rawDir);
+
+	// Non-empty directories to look in should have a trailing slash
+	if (!dir.empty() && dir[dir.length() - 1] != '/') {
+		dir += "/";
+	}
+
+	return dir;
+}
+
 const CVFSHandler::FileData* CVFSHandler::GetFileData(const std::string& normalizedFilePath)
 {
 	const FileData* fileData = NULL;
 
-	const std::map<std::string, FileData>::const_iterator fi = files.find(normalizedFilePath);
+	const boost::unordered_map<std::string, FileData>::const_iterator fi = files.find(normalizedFilePath);
 	if (fi != files.end()) {
 		fileData = &(fi->second);
 	}
@@ -155,6 +175,108 @@ const CVFSHandler::FileData* CVFSHandler::GetFileData(const std::string& normali
 	return fileData;
 }
 
+const CVFSHandler::DirData* CVFSHandler::GetDirData(const std::string& normalizedDir)
+{
+	const DirData* dirData = NULL;
+
+	const boost::unordered_map<std::string, DirData>::const_iterator di = dirs.find(normalizedDir);
+	if (di != dirs.end()) {
+		dirData = &(di->second);
+	}
+
+	return dirData;
+}
+
+
+static std::string GetParentDir(const std::string& path)
+{
+	// a trailing slash belongs to the path itself
+	if (path.length() < 2)
+		return "";
+
+	const std::string::size_type slash = path.rfind('/', path.length() - 2);
+
+	if (slash == std::string::npos)
+		return "";
+
+	return path.substr(0, slash + 1);
+}
+
+void CVFSHandler::InsertIntoTree(const std::string& normalizedFilePath)
+{
+	std::string dir = GetParentDir(normalizedFilePath);
+	const std::string name = normalizedFilePath.substr(dir.length());
+
+	if (name.empty())
+		return;
+
+	if (name[name.length() - 1] == '/') {
+		// a directory entry of the archive
+		dir = normalizedFilePath;
+		dirs[dir];
+	} else if (name.find('\\') == std::string::npos) {
+		dirs[dir].files.insert(name);
+	}
+
+	// register the directory with its parents, up to the first one known already
+	while (!dir.empty()) {
+		const std::string parent = GetParentDir(dir);
+
+		if (!dirs[parent].dirs.insert(dir.substr(parent.length())).second)
+			break;
+
+		dir = parent;
+	}
+}
+
+void CVFSHandler::RemoveFromTree(const std::string& normalizedFilePath)
+{
+	std::string dir = GetParentDir(normalizedFilePath);
+	const std::string name = normalizedFilePath.substr(dir.length());
+
+	if (name.empty())
+		return;
+
+	if (name[name.length() - 1] == '/') {
+		// a directory entry of the archive
+		dir = normalizedFilePath;
+	}
+
+	boost::unordered_map<std::string, DirData>::iterator di = dirs.find(dir);
+	if (di == dirs.end())
+		return;
+
+	di->second.files.erase(name);
+
+	// prune directories that became empty
+	while (!dir.empty() && di->second.files.empty() && di->second.dirs.empty()) {
+		dirs.erase(di);
+
+		const std::string parent = GetParentDir(dir);
+
+		di = dirs.find(parent);
+		if (di == dirs.end())
+			return;
+
+		di->second.dirs.erase(dir.substr(parent.length()));
+		dir = parent;
+	}
+}
+
+void CVFSHandler::GetFilesBelow(const std::string& normalizedDir, std::vector<std::string>& filePaths)
+{
+	const DirData* dirData = GetDirData(normalizedDir);
+	if (dirData == NULL)
+		return;
+
+	for (std::set<std::string>::const_iterator fi = dirData->files.begin(); fi != dirData->files.end(); ++fi) {
+		filePaths.push_back(normalizedDir + *fi);
+	}
+	for (std::set<std::string>::const_iterator di = dirData->dirs.begin(); di != dirData->dirs.end(); ++di) {
+		GetFilesBelow(normalizedDir + *di, filePaths);
+	}
+}
+
 bool CVFSHandler::LoadFile(const std::string& filePath, std::vector<boost::uint8_t>& buffer)
 {
 	LOG_L(L_DEBUG, "LoadFile(filePath = \"%s\", )", filePath.c_str());
@@ -175,6 +297,60 @@ bool CVFSHandler::LoadFile(const std::string& filePath, std::vector<boost::uint8
 	return true;
 }
 
+FileViewPtr CVFSHandler::GetFileView(const std::string& filePath)
+{
+	LOG_L(L_DEBUG, "GetFileView(filePath = \"%s\", )", filePath.c_str());
+
+	const std::string normalizedPath = GetNormalizedPath(filePath);
+
+	const FileData* fileData = GetFileData(normalizedPath);
+	if (fileData == NULL) {
+		LOG_L(L_DEBUG, "GetFileView: File '%s' does not exist in VFS.", filePath.c_str());
+		return FileViewPtr();
+	}
+
+	const FileViewPtr view = fileData->ar->GetFileView(normalizedPath);
+	if (!view) {
+		LOG_L(L_DEBUG, "GetFileView: File '%s' does not exist in archive.", filePath.c_str());
+	}
+	return view;
+}
+
+std::string CVFSHandler::GetFileArchiveName(const std::string& filePath)
+{
+	const FileData* fileData = GetFileData(GetNormalizedPath(filePath));
+	if (fileData == NULL)
+		return "";
+
+	return fileData->ar->GetArchiveName();
+}
+
+void CVFSHandler::PrefetchDir(const std::string& rawDir)
+{
+	LOG_L(L_DEBUG, "PrefetchDir(rawDir = \"%s\")", rawDir.c_str());
+
+	std::vector<std::string> filePaths;
+	GetFilesBelow(GetNormalizedDir(rawDir), filePaths);
+
+	std::vector< std::pair<IArchive*, unsigned int> > prefetched;
+
+	for (std::vector<std::string>::const_iterator fi = filePaths.begin(); fi != filePaths.end(); ++fi) {
+		const FileData* fileData = GetFileData(*fi);
+		if (fileData == NULL)
+			continue;
+
+		IArchive* ar = fileData->ar;
+		const unsigned int fid = ar->FindFile(*fi);
+
+		if (ar->IsFileId(fid))
+			prefetched.push_back(std::make_pair(ar, fid));
+	}
+
+	for_mt(0, prefetched.size(), [&](const int i) {
+		prefetched[i].first->PrefetchFile(prefetched[i].second);
+	});
+}
+
 bool CVFSHandler::FileExists(const std::string& filePath)
 {
 	LOG_L(L_DEBUG, "FileExists(filePath = \"%s\", )", filePath.c_str());
@@ -200,43 +376,10 @@ std::vector<std::string> CVFSHandler::GetFilesInDir(const std::string& rawDir)
 	LOG_L(L_DEBUG, "GetFilesInDir(rawDir = \"%s\")", rawDir.c_str());
 
 	std::vector<std::string> ret;
-	std::string dir = GetNormalizedPath(rawDir);
-
-	std::map<std::string, FileData>::const_iterator filesStart = files.begin();
-	std::map<std::string, FileData>::const_iterator filesEnd   = files.end();
 
-	// Non-empty directories to look in should have a trailing backslash
-	if (!dir.empty()) {
-		std::string::size_type dirLast = (dir.length() - 1);
-		if (dir[dirLast] != '/') {
-			dir += "/";
-			dirLast++;
-		}
-		// limit the iterator range
-		std::string dirEnd = dir;
-		dirEnd[dirLast] = dirEnd[dirLast] + 1;
-		filesStart = files.lower_bound(dir);
-		filesEnd   = files.upper_bound(dirEnd);
-	}
-
-	while (filesStart != filesEnd) {
-		const std::string path = FileSystem::GetDirectory(filesStart->first);
-
-		// Check if this file starts with the dir path
-		if (path.compare(0, dir.length(), dir) == 0) {
-
-			// Strip pathname
-			const std::string name = filesStart->first.substr(dir.length());
-
-			// Do not return files in subfolders
-			if ((name.find('/') == std::string::npos)
-					&& (name.find('\\') == std::string::npos))
-			{
-				ret.push_back(name);
-				LOG_L(L_DEBUG, "%s", name.c_str());
-			}
-		}
-		++filesStart;
+	const DirData* dirData = GetDirData(GetNormalizedDir(rawDir));
+	if (dirData != NULL) {
+		ret.assign(dirData->files.begin(), dirData->files.end());
 	}
 
 	return ret;
@@ -248,46 +391,11 @@ std::vector<std::string> CVFSHandler::GetDirsInDir(const std::string& rawDir)
 	LOG_L(L_DEBUG, "GetDirsInDir(rawDir = \"%s\")", rawDir.c_str());
 
 	std::vector<std::string> ret;
-	std::string dir = GetNormalizedPath(rawDir);
-
-	std::map<std::string, FileData>::const_iterator filesStart = files.begin();
-	std::map<std::string, FileData>::const_iterator filesEnd   = files.end();
 
-	// Non-empty directories to look in should have a trailing backslash
-	if (!dir.empty()) {
-		std::string::size_type dirLast = (dir.length() - 1);
-		if (dir[dirLast] != '/') {
-			dir += "/";
-			++dirLast;
-		}
-		// limit the iterator range
-		std::string dirEnd = dir;
-		dirEnd[dirLast] = dirEnd[dirLast] + 1;
-		filesStart = files.lower_bound(dir);
-		filesEnd   = files.upper_bound(dirEnd);
-	}
-
-	std::set<std::string> dirs;
-
-	while (filesStart != filesEnd) {
-		const std::string path = FileSystem::GetDirectory(filesStart->first);
-		// Test to see if this file start with the dir path
-		if (path.compare(0, dir.length(), dir) == 0) {
-			// Strip pathname
-			const std::string name = filesStart->first.substr(dir.length());
-			const std::string::size_type slash = name.find_first_of("/\\");
-			if (slash != std::string::npos) {
-				dirs.insert(name.substr(0, slash + 1));
-			}
-		}
-		++filesStart;
-	}
-
-	for (std::set<std::string>::const_iterator it = dirs.begin(); it != dirs.end(); ++it) {
-		ret.push_back(*it);
-		LOG_L(L_DEBUG, "%s", it->c_str());
+	const DirData* dirData = GetDirData(GetNormalizedDir(rawDir));
+	if (dirData != NULL) {
+		ret.assign(dirData->dirs.begin(), dirData->dirs.end());
 	}
 
 	return ret;
 }
-
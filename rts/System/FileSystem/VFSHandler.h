@@ -4,16 +4,21 @@
 #define _VFS_HANDLER_H
 
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 #include <boost/cstdint.hpp>
+#include <boost/unordered_map.hpp>
 
-class IArchive;
+#include "Archives/IArchive.h"
 
 /**
  * Main API for accessing the Virtual File System (VFS).
  * This only allows accessing the VFS (stuff within archives registered with the
  * VFS), NOT the real file system.
+ *
+ * Files are looked up by hashed path, directory listings come from a tree of
+ * directories that is kept up to date as archives are added and removed.
  */
 class CVFSHandler
 {
@@ -37,6 +42,29 @@ public:
 	 * @return true if the file exists in the VFS and was successfully read
 	 */
 	bool LoadFile(const std::string& filePath, std::vector<boost::uint8_t>& buffer);
+	/**
+	 * Like LoadFile, but shares the contents instead of copying them.
+	 * @param filePath raw file path, for example "maps/myMap.smf",
+	 *   case-insensitive
+	 * @return the contents, NULL if the file does not exist in the VFS or
+	 *   could not be read
+	 */
+	FileViewPtr GetFileView(const std::string& filePath);
+	/**
+	 * Returns the name of the archive a file is read from.
+	 * @param filePath raw file path, for example "maps/myMap.smf",
+	 *   case-insensitive
+	 * @return the archive name, empty if the file does not exist in the VFS
+	 */
+	std::string GetFileArchiveName(const std::string& filePath);
+	/**
+	 * Warms the archive caches with all files in the given (virtual)
+	 * directory and its sub-directories, using the thread pool. Compressed
+	 * archives decode distinct solid blocks in parallel this way.
+	 * @param dir raw directory path, for example "units/" or "units",
+	 *   case-insensitive
+	 */
+	void PrefetchDir(const std::string& dir);
 
 	/**
 	 * Returns all the files in the given (virtual) directory without the
@@ -78,12 +106,30 @@ protected:
 		IArchive* ar;
 		int size;
 	};
-	std::map<std::string, FileData> files; 
+	struct DirData {
+		/// names of the files directly in this directory
+		std::set<std::string> files;
+		/// names of the sub-directories, with a trailing slash
+		std::set<std::string> dirs;
+	};
+	/// keyed by normalized path
+	boost::unordered_map<std::string, FileData> files;
+	/// keyed by normalized path with a trailing slash, "" is the root
+	boost::unordered_map<std::string, DirData> dirs;
 	std::map<std::string, IArchive*> archives;
 
 private:
 	std::string GetNormalizedPath(const std::string& rawPath);
+	/// @return the normalized path with a trailing slash, unless empty
+	std::string GetNormalizedDir(const std::string& rawDir);
 	const FileData* GetFileData(const std::string& normalizedFilePath);
+	const DirData* GetDirData(const std::string& normalizedDir);
+
+	/// adds the file and its parent directories to the tree
+	void InsertIntoTree(const std::string& normalizedFilePath);
+	/// removes the file, and its parent directories once they are empty
+	void RemoveFromTree(const std::string& normalizedFilePath);
+	void GetFilesBelow(const std::string& normalizedDir, std::vector<std::string>& filePaths);
 };
 
 extern CVFSHandler* vfsHandler;
@@ -1,8 +1,12 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
+#include <algorithm>
 #include <fstream>
+#include <sstream>
+#include <zlib.h>
 
 #include "ExternalAI/EngineOutHandler.h"
+#include "ExternalAI/SkirmishAIHandler.h"
 #include "CregLoadSaveHandler.h"
 #include "Map/ReadMap.h"
 #include "Game/Game.h"
@@ -25,6 +29,8 @@
 #include "Sim/Projectiles/ProjectileHandler.h"
 #include "Sim/Units/CommandAI/BuilderCAI.h"
 #include "Game/UI/Groups/GroupHandler.h"
+#include "Lua/LuaGaia.h"
+#include "Lua/LuaRules.h"
 
 #include "System/Platform/errorhandler.h"
 #include "System/FileSystem/DataDirsAccess.h"
@@ -32,14 +38,106 @@
 #include "System/creg/Serializer.h"
 #include "System/Exceptions.h"
 #include "System/Log/ILog.h"
+#include "System/Sync/SyncChecker.h"
+
+
+/**
+ * Streams through zlib to or from a file, so a savegame never has to be
+ * held in memory as a whole. Files that are not compressed are read as-is.
+ */
+class CGzStreamBuf : public std::streambuf
+{
+public:
+	CGzStreamBuf(const std::string& fileName, const char* mode)
+		: file(gzopen(fileName.c_str(), mode))
+	{}
+	~CGzStreamBuf() { close(); }
+
+	bool is_open() const { return (file != NULL); }
+	bool close() {
+		if (file == NULL)
+			return true;
+
+		const bool closed = (gzclose(file) == Z_OK);
+		file = NULL;
+		return closed;
+	}
+
+protected:
+	// gzwrite does its own buffering
+	int_type overflow(int_type c) {
+		if (traits_type::eq_int_type(c, traits_type::eof()))
+			return traits_type::not_eof(c);
+
+		const char ch = traits_type::to_char_type(c);
+		return ((xsputn(&ch, 1) == 1)? c: traits_type::eof());
+	}
+	std::streamsize xsputn(const char* s, std::streamsize n) {
+		if (file == NULL || n <= 0)
+			return 0;
+
+		return std::max(gzwrite(file, s, n), 0);
+	}
+
+	int_type underflow() {
+		if (gptr() < egptr())
+			return traits_type::to_int_type(*gptr());
+		if (file == NULL)
+			return traits_type::eof();
+
+		const int numRead = gzread(file, readBuffer, sizeof(readBuffer));
+
+		if (numRead <= 0)
+			return traits_type::eof();
+
+		setg(readBuffer, readBuffer, readBuffer + numRead);
+		return traits_type::to_int_type(*gptr());
+	}
+
+	// only telling the (uncompressed) position is supported
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+		if (file == NULL || off != 0 || dir != std::ios_base::cur)
+			return pos_type(off_type(-1));
+
+		return pos_type(off_type(gztell(file)) - (egptr() - gptr()));
+	}
+
+private:
+	gzFile file;
+	char readBuffer[64 * 1024];
+};
+
+class CGzFileStream : public std::iostream
+{
+public:
+	/// @param mode passed to gzopen, "wb1" or "rb"
+	CGzFileStream(const std::string& fileName, const char* mode)
+		: std::iostream(NULL)
+		, buf(fileName, mode)
+	{
+		rdbuf(&buf);
+
+		if (!buf.is_open())
+			setstate(std::ios::failbit);
+	}
+
+	bool is_open() const { return buf.is_open(); }
+	bool close() { return buf.close(); }
+
+private:
+	CGzStreamBuf buf;
+};
 
 
 CCregLoadSaveHandler::CCregLoadSaveHandler()
 	: ifs(NULL)
+	, isSnapshot(false)
 {}
 
 CCregLoadSaveHandler::~CCregLoadSaveHandler()
-{}
+{
+	delete ifs;
+}
 
 class CGameStateCollector
 {
@@ -113,21 +211,13 @@ void CCregLoadSaveHandler::SaveGame(const std::string& file)
 {
 	LOG("Saving game");
 	try {
-		std::ofstream ofs(dataDirsAccess.LocateFile(file, FileQueryFlags::WRITE).c_str(), std::ios::out|std::ios::binary);
+		// compressed while written, sizes below are uncompressed
+		CGzFileStream ofs(dataDirsAccess.LocateFile(file, FileQueryFlags::WRITE), "wb1");
 		if (ofs.bad() || !ofs.is_open()) {
 			throw content_error("Unable to save game to file \"" + file + "\"");
 		}
 
-		// write our own header. SavePackage() will add its own
-		WriteString(ofs, gameSetup->setupText);
-		WriteString(ofs, modName);
-		WriteString(ofs, mapName);
-
-		CGameStateCollector gsc = CGameStateCollector();
-
-		// save creg state
-		creg::COutputStreamSerializer os;
-		os.SavePackage(&ofs, &gsc, gsc.GetClass());
+		SaveState(ofs, modName, mapName);
 		PrintSize("Game", ofs.tellp());
 
 		// save ai state
@@ -136,6 +226,10 @@ void CCregLoadSaveHandler::SaveGame(const std::string& file)
 		PrintSize("AIs", ((int)ofs.tellp()) - aistart);
 
 		//FIXME add lua state
+
+		if (ofs.fail() || !ofs.close()) {
+			throw content_error("Unable to write game to file \"" + file + "\"");
+		}
 	} catch (const content_error& ex) {
 		LOG_L(L_ERROR, "Save failed(content error): %s", ex.what());
 	} catch (const std::exception& ex) {
@@ -149,10 +243,108 @@ void CCregLoadSaveHandler::SaveGame(const std::string& file)
 	}
 }
 
+void CCregLoadSaveHandler::SaveState(std::ostream& os, const std::string& modName, const std::string& mapName)
+{
+	// write our own header. SavePackage() will add its own, it writes sequentially
+	// so savegames can be compressed while written
+	WriteString(os, gameSetup->setupText);
+	WriteString(os, modName);
+	WriteString(os, mapName);
+
+	CGameStateCollector gsc = CGameStateCollector();
+
+	// save creg state
+	creg::COutputStreamSerializer oss;
+	oss.SavePackage(&os, &gsc, gsc.GetClass());
+}
+
+bool CCregLoadSaveHandler::CanSaveSnapshot()
+{
+	// creg does not see into synced Lua states, and AI state is only saved
+	// by the clients hosting the AIs (see SaveGame)
+	return (luaRules == NULL && luaGaia == NULL && skirmishAIHandler.GetAllSkirmishAIs().empty());
+}
+
+bool CCregLoadSaveHandler::SaveSnapshot(std::string& state)
+{
+	std::ostringstream oss(std::ios::out | std::ios::binary);
+
+	try {
+		SaveState(oss, gameSetup->modName, gameSetup->mapName);
+
+	#ifdef SYNCCHECK
+		// the running checksums continue across the snapshot
+		for (unsigned int n = 0; n < CSyncChecker::SECTION_COUNT; ++n) {
+			const unsigned checksum = CSyncChecker::GetSectionChecksum(CSyncChecker::Section(n));
+			oss.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+		}
+	#endif
+	} catch (const std::exception& ex) {
+		LOG_L(L_ERROR, "[%s] failed: %s", __FUNCTION__, ex.what());
+		return false;
+	}
+
+	state = oss.str();
+	PrintSize("Snapshot", state.size());
+	return true;
+}
+
+bool CCregLoadSaveHandler::CompressSnapshot(const std::string& state, std::vector<boost::uint8_t>& data)
+{
+	const boost::uint32_t stateSize = state.size();
+
+	uLongf compressedSize = compressBound(stateSize);
+
+	// uncompressed size, then the zlib stream
+	data.resize(sizeof(stateSize) + compressedSize);
+	memcpy(&data[0], &stateSize, sizeof(stateSize));
+
+	if (compress2(&data[sizeof(stateSize)], &compressedSize, reinterpret_cast<const Bytef*>(state.data()), stateSize, Z_BEST_SPEED) != Z_OK) {
+		LOG_L(L_ERROR, "[%s] compression failed", __FUNCTION__);
+		return false;
+	}
+
+	data.resize(sizeof(stateSize) + compressedSize);
+
+	PrintSize("Snapshot (compressed)", data.size());
+	return true;
+}
+
+bool CCregLoadSaveHandler::LoadSnapshotStartInfo(const std::vector<boost::uint8_t>& data)
+{
+	boost::uint32_t stateSize = 0;
+
+	if (data.size() <= sizeof(stateSize))
+		return false;
+
+	memcpy(&stateSize, &data[0], sizeof(stateSize));
+
+	std::string state(stateSize, 0);
+	uLongf uncompressedSize = stateSize;
+
+	if (uncompress(reinterpret_cast<Bytef*>(&state[0]), &uncompressedSize, &data[sizeof(stateSize)], data.size() - sizeof(stateSize)) != Z_OK || uncompressedSize != stateSize) {
+		LOG_L(L_ERROR, "[%s] corrupt snapshot", __FUNCTION__);
+		return false;
+	}
+
+	delete ifs;
+	ifs = new std::istringstream(state, std::ios::in | std::ios::binary);
+	isSnapshot = true;
+
+	scriptText = "";
+	modName = "";
+	mapName = "";
+
+	ReadString(*ifs, scriptText);
+	ReadString(*ifs, modName);
+	ReadString(*ifs, mapName);
+	return true;
+}
+
 /// this just loads the mapname and some other early stuff
 void CCregLoadSaveHandler::LoadGameStartInfo(const std::string& file)
 {
-	ifs = new std::ifstream(dataDirsAccess.LocateFile(FindSaveFile(file)), std::ios::in|std::ios::binary);
+	ifs = new CGzFileStream(dataDirsAccess.LocateFile(FindSaveFile(file)), "rb");
 
 	// in case these contained values alredy
 	// (this is the case when loading a game through the spring menu eg),
@@ -190,6 +382,22 @@ void CCregLoadSaveHandler::LoadGame()
 	delete gsc; // the only job of gsc is to collect gamestate data
 	gsc = NULL;
 
+	if (isSnapshot) {
+	#ifdef SYNCCHECK
+		for (unsigned int n = 0; n < CSyncChecker::SECTION_COUNT; ++n) {
+			unsigned checksum = 0;
+			ifs->read(reinterpret_cast<char*>(&checksum), sizeof(checksum));
+			CSyncChecker::SetSectionChecksum(CSyncChecker::Section(n), checksum);
+		}
+	#endif
+
+		delete ifs;
+		ifs = NULL;
+
+		LEAVE_SYNCED_CODE();
+		return;
+	}
+
 	// load ai state
 	eoh->Load(ifs);
 	//for (int a=0; a < teamHandler->ActiveTeams(); a++) { // For old savegames
@@ -4,7 +4,11 @@
 #define CREG_LOAD_SAVE_HANDLER_H
 
 #include <string>
-#include <fstream>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <boost/cstdint.hpp>
+
 #include "LoadSaveHandler.h"
 
 class CCregLoadSaveHandler : public ILoadSaveHandler
@@ -17,8 +21,30 @@ public:
 	void LoadGameStartInfo(const std::string& file);
 	void LoadGame();
 
+	/**
+	 * @brief false while the game has state a snapshot would miss
+	 * That is synced Lua (LuaRules, LuaGaia) and skirmish AIs; midgame
+	 * joiners then have to simulate the game from frame 0.
+	 */
+	static bool CanSaveSnapshot();
+	/**
+	 * @brief serialize the game state into <state>
+	 * Snapshots are what SaveGame writes minus the skirmish AI state plus
+	 * the sync checker state, so a midgame joiner can continue from them
+	 * instead of simulating the game from frame 0.
+	 */
+	static bool SaveSnapshot(std::string& state);
+	/// zlib-compress a snapshot for sending, does not touch the game state
+	static bool CompressSnapshot(const std::string& state, std::vector<boost::uint8_t>& data);
+	/// like LoadGameStartInfo, for a snapshot made by SaveSnapshot
+	bool LoadSnapshotStartInfo(const std::vector<boost::uint8_t>& data);
+
+protected:
+	static void SaveState(std::ostream& os, const std::string& modName, const std::string& mapName);
+
 protected:
-	std::ifstream* ifs;
+	std::istream* ifs;
+	bool isSnapshot;
 };
 
 #endif // CREG_LOAD_SAVE_HANDLER_H
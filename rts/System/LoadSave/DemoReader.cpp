@@ -12,6 +12,8 @@ CONFIG(bool, DisableDemoVersionCheck).defaultValue(false).description("Allow to
 #include "System/Net/RawPacket.h"
 #include "Game/GameVersion.h"
 
+#include <zlib.h>
+#include <algorithm>
 #include <limits.h>
 #include <stdexcept>
 #include <cassert>
@@ -20,6 +22,11 @@ CONFIG(bool, DisableDemoVersionCheck).defaultValue(false).description("Allow to
 
 CDemoReader::CDemoReader(const std::string& filename, float curTime)
 	: playbackDemo(NULL)
+	, compressedStream(false)
+	, streamEnded(false)
+	, streamStart(0)
+	, streamEnd(0)
+	, streamBlockPos(0)
 {
 	playbackDemo = new CFileHandler(filename, SPRING_VFS_PWD_ALL);
 
@@ -32,7 +39,7 @@ CDemoReader::CDemoReader(const std::string& filename, float curTime)
 	fileHeader.swab();
 
 	if (memcmp(fileHeader.magic, DEMOFILE_MAGIC, sizeof(fileHeader.magic))
-		|| fileHeader.version != DEMOFILE_VERSION
+		|| (fileHeader.version != DEMOFILE_VERSION && fileHeader.version != DEMOFILE_VERSION_UNCOMPRESSED)
 		|| fileHeader.headerSize != sizeof(fileHeader)
 		|| fileHeader.playerStatElemSize != sizeof(PlayerStatistics)
 		|| fileHeader.teamStatElemSize != sizeof(TeamStatistics)
@@ -58,15 +65,26 @@ CDemoReader::CDemoReader(const std::string& filename, float curTime)
 		delete[] buf;
 	}
 
-	playbackDemo->Read((char*)&chunkHeader, sizeof(chunkHeader));
+	compressedStream = (fileHeader.version != DEMOFILE_VERSION_UNCOMPRESSED);
+
+	streamStart = playbackDemo->GetPos();
+	playbackDemo->Seek(0, std::ios::end);
+	playbackDemoSize = playbackDemo->GetPos();
+	playbackDemo->Seek(streamStart);
+
+	// an unfinished demo's stream continues until EOF, see demofile.h
+	streamEnd = (fileHeader.demoStreamSize != 0)? (streamStart + fileHeader.demoStreamSize): playbackDemoSize;
+
+	if (compressedStream && fileHeader.demoStreamSize != 0)
+		LoadSeekIndex();
+
+	streamEnded = !ReadStream(&chunkHeader, sizeof(chunkHeader));
 	chunkHeader.swab();
 
 	demoTimeOffset = curTime - chunkHeader.modGameTime - 0.1f;
 	nextDemoReadTime = curTime - 0.01f;
 
 	long curPos = playbackDemo->GetPos();
-	playbackDemo->Seek(0, std::ios::end);
-	playbackDemoSize = playbackDemo->GetPos();
 	if (fileHeader.demoStreamSize != 0) {
 		bytesRemaining = fileHeader.demoStreamSize;
 	}
@@ -77,7 +95,6 @@ CDemoReader::CDemoReader(const std::string& filename, float curTime)
 		// (if this had still used CFileHandler that would have been easier ;-))
 		bytesRemaining = playbackDemoSize - curPos;
 	}
-	playbackDemo->Seek(curPos);
 }
 
 
@@ -97,23 +114,30 @@ netcode::RawPacket* CDemoReader::GetData(const float readTime)
 	// check needed
 	if (readTime >= nextDemoReadTime) {
 		netcode::RawPacket* buf = new netcode::RawPacket(chunkHeader.length);
-		if (playbackDemo->Read((char*)(buf->data), chunkHeader.length) < chunkHeader.length) {
+		if (!ReadStream(buf->data, chunkHeader.length)) {
 			delete buf;
 			bytesRemaining = 0;
+			streamEnded = true;
 			return NULL;
 		}
 		bytesRemaining -= chunkHeader.length;
 
 		if (!ReachedEnd()) {
 			// read next chunk header
-			if (playbackDemo->Read((char*)&chunkHeader, sizeof(chunkHeader)) < sizeof(chunkHeader)) {
-				delete buf;
-				bytesRemaining = 0;
-				return NULL;
+			if (!ReadStream(&chunkHeader, sizeof(chunkHeader))) {
+				// compressed streams do not know their uncompressed size,
+				// they end where no more chunk header can be read
+				if (!compressedStream) {
+					delete buf;
+					bytesRemaining = 0;
+					return NULL;
+				}
+				streamEnded = true;
+			} else {
+				chunkHeader.swab();
+				nextDemoReadTime = chunkHeader.modGameTime + demoTimeOffset;
+				bytesRemaining -= sizeof(chunkHeader);
 			}
-			chunkHeader.swab();
-			nextDemoReadTime = chunkHeader.modGameTime + demoTimeOffset;
-			bytesRemaining -= sizeof(chunkHeader);
 		}
 		if (readTime < 0) {
 			delete buf;
@@ -127,6 +151,9 @@ netcode::RawPacket* CDemoReader::GetData(const float readTime)
 
 bool CDemoReader::ReachedEnd()
 {
+	if (compressedStream)
+		return streamEnded;
+
 	if (bytesRemaining <= 0 || playbackDemo->Eof() ||
 		(playbackDemo->GetPos() > playbackDemoSize) )
 		return true;
@@ -135,6 +162,134 @@ bool CDemoReader::ReachedEnd()
 }
 
 
+bool CDemoReader::ReadStream(void* buf, const unsigned size)
+{
+	if (!compressedStream)
+		return (playbackDemo->Read(buf, size) == int(size));
+
+	char* dst = reinterpret_cast<char*>(buf);
+	unsigned remaining = size;
+
+	while (remaining > 0) {
+		if (streamBlockPos >= streamBlock.size() && !ReadStreamBlock())
+			return false;
+
+		const unsigned n = std::min<unsigned>(remaining, streamBlock.size() - streamBlockPos);
+
+		memcpy(dst, &streamBlock[streamBlockPos], n);
+		streamBlockPos += n;
+		dst += n;
+		remaining -= n;
+	}
+
+	return true;
+}
+
+bool CDemoReader::ReadStreamBlock()
+{
+	// anything larger is garbage (a block of an unfinished demo)
+	static const unsigned maxBlockSize = 64 * 1024 * 1024;
+
+	const long pos = playbackDemo->GetPos();
+
+	DemoStreamBlockHeader blockHeader;
+
+	if ((pos + long(sizeof(blockHeader))) > streamEnd)
+		return false;
+	if (playbackDemo->Read(&blockHeader, sizeof(blockHeader)) < int(sizeof(blockHeader)))
+		return false;
+
+	blockHeader.swab();
+
+	if (blockHeader.compressedSize > (streamEnd - pos - sizeof(blockHeader)))
+		return false;
+	if (blockHeader.rawSize > maxBlockSize)
+		return false;
+
+	std::vector<boost::uint8_t> compressed(blockHeader.compressedSize);
+
+	if (playbackDemo->Read(&compressed[0], compressed.size()) < int(compressed.size()))
+		return false;
+
+	uLongf rawSize = blockHeader.rawSize;
+	streamBlock.resize(rawSize);
+	streamBlockPos = 0;
+
+	if (uncompress(reinterpret_cast<Bytef*>(&streamBlock[0]), &rawSize, &compressed[0], compressed.size()) != Z_OK || rawSize != blockHeader.rawSize) {
+		LOG_L(L_WARNING, "[DemoReader::%s] corrupt block at offset %ld, demo ends here", __FUNCTION__, pos);
+		streamBlock.clear();
+		return false;
+	}
+
+	return true;
+}
+
+
+void CDemoReader::LoadSeekIndex()
+{
+	const int indexPos =
+		fileHeader.headerSize + fileHeader.scriptSize + fileHeader.demoStreamSize +
+		fileHeader.winningAllyTeamsSize + fileHeader.playerStatSize + fileHeader.teamStatSize;
+
+	DemoSeekIndexHeader indexHeader;
+
+	playbackDemo->Seek(indexPos);
+
+	if (playbackDemo->Read(&indexHeader, sizeof(indexHeader)) == int(sizeof(indexHeader))) {
+		indexHeader.swab();
+
+		const bool validIndex =
+			(indexHeader.entrySize == sizeof(DemoSeekIndexEntry)) &&
+			(indexHeader.numEntries >= 0) &&
+			(indexHeader.numEntries <= ((playbackDemoSize - indexPos) / indexHeader.entrySize));
+
+		if (validIndex && indexHeader.numEntries > 0) {
+			seekIndex.resize(indexHeader.numEntries);
+
+			if (playbackDemo->Read(&seekIndex[0], seekIndex.size() * sizeof(DemoSeekIndexEntry)) == int(seekIndex.size() * sizeof(DemoSeekIndexEntry))) {
+				for (DemoSeekIndexEntry& entry: seekIndex) {
+					entry.swab();
+				}
+			} else {
+				seekIndex.clear();
+			}
+		}
+
+		if (!validIndex)
+			LOG_L(L_WARNING, "[DemoReader::%s] ignoring corrupt seek index", __FUNCTION__);
+	}
+
+	playbackDemo->Seek(streamStart);
+}
+
+int CDemoReader::SeekToFrame(int frameNum)
+{
+	if (seekIndex.empty())
+		return -1;
+
+	// the last block which starts before <frameNum> has been reached
+	unsigned n = 0;
+
+	while ((n + 1) < seekIndex.size() && seekIndex[n + 1].frameNum < frameNum)
+		n += 1;
+
+	const DemoSeekIndexEntry& entry = seekIndex[n];
+
+	if (entry.streamOffset >= (unsigned) fileHeader.demoStreamSize)
+		return -1;
+
+	playbackDemo->Seek(streamStart + entry.streamOffset);
+	streamBlock.clear();
+	streamBlockPos = 0;
+
+	streamEnded = !ReadStream(&chunkHeader, sizeof(chunkHeader));
+	chunkHeader.swab();
+	nextDemoReadTime = chunkHeader.modGameTime + demoTimeOffset;
+
+	return entry.frameNum;
+}
+
+
 void CDemoReader::LoadStats()
 {
 	// Stats are not available if Spring crashed while writing the demo.
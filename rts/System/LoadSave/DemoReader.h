@@ -55,6 +55,25 @@ public:
 	/// Not needed for normal demo watching
 	void LoadStats();
 
+	/// empty for unfinished and DEMOFILE_VERSION_UNCOMPRESSED demos
+	const std::vector<DemoSeekIndexEntry>& GetSeekIndex() const { return seekIndex; }
+
+	/**
+	@brief continue reading at the last indexed position before <frameNum>
+	  (for tools only, a replay can not skip frames it did not simulate)
+	@return number of sim frames in the stream before that position
+	  (reading on yields frame number return + 1 next), -1 if the demo
+	  has no seek index
+	*/
+	int SeekToFrame(int frameNum);
+
+private:
+	/// read the next <size> bytes of the demo stream
+	bool ReadStream(void* buf, const unsigned size);
+	/// read and decompress the next block of a compressed demo stream
+	bool ReadStreamBlock();
+	void LoadSeekIndex();
+
 private:
 	CFileHandler* playbackDemo;
 
@@ -65,11 +84,23 @@ private:
 
 	DemoStreamChunkHeader chunkHeader;
 
+	/// false for DEMOFILE_VERSION_UNCOMPRESSED demos
+	bool compressedStream;
+	bool streamEnded;
+	/// file offsets at which the (compressed) demo stream starts and ends
+	long streamStart;
+	long streamEnd;
+	/// the current uncompressed block, see DemoStreamBlockHeader
+	std::vector<char> streamBlock;
+	unsigned streamBlockPos;
+
 	std::string setupScript;	// the original, unaltered version from script
 
 	std::vector<PlayerStatistics> playerStats; // one stat per player
 	std::vector< std::vector<TeamStatistics> > teamStats; // many stats per team
 	std::vector<unsigned char> winningAllyTeams;
+
+	std::vector<DemoSeekIndexEntry> seekIndex;
 };
 
 #endif
@@ -6,34 +6,80 @@
 #include "System/FileSystem/FileQueryFlags.h"
 #include "System/FileSystem/FileHandler.h"
 #include "Game/GameVersion.h"
+#include "Net/Protocol/BaseNetProtocol.h"
 #include "Sim/Misc/TeamStatistics.h"
 #include "System/Util.h"
 #include "System/TimeUtil.h"
+#include "System/Platform/Threading.h"
 
 #include "System/Log/ILog.h"
 
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <zlib.h>
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
 #include <cstring>
 
 
-CDemoRecorder::CDemoRecorder(const std::string& mapName, const std::string& modName, bool serverDemo):
-demoStream(std::ios::binary | std::ios::out)
+const float CDemoRecorder::blockMaxGameTime = 5.0f;
+
+
+CDemoRecorder::CDemoRecorder(const std::string& mapName, const std::string& modName, bool serverDemo)
+	: streamFrameNum(0)
+	, writerThread(NULL)
+	, writerQuit(false)
+	, demoStreamSize(0)
 {
 	SetName(mapName, modName, serverDemo);
 	SetFileHeader();
 
 	file.open(demoName.c_str(), std::ios::binary | std::ios::out);
+	block.reserve(blockSize * 2);
+
+	QueueFileHeader();
+	writerThread = new boost::thread(boost::bind(&CDemoRecorder::WriterLoop, this));
 }
 
 CDemoRecorder::~CDemoRecorder()
 {
 	LOG("Writing demo: %s", GetName().c_str());
-	WriteWinnerList();
-	WritePlayerStats();
-	WriteTeamStats();
-	WriteFileHeader(true);
-	WriteDemoFile();
+
+	QueueBlock();
+
+	std::vector<char> stats;
+	WriteWinnerList(stats);
+	WritePlayerStats(stats);
+	WriteTeamStats(stats);
+	QueueJob(WriteJob::APPEND, stats);
+
+	{
+		boost::mutex::scoped_lock lock(writerMutex);
+		writerQuit = true;
+	}
+
+	writerCond.notify_one();
+	writerThread->join();
+	delete writerThread;
+
+	WriteJob index;
+	index.type = WriteJob::APPEND;
+	WriteSeekIndex(index.data);
+	Write(index);
+
+	// the demo is complete now, so the header gets its stream size
+	fileHeader.demoStreamSize = demoStreamSize;
+
+	DemoFileHeader tmpHeader = fileHeader;
+	tmpHeader.swab();
+
+	WriteJob header;
+	header.type = WriteJob::REPLACE_HEADER;
+	header.data.assign(reinterpret_cast<char*>(&tmpHeader), reinterpret_cast<char*>(&tmpHeader) + sizeof(tmpHeader));
+
+	Write(header);
+	file.close();
 }
 
 void CDemoRecorder::SetFileHeader()
@@ -48,32 +94,23 @@ void CDemoRecorder::SetFileHeader()
 	fileHeader.teamStatElemSize = sizeof(TeamStatistics);
 	fileHeader.teamStatPeriod = TeamStatistics::statsPeriod;
 	fileHeader.winningAllyTeamsSize = 0;
-
-	demoStream.seekp(WriteFileHeader(false) + sizeof(DemoFileHeader));
-}
-
-void CDemoRecorder::WriteDemoFile()
-{
-	// using operator<<(basic_stringbuf*) requires the stream to be opened with std::ios::in
-	// stringbuf::{eback(), egptr(), gptr()} are protected so we cannot access them directly
-	// (plus data is not guaranteed to be stored contiguously) ==> the only clean OO solution
-	// that avoids str()'s copy would be to supply our own stringbuffer backend to demoStream
-	// which is slightly overdoing it
-	const std::string data = demoStream.str();
-	file.write(data.c_str(), data.size());
-	file.flush();
-	file.close();
 }
 
+/** @brief must be called before anything is saved to the demo stream */
 void CDemoRecorder::WriteSetupText(const std::string& text)
 {
+	assert(block.empty());
+
 	int length = text.length();
 	while (text[length - 1] == '\0') {
 		--length;
 	}
 
+	std::vector<char> data(text.begin(), text.begin() + length);
+
 	fileHeader.scriptSize = length;
-	demoStream.write(text.c_str(), length);
+	QueueJob(WriteJob::APPEND, data);
+	QueueFileHeader();
 }
 
 void CDemoRecorder::SaveToDemo(const unsigned char* buf, const unsigned length, const float modGameTime)
@@ -83,9 +120,131 @@ void CDemoRecorder::SaveToDemo(const unsigned char* buf, const unsigned length,
 	chunkHeader.modGameTime = modGameTime;
 	chunkHeader.length = length;
 	chunkHeader.swab();
-	demoStream.write((char*) &chunkHeader, sizeof(chunkHeader));
-	demoStream.write((char*) buf, length);
-	fileHeader.demoStreamSize += length + sizeof(chunkHeader);
+
+	if (block.empty()) {
+		blockIndexEntry.frameNum = streamFrameNum;
+		blockIndexEntry.modGameTime = modGameTime;
+		blockIndexEntry.streamOffset = 0;
+	}
+
+	block.insert(block.end(), reinterpret_cast<char*>(&chunkHeader), reinterpret_cast<char*>(&chunkHeader) + sizeof(chunkHeader));
+	block.insert(block.end(), buf, buf + length);
+
+	if (length > 0) {
+		switch (buf[0]) {
+			case NETMSG_NEWFRAME: {
+				streamFrameNum += 1;
+			} break;
+			case NETMSG_KEYFRAME: {
+				if (length >= (1 + sizeof(streamFrameNum)))
+					memcpy(&streamFrameNum, buf + 1, sizeof(streamFrameNum));
+			} break;
+		}
+	}
+
+	if (block.size() >= blockSize || (modGameTime - blockIndexEntry.modGameTime) >= blockMaxGameTime)
+		QueueBlock();
+}
+
+void CDemoRecorder::QueueBlock()
+{
+	if (block.empty())
+		return;
+
+	QueueJob(WriteJob::APPEND_BLOCK, block, blockIndexEntry);
+	block.reserve(blockSize * 2);
+}
+
+/** @brief hand <data> to the writer thread, leaves it empty */
+void CDemoRecorder::QueueJob(WriteJob::Type type, std::vector<char>& data, const DemoSeekIndexEntry& indexEntry)
+{
+	{
+		boost::mutex::scoped_lock lock(writerMutex);
+
+		writerJobs.push_back(WriteJob());
+		writerJobs.back().type = type;
+		writerJobs.back().data.swap(data);
+		writerJobs.back().indexEntry = indexEntry;
+	}
+
+	writerCond.notify_one();
+}
+
+void CDemoRecorder::WriterLoop()
+{
+	Threading::SetThreadName("demowriter");
+
+	boost::mutex::scoped_lock lock(writerMutex);
+
+	while (true) {
+		while (writerJobs.empty() && !writerQuit)
+			writerCond.wait(lock);
+
+		// on quit, finish the remaining jobs first
+		if (writerJobs.empty())
+			break;
+
+		WriteJob job;
+		job.type = writerJobs.front().type;
+		job.data.swap(writerJobs.front().data);
+		job.indexEntry = writerJobs.front().indexEntry;
+		writerJobs.pop_front();
+
+		lock.unlock();
+		Write(job);
+		lock.lock();
+	}
+}
+
+void CDemoRecorder::Write(WriteJob& job)
+{
+	if (job.data.empty())
+		return;
+
+	switch (job.type) {
+		case WriteJob::APPEND: {
+			file.write(&job.data[0], job.data.size());
+		} break;
+
+		case WriteJob::APPEND_BLOCK: {
+			uLongf compressedSize = compressBound(job.data.size());
+			std::vector<char> compressed(sizeof(DemoStreamBlockHeader) + compressedSize);
+
+			const int error = compress(
+				reinterpret_cast<Bytef*>(&compressed[sizeof(DemoStreamBlockHeader)]), &compressedSize,
+				reinterpret_cast<const Bytef*>(&job.data[0]), job.data.size()
+			);
+
+			if (error != Z_OK) {
+				LOG_L(L_ERROR, "[DemoRecorder::%s] zlib error %d, demo stream is cut off", __FUNCTION__, error);
+				return;
+			}
+
+			DemoStreamBlockHeader blockHeader;
+			blockHeader.compressedSize = compressedSize;
+			blockHeader.rawSize = job.data.size();
+			blockHeader.swab();
+
+			memcpy(&compressed[0], &blockHeader, sizeof(blockHeader));
+			file.write(&compressed[0], sizeof(blockHeader) + compressedSize);
+
+			seekIndex.push_back(job.indexEntry);
+			seekIndex.back().streamOffset = demoStreamSize;
+			demoStreamSize += (sizeof(blockHeader) + compressedSize);
+		} break;
+
+		case WriteJob::REPLACE_HEADER: {
+			const std::streamoff end = file.tellp();
+
+			file.seekp(0);
+			file.write(&job.data[0], job.data.size());
+			// the first header goes to the still empty file
+			file.seekp(std::max<std::streamoff>(end, file.tellp()));
+		} break;
+	}
+
+	// so a crash loses as little as possible
+	file.flush();
 }
 
 void CDemoRecorder::SetName(const std::string& mapName, const std::string& modName, bool serverDemo)
@@ -122,7 +281,7 @@ void CDemoRecorder::SetName(const std::string& mapName, const std::string& modNa
 void CDemoRecorder::SetGameID(const unsigned char* buf)
 {
 	memcpy(&fileHeader.gameID, buf, sizeof(fileHeader.gameID));
-	WriteFileHeader(false);
+	QueueFileHeader();
 }
 
 void CDemoRecorder::SetTime(int gameTime, int wallclockTime)
@@ -172,99 +331,95 @@ void CDemoRecorder::SetWinningAllyTeams(const std::vector<unsigned char>& winnin
 	winningAllyTeams = winningAllyTeamIDs;
 }
 
-/** @brief Write DemoFileHeader
-Write the DemoFileHeader at the start of the file and restores the original
-position in the file afterwards. */
-unsigned int CDemoRecorder::WriteFileHeader(bool updateStreamLength)
+/** @brief Queue writing the DemoFileHeader at the start of the file
+The stream size is left 0 (unfinished demo) until the recorder is destroyed. */
+void CDemoRecorder::QueueFileHeader()
 {
-#ifdef _MSC_VER // MSVC8 behaves strange if tell/seek is called before anything has been written
-	const bool empty = (demoStream.str() == "");
-	const unsigned int pos = empty? 0 : demoStream.tellp();
-#else
-	const unsigned int pos = demoStream.tellp();
-#endif
-
-	DemoFileHeader tmpHeader;
-	memcpy(&tmpHeader, &fileHeader, sizeof(fileHeader));
-	if (!updateStreamLength)
-		tmpHeader.demoStreamSize = 0;
+	DemoFileHeader tmpHeader = fileHeader;
+	tmpHeader.demoStreamSize = 0;
 	tmpHeader.swab(); // to little endian
 
-#ifdef _MSC_VER
-	if (!empty)
-#endif
-	{
-		demoStream.seekp(0);
-	}
-
-
-	demoStream.write((char*) &tmpHeader, sizeof(tmpHeader));
-	demoStream.seekp(pos);
-
-	return pos;
+	std::vector<char> data(reinterpret_cast<char*>(&tmpHeader), reinterpret_cast<char*>(&tmpHeader) + sizeof(tmpHeader));
+	QueueJob(WriteJob::REPLACE_HEADER, data);
 }
 
-/** @brief Write the CPlayer::Statistics at the current position in the file. */
-void CDemoRecorder::WritePlayerStats()
+/** @brief Append the CPlayer::Statistics to <stats>. */
+void CDemoRecorder::WritePlayerStats(std::vector<char>& stats)
 {
 	if (fileHeader.numPlayers == 0)
 		return;
 
-	int pos = demoStream.tellp();
+	const int pos = stats.size();
 
 	for (std::vector< PlayerStatistics >::iterator it = playerStats.begin(); it != playerStats.end(); ++it) {
-		PlayerStatistics& stats = *it;
-		stats.swab();
-		demoStream.write(reinterpret_cast<char*>(&stats), sizeof(PlayerStatistics));
+		PlayerStatistics& playerStat = *it;
+		playerStat.swab();
+		stats.insert(stats.end(), reinterpret_cast<char*>(&playerStat), reinterpret_cast<char*>(&playerStat) + sizeof(PlayerStatistics));
 	}
 	playerStats.clear();
 
-	fileHeader.playerStatSize = (int)demoStream.tellp() - pos;
+	fileHeader.playerStatSize = int(stats.size()) - pos;
 }
 
 
 
-/** @brief Write the winningAllyTeams at the current position in the file. */
-void CDemoRecorder::WriteWinnerList()
+/** @brief Append the winningAllyTeams to <stats>. */
+void CDemoRecorder::WriteWinnerList(std::vector<char>& stats)
 {
 	if (fileHeader.numTeams == 0)
 		return;
 
-	const int pos = demoStream.tellp();
+	const int pos = stats.size();
 
 	// Write the array of winningAllyTeams.
-	for (std::vector<unsigned char>::const_iterator it = winningAllyTeams.begin(); it != winningAllyTeams.end(); ++it) {
-		demoStream.write((char*) &(*it), sizeof(unsigned char));
-	}
+	stats.insert(stats.end(), winningAllyTeams.begin(), winningAllyTeams.end());
 
 	winningAllyTeams.clear();
 
-	fileHeader.winningAllyTeamsSize = int(demoStream.tellp()) - pos;
+	fileHeader.winningAllyTeamsSize = int(stats.size()) - pos;
+}
+
+/** @brief Append the seek index (see DemoSeekIndexHeader) to <data>. */
+void CDemoRecorder::WriteSeekIndex(std::vector<char>& data)
+{
+	DemoSeekIndexHeader indexHeader;
+	indexHeader.numEntries = seekIndex.size();
+	indexHeader.entrySize = sizeof(DemoSeekIndexEntry);
+	indexHeader.swab();
+
+	data.insert(data.end(), reinterpret_cast<char*>(&indexHeader), reinterpret_cast<char*>(&indexHeader) + sizeof(indexHeader));
+
+	for (DemoSeekIndexEntry& entry: seekIndex) {
+		entry.swab();
+		data.insert(data.end(), reinterpret_cast<char*>(&entry), reinterpret_cast<char*>(&entry) + sizeof(entry));
+	}
+
+	seekIndex.clear();
 }
 
-/** @brief Write the TeamStatistics at the current position in the file. */
-void CDemoRecorder::WriteTeamStats()
+/** @brief Append the TeamStatistics to <stats>. */
+void CDemoRecorder::WriteTeamStats(std::vector<char>& stats)
 {
 	if (fileHeader.numTeams == 0)
 		return;
 
-	int pos = demoStream.tellp();
+	const int pos = stats.size();
 
 	// Write array of dwords indicating number of TeamStatistics per team.
 	for (std::vector< std::vector< TeamStatistics > >::iterator it = teamStats.begin(); it != teamStats.end(); ++it) {
 		unsigned int c = swabDWord(it->size());
-		demoStream.write((char*)&c, sizeof(unsigned int));
+		stats.insert(stats.end(), reinterpret_cast<char*>(&c), reinterpret_cast<char*>(&c) + sizeof(unsigned int));
 	}
 
 	// Write big array of TeamStatistics.
 	for (std::vector< std::vector< TeamStatistics > >::iterator it = teamStats.begin(); it != teamStats.end(); ++it) {
 		for (std::vector< TeamStatistics >::iterator it2 = it->begin(); it2 != it->end(); ++it2) {
-			TeamStatistics& stats = *it2;
-			stats.swab();
-			demoStream.write(reinterpret_cast<char*>(&stats), sizeof(TeamStatistics));
+			TeamStatistics& teamStat = *it2;
+			teamStat.swab();
+			stats.insert(stats.end(), reinterpret_cast<char*>(&teamStat), reinterpret_cast<char*>(&teamStat) + sizeof(TeamStatistics));
 		}
 	}
 	teamStats.clear();
 
-	fileHeader.teamStatSize = (int)demoStream.tellp() - pos;
+	fileHeader.teamStatSize = int(stats.size()) - pos;
 }
@@ -4,16 +4,28 @@
 #define DEMO_RECORDER
 
 #include <vector>
+#include <deque>
 #include <fstream>
-#include <sstream>
 #include <list>
 
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
 #include "Demo.h"
 #include "Game/Players/PlayerStatistics.h"
 #include "Sim/Misc/TeamStatistics.h"
 
+namespace boost {
+	class thread;
+}
+
 /**
  * @brief Used to record demos
+ *
+ * The demo stream is collected in blocks which a background thread
+ * compresses and appends to the file while the game runs, the statistics,
+ * the seek index and the final header are written when the recorder is
+ * destroyed.
  */
 class CDemoRecorder : public CDemo
 {
@@ -38,17 +50,57 @@ public:
 	void SetTeamStats(int teamNum, const std::list< TeamStatistics >& stats);
 	void SetWinningAllyTeams(const std::vector<unsigned char>& winningAllyTeams);
 
+	/// uncompressed size of the blocks handed to the writer thread
+	static const unsigned int blockSize = 64 * 1024;
+	/// blocks are handed over after this much game time even when not full
+	static const float blockMaxGameTime;
+
 private:
-	unsigned int WriteFileHeader(bool updateStreamLength);
+	struct WriteJob {
+		enum Type {
+			APPEND,          ///< write data at the end of the file
+			APPEND_BLOCK,    ///< compress data and write it at the end as a stream block
+			REPLACE_HEADER,  ///< write data (a DemoFileHeader) at the start of the file
+		};
+
+		Type type;
+		std::vector<char> data;
+		/// APPEND_BLOCK only, streamOffset is set by the writer
+		DemoSeekIndexEntry indexEntry;
+	};
+
+	void QueueJob(WriteJob::Type type, std::vector<char>& data, const DemoSeekIndexEntry& indexEntry = DemoSeekIndexEntry());
+	void QueueBlock();
+
+	void WriterLoop();
+	void Write(WriteJob& job);
+
+	void QueueFileHeader();
 	void SetFileHeader();
-	void WritePlayerStats();
-	void WriteTeamStats();
-	void WriteWinnerList();
-	void WriteDemoFile();
+	void WritePlayerStats(std::vector<char>& stats);
+	void WriteTeamStats(std::vector<char>& stats);
+	void WriteWinnerList(std::vector<char>& stats);
+	void WriteSeekIndex(std::vector<char>& data);
 
 private:
 	std::ofstream file;
-	std::stringstream demoStream;
+
+	/// demo stream not yet handed to the writer
+	std::vector<char> block;
+	DemoSeekIndexEntry blockIndexEntry;
+	/// sim frames recorded so far
+	int streamFrameNum;
+
+	boost::thread* writerThread;
+	boost::mutex writerMutex;
+	boost::condition_variable writerCond;
+	std::deque<WriteJob> writerJobs;
+	bool writerQuit;
+
+	/// only touched by the writer thread while it runs
+	int demoStreamSize;
+	std::vector<DemoSeekIndexEntry> seekIndex;
+
 	std::vector<PlayerStatistics> playerStats;
 	std::vector< std::vector<TeamStatistics> > teamStats;
 	std::vector<unsigned char> winningAllyTeams;
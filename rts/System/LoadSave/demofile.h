@@ -21,7 +21,13 @@
  * The current demofile version. Only change on major modifications for which
  * appending stuff to DemoFileHeader is not sufficient.
  */
-#define DEMOFILE_VERSION 5
+#define DEMOFILE_VERSION 6
+
+/**
+ * The last version with an uncompressed demo stream, which CDemoReader still
+ * reads.
+ */
+#define DEMOFILE_VERSION_UNCOMPRESSED 5
 
 #pragma pack(push, 1)
 
@@ -33,13 +39,17 @@
  * - DemoFileHeader
  *   - Data chunks:
  *     - Startscript (scriptSize)
- *     - Demo stream (demoStreamSize)
+ *     - Demo stream (demoStreamSize), a sequence of DemoStreamBlockHeader's
+ *       each followed by a zlib-compressed block of the stream (version 5
+ *       stores the stream uncompressed, without block headers)
  *     - Player statistics, one PlayerStatistic for each player
  *     - Team statistics, consisting of:
  *       - Array of numTeams dwords indicating the number of
  *         CTeam::Statistics for each team.
  *       - Array of all CTeam::Statistics (total number of items is the
  *         sum of the elements in the array of dwords).
+ *     - Seek index (not in version 5 demos), a DemoSeekIndexHeader followed
+ *       by numEntries DemoSeekIndexEntry's
  *
  * The header is designed to be extensible: it contains a version field and a
  * headerSize field to support this. The version field is a major version number
@@ -48,7 +58,9 @@
  * minor version number, which happens to be equal to sizeof(DemoFileHeader).
  *
  * If Spring did not cleanup properly (crashed), the demoStreamSize is 0 and it
- * can be assumed the demo stream continues until the end of the file.
+ * can be assumed the demo stream continues until the end of the file (the
+ * blocks are written while the game runs, a crash loses at most the last few
+ * seconds).
  */
 struct DemoFileHeader
 {
@@ -115,6 +127,57 @@ struct DemoStreamChunkHeader
 	}
 };
 
+/**
+ * @brief Spring demo stream block header
+ *
+ * Precedes each compressed block of the demo stream (see DemoFileHeader),
+ * the uncompressed blocks joined together form the chunk stream described
+ * above. Every block starts with a DemoStreamChunkHeader, so reading can
+ * begin at any block.
+ */
+struct DemoStreamBlockHeader
+{
+	boost::uint32_t compressedSize; ///< Length of the compressed data following this header.
+	boost::uint32_t rawSize;        ///< Length of the block when uncompressed.
+
+	/// Change structure from host endian to little endian or vice versa.
+	void swab() {
+		swabDWordInPlace(compressedSize);
+		swabDWordInPlace(rawSize);
+	}
+};
+
+/**
+ * @brief Spring demo seek index header
+ *
+ * The seek index has one entry per block of the demo stream, in stream order.
+ */
+struct DemoSeekIndexHeader
+{
+	int numEntries; ///< Number of DemoSeekIndexEntry's following this header.
+	int entrySize;  ///< sizeof(DemoSeekIndexEntry)
+
+	/// Change structure from host endian to little endian or vice versa.
+	void swab() {
+		swabDWordInPlace(numEntries);
+		swabDWordInPlace(entrySize);
+	}
+};
+
+struct DemoSeekIndexEntry
+{
+	int frameNum;                 ///< Number of sim frames in the stream before this block.
+	float modGameTime;            ///< modGameTime of the block's first chunk.
+	boost::uint32_t streamOffset; ///< Offset of the block's DemoStreamBlockHeader, relative to the start of the demo stream.
+
+	/// Change structure from host endian to little endian or vice versa.
+	void swab() {
+		swabDWordInPlace(frameNum);
+		swabFloatInPlace(modGameTime);
+		swabDWordInPlace(streamOffset);
+	}
+};
+
 #pragma pack(pop)
 
 #endif // DEMO_FILE_H
@@ -0,0 +1,351 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "FrameBundle.h"
+
+#include <cstring>
+
+#include "ProtocolDef.h"
+#include "RawPacket.h"
+#include "Net/Protocol/BaseNetProtocol.h"
+
+namespace netcode
+{
+
+/// uchar id, ushort size
+static const unsigned bundleHeaderSize = 3;
+/// upper bound of what a NEWFRAME run adds to a bundle
+static const unsigned maxRunSize = 6;
+
+
+static void PutVarInt(std::vector<boost::uint8_t>& buf, boost::uint32_t v)
+{
+	while (v >= 0x80) {
+		buf.push_back((v & 0x7F) | 0x80);
+		v >>= 7;
+	}
+	buf.push_back(v);
+}
+
+static void PutBytes(std::vector<boost::uint8_t>& buf, const unsigned char* data, const unsigned size)
+{
+	buf.insert(buf.end(), data, data + size);
+}
+
+static boost::uint32_t ZigZag(const boost::int32_t v) { return ((boost::uint32_t(v) << 1) ^ boost::uint32_t(v >> 31)); }
+static boost::int32_t UnZigZag(const boost::uint32_t v) { return boost::int32_t((v >> 1) ^ (~(v & 1) + 1)); }
+
+
+
+const unsigned FrameBundleWriter::maxBundleSize;
+const unsigned FrameBundleWriter::maxNewFrameRun;
+
+FrameBundleWriter::FrameBundleWriter()
+	: messagesSize(0)
+	, numNewFrames(0)
+	, lastFrame(0)
+	, numRawBytes(0)
+	, numFlushedBytes(0)
+{
+}
+
+void FrameBundleWriter::Add(boost::shared_ptr<const RawPacket> msg)
+{
+	const ProtocolDef* proto = ProtocolDef::GetInstance();
+
+	numRawBytes += msg->length;
+
+	const unsigned char id = (msg->length > 0)? msg->data[0]: 0;
+	const int typeLength = proto->GetTypeLength(id);
+
+	const bool canBundle =
+		(typeLength != 0) &&
+		(id != NETMSG_FRAMEBUNDLE) &&
+		(proto->PacketLength(msg->data, msg->length) == int(msg->length)) &&
+		(msg->length <= (maxBundleSize / 2));
+
+	if (!canBundle) {
+		CloseBundle();
+		ready.push_back(msg);
+		return;
+	}
+
+	if (id == NETMSG_NEWFRAME) {
+		if (numNewFrames == maxNewFrameRun) {
+			if ((bundleHeaderSize + entries.size() + maxRunSize * 2) > maxBundleSize)
+				CloseBundle();
+
+			WriteNewFrames();
+		}
+
+		messages.push_back(msg);
+		messagesSize += msg->length;
+		numNewFrames += 1;
+		return;
+	}
+
+	// no entry is more than 2 bytes larger than its message
+	if ((bundleHeaderSize + entries.size() + maxRunSize + msg->length + 2) > maxBundleSize)
+		CloseBundle();
+
+	WriteNewFrames();
+
+	entries.push_back(id);
+
+	switch (id) {
+		case NETMSG_KEYFRAME: {
+			boost::int32_t frame;
+			std::memcpy(&frame, msg->data + 1, sizeof(frame));
+			PutVarInt(entries, ZigZag(frame - lastFrame));
+			lastFrame = frame;
+		} break;
+		case NETMSG_SYNCRESPONSE: {
+			// uchar player, int frame, uint checksum
+			boost::int32_t frame;
+			std::memcpy(&frame, msg->data + 2, sizeof(frame));
+			PutBytes(entries, msg->data + 1, 1);
+			PutVarInt(entries, ZigZag(frame - lastFrame));
+			PutBytes(entries, msg->data + 6, 4);
+		} break;
+		case NETMSG_PLAYERINFO: {
+			// uchar player, float cpuUsage, int ping
+			boost::int32_t ping;
+			std::memcpy(&ping, msg->data + 6, sizeof(ping));
+			PutBytes(entries, msg->data + 1, 5);
+			PutVarInt(entries, ZigZag(ping));
+		} break;
+		default: {
+			if (typeLength > 0) {
+				PutBytes(entries, msg->data + 1, msg->length - 1);
+			} else {
+				const unsigned prefixSize = -typeLength;
+				PutVarInt(entries, msg->length);
+				PutBytes(entries, msg->data + 1 + prefixSize, msg->length - 1 - prefixSize);
+			}
+		} break;
+	}
+
+	messages.push_back(msg);
+	messagesSize += msg->length;
+}
+
+void FrameBundleWriter::Flush(std::vector< boost::shared_ptr<const RawPacket> >& out)
+{
+	CloseBundle();
+
+	for (auto it = ready.begin(); it != ready.end(); ++it) {
+		numFlushedBytes += (*it)->length;
+		out.push_back(*it);
+	}
+
+	ready.clear();
+}
+
+void FrameBundleWriter::CloseBundle()
+{
+	if (messages.empty())
+		return;
+
+	WriteNewFrames();
+
+	const unsigned bundleSize = bundleHeaderSize + entries.size();
+
+	if (messages.size() > 1 && bundleSize < messagesSize) {
+		RawPacket* bundle = new RawPacket(bundleSize);
+		const boost::uint16_t size = bundleSize;
+
+		bundle->data[0] = NETMSG_FRAMEBUNDLE;
+		std::memcpy(bundle->data + 1, &size, sizeof(size));
+		std::memcpy(bundle->data + bundleHeaderSize, &entries[0], entries.size());
+
+		ready.push_back(boost::shared_ptr<const RawPacket>(bundle));
+	} else {
+		ready.insert(ready.end(), messages.begin(), messages.end());
+	}
+
+	messages.clear();
+	entries.clear();
+	messagesSize = 0;
+	lastFrame = 0;
+}
+
+void FrameBundleWriter::WriteNewFrames()
+{
+	if (numNewFrames == 0)
+		return;
+
+	entries.push_back(NETMSG_NEWFRAME);
+	PutVarInt(entries, numNewFrames);
+	numNewFrames = 0;
+}
+
+
+
+FrameBundleReader::FrameBundleReader(const unsigned char* _data, const unsigned _length)
+	: data(_data)
+	, length(_length)
+	, pos(bundleHeaderSize)
+	, numNewFrames(0)
+	, lastFrame(0)
+	, failed(false)
+{
+	failed = (length < bundleHeaderSize || length > FrameBundleWriter::maxBundleSize || data[0] != NETMSG_FRAMEBUNDLE);
+}
+
+bool FrameBundleReader::Next(boost::shared_ptr<const RawPacket>& msg)
+{
+	if (numNewFrames > 0) {
+		numNewFrames -= 1;
+		msg = newFrame;
+		return true;
+	}
+
+	if (failed || pos >= length)
+		return false;
+
+	const unsigned char id = data[pos++];
+	RawPacket* pkt = NULL;
+
+	switch (id) {
+		case NETMSG_NEWFRAME: {
+			boost::uint32_t count;
+
+			// bounds what a single entry can expand to
+			if (!ReadVarInt(count) || count == 0 || count > FrameBundleWriter::maxNewFrameRun)
+				break;
+
+			if (!newFrame)
+				newFrame.reset(new RawPacket(&id, 1));
+
+			numNewFrames = count - 1;
+			msg = newFrame;
+			return true;
+		} break;
+		case NETMSG_KEYFRAME: {
+			boost::int32_t frame;
+
+			if (!ReadFrame(frame))
+				break;
+
+			lastFrame = frame;
+			pkt = new RawPacket(5);
+			pkt->data[0] = id;
+			std::memcpy(pkt->data + 1, &frame, sizeof(frame));
+		} break;
+		case NETMSG_SYNCRESPONSE: {
+			unsigned char player;
+			boost::int32_t frame;
+			boost::uint32_t checksum;
+
+			if (!Read(&player, 1) || !ReadFrame(frame) || !Read(&checksum, 4))
+				break;
+
+			pkt = new RawPacket(10);
+			pkt->data[0] = id;
+			pkt->data[1] = player;
+			std::memcpy(pkt->data + 2, &frame, sizeof(frame));
+			std::memcpy(pkt->data + 6, &checksum, sizeof(checksum));
+		} break;
+		case NETMSG_PLAYERINFO: {
+			unsigned char playerAndCpu[5];
+			boost::uint32_t ping;
+
+			if (!Read(playerAndCpu, 5) || !ReadVarInt(ping))
+				break;
+
+			const boost::int32_t realPing = UnZigZag(ping);
+
+			pkt = new RawPacket(10);
+			pkt->data[0] = id;
+			std::memcpy(pkt->data + 1, playerAndCpu, 5);
+			std::memcpy(pkt->data + 6, &realPing, sizeof(realPing));
+		} break;
+		default: {
+			const int typeLength = ProtocolDef::GetInstance()->GetTypeLength(id);
+
+			if (id == NETMSG_FRAMEBUNDLE)
+				break;
+
+			if (typeLength > 0) {
+				if ((pos + typeLength - 1) > length)
+					break;
+
+				pkt = new RawPacket(data + pos - 1, typeLength);
+				pos += (typeLength - 1);
+				break;
+			}
+
+			if (typeLength != -1 && typeLength != -2)
+				break;
+
+			const unsigned prefixSize = -typeLength;
+			boost::uint32_t msgLength;
+
+			if (!ReadVarInt(msgLength))
+				break;
+			if (msgLength < (1 + prefixSize) || msgLength >= (1u << (8 * prefixSize)))
+				break;
+			if ((pos + msgLength - 1 - prefixSize) > length)
+				break;
+
+			pkt = new RawPacket(msgLength);
+			pkt->data[0] = id;
+
+			if (prefixSize == 1) {
+				pkt->data[1] = msgLength;
+			} else {
+				const boost::uint16_t size = msgLength;
+				std::memcpy(pkt->data + 1, &size, sizeof(size));
+			}
+
+			std::memcpy(pkt->data + 1 + prefixSize, data + pos, msgLength - 1 - prefixSize);
+			pos += (msgLength - 1 - prefixSize);
+		} break;
+	}
+
+	if (pkt == NULL) {
+		failed = true;
+		return false;
+	}
+
+	msg.reset(pkt);
+	return true;
+}
+
+bool FrameBundleReader::Read(void* dst, const unsigned size)
+{
+	if ((pos + size) > length)
+		return false;
+
+	std::memcpy(dst, data + pos, size);
+	pos += size;
+	return true;
+}
+
+bool FrameBundleReader::ReadVarInt(boost::uint32_t& v)
+{
+	v = 0;
+
+	for (unsigned shift = 0; shift < 35 && pos < length; shift += 7) {
+		const boost::uint8_t b = data[pos++];
+
+		v |= (boost::uint32_t(b & 0x7F) << shift);
+
+		if ((b & 0x80) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+bool FrameBundleReader::ReadFrame(boost::int32_t& frame)
+{
+	boost::uint32_t delta;
+
+	if (!ReadVarInt(delta))
+		return false;
+
+	frame = lastFrame + UnZigZag(delta);
+	return true;
+}
+
+} // namespace netcode
@@ -0,0 +1,107 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _FRAME_BUNDLE_H
+#define _FRAME_BUNDLE_H
+
+#include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
+#include <vector>
+
+namespace netcode
+{
+class RawPacket;
+
+/**
+ * NETMSG_FRAMEBUNDLE layout: uchar id, ushort size, then one entry per
+ * message (integers are little-endian base-128 varints, frame numbers and
+ * pings are zigzag-encoded):
+ *
+ *   NETMSG_NEWFRAME     count                       run of <count> NEWFRAMEs (at most maxNewFrameRun)
+ *   NETMSG_KEYFRAME     frame - lastFrame
+ *   NETMSG_SYNCRESPONSE player, frame - lastFrame, uint checksum
+ *   NETMSG_PLAYERINFO   player, float cpuUsage, ping
+ *   variable length     id, length, payload         length as in the original
+ *   fixed length        the original message
+ *
+ * lastFrame starts at 0 in each bundle and is set by every KEYFRAME entry.
+ */
+class FrameBundleWriter
+{
+public:
+	/// bundles are closed before they grow beyond this
+	static const unsigned maxBundleSize = 4096;
+	/// longer NEWFRAME runs are split, readers reject them
+	static const unsigned maxNewFrameRun = 256;
+
+	FrameBundleWriter();
+
+	void Add(boost::shared_ptr<const RawPacket> msg);
+
+	/**
+	 * @brief hand out everything added since the last call, in order
+	 * Messages are passed as bundles, or unchanged where a bundle would not
+	 * be smaller than its content (or the message can not be bundled).
+	 */
+	void Flush(std::vector< boost::shared_ptr<const RawPacket> >& out);
+
+	bool Empty() const { return (messages.empty() && ready.empty()); }
+
+	/// bytes of all messages added so far
+	size_t GetNumRawBytes() const { return numRawBytes; }
+	/// bytes of all packets handed out so far
+	size_t GetNumFlushedBytes() const { return numFlushedBytes; }
+
+private:
+	void CloseBundle();
+	void WriteNewFrames();
+
+private:
+	/// content of the open bundle, sent as is if bundling does not pay off
+	std::vector< boost::shared_ptr<const RawPacket> > messages;
+	/// entries of the open bundle
+	std::vector<boost::uint8_t> entries;
+	unsigned messagesSize;
+	unsigned numNewFrames;
+	int lastFrame;
+
+	std::vector< boost::shared_ptr<const RawPacket> > ready;
+
+	size_t numRawBytes;
+	size_t numFlushedBytes;
+};
+
+
+/**
+ * @brief restores the messages of a NETMSG_FRAMEBUNDLE
+ */
+class FrameBundleReader
+{
+public:
+	/// bundles larger than FrameBundleWriter::maxBundleSize are rejected
+	FrameBundleReader(const unsigned char* data, const unsigned length);
+
+	/// @return false at the end of the bundle or when it is malformed (see Failed)
+	bool Next(boost::shared_ptr<const RawPacket>& msg);
+	bool Failed() const { return failed; }
+
+private:
+	bool Read(void* dst, const unsigned size);
+	bool ReadVarInt(boost::uint32_t& v);
+	bool ReadFrame(boost::int32_t& frame);
+
+private:
+	const unsigned char* data;
+	const unsigned length;
+	unsigned pos;
+
+	unsigned numNewFrames;
+	int lastFrame;
+	bool failed;
+
+	/// NEWFRAME runs all share this one
+	boost::shared_ptr<const RawPacket> newFrame;
+};
+
+} // namespace netcode
+
+#endif // _FRAME_BUNDLE_H
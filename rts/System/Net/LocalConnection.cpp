@@ -13,8 +13,10 @@ namespace netcode {
 // static stuff
 unsigned CLocalConnection::instances = 0;
 
-std::deque< boost::shared_ptr<const RawPacket> > CLocalConnection::pqueues[2];
-boost::mutex CLocalConnection::mutexes[2];
+spring::SPSCQueue< boost::shared_ptr<const RawPacket> > CLocalConnection::pqueues[2] = {{queueSize}, {queueSize}};
+std::deque< boost::shared_ptr<const RawPacket> > CLocalConnection::overflows[2];
+boost::mutex CLocalConnection::overflowMutexes[2];
+std::atomic<bool> CLocalConnection::overflowing[2] = {{false}, {false}};
 
 CLocalConnection::CLocalConnection()
 {
@@ -26,7 +28,12 @@ CLocalConnection::CLocalConnection()
 	instances++;
 
 	// clear data that might have been left over (if we reloaded)
-	pqueues[instance].clear();
+	pqueues[instance].Clear();
+	{
+		boost::mutex::scoped_lock lck(overflowMutexes[instance]);
+		overflows[instance].clear();
+		overflowing[instance] = false;
+	}
 
 	// make sure protocoldef is initialized
 	CBaseNetProtocol::Get();
@@ -40,8 +47,7 @@ CLocalConnection::~CLocalConnection()
 void CLocalConnection::Close(bool flush)
 {
 	if (flush) {
-		boost::mutex::scoped_lock scoped_lock(mutexes[instance]);
-		pqueues[instance].clear();
+		pqueues[instance].Clear();
 	}
 }
 
@@ -57,32 +63,86 @@ void CLocalConnection::SendData(boost::shared_ptr<const RawPacket> packet)
 
 	dataSent += packet->length;
 
-	// when sending from A to B we must lock B's queue
-	boost::mutex::scoped_lock scoped_lock(mutexes[OtherInstance()]);
-	pqueues[OtherInstance()].push_back(packet);
+	const unsigned int other = OtherInstance();
+
+	// the receiver picks packets up on its next pass, there is no wakeup:
+	// the server waits on its sockets and passes at least once per frame
+	// interval anyway, and waking it for each local packet (including those
+	// it sends to the local client itself) would mostly be spurious
+	//
+	// when sending from A to B we are the only producer of B's queue
+	// unless it overflowed, then B takes part in moving the overflow
+	if (!overflowing[other].load(std::memory_order_acquire)) {
+		if (!pqueues[other].TryPush(packet)) {
+			boost::mutex::scoped_lock lck(overflowMutexes[other]);
+			overflows[other].push_back(packet);
+			overflowing[other].store(true, std::memory_order_release);
+		}
+	} else {
+		boost::mutex::scoped_lock lck(overflowMutexes[other]);
+
+		// packets must not overtake those still waiting in the overflow
+		overflows[other].push_back(packet);
+		FlushOverflow(other);
+	}
+}
+
+void CLocalConnection::Flush(const bool forced)
+{
+	const unsigned int other = OtherInstance();
+
+	if (!overflowing[other].load(std::memory_order_acquire))
+		return;
+
+	boost::mutex::scoped_lock lck(overflowMutexes[other]);
+	FlushOverflow(other);
+}
+
+void CLocalConnection::FlushOverflow(unsigned int n)
+{
+	std::deque< boost::shared_ptr<const RawPacket> >& overflow = overflows[n];
+	spring::SPSCQueue< boost::shared_ptr<const RawPacket> >& pqueue = pqueues[n];
+
+	while (!overflow.empty() && pqueue.TryPush(overflow.front())) {
+		overflow.pop_front();
+	}
+
+	overflowing[n].store(!overflow.empty(), std::memory_order_release);
+}
+
+void CLocalConnection::DrainOverflow() const
+{
+	// the sender may not send again for a while, so do not leave
+	// the rest of a large burst to it
+	if (!overflowing[instance].load(std::memory_order_acquire))
+		return;
+
+	boost::mutex::scoped_lock lck(overflowMutexes[instance]);
+	FlushOverflow(instance);
 }
 
 boost::shared_ptr<const RawPacket> CLocalConnection::GetData()
 {
-	boost::mutex::scoped_lock scoped_lock(mutexes[instance]);
+	boost::shared_ptr<const RawPacket> next;
+
+	if (pqueues[instance].Empty())
+		DrainOverflow();
 
-	if (!pqueues[instance].empty()) {
-		boost::shared_ptr<const RawPacket> next = pqueues[instance].front();
-		pqueues[instance].pop_front();
+	if (pqueues[instance].Pop(next))
 		dataRecv += next->length;
-		return next;
-	}
 
-	boost::shared_ptr<const RawPacket> empty;
-	return empty;
+	return next;
 }
 
 boost::shared_ptr<const RawPacket> CLocalConnection::Peek(unsigned ahead) const
 {
-	boost::mutex::scoped_lock scoped_lock(mutexes[instance]);
+	if (ahead >= pqueues[instance].SizeApprox())
+		DrainOverflow();
 
-	if (ahead < pqueues[instance].size())
-		return pqueues[instance][ahead];
+	const boost::shared_ptr<const RawPacket>* packet = pqueues[instance].Peek(ahead);
+
+	if (packet != NULL)
+		return *packet;
 
 	boost::shared_ptr<const RawPacket> empty;
 	return empty;
@@ -90,12 +150,7 @@ boost::shared_ptr<const RawPacket> CLocalConnection::Peek(unsigned ahead) const
 
 void CLocalConnection::DeleteBufferPacketAt(unsigned index)
 {
-	boost::mutex::scoped_lock scoped_lock(mutexes[instance]);
-
-	if (index >= pqueues[instance].size())
-		return;
-
-	pqueues[instance].erase(pqueues[instance].begin() + index);
+	pqueues[instance].Erase(index);
 }
 
 
@@ -115,14 +170,16 @@ std::string CLocalConnection::GetFullAddress() const
 
 bool CLocalConnection::HasIncomingData() const
 {
-	boost::mutex::scoped_lock scoped_lock(mutexes[instance]);
-	return (!pqueues[instance].empty());
+	if (pqueues[instance].Empty())
+		DrainOverflow();
+
+	return (!pqueues[instance].Empty());
 }
 
 unsigned int CLocalConnection::GetPacketQueueSize() const
 {
-	boost::mutex::scoped_lock scoped_lock(mutexes[instance]);
-	return (!pqueues[instance].size());
+	DrainOverflow();
+	return (pqueues[instance].SizeApprox());
 }
 
 } // namespace netcode
@@ -3,10 +3,12 @@
 #ifndef _LOCAL_CONNECTION_H
 #define _LOCAL_CONNECTION_H
 
-#include <boost/thread/mutex.hpp>
+#include <atomic>
 #include <deque>
+#include <boost/thread/mutex.hpp>
 
 #include "Connection.h"
+#include "System/Threading/SPSCQueue.h"
 
 namespace netcode {
 
@@ -17,6 +19,12 @@ namespace netcode {
  * of spring for this to work.
  * Otherwise, a normal UDP connection had to be used.
  * IMPORTANT: You must not have more than two instances of this.
+ *
+ * Each direction is a lock-free single-producer single-consumer queue, so
+ * (like before) each instance must only be used by one thread at a time.
+ * Packets that do not fit are kept in a locked overflow, which is moved
+ * into the queue by whichever side touches it next; while it is non-empty
+ * all pushes to that queue happen under its lock.
  */
 class CLocalConnection : public CConnection
 {
@@ -35,7 +43,7 @@ public:
 	boost::shared_ptr<const RawPacket> Peek(unsigned ahead) const;
 	boost::shared_ptr<const RawPacket> GetData();
 	void DeleteBufferPacketAt(unsigned index);
-	void Flush(const bool forced) {}
+	void Flush(const bool forced);
 	bool CheckTimeout(int seconds, bool initial) const { return false; }
 
 	void ReconnectTo(CConnection& conn) {}
@@ -53,8 +61,20 @@ public:
 	// END overriding CConnection
 
 private:
-	static std::deque< boost::shared_ptr<const RawPacket> > pqueues[2];
-	static boost::mutex mutexes[2];
+	static const unsigned int queueSize = 16384;
+
+	/// packets sent to each instance
+	static spring::SPSCQueue< boost::shared_ptr<const RawPacket> > pqueues[2];
+	/// packets that did not fit into pqueues yet, guarded by overflowMutexes
+	static std::deque< boost::shared_ptr<const RawPacket> > overflows[2];
+	static boost::mutex overflowMutexes[2];
+	/// set while overflows[n] is non-empty, clear means the sender may push to pqueues[n] without locking
+	static std::atomic<bool> overflowing[2];
+
+	/// move what fits from overflows[n] to pqueues[n], must hold overflowMutexes[n]
+	static void FlushOverflow(unsigned int n);
+	/// receiver side: pick up packets the sender could not place
+	void DrainOverflow() const;
 
 	unsigned int OtherInstance() const { return ((instance + 1) % 2); }
 
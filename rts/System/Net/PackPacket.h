@@ -49,6 +49,17 @@ public:
 		return *this;
 	}
 
+	template <typename element>
+	PackPacket& WriteArray(const element* elems, size_t count) {
+		const size_t size = count * sizeof(element);
+		assert((size + pos) <= length);
+		if (size > 0) {
+			std::memcpy((data+pos), (const void*)elems, size);
+			pos += size;
+		}
+		return *this;
+	}
+
 #ifdef USE_SAFE_VECTOR
 	template <typename element>
 	PackPacket& operator<<(const safe_vector<element>& vec) {
@@ -11,6 +11,8 @@ public:
 	static ProtocolDef* GetInstance();
 
 	void AddType(const unsigned char id, const int msgLength);
+	/// the msgLength <id> was added with, 0 for unknown ids
+	int GetTypeLength(const unsigned char id) const { return msg[id].length; }
 
 	/**
 	 * @return <  -1: invalid id
@@ -3,6 +3,10 @@
 #include "Socket.h"
 
 #include <boost/system/error_code.hpp>
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/make_shared.hpp>
+#include <algorithm>
+#include <atomic>
 #include "lib/streflop/streflop_cond.h"
 
 #include "System/Log/ILog.h"
@@ -14,6 +18,9 @@ namespace netcode
 using namespace boost::system::errc;
 
 boost::asio::io_service netservice;
+boost::asio::io_service serverservice;
+
+static std::atomic<bool> wakeupPending(false);
 
 bool CheckErrorCode(boost::system::error_code& err)
 {
@@ -109,5 +116,55 @@ boost::asio::ip::address GetAnyAddress(const bool IPv6)
 }
 
 
+
+bool WaitForNetEvents(boost::asio::ip::udp::socket* socket, spring_time maxWait)
+{
+	struct WaitState {
+		WaitState(): dataReady(false), timedOut(false) {}
+		bool dataReady;
+		bool timedOut;
+	};
+
+	// handlers can outlive this call (they are only run by the next poll
+	// after being cancelled), so they must not reference the stack
+	boost::shared_ptr<WaitState> state = boost::make_shared<WaitState>();
+	boost::asio::deadline_timer timer(serverservice, boost::posix_time::microseconds(std::max(maxWait.toMicroSecsi(), boost::int64_t(0))));
+
+	timer.async_wait([state](const boost::system::error_code& err) { state->timedOut |= !err; });
+
+	if (socket != NULL) {
+		// zero-byte read, completes as soon as a datagram is queued
+		socket->async_receive(boost::asio::null_buffers(), [state](const boost::system::error_code& err, size_t) { state->dataReady |= !err; });
+	}
+
+	// poll() leaves the service stopped when it runs out of work
+	serverservice.reset();
+
+	while (!wakeupPending.exchange(false)) {
+		if (state->dataReady || state->timedOut)
+			break;
+		if (serverservice.run_one() == 0)
+			break;
+	}
+
+	boost::system::error_code err;
+
+	if (socket != NULL)
+		socket->cancel(err);
+
+	timer.cancel(err);
+	serverservice.poll();
+
+	return (state->dataReady || (socket != NULL && socket->available(err) > 0));
+}
+
+void WakeupNetService()
+{
+	wakeupPending = true;
+
+	// interrupt a blocking run_one()
+	serverservice.post([]() {});
+}
+
 } // namespace netcode
 
@@ -8,11 +8,19 @@
 #include <boost/asio/ip/udp.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
+#include "System/Misc/SpringTime.h"
+
 
 namespace netcode
 {
 
 extern boost::asio::io_service netservice;
+/**
+ * Runs the sockets of the server (see UDPListener::TryBindSocket) and
+ * WaitForNetEvents; only the server thread runs it, while clients in the
+ * same process keep polling netservice from theirs.
+ */
+extern boost::asio::io_service serverservice;
 
 /**
  * Check if a network error occured and eventually log it.
@@ -52,6 +60,21 @@ boost::asio::ip::udp::resolver::iterator WrapResolve(
 
 boost::asio::ip::address GetAnyAddress(const bool IPv6);
 
+/**
+ * Runs serverservice until <socket> (may be NULL, otherwise it has to
+ * belong to serverservice) has data to be read,
+ * WakeupNetService() gets called or <maxWait> has passed, whichever comes
+ * first. Replaces polling the sockets in a sleep-loop.
+ * @return true if data is waiting to be read from <socket>
+ */
+bool WaitForNetEvents(boost::asio::ip::udp::socket* socket, spring_time maxWait);
+
+/**
+ * Makes the current (or, if none is running, the next) WaitForNetEvents
+ * call return immediately. Can be called from any thread.
+ */
+void WakeupNetService();
+
 } // namespace netcode
 
 #endif // SOCKET_H
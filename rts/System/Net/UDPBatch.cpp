@@ -0,0 +1,235 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "UDPBatch.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#if defined(__linux__)
+	#include <sys/socket.h>
+	#include <sys/uio.h>
+	#define UDP_BATCH_SYSCALLS 1
+#else
+	#define UDP_BATCH_SYSCALLS 0
+#endif
+
+#include "Socket.h"
+#include "System/Log/ILog.h"
+
+
+namespace netcode
+{
+using namespace boost::asio;
+
+static bool batchedIO = (UDP_BATCH_SYSCALLS != 0);
+
+void EnableBatchedIO(bool enable) { batchedIO = enable && (UDP_BATCH_SYSCALLS != 0); }
+bool IsBatchedIOEnabled() { return batchedIO; }
+
+
+#if UDP_BATCH_SYSCALLS
+static bool CheckBatchSyscallError(int err)
+{
+	if (err != ENOSYS && err != EOPNOTSUPP)
+		return false;
+
+	LOG_L(L_WARNING, "[UDPBatch] batched socket calls are not supported, falling back to single calls");
+	batchedIO = false;
+	return true;
+}
+#endif
+
+
+
+UDPRecvBatch::UDPRecvBatch()
+{
+	std::fill(sizes, sizes + maxDatagrams, 0);
+}
+
+unsigned UDPRecvBatch::Receive(ip::udp::socket& socket, boost::system::error_code& err)
+{
+	err.clear();
+
+	if (buffer.empty())
+		buffer.resize(maxDatagrams * maxDatagramSize);
+
+#if UDP_BATCH_SYSCALLS
+	if (batchedIO) {
+		mmsghdr msgs[maxDatagrams];
+		iovec iovs[maxDatagrams];
+
+		for (unsigned n = 0; n < maxDatagrams; ++n) {
+			iovs[n].iov_base = &buffer[n * maxDatagramSize];
+			iovs[n].iov_len = maxDatagramSize;
+
+			msgs[n].msg_hdr.msg_name = senders[n].data();
+			msgs[n].msg_hdr.msg_namelen = senders[n].capacity();
+			msgs[n].msg_hdr.msg_iov = &iovs[n];
+			msgs[n].msg_hdr.msg_iovlen = 1;
+			msgs[n].msg_hdr.msg_control = NULL;
+			msgs[n].msg_hdr.msg_controllen = 0;
+			msgs[n].msg_hdr.msg_flags = 0;
+			msgs[n].msg_len = 0;
+		}
+
+		const int numRecv = recvmmsg(socket.native_handle(), msgs, maxDatagrams, MSG_DONTWAIT, NULL);
+
+		if (numRecv >= 0) {
+			for (int n = 0; n < numRecv; ++n) {
+				sizes[n] = msgs[n].msg_len;
+				senders[n].resize(msgs[n].msg_hdr.msg_namelen);
+			}
+
+			return numRecv;
+		}
+
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return 0;
+
+		if (!CheckBatchSyscallError(errno)) {
+			err = boost::system::error_code(errno, boost::system::system_category());
+			return 0;
+		}
+	}
+#endif
+
+	return ReceiveSingle(socket, err);
+}
+
+unsigned UDPRecvBatch::ReceiveSingle(ip::udp::socket& socket, boost::system::error_code& err)
+{
+	unsigned numRecv = 0;
+
+	while (numRecv < maxDatagrams && socket.available(err) > 0 && !err) {
+		sizes[numRecv] = socket.receive_from(boost::asio::buffer(&buffer[numRecv * maxDatagramSize], maxDatagramSize), senders[numRecv], 0, err);
+
+		if (err)
+			break;
+
+		++numRecv;
+	}
+
+	return numRecv;
+}
+
+
+
+UDPSendBatch::UDPSendBatch(boost::shared_ptr<ip::udp::socket> socket)
+	: mySocket(socket)
+	, datagrams(maxDatagrams)
+	, numQueued(0)
+	, active(false)
+{
+}
+
+unsigned UDPSendBatch::Add(const ip::udp::endpoint& to, const Packet& pkt)
+{
+	assert(active);
+
+	if (numQueued == maxDatagrams) {
+		Flush();
+		Begin();
+	}
+
+	Datagram& d = datagrams[numQueued++];
+	d.to = to;
+	d.chunks.assign(pkt.chunks.begin(), pkt.chunks.end());
+	pkt.SerializeHeaders(d.headers, d.buffers);
+
+	if (d.buffers.size() <= maxGatherBuffers)
+		return 0;
+
+	// too many tiny messages in this packet, flatten it
+	d.flat.resize(buffer_size(d.buffers));
+	buffer_copy(buffer(d.flat), d.buffers);
+	d.buffers.assign(1, buffer(d.flat));
+	d.chunks.clear();
+
+	return (d.flat.size() - d.headers.size());
+}
+
+void UDPSendBatch::Flush()
+{
+	boost::system::error_code err;
+
+	for (unsigned n = 0; n < numQueued; ) {
+	#if UDP_BATCH_SYSCALLS
+		if (batchedIO) {
+			const unsigned numSent = SendBatched(n, err);
+
+			n += numSent;
+
+			// the kernel refused datagram <n>, drop it (like a lost one, it
+			// gets resent by its connection) unless we just fell back
+			if (numSent == 0 && batchedIO) {
+				CheckErrorCode(err);
+				++n;
+			}
+
+			continue;
+		}
+	#endif
+
+		SendSingle(n++, err);
+		CheckErrorCode(err);
+	}
+
+	for (unsigned n = 0; n < numQueued; ++n) {
+		datagrams[n].chunks.clear();
+	}
+
+	numQueued = 0;
+	active = false;
+}
+
+unsigned UDPSendBatch::SendBatched(unsigned first, boost::system::error_code& err)
+{
+	err.clear();
+
+#if UDP_BATCH_SYSCALLS
+	mmsghdr msgs[maxDatagrams];
+	iovec iovs[maxDatagrams * maxGatherBuffers];
+	unsigned numIovs = 0;
+
+	const unsigned numMsgs = numQueued - first;
+
+	for (unsigned n = 0; n < numMsgs; ++n) {
+		Datagram& d = datagrams[first + n];
+
+		msgs[n].msg_hdr.msg_name = d.to.data();
+		msgs[n].msg_hdr.msg_namelen = d.to.size();
+		msgs[n].msg_hdr.msg_iov = &iovs[numIovs];
+		msgs[n].msg_hdr.msg_iovlen = d.buffers.size();
+		msgs[n].msg_hdr.msg_control = NULL;
+		msgs[n].msg_hdr.msg_controllen = 0;
+		msgs[n].msg_hdr.msg_flags = 0;
+		msgs[n].msg_len = 0;
+
+		for (auto bi = d.buffers.begin(); bi != d.buffers.end(); ++bi) {
+			iovs[numIovs].iov_base = const_cast<void*>(buffer_cast<const void*>(*bi));
+			iovs[numIovs].iov_len = buffer_size(*bi);
+			++numIovs;
+		}
+	}
+
+	const int numSent = sendmmsg(mySocket->native_handle(), msgs, numMsgs, 0);
+
+	if (numSent >= 0)
+		return numSent;
+
+	if (CheckBatchSyscallError(errno))
+		return 0;
+
+	err = boost::system::error_code(errno, boost::system::system_category());
+#endif
+
+	return 0;
+}
+
+void UDPSendBatch::SendSingle(unsigned n, boost::system::error_code& err)
+{
+	const Datagram& d = datagrams[n];
+	mySocket->send_to(d.buffers, d.to, 0, err);
+}
+
+} // namespace netcode
@@ -0,0 +1,116 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _UDP_BATCH_H
+#define _UDP_BATCH_H
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/cstdint.hpp>
+#include <vector>
+
+#include "UDPConnection.h"
+
+namespace netcode
+{
+
+/**
+ * Batched datagram I/O: on linux many datagrams are received/sent with a
+ * single recvmmsg/sendmmsg call, elsewhere (or when the kernel does not
+ * support these) it falls back to one asio call per datagram.
+ */
+void EnableBatchedIO(bool enable);
+bool IsBatchedIOEnabled();
+
+
+/**
+ * @brief receives up to maxDatagrams waiting datagrams at once
+ */
+class UDPRecvBatch : boost::noncopyable
+{
+public:
+	static const unsigned maxDatagrams = 32;
+	static const unsigned maxDatagramSize = 4096;
+
+	UDPRecvBatch();
+
+	/**
+	 * @brief read the datagrams waiting on <socket>, does not block
+	 * @return the number of datagrams received, 0 if none were waiting
+	 *   or an error occured (which is then stored in <err>)
+	 */
+	unsigned Receive(boost::asio::ip::udp::socket& socket, boost::system::error_code& err);
+
+	const boost::uint8_t* GetData(unsigned n) const { return &buffer[n * maxDatagramSize]; }
+	unsigned GetSize(unsigned n) const { return sizes[n]; }
+	const boost::asio::ip::udp::endpoint& GetSender(unsigned n) const { return senders[n]; }
+
+private:
+	unsigned ReceiveSingle(boost::asio::ip::udp::socket& socket, boost::system::error_code& err);
+
+private:
+	/// maxDatagrams slots of maxDatagramSize bytes, allocated on first use
+	std::vector<boost::uint8_t> buffer;
+
+	unsigned sizes[maxDatagrams];
+	boost::asio::ip::udp::endpoint senders[maxDatagrams];
+};
+
+
+/**
+ * @brief collects the packets all connections on a socket send during one
+ *   update and hands them to the kernel together
+ * The payload is not copied, the packets' chunks are kept alive until the
+ * batch is flushed.
+ */
+class UDPSendBatch : boost::noncopyable
+{
+public:
+	static const unsigned maxDatagrams = 32;
+	/// asio hands at most this many buffers per datagram to the kernel (and silently drops the rest)
+	static const unsigned maxGatherBuffers = 64;
+
+	UDPSendBatch(boost::shared_ptr<boost::asio::ip::udp::socket> socket);
+
+	/// start collecting, until then (and after Flush) connections send directly
+	void Begin() { active = true; }
+	bool IsActive(const boost::shared_ptr<boost::asio::ip::udp::socket>& socket) const {
+		return (active && socket == mySocket);
+	}
+
+	/**
+	 * @brief queue <pkt> for sending to <to>, flushes if the batch is full
+	 * @return the number of payload bytes that had to be copied
+	 */
+	unsigned Add(const boost::asio::ip::udp::endpoint& to, const Packet& pkt);
+
+	/// send all queued datagrams and stop collecting
+	void Flush();
+
+private:
+	/// send datagrams [first, numQueued), returns how many the kernel took
+	unsigned SendBatched(unsigned first, boost::system::error_code& err);
+	void SendSingle(unsigned n, boost::system::error_code& err);
+
+private:
+	struct Datagram {
+		boost::asio::ip::udp::endpoint to;
+		std::vector<boost::uint8_t> headers;
+		/// only used for packets with too many buffers, see Add
+		std::vector<boost::uint8_t> flat;
+		std::vector<boost::asio::const_buffer> buffers;
+		std::vector<ChunkPtr> chunks;
+	};
+
+	boost::shared_ptr<boost::asio::ip::udp::socket> mySocket;
+
+	std::vector<Datagram> datagrams;
+	unsigned numQueued;
+
+	bool active;
+};
+
+} // namespace netcode
+
+#endif // _UDP_BATCH_H
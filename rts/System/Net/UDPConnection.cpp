@@ -8,6 +8,8 @@
 
 
 #include "Socket.h"
+#include "UDPBatch.h"
+#include "FrameBundle.h"
 #include "ProtocolDef.h"
 #include "Exception.h"
 #include "Net/Protocol/BaseNetProtocol.h"
@@ -103,11 +105,12 @@ public:
 		pos += sizeof(t);
 	}
 
-	void Unpack(std::vector<boost::uint8_t>& t, unsigned unpackLength) {
-		std::copy(data + pos, data + pos + unpackLength, std::back_inserter(t));
-		pos += unpackLength;
+	void Skip(unsigned skipLength) {
+		pos += skipLength;
 	}
 
+	unsigned Position() const { return pos; }
+
 	unsigned Remaining() const {
 		return length - std::min(pos, length);
 	}
@@ -126,13 +129,13 @@ public:
 	}
 
 	template<typename T>
-	void Pack(T& t) {
+	void Pack(const T& t) {
 		const size_t pos = data.size();
 		data.resize(pos + sizeof(T));
 		*reinterpret_cast<T*>(&data[pos]) = t;
 	}
 
-	void Pack(std::vector<boost::uint8_t>& _data) {
+	void Pack(const std::vector<boost::uint8_t>& _data) {
 		std::copy(_data.begin(), _data.end(), std::back_inserter(data));
 	}
 
@@ -147,8 +150,27 @@ void Chunk::UpdateChecksum(CRC& crc) const {
 	crc << chunkNumber;
 	crc << (unsigned int)chunkSize;
 
-	if (!data.empty()) {
-		crc.Update(&data[0], data.size());
+	for (auto si = slices.begin(); si != slices.end(); ++si) {
+		crc.Update(si->GetData(), si->length);
+	}
+}
+
+void Chunk::AddSlice(const boost::shared_ptr<const RawPacket>& packet, unsigned offset, unsigned length) {
+
+	assert((offset + length) <= packet->length);
+
+	Slice s;
+	s.packet = packet;
+	s.offset = offset;
+	s.length = length;
+	slices.push_back(s);
+}
+
+void Chunk::CopyTo(boost::uint8_t* dst) const {
+
+	for (auto si = slices.begin(); si != slices.end(); ++si) {
+		std::copy(si->GetData(), si->GetData() + si->length, dst);
+		dst += si->length;
 	}
 }
 
@@ -156,7 +178,10 @@ void Chunk::UpdateChecksum(CRC& crc) const {
 
 Packet::Packet(const unsigned char* data, unsigned length)
 {
-	Unpacker buf(data, length);
+	// all chunks reference this single copy of the datagram
+	const boost::shared_ptr<const RawPacket> datagram(new RawPacket(data, length));
+
+	Unpacker buf(datagram->data, length);
 	buf.Unpack(lastContinuous);
 	buf.Unpack(nakType);
 	buf.Unpack(checksum);
@@ -180,7 +205,9 @@ Packet::Packet(const unsigned char* data, unsigned length)
 		buf.Unpack(temp->chunkNumber);
 		buf.Unpack(temp->chunkSize);
 		if (buf.Remaining() >= temp->chunkSize) {
-			buf.Unpack(temp->data, temp->chunkSize);
+			if (temp->chunkSize > 0)
+				temp->AddSlice(datagram, buf.Position(), temp->chunkSize);
+			buf.Skip(temp->chunkSize);
 			chunks.push_back(temp);
 		} else {
 			// defective, ignore
@@ -220,20 +247,57 @@ boost::uint8_t Packet::GetChecksum() const {
 	return (boost::uint8_t)crc.GetDigest();
 }
 
-void Packet::Serialize(std::vector<boost::uint8_t>& data)
+unsigned Packet::GetNumBuffers() const {
+
+	unsigned num = 1;
+
+	for (auto chk = chunks.begin(); chk != chunks.end(); ++chk)
+		num += (1 + (*chk)->slices.size());
+
+	return num;
+}
+
+void Packet::SerializeHeaders(std::vector<boost::uint8_t>& headers, std::vector<const_buffer>& buffers) const
 {
-	data.reserve(GetSize());
-	Packer buf(data);
+	headers.clear();
+	headers.reserve(headerSize + naks.size() + chunks.size() * Chunk::headerSize);
+	buffers.clear();
+	buffers.reserve(GetNumBuffers());
+
+	Packer buf(headers);
 	buf.Pack(lastContinuous);
 	buf.Pack(nakType);
 	buf.Pack(checksum);
 	buf.Pack(naks);
 
+	// headers.data() is stable from here on (capacity was reserved)
+	unsigned hdrStart = 0;
+
 	for (auto ci = chunks.begin(); ci != chunks.end(); ++ci) {
-		buf.Pack((*ci)->chunkNumber);
-		buf.Pack((*ci)->chunkSize);
-		buf.Pack((*ci)->data);
+		const Chunk* chk = ci->get();
+
+		buf.Pack(chk->chunkNumber);
+		buf.Pack(chk->chunkSize);
+		buffers.push_back(buffer(&headers[hdrStart], headers.size() - hdrStart));
+		hdrStart = headers.size();
+
+		for (auto si = chk->slices.begin(); si != chk->slices.end(); ++si) {
+			buffers.push_back(buffer(si->GetData(), si->length));
+		}
 	}
+
+	if (hdrStart < headers.size())
+		buffers.push_back(buffer(&headers[hdrStart], headers.size() - hdrStart));
+}
+
+void Packet::Serialize(std::vector<boost::uint8_t>& data) const
+{
+	std::vector<boost::uint8_t> headers;
+	std::vector<const_buffer> buffers;
+	SerializeHeaders(headers, buffers);
+
+	data.resize(buffer_size(buffers));
+	buffer_copy(buffer(data), buffers);
 }
 
 
@@ -306,12 +370,17 @@ void UDPConnection::Init()
 	resentChunks = 0;
 	sentPackets = recvPackets = 0;
 	droppedChunks = 0;
+	numChunkAllocs = 0;
+	numBytesCopied = 0;
+	numBytesReferenced = 0;
+	outgoingOffset = 0;
 	mtu = globalConfig->mtu;
 	reconnectTime = globalConfig->reconnectTimeout;
 
 	muted = true;
 	closed = false;
 	resend = false;
+	unpackFrameBundles = false;
 
 	#ifndef UNIT_TEST
 	logMessages = configHandler->GetBool("UDPConnectionLogDebugMessages");
@@ -437,32 +506,31 @@ void UDPConnection::Update()
 	if (!sharedSocket && !closed) {
 		// duplicated code with UDPListener
 		netservice.poll();
-		size_t bytesAvail = 0;
-
-		while ((bytesAvail = mySocket->available()) > 0) {
-			std::vector<boost::uint8_t> buffer(bytesAvail, 0);
-			ip::udp::endpoint sender_endpoint;
-			ip::udp::socket::message_flags flags = 0;
-			boost::system::error_code err;
 
-			const size_t bytesReceived = mySocket->receive_from(boost::asio::buffer(buffer), sender_endpoint, flags, err);
+		if (recvBatch == NULL)
+			recvBatch.reset(new UDPRecvBatch());
 
-			if (CheckErrorCode(err))
-				break;
+		boost::system::error_code err;
+		unsigned numReceived = 0;
 
-			if (bytesReceived < Packet::headerSize)
-				continue;
+		while ((numReceived = recvBatch->Receive(*mySocket, err)) > 0) {
+			for (unsigned n = 0; n < numReceived; ++n) {
+				if (recvBatch->GetSize(n) < Packet::headerSize)
+					continue;
 
-			Packet data(&buffer[0], bytesReceived);
+				Packet data(recvBatch->GetData(n), recvBatch->GetSize(n));
 
-			if (IsUsingAddress(sender_endpoint))
-				ProcessRawPacket(data);
+				if (IsUsingAddress(recvBatch->GetSender(n)))
+					ProcessRawPacket(data);
+			}
 
 			// not likely, but make sure we do not get stuck here
 			if ((spring_gettime() - curTime) > spring_msecs(10)) {
 				break;
 			}
 		}
+
+		CheckErrorCode(err);
 	}
 
 	Flush(false);
@@ -545,7 +613,8 @@ void UDPConnection::ProcessRawPacket(Packet& incoming)
 			continue;
 		}
 
-		waitingPackets.insert(c->chunkNumber, new RawPacket(&c->data[0], c->data.size()));
+		// keep the chunk (and with it the received datagram) until it is in order
+		waitingPackets[c->chunkNumber] = c;
 	}
 
 	packetMap::iterator wpi;
@@ -563,7 +632,16 @@ void UDPConnection::ProcessRawPacket(Packet& incoming)
 		}
 
 		lastInOrder++;
-		std::copy(wpi->second->data, wpi->second->data + wpi->second->length, std::back_inserter(buf));
+
+		const unsigned bufSize = buf.size();
+		const unsigned chunkSize = wpi->second->chunkSize;
+
+		if (chunkSize > 0) {
+			buf.resize(bufSize + chunkSize);
+			wpi->second->CopyTo(&buf[bufSize]);
+			numBytesCopied += chunkSize;
+		}
+
 		waitingPackets.erase(wpi);
 
 		for (unsigned pos = 0; pos < buf.size(); ) {
@@ -574,6 +652,21 @@ void UDPConnection::ProcessRawPacket(Packet& incoming)
 
 			// this returns false for zero/invalid pktlength
 			if (ProtocolDef::GetInstance()->IsValidLength(pktlength, msglength)) {
+				if (*bufp == NETMSG_FRAMEBUNDLE && unpackFrameBundles) {
+					FrameBundleReader reader(bufp, pktlength);
+					boost::shared_ptr<const RawPacket> msg;
+
+					while (reader.Next(msg)) {
+						msgQueue.push_back(msg);
+					}
+
+					if (reader.Failed())
+						LOG_L(L_ERROR, "Discarding rest of invalid frame bundle (LEN %d)", pktlength);
+
+					pos += pktlength;
+					continue;
+				}
+
 				msgQueue.push_back(boost::shared_ptr<const RawPacket>(new RawPacket(bufp, pktlength)));
 
 				#ifdef ENABLE_DEBUG_STATS
@@ -636,10 +729,15 @@ void UDPConnection::Flush(const bool forced)
 		for (auto pi = outgoingData.begin(); (pi != outgoingData.end()) && (outgoingLength <= requiredLength); ++pi) {
 			outgoingLength += (*pi)->length;
 		}
+
+		outgoingLength -= outgoingOffset;
 	}
 
 	if (forced || (!waitMore && outgoingLength > requiredLength)) {
-		boost::uint8_t buffer[udpMaxPacketSize];
+		// chunks only reference the queued packets (which are shared between
+		// all connections a message is broadcast to), the payload is copied
+		// at most once by the kernel when the chunk is sent
+		ChunkPtr chunk;
 		unsigned pos = 0;
 
 		// Manually fragment packets to respect configured UDP_MTU.
@@ -653,34 +751,40 @@ void UDPConnection::Flush(const bool forced)
 			sendMore |= ((globalConfig->linkOutgoingBandwidth <= 0) || partialPacket || forced);
 
 			if (!outgoingData.empty() && sendMore) {
-				boost::shared_ptr<const RawPacket>& packet = *(outgoingData.begin());
+				const boost::shared_ptr<const RawPacket>& packet = *(outgoingData.begin());
 
-				if (!partialPacket && !ProtocolDef::GetInstance()->IsValidPacket(packet->data, packet->length)) {
+				if (outgoingOffset == 0 && !ProtocolDef::GetInstance()->IsValidPacket(packet->data, packet->length)) {
 					LOG_L(L_ERROR,
 						"Discarding outgoing invalid packet: ID %d, LEN %d",
 						((packet->length > 0) ? (int)packet->data[0] : -1),
 						packet->length);
 					outgoingData.pop_front();
 				} else {
-					const unsigned numBytes = std::min((unsigned)maxChunkSize - pos, packet->length);
+					const unsigned numBytes = std::min((unsigned)maxChunkSize - pos, packet->length - outgoingOffset);
 
 					assert(packet->length > 0);
-					memcpy(buffer + pos, packet->data, numBytes);
+
+					if (chunk == NULL) {
+						chunk.reset(new Chunk);
+						++numChunkAllocs;
+					}
+
+					chunk->AddSlice(packet, outgoingOffset, numBytes);
 					pos += numBytes;
 					outgoing.DataSent(numBytes, true);
-					partialPacket = (numBytes != packet->length);
+					outgoingOffset += numBytes;
+					partialPacket = (outgoingOffset != packet->length);
 
-					if (partialPacket) {
-						// partially transfered
-						packet.reset(new RawPacket(packet->data + numBytes, packet->length - numBytes));
-					} else {
-						// full packet copied
+					if (!partialPacket) {
+						// full packet referenced
 						outgoingData.pop_front();
+						outgoingOffset = 0;
 					}
 				}
 			}
 			if ((pos > 0) && (outgoingData.empty() || (pos == maxChunkSize) || !sendMore)) {
-				CreateChunk(buffer, pos, currentPacketChunkNum++);
+				CreateChunk(chunk, pos, currentPacketChunkNum++);
+				chunk.reset();
 				pos = 0;
 			}
 		} while (!outgoingData.empty() && sendMore);
@@ -735,6 +839,8 @@ std::string UDPConnection::Statistics() const
 			%SafeDivide(sentOverhead, dataSent) %SafeDivide(recvOverhead, dataRecv) );
 	msg += str( boost::format("%1% incoming chunks dropped, %2% outgoing chunks resent\n")
 			%droppedChunks %resentChunks);
+	msg += str( boost::format("%1% chunks allocated, %2% bytes copied, %3% bytes sent without copying\n")
+			%numChunkAllocs %numBytesCopied %numBytesReferenced);
 	return msg;
 }
 
@@ -755,14 +861,12 @@ void UDPConnection::SetMTU(unsigned mtu2)
 	}
 }
 
-void UDPConnection::CreateChunk(const unsigned char* data, const unsigned length, const int packetNum)
+void UDPConnection::CreateChunk(ChunkPtr chunk, const unsigned length, const int packetNum)
 {
 	assert((length > 0) && (length < 255));
-	ChunkPtr buf(new Chunk);
-	buf->chunkNumber = packetNum;
-	buf->chunkSize = length;
-	std::copy(data, data+length, std::back_inserter(buf->data));
-	newChunks.push_back(buf);
+	chunk->chunkNumber = packetNum;
+	chunk->chunkSize = length;
+	newChunks.push_back(chunk);
 	lastChunkCreatedTime = spring_gettime();
 }
 
@@ -938,22 +1042,48 @@ void UDPConnection::SendIfNecessary(bool flushed)
 
 void UDPConnection::SendPacket(Packet& pkt)
 {
+	const unsigned dataSize = pkt.GetSize();
+	const unsigned payloadSize = dataSize - (Packet::headerSize + pkt.naks.size() + pkt.chunks.size() * Chunk::headerSize);
+
+#if NETWORK_TEST
 	std::vector<boost::uint8_t> data;
 	pkt.Serialize(data);
+#endif
 
-	outgoing.DataSent(data.size());
+	outgoing.DataSent(dataSize);
 	lastPacketSendTime = spring_gettime();
 	ip::udp::socket::message_flags flags = 0;
 	boost::system::error_code err;
 
 	EMULATE_LATENCY( !EMULATE_PACKET_LOSS( LOSS_COUNTER ) ) {
-		mySocket->send_to(buffer(data), addr, flags, err);
+		if (sendBatch != NULL && sendBatch->IsActive(mySocket)) {
+			// sent together with the other connections' packets, errors are logged by the batch
+			const unsigned numCopied = sendBatch->Add(addr, pkt);
+
+			numBytesReferenced += (payloadSize - numCopied);
+			numBytesCopied += numCopied;
+		} else {
+			pkt.SerializeHeaders(sendHeaders, sendBuffers);
+
+			if (sendBuffers.size() <= UDPSendBatch::maxGatherBuffers) {
+				// scatter/gather straight from the shared packet buffers
+				mySocket->send_to(sendBuffers, addr, flags, err);
+				numBytesReferenced += payloadSize;
+			} else {
+				// too many tiny messages in this packet, flatten it
+				boost::uint8_t flatBuffer[udpMaxPacketSize];
+				assert(dataSize <= udpMaxPacketSize);
+				buffer_copy(buffer(flatBuffer), sendBuffers);
+				mySocket->send_to(buffer(flatBuffer, dataSize), addr, flags, err);
+				numBytesCopied += payloadSize;
+			}
+		}
 	}
 
 	if (CheckErrorCode(err))
 		return;
 
-	dataSent += data.size();
+	dataSent += dataSize;
 	++sentPackets;
 }
 
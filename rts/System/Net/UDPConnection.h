@@ -3,13 +3,16 @@
 #ifndef _UDP_CONNECTION_H
 #define _UDP_CONNECTION_H
 
-#include <boost/ptr_container/ptr_map.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/asio/buffer.hpp>
 #include <boost/asio/ip/udp.hpp>
 #include <deque>
 #include <list>
+#include <map>
+#include <vector>
 
 #include "Connection.h"
+#include "RawPacket.h"
 #include "System/Misc/SpringTime.h"
 
 class CRC;
@@ -17,6 +20,9 @@ class CRC;
 
 namespace netcode {
 
+class UDPRecvBatch;
+class UDPSendBatch;
+
 // for reliability testing, introduce fake packet loss with a percentage probability
 #define NETWORK_TEST 0                        // in [0, 1] // enable network reliability testing mode
 #define PACKET_LOSS_FACTOR 50                 // in [0, 100)
@@ -27,16 +33,35 @@ namespace netcode {
 #define PACKET_MAX_LATENCY 1250               // in [milliseconds] maximum latency
 #define ENABLE_DEBUG_STATS
 
+/**
+ * @brief a piece of the reliable byte-stream, as sent in one packet
+ *
+ * The payload is not copied into the chunk but referenced as a list of
+ * slices of the (shared, immutable) RawPackets it was built from, so the
+ * same broadcast packet queued on many connections exists only once.
+ */
 class Chunk
 {
 public:
-	unsigned GetSize() const { return (data.size() + headerSize); }
+	struct Slice {
+		boost::shared_ptr<const RawPacket> packet;
+		unsigned offset;
+		unsigned length;
+
+		const boost::uint8_t* GetData() const { return (packet->data + offset); }
+	};
+
+	unsigned GetSize() const { return (chunkSize + headerSize); }
 	void UpdateChecksum(CRC& crc) const;
+	void AddSlice(const boost::shared_ptr<const RawPacket>& packet, unsigned offset, unsigned length);
+	/// copies the payload to <dst>, which must have room for chunkSize bytes
+	void CopyTo(boost::uint8_t* dst) const;
+
 	static const unsigned maxSize = 254;
 	static const unsigned headerSize = 5;
 	boost::int32_t chunkNumber;
 	boost::uint8_t chunkSize;
-	std::vector<boost::uint8_t> data;
+	std::vector<Slice> slices;
 };
 typedef boost::shared_ptr<Chunk> ChunkPtr;
 
@@ -51,7 +76,17 @@ public:
 
 	boost::uint8_t GetChecksum() const;
 
-	void Serialize(std::vector<boost::uint8_t>& data);
+	/// number of scatter/gather buffers SerializeHeaders will produce
+	unsigned GetNumBuffers() const;
+
+	/**
+	 * @brief write the packet- and chunk-headers to <headers> and collect
+	 *   the buffer sequence (headers interleaved with chunk payloads)
+	 * <headers> is reserved up-front and must not be modified while
+	 * <buffers> is in use.
+	 */
+	void SerializeHeaders(std::vector<boost::uint8_t>& headers, std::vector<boost::asio::const_buffer>& buffers) const;
+	void Serialize(std::vector<boost::uint8_t>& data) const;
 
 	boost::int32_t lastContinuous;
 	/// if < 0, we lost -x packets since lastContinuous, if >0, x = size of naks
@@ -99,6 +134,8 @@ public:
 	bool NeedsReconnect();
 
 	unsigned int GetPacketQueueSize() const { return msgQueue.size(); }
+	/// true if there is data waiting to be flushed, acknowledged or resent
+	bool HasPendingOutgoingData() const { return (!outgoingData.empty() || !unackedChunks.empty() || !resendRequested.empty()); }
 
 	std::string Statistics() const;
 	std::string GetFullAddress() const;
@@ -125,6 +162,12 @@ public:
 
 	const boost::asio::ip::udp::endpoint &GetEndpoint() const { return addr; }
 
+	/// only the client's link to the server unpacks NETMSG_FRAMEBUNDLE, elsewhere they are passed on as is
+	void SetUnpackFrameBundles(bool b) { unpackFrameBundles = b; }
+
+	/// while <batch> is active on our socket, packets are queued there instead of sent directly
+	void SetSendBatch(boost::shared_ptr<UDPSendBatch> batch) { sendBatch = batch; }
+
 private:
 	void InitConnection(boost::asio::ip::udp::endpoint address,
 			boost::shared_ptr<boost::asio::ip::udp::socket> socket);
@@ -135,8 +178,8 @@ private:
 
 	void Init();
 
-	/// add header to data and send it
-	void CreateChunk(const unsigned char* data, const unsigned length,
+	/// number the (filled) chunk and queue it for sending
+	void CreateChunk(ChunkPtr chunk, const unsigned length,
 			const int packetNum);
 	void SendIfNecessary(bool flushed);
 	void AckChunks(int lastAck);
@@ -155,7 +198,7 @@ private:
 	spring_time lastFramePacketRecvTime;
 	#endif
 
-	typedef boost::ptr_map<int,RawPacket> packetMap;
+	typedef std::map<int, ChunkPtr> packetMap;
 	typedef std::list< boost::shared_ptr<const RawPacket> > packetList;
 	/// address of the other end
 	boost::asio::ip::udp::endpoint addr;
@@ -168,12 +211,15 @@ private:
 	bool resend;
 	bool sharedSocket;
 	bool logMessages;
+	bool unpackFrameBundles;
 
 	int netLossFactor;
 	int reconnectTime;
 
 	/// outgoing stuff (pure data without header) waiting to be sent
 	packetList outgoingData;
+	/// bytes of outgoingData.front() already put into chunks
+	unsigned outgoingOffset;
 	/// packets we have received but not yet read
 	packetMap waitingPackets;
 
@@ -201,6 +247,10 @@ private:
 
 	/// Our socket
 	boost::shared_ptr<boost::asio::ip::udp::socket> mySocket;
+	/// set by the UDPListener that owns mySocket
+	boost::shared_ptr<UDPSendBatch> sendBatch;
+	/// only used if we do not share mySocket, allocated on demand
+	boost::shared_ptr<UDPRecvBatch> recvBatch;
 
 	RawPacket* fragmentBuffer;
 
@@ -224,6 +274,17 @@ private:
 	unsigned int sentOverhead, recvOverhead;
 	unsigned int sentPackets, recvPackets;
 
+	/// outgoing chunks allocated
+	unsigned int numChunkAllocs;
+	/// payload bytes memcpy'd (receive reassembly, gather-fallback)
+	unsigned int numBytesCopied;
+	/// payload bytes sent straight from the shared RawPackets
+	unsigned int numBytesReferenced;
+
+	/// reused by SendPacket
+	std::vector<boost::uint8_t> sendHeaders;
+	std::vector<boost::asio::const_buffer> sendBuffers;
+
 	class BandwidthUsage {
 	public:
 		BandwidthUsage();
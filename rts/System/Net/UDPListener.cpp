@@ -15,6 +15,7 @@
 
 
 #include "ProtocolDef.h"
+#include "UDPBatch.h"
 #include "UDPConnection.h"
 #include "Socket.h"
 #include "System/Log/ILog.h"
@@ -38,6 +39,7 @@ UDPListener::UDPListener(int port, const std::string& ip)
 		socket->io_control(socketCommand);
 
 		mySocket = socket;
+		sendBatch.reset(new UDPSendBatch(mySocket));
 		SetAcceptingConnections(true);
 	}
 
@@ -59,7 +61,7 @@ std::string UDPListener::TryBindSocket(int port, SocketPtr* socket, const std::s
 			throw std::range_error("Port is out of range [0, 65535]: " + IntToString(port));
 		}
 
-		socket->reset(new ip::udp::socket(netservice));
+		socket->reset(new ip::udp::socket(serverservice));
 		(*socket)->open(ip::udp::v6(), err); // test IP v6 support
 
 		const bool supportsIPv6 = !err;
@@ -106,73 +108,98 @@ std::string UDPListener::TryBindSocket(int port, SocketPtr* socket, const std::s
 }
 
 void UDPListener::Update() {
-	netservice.poll();
+	serverservice.poll();
 
-	size_t bytes_avail = 0;
+	boost::system::error_code err;
+	unsigned numReceived = 0;
 
-	while ((bytes_avail = mySocket->available()) > 0) {
-		std::vector<boost::uint8_t> buffer(bytes_avail);
-		ip::udp::endpoint sender_endpoint;
-		boost::asio::ip::udp::socket::message_flags flags = 0;
-		boost::system::error_code err;
-		size_t bytesReceived = mySocket->receive_from(boost::asio::buffer(buffer), sender_endpoint, flags, err);
+	while ((numReceived = recvBatch.Receive(*mySocket, err)) > 0) {
+		for (unsigned n = 0; n < numReceived; ++n) {
+			ProcessDatagram(recvBatch.GetData(n), recvBatch.GetSize(n), recvBatch.GetSender(n));
+		}
+	}
 
-		ConnMap::iterator ci = conn.find(sender_endpoint);
-		bool knownConnection = (ci != conn.end());
+	CheckErrorCode(err);
 
-		if (knownConnection && ci->second.expired())
+	// packets all connections send from here on leave in a few sendmmsg calls
+	sendBatch->Begin();
+
+	for (ConnMap::iterator i = conn.begin(); i != conn.end(); ) {
+		if (i->second.expired()) {
+			LOG_L(L_DEBUG, "Connection closed: [%s]:%i", i->first.address().to_string().c_str(), i->first.port());
+			i = set_erase(conn, i);
 			continue;
+		}
+		i->second.lock()->Update();
+		++i;
+	}
 
-		if (CheckErrorCode(err))
-			break;
+	sendBatch->Flush();
+}
 
-		if (bytesReceived < Packet::headerSize)
-			continue;
+void UDPListener::ProcessDatagram(const boost::uint8_t* buf, unsigned bytesReceived, const ip::udp::endpoint& sender_endpoint)
+{
+	ConnMap::iterator ci = conn.find(sender_endpoint);
+	bool knownConnection = (ci != conn.end());
 
-		Packet data(&buffer[0], bytesReceived);
+	if (knownConnection && ci->second.expired())
+		return;
 
-		if (knownConnection) {
-			ci->second.lock()->ProcessRawPacket(data);
-		}
-		else { // still have the packet (means no connection with the sender's address found)
-			if (acceptNewConnections && data.lastContinuous == -1 && data.nakType == 0)	{
-				if (!data.chunks.empty() && (*data.chunks.begin())->chunkNumber == 0) {
-					// new client wants to connect
-					boost::shared_ptr<UDPConnection> incoming(new UDPConnection(mySocket, sender_endpoint));
-					waiting.push(incoming);
-					conn[sender_endpoint] = incoming;
-					incoming->ProcessRawPacket(data);
-				}
+	if (bytesReceived < Packet::headerSize)
+		return;
+
+	Packet data(buf, bytesReceived);
+
+	if (knownConnection) {
+		ci->second.lock()->ProcessRawPacket(data);
+	}
+	else { // still have the packet (means no connection with the sender's address found)
+		if (acceptNewConnections && data.lastContinuous == -1 && data.nakType == 0)	{
+			if (!data.chunks.empty() && (*data.chunks.begin())->chunkNumber == 0) {
+				// new client wants to connect
+				boost::shared_ptr<UDPConnection> incoming(new UDPConnection(mySocket, sender_endpoint));
+				incoming->SetSendBatch(sendBatch);
+				waiting.push(incoming);
+				conn[sender_endpoint] = incoming;
+				incoming->ProcessRawPacket(data);
 			}
-			else {
-				LOG_L(L_WARNING, "Dropping packet from unknown IP: [%s]:%i",
-						sender_endpoint.address().to_string().c_str(),
-						sender_endpoint.port());
-			#ifdef DEBUG
-				std::string conns;
-				for (ConnMap::iterator it = conn.begin(); it != conn.end(); ++it) {
-					conns += str(boost::format(" [%s]:%i;") %it->first.address().to_string().c_str() %it->first.port());
-				}
-				LOG_L(L_DEBUG, "Open connections: %s", conns.c_str());
-			#endif
+		}
+		else {
+			LOG_L(L_WARNING, "Dropping packet from unknown IP: [%s]:%i",
+					sender_endpoint.address().to_string().c_str(),
+					sender_endpoint.port());
+		#ifdef DEBUG
+			std::string conns;
+			for (ConnMap::iterator it = conn.begin(); it != conn.end(); ++it) {
+				conns += str(boost::format(" [%s]:%i;") %it->first.address().to_string().c_str() %it->first.port());
 			}
+			LOG_L(L_DEBUG, "Open connections: %s", conns.c_str());
+		#endif
 		}
 	}
+}
 
-	for (ConnMap::iterator i = conn.begin(); i != conn.end(); ) {
-		if (i->second.expired()) {
-			LOG_L(L_DEBUG, "Connection closed: [%s]:%i", i->first.address().to_string().c_str(), i->first.port());
-			i = set_erase(conn, i);
-			continue;
-		}
-		i->second.lock()->Update();
-		++i;
+bool UDPListener::Wait(spring_time maxWait)
+{
+	return WaitForNetEvents(mySocket.get(), maxWait);
+}
+
+bool UDPListener::HasPendingOutgoingData() const
+{
+	for (ConnMap::const_iterator i = conn.begin(); i != conn.end(); ++i) {
+		const boost::shared_ptr<UDPConnection> uc = i->second.lock();
+
+		if (uc && uc->HasPendingOutgoingData())
+			return true;
 	}
+
+	return false;
 }
 
 boost::shared_ptr<UDPConnection> UDPListener::SpawnConnection(const std::string& ip, const unsigned port)
 {
 	boost::shared_ptr<UDPConnection> newConn(new UDPConnection(mySocket, ip::udp::endpoint(WrapIP(ip), port)));
+	newConn->SetSendBatch(sendBatch);
 	conn[newConn->GetEndpoint()] = newConn;
 	return newConn;
 }
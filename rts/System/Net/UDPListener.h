@@ -7,11 +7,15 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
 #include <boost/asio/ip/udp.hpp>
+#include <boost/cstdint.hpp>
 #include <list>
 #include <map>
 #include <queue>
 #include <string>
 
+#include "UDPBatch.h"
+#include "System/Misc/SpringTime.h"
+
 namespace netcode
 {
 class UDPConnection;
@@ -48,6 +52,7 @@ public:
 	 * @param  ip local IP (v4 or v6) to bind to,
 	 *         the default value "" results in the v6 any address "::",
 	 *         or the v4 equivalent "0.0.0.0", if v6 is no supported
+	 * The socket belongs to netcode::serverservice.
 	 */
 	static std::string TryBindSocket(int port, SocketPtr* socket,
 			const std::string& ip = "");
@@ -59,6 +64,18 @@ public:
 	 */
 	void Update();
 
+	/**
+	 * @brief Block until there is something to do
+	 * Returns as soon as a datagram arrives, netcode::WakeupNetService is
+	 * called or <maxWait> has passed.
+	 * @return true if data is waiting to be read
+	 * @see netcode::WaitForNetEvents
+	 */
+	bool Wait(spring_time maxWait);
+
+	/// true if any connection still has data to flush, or to be acknowledged
+	bool HasPendingOutgoingData() const;
+
 	/**
 	 * @brief Initiate a connection
 	 * Make a new connection to ip:port. It will be pushed back in conn.
@@ -80,6 +97,10 @@ public:
 
 	void UpdateConnections(); // Updates connections when the endpoint has been reconnected
 
+private:
+	/// hand one received datagram to its connection, or open a new one
+	void ProcessDatagram(const boost::uint8_t* buf, unsigned bytesReceived, const boost::asio::ip::udp::endpoint& sender_endpoint);
+
 private:
 	/**
 	 * @brief Do we accept packets from unknown sources?
@@ -91,6 +112,10 @@ private:
 	/// typedef boost::shared_ptr<boost::asio::ip::udp::socket> SocketPtr;
 	SocketPtr mySocket;
 
+	UDPRecvBatch recvBatch;
+	/// shared with all our connections
+	boost::shared_ptr<UDPSendBatch> sendBatch;
+
 	/// all connections
 	typedef std::map< boost::asio::ip::udp::endpoint, boost::weak_ptr<UDPConnection> > ConnMap;
 	ConnMap conn;
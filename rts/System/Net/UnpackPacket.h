@@ -60,6 +60,9 @@ public:
 		pos += text.size() + 1;
 	}
 
+	/// number of bytes not read yet (optional trailing fields)
+	size_t GetRemaining() const { return (pckt->length - pos); }
+
 private:
 	boost::shared_ptr<const RawPacket> pckt;
 	size_t pos;
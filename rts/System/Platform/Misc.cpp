@@ -36,6 +36,7 @@
 
 #if !defined(WIN32)
 #include <sys/utsname.h> // for uname()
+#include <sys/wait.h> // for waitpid()
 #include <sys/types.h> // for getpw
 #include <pwd.h> // for getpw
 
@@ -482,4 +483,49 @@ std::string ExecuteProcess(const std::string& file, std::vector<std::string> arg
 	return execError;
 }
 
+intptr_t SpawnProcess(const std::string& file, std::vector<std::string> args)
+{
+	args.insert(args.begin(), GetShortFileName(file));
+
+	// prepared before forking, the child may only call exec
+	std::vector<const char*> processArgs(args.size() + 1, NULL);
+
+	for (size_t a = 0; a < args.size(); ++a) {
+		processArgs[a] = args[a].c_str();
+	}
+
+#ifdef WIN32
+	const intptr_t process = _spawnv(_P_NOWAIT, args[0].c_str(), &processArgs[0]);
+#else
+	const intptr_t process = fork();
+
+	if (process == 0) {
+		execvp(args[0].c_str(), const_cast<char* const*>(&processArgs[0]));
+		_exit(127);
+	}
+#endif
+
+	if (process == -1)
+		LOG_L(L_ERROR, "[%s] error: \"%s\" %s (%d)", __FUNCTION__, args[0].c_str(), strerror(errno), errno);
+
+	return process;
+}
+
+int WaitForProcess(intptr_t process)
+{
+	int status = 0;
+
+#ifdef WIN32
+	if (_cwait(&status, process, 0) == -1)
+		return -1;
+
+	return status;
+#else
+	if (waitpid(process, &status, 0) != process)
+		return -1;
+
+	return (WIFEXITED(status)? WEXITSTATUS(status): -1);
+#endif
+}
+
 } // namespace Platform
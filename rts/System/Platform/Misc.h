@@ -5,6 +5,7 @@
 
 #include <string>
 #include <vector>
+#include <stdint.h>
 
 namespace Platform
 {
@@ -93,6 +94,20 @@ bool IsRunningInGDB();
  * @return error message, or "" on success
  */
 std::string ExecuteProcess(const std::string& file, std::vector<std::string> args);
+
+/**
+ * Starts a native binary as child process without waiting for it,
+ * file and args have to be not escaped!
+ * @see ExecuteProcess
+ * @return the child's process id (process handle on Windows), or -1 on error
+ */
+intptr_t SpawnProcess(const std::string& file, std::vector<std::string> args);
+
+/**
+ * Waits for a child process started with SpawnProcess to exit.
+ * @return its exit code, or -1 if it did not exit normally
+ */
+int WaitForProcess(intptr_t process);
 }
 
 #endif // PLATFORM_MISC_H
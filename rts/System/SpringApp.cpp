@@ -18,6 +18,7 @@
 #include "aGui/Gui.h"
 #include "ExternalAI/IAILibraryManager.h"
 #include "Game/Benchmark.h"
+#include "Game/DemoAnalysis.h"
 #include "Game/ClientSetup.h"
 #include "Game/GameSetup.h"
 #include "Game/GameVersion.h"
@@ -631,6 +632,9 @@ void SpringApp::ParseCmdLine(const std::string& binaryName)
 	cmdline->AddSwitch('t', "textureatlas",       "Dump each finalized textureatlas in textureatlasN.tga");
 	cmdline->AddInt(   0,   "benchmark",          "Enable benchmark mode (writes a benchmark.data file). The given number specifies the timespan to test.");
 	cmdline->AddInt(   0,   "benchmarkstart",     "Benchmark start time in minutes.");
+	cmdline->AddString(0,   "demo-analysis",      "Replay the given demo as fast as possible, then write per-frame sim timings, sync checksums and team statistics to this file and quit");
+	cmdline->AddString(0,   "demo-batch",         "Run --demo-analysis for each demo listed (one per line) in this file, in parallel child processes; results go to ./demo-batch/");
+	cmdline->AddInt(   0,   "demo-batch-jobs",    "Number of demos --demo-batch replays at once (default: number of cores)");
 
 	cmdline->AddSwitch(0,   "list-ai-interfaces", "Dump a list of available AI Interfaces to stdout");
 	cmdline->AddSwitch(0,   "list-skirmish-ais",  "Dump a list of available Skirmish AIs to stdout");
@@ -731,6 +735,27 @@ void SpringApp::ParseCmdLine(const std::string& binaryName)
 		exit(0);
 	}
 
+	if (cmdline->IsSet("demo-batch")) {
+		ConsolePrintInitialize(configSource, safemode);
+
+		std::vector<std::string> childArgs;
+		childArgs.push_back("--nocolor");
+
+		if (!configSource.empty()) {
+			childArgs.push_back("--config");
+			childArgs.push_back(configSource);
+		}
+		if (cmdline->IsSet("isolation-dir")) {
+			childArgs.push_back("--isolation-dir");
+			childArgs.push_back(cmdline->GetString("isolation-dir"));
+		} else if (cmdline->IsSet("isolation")) {
+			childArgs.push_back("--isolation");
+		}
+
+		const int numJobs = cmdline->IsSet("demo-batch-jobs")? cmdline->GetInt("demo-batch-jobs"): Threading::GetLogicalCpuCores();
+		exit(CDemoAnalysis::RunBatch(cmdline->GetString("demo-batch"), std::max(1, numJobs), childArgs));
+	}
+
 	LOG("[%s] command-line args: \"%s\"", __FUNCTION__, cmdline->GetCmdLine().c_str());
 	FileSystemInitializer::PreInitializeConfigHandler(configSource, safemode);
 
@@ -752,6 +777,10 @@ void SpringApp::ParseCmdLine(const std::string& binaryName)
 		}
 		CBenchmark::endFrame = CBenchmark::startFrame + cmdline->GetInt("benchmark") * 60 * GAME_SPEED;
 	}
+
+	if (cmdline->IsSet("demo-analysis")) {
+		CDemoAnalysis::outputFile = cmdline->GetString("demo-analysis");
+	}
 }
 
 
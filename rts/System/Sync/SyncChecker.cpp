@@ -5,9 +5,169 @@
 
 #include "SyncChecker.h"
 
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	// the engine is built without SSE4.2, so use it only if the CPU has it
+	#define CRC32C_HARDWARE
+#endif
+
+
+static const unsigned checksumSeed = 0xfade1eaf;
 
 unsigned CSyncChecker::g_checksum;
+unsigned CSyncChecker::sectionChecksums[SECTION_COUNT];
+CSyncChecker::Section CSyncChecker::curSection = CSyncChecker::SECTION_OTHER;
+unsigned char CSyncChecker::buffer[256];
+unsigned CSyncChecker::bufferPos;
 int CSyncChecker::inSyncedCode;
 
 
+
+unsigned CSyncChecker::GetChecksum()
+{
+	FlushBuffer();
+	sectionChecksums[curSection] = g_checksum;
+
+	return UpdateCRC32C(checksumSeed, sectionChecksums, sizeof(sectionChecksums));
+}
+
+unsigned CSyncChecker::GetSectionChecksum(Section section)
+{
+	FlushBuffer();
+	sectionChecksums[curSection] = g_checksum;
+
+	return sectionChecksums[section];
+}
+
+void CSyncChecker::SetSectionChecksum(Section section, unsigned checksum)
+{
+	// whatever was written before is replaced by the snapshot
+	bufferPos = 0;
+	sectionChecksums[section] = checksum;
+
+	if (section == curSection)
+		g_checksum = checksum;
+}
+
+void CSyncChecker::NewFrame()
+{
+	for (unsigned int n = 0; n < SECTION_COUNT; ++n) {
+		sectionChecksums[n] = checksumSeed;
+	}
+
+	g_checksum = checksumSeed;
+	bufferPos = 0;
+}
+
+CSyncChecker::Section CSyncChecker::SetSection(Section section)
+{
+	const Section prevSection = curSection;
+
+	if (section == curSection)
+		return prevSection;
+
+	FlushBuffer();
+	sectionChecksums[curSection] = g_checksum;
+
+	curSection = section;
+	g_checksum = sectionChecksums[curSection];
+
+	return prevSection;
+}
+
+
+
+// slicing-by-8 tables for the reflected CRC-32C (Castagnoli) polynomial
+static struct CRC32CTables {
+	CRC32CTables() {
+		for (unsigned int n = 0; n < 256; ++n) {
+			unsigned crc = n;
+
+			for (unsigned int k = 0; k < 8; ++k) {
+				crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+			}
+
+			table[0][n] = crc;
+		}
+
+		for (unsigned int n = 0; n < 256; ++n) {
+			for (unsigned int k = 1; k < 8; ++k) {
+				table[k][n] = (table[k - 1][n] >> 8) ^ table[0][table[k - 1][n] & 0xff];
+			}
+		}
+	}
+
+	unsigned table[8][256];
+} crc32cTables;
+
+static unsigned UpdateCRC32CSoftware(unsigned crc, const unsigned char* data, unsigned size)
+{
+	const unsigned (&t)[8][256] = crc32cTables.table;
+
+	for (; size >= 8; size -= 8, data += 8) {
+		unsigned lo; memcpy(&lo, data + 0, 4);
+		unsigned hi; memcpy(&hi, data + 4, 4);
+
+		// little endian
+		lo ^= crc;
+		crc =
+			t[7][(lo      ) & 0xff] ^ t[6][(lo >>  8) & 0xff] ^
+			t[5][(lo >> 16) & 0xff] ^ t[4][(lo >> 24)       ] ^
+			t[3][(hi      ) & 0xff] ^ t[2][(hi >>  8) & 0xff] ^
+			t[1][(hi >> 16) & 0xff] ^ t[0][(hi >> 24)       ];
+	}
+
+	for (; size > 0; --size, ++data) {
+		crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xff];
+	}
+
+	return crc;
+}
+
+#ifdef CRC32C_HARDWARE
+__attribute__((target("sse4.2")))
+static unsigned UpdateCRC32CHardware(unsigned crc, const unsigned char* data, unsigned size)
+{
+#if defined(__x86_64__)
+	unsigned long long crc64 = crc;
+
+	for (; size >= 8; size -= 8, data += 8) {
+		unsigned long long v; memcpy(&v, data, 8);
+		crc64 = __builtin_ia32_crc32di(crc64, v);
+	}
+
+	crc = crc64;
+#endif
+
+	for (; size >= 4; size -= 4, data += 4) {
+		unsigned v; memcpy(&v, data, 4);
+		crc = __builtin_ia32_crc32si(crc, v);
+	}
+
+	for (; size > 0; --size, ++data) {
+		crc = __builtin_ia32_crc32qi(crc, *data);
+	}
+
+	return crc;
+}
+
+static bool HaveCRC32CInstruction()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.2");
+}
+
+static const bool haveCRC32CInstruction = HaveCRC32CInstruction();
+#endif
+
+
+unsigned CSyncChecker::UpdateCRC32C(unsigned crc, const void* data, unsigned size)
+{
+#ifdef CRC32C_HARDWARE
+	if (haveCRC32CInstruction)
+		return UpdateCRC32CHardware(crc, reinterpret_cast<const unsigned char*>(data), size);
+#endif
+
+	return UpdateCRC32CSoftware(crc, reinterpret_cast<const unsigned char*>(data), size);
+}
+
 #endif // SYNCDEBUG
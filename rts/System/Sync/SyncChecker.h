@@ -14,15 +14,51 @@
 #endif
 
 #include <assert.h>
+#include <string.h>
 
 /**
  * @brief sync checker class
  *
  * A Lightweight sync debugger that just keeps a running checksum over all
  * assignments to synced variables.
+ *
+ * Assigned values are collected in a small buffer which is folded into the
+ * checksum (CRC-32C, using the SSE4.2 instruction where available) when it
+ * is full or the checksum is read.
+ * Each section (a phase of the sim frame, see SCOPED_SYNC_SECTION) has its
+ * own running checksum, the overall checksum combines them; comparing the
+ * section checksums of two clients tells where they started to differ.
  */
 class CSyncChecker {
 
+	public:
+		enum Section {
+			SECTION_OTHER = 0,
+			SECTION_LUA,
+			SECTION_PATHING,
+			SECTION_UNITS,
+			SECTION_PROJECTILES,
+			SECTION_FEATURES,
+			SECTION_LOS,
+			SECTION_COUNT
+		};
+
+		static const char* GetSectionName(unsigned int section) {
+			static const char* names[SECTION_COUNT] = {"other", "lua", "pathing", "units", "projectiles", "features", "los"};
+			return ((section < SECTION_COUNT)? names[section]: "unknown");
+		}
+
+		/**
+		 * @brief sends the synced writes to <section> while in scope
+		 */
+		class ScopedSection {
+			public:
+				ScopedSection(Section section): prevSection(SetSection(section)) {}
+				~ScopedSection() { SetSection(prevSection); }
+			private:
+				const Section prevSection;
+		};
+
 	public:
 		/**
 		 * Whether one thread (doesn't have to be the current thread!!!) is currently processing a SimFrame.
@@ -34,65 +70,65 @@ class CSyncChecker {
 		/**
 		 * Keeps a running checksum over all assignments to synced variables.
 		 */
-		static unsigned GetChecksum() { return g_checksum; }
-		static void NewFrame() { g_checksum = 0xfade1eaf; }
+		static unsigned GetChecksum();
+		static unsigned GetSectionChecksum(Section section);
+		/// continue from a checksum saved with a game state snapshot
+		static void SetSectionChecksum(Section section, unsigned checksum);
+		static void NewFrame();
+
+		/// @return the previous section
+		static Section SetSection(Section section);
 
 		static void Sync(const void* p, unsigned size) {
-			// most common cases first, make it easy for compiler to optimize for it
-			// simple xor is not enough to detect multiple zeroes, e.g.
 #ifdef TRACE_SYNC_HEAVY
 			g_checksum = HsiehHash((const char*)p, size, g_checksum);
 #else
-			switch(size) {
-			case 1:
-				g_checksum += *(const unsigned char*)p;
-				g_checksum ^= g_checksum << 10;
-				g_checksum += g_checksum >> 1;
-				break;
-			case 2:
-				g_checksum += *(const unsigned short*)(const char*)p;
-				g_checksum ^= g_checksum << 11;
-				g_checksum += g_checksum >> 17;
-				break;
-			case 3:
-				// just here to make the switch statements contiguous (so it can be optimized)
-				for (unsigned i = 0; i < 3; ++i) {
-					g_checksum += *(const unsigned char*)p + i;
-					g_checksum ^= g_checksum << 10;
-					g_checksum += g_checksum >> 1;
-				}
-				break;
-			case 4:
-				g_checksum += *(const unsigned int*)(const char*)p;
-				g_checksum ^= g_checksum << 16;
-				g_checksum += g_checksum >> 11;
-				break;
-			default:
-			{
-				unsigned i = 0;
-				for (; i < (size & ~3) / 4; ++i) {
-					g_checksum += *(reinterpret_cast<const unsigned int*>(p) + i);
-					g_checksum ^= g_checksum << 16;
-					g_checksum += g_checksum >> 11;
-				}
-				for (; i < size; ++i) {
-					g_checksum += *(const unsigned char*)p + i;
-					g_checksum ^= g_checksum << 10;
-					g_checksum += g_checksum >> 1;
-				}
-				break;
+			// most common case first: a primitive that still fits, the
+			// memcpy is inlined as a single store for those
+			if ((bufferPos + size) <= sizeof(buffer)) {
+				memcpy(buffer + bufferPos, p, size);
+				bufferPos += size;
+				return;
 			}
+
+			FlushBuffer();
+
+			if (size <= sizeof(buffer)) {
+				memcpy(buffer, p, size);
+				bufferPos = size;
+			} else {
+				g_checksum = UpdateCRC32C(g_checksum, p, size);
 			}
 #endif
 		}
 
+		/**
+		 * @brief update a (not pre- or post-inverted) CRC-32C over <size> bytes of <data>
+		 */
+		static unsigned UpdateCRC32C(unsigned crc, const void* data, unsigned size);
+
+	private:
+		static void FlushBuffer() {
+			g_checksum = UpdateCRC32C(g_checksum, buffer, bufferPos);
+			bufferPos = 0;
+		}
+
 	private:
 
 		/**
-		 * The sync checksum
+		 * The running checksum of the current section
 		 */
 		static unsigned g_checksum;
 
+		static unsigned sectionChecksums[SECTION_COUNT];
+		static Section curSection;
+
+		/**
+		 * Synced writes not yet folded into g_checksum
+		 */
+		static unsigned char buffer[256];
+		static unsigned bufferPos;
+
 		/**
 		 * @brief in synced code
 		 *
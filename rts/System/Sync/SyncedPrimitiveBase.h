@@ -70,6 +70,12 @@ namespace Sync {
 #  define LEAVE_SYNCED_CODE()
 #endif
 
+#ifdef SYNCCHECK
+#  define SCOPED_SYNC_SECTION(section) CSyncChecker::ScopedSection mySyncSectionFromMacro(CSyncChecker::section)
+#else
+#  define SCOPED_SYNC_SECTION(section)
+#endif
+
 #ifdef SYNCDEBUG
 #  define ASSERT_SYNCED(x) Sync::AssertDebugger(x)
 #else
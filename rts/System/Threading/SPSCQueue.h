@@ -0,0 +1,125 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace spring {
+
+/**
+ * @brief bounded lock-free queue for exactly one producer and one consumer thread
+ *
+ * The producer only calls TryPush (and SizeApprox), everything else is for the
+ * consumer. Elements between the consumer's end and the producer's end belong
+ * to the consumer, so it can look at, and remove, any of them without locking.
+ */
+template<typename T>
+class SPSCQueue
+{
+public:
+	/// @param capacity rounded up to a power of two
+	SPSCQueue(size_t capacity)
+		: head(0)
+		, tail(0)
+	{
+		size_t size = 1;
+
+		while (size < capacity)
+			size <<= 1;
+
+		slots.resize(size);
+		mask = size - 1;
+	}
+
+	SPSCQueue(const SPSCQueue&) = delete;
+	SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+	size_t Capacity() const { return slots.size(); }
+
+	/// producer: @return false if the queue is full
+	bool TryPush(const T& value) {
+		const size_t t = tail.load(std::memory_order_relaxed);
+
+		if ((t - head.load(std::memory_order_acquire)) == slots.size())
+			return false;
+
+		slots[t & mask] = value;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// exact for the consumer, a lower bound for the producer
+	size_t SizeApprox() const {
+		const size_t h = head.load(std::memory_order_acquire);
+		const size_t t = tail.load(std::memory_order_acquire);
+		return (t - h);
+	}
+
+	bool Empty() const { return (SizeApprox() == 0); }
+
+	/// consumer: @return the element <ahead> places behind the front, NULL if there is none
+	const T* Peek(size_t ahead) const {
+		const size_t h = head.load(std::memory_order_relaxed);
+
+		if (ahead >= (tail.load(std::memory_order_acquire) - h))
+			return NULL;
+
+		return &slots[(h + ahead) & mask];
+	}
+
+	/// consumer: @return false if the queue is empty
+	bool Pop(T& value) {
+		const size_t h = head.load(std::memory_order_relaxed);
+
+		if (h == tail.load(std::memory_order_acquire))
+			return false;
+
+		value = slots[h & mask];
+		slots[h & mask] = T();
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// consumer: remove the element <ahead> places behind the front
+	void Erase(size_t ahead) {
+		const size_t h = head.load(std::memory_order_relaxed);
+
+		if (ahead >= (tail.load(std::memory_order_acquire) - h))
+			return;
+
+		// shift the elements in front of it back by one
+		for (size_t n = h + ahead; n != h; --n) {
+			slots[n & mask] = slots[(n - 1) & mask];
+		}
+
+		slots[h & mask] = T();
+		head.store(h + 1, std::memory_order_release);
+	}
+
+	/// consumer: remove everything pushed so far
+	void Clear() {
+		const size_t t = tail.load(std::memory_order_acquire);
+
+		for (size_t n = head.load(std::memory_order_relaxed); n != t; ++n) {
+			slots[n & mask] = T();
+		}
+
+		head.store(t, std::memory_order_release);
+	}
+
+private:
+	std::vector<T> slots;
+	size_t mask;
+
+	/// written by the consumer only
+	std::atomic<size_t> head;
+	/// written by the producer only
+	std::atomic<size_t> tail;
+};
+
+} // namespace spring
+
+#endif // SPSC_QUEUE_H
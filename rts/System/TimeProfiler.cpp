@@ -2,6 +2,7 @@
 
 #include "System/TimeProfiler.h"
 
+#include <algorithm>
 #include <cstring>
 #include <boost/unordered_map.hpp>
 #include <boost/thread/mutex.hpp>
@@ -250,6 +251,16 @@ void CTimeProfiler::AddTime(const std::string& name, const spring_time time, con
 	}
 }
 
+void CTimeProfiler::SetCounter(const std::string& name, const int value)
+{
+	boost::unique_lock<boost::mutex> ulk(m, boost::defer_lock);
+	while (!ulk.try_lock()) {}
+
+	CounterRecord& c = counters[name];
+	c.current = value;
+	c.peak = std::max(c.peak, value);
+}
+
 void CTimeProfiler::PrintProfilingInfo() const
 {
 	LOG("%35s|%18s|%s", "Part", "Total Time", "Time of the last 0.5s");
@@ -260,4 +271,13 @@ void CTimeProfiler::PrintProfilingInfo() const
 
 		LOG("%35s %16.2fms %5.2f%%", name.c_str(), tr.total.toMilliSecsf(), tr.percent * 100);
 	}
+
+	if (counters.empty())
+		return;
+
+	LOG("%35s|%18s|%s", "Counter", "Current", "Peak");
+
+	for (auto ci = counters.begin(); ci != counters.end(); ++ci) {
+		LOG("%35s %18d %d", ci->first.c_str(), ci->second.current, ci->second.peak);
+	}
 }
@@ -95,6 +95,8 @@ public:
 	void PrintProfilingInfo() const;
 
 	void AddTime(const std::string& name, const spring_time time, const bool showGraph = false);
+	/// record a sampled value (eg. a queue depth), can be called from any thread
+	void SetCounter(const std::string& name, const int value);
 
 public:
 	struct TimeRecord {
@@ -124,7 +126,14 @@ public:
 		bool showGraph;
 	};
 
+	struct CounterRecord {
+		CounterRecord(): current(0), peak(0) {}
+		int current;
+		int peak;
+	};
+
 	std::map<std::string,TimeRecord> profile;
+	std::map<std::string,CounterRecord> counters;
 
 	std::vector<std::deque<std::pair<spring_time,spring_time>>> profileCore;
 
@@ -21,6 +21,9 @@ namespace creg
 		virtual void SerializeInt(void* data, int byteSize) = 0;
 		template <typename T> void SerializeInt(T* data) { SerializeInt(data, sizeof(T)); }
 
+		/// Serialize count consecutive integer values, same format as calling SerializeInt for each
+		virtual void SerializeIntArray(void* data, int byteSize, int count);
+
 		/// Serialize a pointer to an instance of a creg registered class/struct
 		virtual void SerializeObjectPtr(void** ptr, Class* objectClass) = 0;
 		
@@ -31,6 +31,7 @@
 #endif
 
 #include <set>
+#include <vector>
 
 namespace creg
 {
@@ -56,15 +57,35 @@ namespace creg
 			} else {
 				int size;
 				s->SerializeInt(&size, sizeof(int));
+
+				// comparators may dereference the elements (eg. units ordered by id)
+				// which need not be read yet, so insert them once loading is done
+				PendingInserts* pending = new PendingInserts(&ct, size);
+
 				for (int i = 0; i < size; i++) {
-					typename T::value_type v;
-					elemType->Serialize(s, &v);
-					ct.insert(v);
+					elemType->Serialize(s, &pending->elems[i]);
 				}
+
+				s->AddPostLoadCallback(&PendingInserts::Insert, pending);
 			}
 		}
 		std::string GetName() const { return "set<" + elemType->GetName() + ">"; }
 		size_t GetSize() const { return sizeof(T); }
+
+	private:
+		struct PendingInserts {
+			PendingInserts(T* ct, int size): ct(ct), elems(size) {}
+
+			static void Insert(void* userdata) {
+				PendingInserts* pending = static_cast<PendingInserts*>(userdata);
+				pending->ct->insert(pending->elems.begin(), pending->elems.end());
+				delete pending;
+			}
+
+			T* ct;
+			// stable addresses, pointers to embedded objects are fixed in place
+			std::vector<typename T::value_type> elems;
+		};
 	};
 
 
@@ -14,6 +14,7 @@
 #include "System/Platform/byteorder.h"
 #include "System/Exceptions.h"
 
+#include <algorithm>
 #include <fstream>
 #include <assert.h>
 #include <stdexcept>
@@ -31,43 +32,33 @@ using std::vector;
 LOG_REGISTER_SECTION_GLOBAL(LOG_SECTION_CREG_SERIALIZER)
 
 //
-#define CREG_PACKAGE_FILE_ID "CRPK"
+#define CREG_PACKAGE_FILE_ID "CRP2"
 
-// File format structures
+/*
+ * Package layout, written in one pass:
+ *
+ *   PackageHeader
+ *   root object pointer
+ *   { object ID, object data }  for each object only referenced by pointers
+ *   0
+ *
+ * Objects get their IDs in the order they are first referenced. The first
+ * pointer to an object is followed by its class reference, the first class
+ * reference to a class by its name and its metadata checksum, so the loader
+ * can allocate objects as soon as they are referenced. Embedded objects are
+ * written where they are embedded, prefixed with their ID.
+ */
 struct PackageHeader
 {
 	char magic[4];
-	int objDataOffset;
-	int objTableOffset;
-	int numObjects;
-	int objClassRefOffset; // a class ref is: zero-term class string + checksum DWORD
-	int numObjClassRefs;
-	unsigned int metadataChecksum;
-
-	void SwapBytes()
-	{
-		swabDWordInPlace(objDataOffset);
-		swabDWordInPlace(objTableOffset);
-		swabDWordInPlace(objClassRefOffset);
-		swabDWordInPlace(numObjClassRefs);
-		swabDWordInPlace(numObjects);
-		swabDWordInPlace(metadataChecksum);
-	}
-	PackageHeader():
-		objDataOffset(0),
-		objTableOffset(0),
-		numObjects(0),
-		objClassRefOffset(0),
-		numObjClassRefs(0),
-		metadataChecksum(0)
-	{
-		magic[0] = 0;
-		magic[1] = 0;
-		magic[2] = 0;
-		magic[3] = 0;
-	}
 };
 
+// objects written before the pointer table grows
+static const unsigned int PTR_TABLE_INITIAL_BITS = 12;
+// output is passed to the stream in blocks of this size
+static const size_t OUTPUT_BLOCK_SIZE = 64 * 1024;
+// integer arrays are converted in chunks of this many elements
+static const int INT_ARRAY_CHUNK_SIZE = 4096;
 
 
 static std::string ReadZStr(std::istream& file)
@@ -77,33 +68,7 @@ static std::string ReadZStr(std::istream& file)
 	return std::string(cstr);
 }
 
-static void WriteZStr(std::ostream& file, const std::string& str)
-{
-	assert(str.length() < 1024); // check func above!
-	file.write(str.c_str(), str.length() + 1);
-}
-
-void WriteVarSizeUInt(std::ostream* stream, unsigned int val)
-{
-	if (val < 0x80) {
-		unsigned char a = val;
-		stream->write((char*)&a, sizeof(char));
-	} else if (val < 0x4000) {
-		unsigned char a = (val & 0x7F) | 0x80;
-		unsigned char b = val >> 7;
-		stream->write((char*)&a, sizeof(char));
-		stream->write((char*)&b, sizeof(char));
-	} else if (val < 0x40000000) {
-		unsigned char a = (val & 0x7F) | 0x80;
-		unsigned char b = ((val >> 7) & 0x7F) | 0x80;
-		unsigned short c = swabWord(val >> 14);
-		stream->write((char*)&a, sizeof(char));
-		stream->write((char*)&b, sizeof(char));
-		stream->write((char*)&c, sizeof(short));
-	} else throw "Cannot save varible-size int";
-}
-
-void ReadVarSizeUInt(std::istream* stream, unsigned int* buf)
+static void ReadVarSizeUInt(std::istream* stream, unsigned int* buf)
 {
 	unsigned char a;
 	stream->read((char*)&a, sizeof(char));
@@ -122,12 +87,33 @@ void ReadVarSizeUInt(std::istream* stream, unsigned int* buf)
 	}
 }
 
+// ints are always saved as 64bit, int-types might differ
+// in size between platforms and savegames should not
+template<typename T>
+static void WidenInts(const void* src, char* dst, int count)
+{
+	for (int a = 0; a < count; a++) {
+		const boost::int64_t x = ((const T*)src)[a];
+		memcpy(dst + a * sizeof(x), &x, sizeof(x));
+	}
+}
+
+template<typename T>
+static void NarrowInts(const boost::int64_t* src, void* dst, int count)
+{
+	for (int a = 0; a < count; a++) {
+		((T*)dst)[a] = src[a];
+	}
+}
+
 //-------------------------------------------------------------------------
 // Base output serializer
 //-------------------------------------------------------------------------
 COutputStreamSerializer::COutputStreamSerializer()
+	: stream(NULL)
+	, flushedSize(0)
+	, ptrTableBits(0)
 {
-	stream = NULL;
 }
 
 bool COutputStreamSerializer::IsWriting()
@@ -135,23 +121,142 @@ bool COutputStreamSerializer::IsWriting()
 	return true;
 }
 
-COutputStreamSerializer::ObjectRef* COutputStreamSerializer::FindObjectRef(void* inst, creg::Class* objClass, bool isEmbedded)
+void COutputStreamSerializer::Write(const void* data, size_t size)
+{
+	buffer.insert(buffer.end(), (const char*)data, ((const char*)data) + size);
+
+	if (buffer.size() >= OUTPUT_BLOCK_SIZE)
+		FlushBuffer();
+}
+
+void COutputStreamSerializer::FlushBuffer()
+{
+	if (buffer.empty())
+		return;
+
+	stream->write(&buffer[0], buffer.size());
+
+	if (stream->fail())
+		throw std::runtime_error("Failed to write package data");
+
+	flushedSize += buffer.size();
+	buffer.clear();
+}
+
+void COutputStreamSerializer::WriteVarSizeUInt(unsigned int val)
+{
+	if (val < 0x80) {
+		unsigned char a = val;
+		Write(&a, sizeof(char));
+	} else if (val < 0x4000) {
+		unsigned char a[2] = {(unsigned char)((val & 0x7F) | 0x80), (unsigned char)(val >> 7)};
+		Write(a, sizeof(a));
+	} else if (val < 0x40000000) {
+		unsigned char a = (val & 0x7F) | 0x80;
+		unsigned char b = ((val >> 7) & 0x7F) | 0x80;
+		unsigned short c = swabWord(val >> 14);
+		Write(&a, sizeof(char));
+		Write(&b, sizeof(char));
+		Write(&c, sizeof(short));
+	} else throw "Cannot save varible-size int";
+}
+
+void COutputStreamSerializer::WriteClassRef(Class* cls)
 {
-	std::vector<ObjectRef*>* refs = &(ptrToId[inst]);
-	for (std::vector<ObjectRef*>::iterator i = refs->begin(); i != refs->end(); ++i) {
-		if ((*i)->isThisObject(inst, objClass, isEmbedded))
-			return *i;
+	std::map<Class*, unsigned int>::const_iterator it = classIndices.find(cls);
+
+	if (it != classIndices.end()) {
+		WriteVarSizeUInt(it->second);
+		return;
 	}
-	return NULL;
+
+	const unsigned int index = classIndices.size();
+	unsigned int checksum = 0;
+	cls->CalculateChecksum(checksum);
+	swabDWordInPlace(checksum);
+
+	assert(cls->name.length() < 1024); // see ReadZStr
+	classIndices[cls] = index;
+	WriteVarSizeUInt(index);
+	Write(cls->name.c_str(), cls->name.length() + 1);
+	Write(&checksum, sizeof(checksum));
 }
 
-void COutputStreamSerializer::SerializeObject(Class* c, void* ptr, ObjectRef* objr)
+size_t COutputStreamSerializer::GetPtrTableSlot(void* inst) const
 {
-	if (c->base)
-		SerializeObject(c->base, ptr, objr);
+	// fibonacci hashing, the low bits of addresses are mostly zero
+	return (size_t)((boost::uint64_t(size_t(inst)) * 0x9E3779B97F4A7C15ULL) >> (64 - ptrTableBits));
+}
 
-	ObjectMemberGroup omg;
-	omg.membersClass = c;
+void COutputStreamSerializer::GrowPtrTable()
+{
+	ptrTableBits = std::max(ptrTableBits + 1, PTR_TABLE_INITIAL_BITS);
+	ptrTable.clear();
+	ptrTable.resize(size_t(1) << ptrTableBits, 0);
+
+	const size_t mask = ptrTable.size() - 1;
+
+	for (unsigned int id = 1; id < objects.size(); id++) {
+		size_t slot = GetPtrTableSlot(objects[id].ptr);
+
+		while (ptrTable[slot] != 0 && objects[ptrTable[slot]].ptr != objects[id].ptr)
+			slot = (slot + 1) & mask;
+
+		// objects at the same address are chained from the first one
+		if (ptrTable[slot] == 0)
+			ptrTable[slot] = id;
+	}
+}
+
+unsigned int COutputStreamSerializer::FindObjectRef(void* inst, creg::Class* objClass, bool isEmbedded)
+{
+	const size_t mask = ptrTable.size() - 1;
+	size_t slot = GetPtrTableSlot(inst);
+
+	while (ptrTable[slot] != 0 && objects[ptrTable[slot]].ptr != inst)
+		slot = (slot + 1) & mask;
+
+	for (unsigned int id = ptrTable[slot]; id != 0; id = objects[id].nextSamePtr) {
+		if (objects[id].isThisObject(inst, objClass, isEmbedded))
+			return id;
+	}
+	return 0;
+}
+
+unsigned int COutputStreamSerializer::AddObjectRef(void* inst, creg::Class* objClass, bool isEmbedded)
+{
+	const unsigned int id = objects.size();
+
+	// keep the table at most half full
+	if ((objects.size() * 2) >= ptrTable.size())
+		GrowPtrTable();
+
+	objects.push_back(ObjectRef(inst, objClass, isEmbedded));
+
+	const size_t mask = ptrTable.size() - 1;
+	size_t slot = GetPtrTableSlot(inst);
+
+	while (ptrTable[slot] != 0 && objects[ptrTable[slot]].ptr != inst)
+		slot = (slot + 1) & mask;
+
+	if (ptrTable[slot] == 0) {
+		ptrTable[slot] = id;
+	} else {
+		ObjectRef& first = objects[ptrTable[slot]];
+		objects[id].nextSamePtr = first.nextSamePtr;
+		first.nextSamePtr = id;
+	}
+
+	if (!isEmbedded)
+		pendingObjects.push_back(id);
+
+	return id;
+}
+
+void COutputStreamSerializer::SerializeObject(Class* c, void* ptr)
+{
+	if (c->base)
+		SerializeObject(c->base, ptr);
 
 	for (uint a = 0; a < c->members.size(); a++)
 	{
@@ -159,261 +264,146 @@ void COutputStreamSerializer::SerializeObject(Class* c, void* ptr, ObjectRef* ob
 		if (m->flags & CM_NoSerialize)
 			continue;
 
-		ObjectMember om;
-		om.member = m;
-		om.memberId = a;
 		void* memberAddr = ((char*)ptr) + m->offset;
-		unsigned mstart = stream->tellp();
-		LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Serialized %s::%s type:%s", c->name.c_str(), m->name, m->type->GetName().c_str());
+		const size_t mstart = GetPosition();
 		m->type->Serialize(this, memberAddr);
-		unsigned mend = stream->tellp();
-		om.size = mend - mstart;
-		omg.members.push_back(om);
-		omg.size += om.size;
-		LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Serialized %s::%s type:%s size:%d", c->name.c_str(), m->name, m->type->GetName().c_str(), om.size);
+		LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Serialized %s::%s type:%s size:%d", c->name.c_str(), m->name, m->type->GetName().c_str(), int(GetPosition() - mstart));
 	}
 
-
 	if (c->HasSerialize()) {
-		ObjectMember om;
-		om.member = NULL;
-		om.memberId = -1;
-		unsigned mstart = stream->tellp();
 		c->CallSerializeProc(ptr, this);
-		unsigned mend = stream->tellp();
-		om.size = mend - mstart;
-		omg.members.push_back(om);
-		omg.size += om.size;
 	}
-
-	objr->memberGroups.push_back(omg);
 }
 
 void COutputStreamSerializer::SerializeObjectInstance(void* inst, creg::Class* objClass)
 {
 	// register the object, and mark it as embedded if a pointer was already referencing it
-	ObjectRef* obj = FindObjectRef(inst, objClass, true);
-	if (!obj) {
-		objects.push_back(ObjectRef(inst, objects.size(), true, objClass));
-		obj = &objects.back();
-		ptrToId[inst].push_back(obj);
-	} else if (obj->isEmbedded) {
+	unsigned int id = FindObjectRef(inst, objClass, true);
+	if (id == 0) {
+		id = AddObjectRef(inst, objClass, true);
+	} else if (objects[id].isEmbedded) {
 		throw "Reserialization of embedded object (" + objClass->name + ")";
-	} else {
-		std::vector<ObjectRef*>::iterator it = std::find(pendingObjects.begin(), pendingObjects.end(), obj);
-		if (it == pendingObjects.end()) {
-			throw "Object pointer was serialized (" + objClass->name + ")";
-		} else {
-			pendingObjects.erase(it);
-		}
+	} else if (!objects[id].isPending) {
+		throw "Object pointer was serialized (" + objClass->name + ")";
 	}
-	obj->class_ = objClass;
-	obj->isEmbedded = true;
+
+	ObjectRef& obj = objects[id];
+	obj.class_ = objClass;
+	obj.isEmbedded = true;
+	obj.isPending = false;
 
 	// write an object ID
-	WriteVarSizeUInt(stream, obj->id);
+	WriteVarSizeUInt(id);
 
 	// write the object
-	SerializeObject(objClass, inst, obj);
+	SerializeObject(objClass, inst);
 }
 
 void COutputStreamSerializer::SerializeObjectPtr(void** ptr, creg::Class* objClass)
 {
 	if (*ptr) {
-		// valid pointer, write a one and the object ID
-		int id;
-		ObjectRef* obj = FindObjectRef(*ptr, objClass, false);
-		if (!obj) {
-			objects.push_back(ObjectRef(*ptr, objects.size(), false, objClass));
-			obj = &objects.back();
-			ptrToId[*ptr].push_back(obj);
-			pendingObjects.push_back(obj);
-		}
-		id = obj->id;
+		// valid pointer, write the object ID (and its class if it is new)
+		unsigned int id = FindObjectRef(*ptr, objClass, false);
 
-		WriteVarSizeUInt(stream, id);
+		if (id == 0) {
+			id = AddObjectRef(*ptr, objClass, false);
+			WriteVarSizeUInt(id);
+			WriteClassRef(objClass);
+		} else {
+			WriteVarSizeUInt(id);
+		}
 	} else {
 		// null pointer, write a zero
-		WriteVarSizeUInt(stream, 0);
+		WriteVarSizeUInt(0);
 	}
 }
 
 void COutputStreamSerializer::Serialize(void* data, int byteSize)
 {
-	stream->write((char*)data, byteSize);
+	Write(data, byteSize);
 }
 
 void COutputStreamSerializer::SerializeInt(void* data, int byteSize)
 {
-	// always save ints as 64bit
-	// cause of int-types might differ in size depending on platforms
-	// to make savegames compatible between those we need to so
-	boost::int64_t x = 0;
-	switch (byteSize) {
-		case 1: { x = *(boost::int8_t* )data; break; }
-		case 2: { x = *(boost::int16_t*)data; break; }
-		case 4: { x = *(boost::int32_t*)data; break; }
-		case 8: { x = *(boost::int64_t*)data; break; }
-		default: {
-			throw "Unknown int type";
-		}
-	}
-	stream->write((char*)&x, 8);
+	SerializeIntArray(data, byteSize, 1);
 }
 
-
-struct COutputStreamSerializer::ClassRef
+void COutputStreamSerializer::SerializeIntArray(void* data, int byteSize, int count)
 {
-	int index;
-	creg::Class* class_;
-};
+	for (int first = 0; first < count; first += INT_ARRAY_CHUNK_SIZE) {
+		const int chunkSize = std::min(count - first, INT_ARRAY_CHUNK_SIZE);
+		const void* src = ((const char*)data) + first * byteSize;
+
+		const size_t pos = buffer.size();
+		buffer.resize(pos + chunkSize * sizeof(boost::int64_t));
+		char* dst = &buffer[pos];
+
+		switch (byteSize) {
+			case 1: { WidenInts<boost::int8_t >(src, dst, chunkSize); break; }
+			case 2: { WidenInts<boost::int16_t>(src, dst, chunkSize); break; }
+			case 4: { WidenInts<boost::int32_t>(src, dst, chunkSize); break; }
+			case 8: { WidenInts<boost::int64_t>(src, dst, chunkSize); break; }
+			default: {
+				throw "Unknown int type";
+			}
+		}
+
+		if (buffer.size() >= OUTPUT_BLOCK_SIZE)
+			FlushBuffer();
+	}
+}
 
 void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class* rootObjClass)
 {
 	PackageHeader ph;
+	memcpy(ph.magic, CREG_PACKAGE_FILE_ID, 4);
 
 	stream = s;
-	unsigned startOffset = stream->tellp();
-	stream->write((char*)&ph, sizeof(PackageHeader));
-	stream->seekp(startOffset + sizeof(PackageHeader));
-	ph.objDataOffset = (int)stream->tellp();
+	flushedSize = 0;
+	buffer.reserve(OUTPUT_BLOCK_SIZE + INT_ARRAY_CHUNK_SIZE * sizeof(boost::int64_t));
+	Write(&ph, sizeof(PackageHeader));
 
 	// Insert dummy object with id 0
-	objects.push_back(ObjectRef(0, 0, true, 0));
-	ObjectRef* obj = &objects.back();
-	obj->classIndex = 0;
+	objects.push_back(ObjectRef(NULL, NULL, true));
+	GrowPtrTable();
 
-	// Insert the first object that will provide references to everything
-	objects.push_back(ObjectRef(rootObj, objects.size(), false, rootObjClass));
-	obj = &objects.back();
-	ptrToId[rootObj].push_back(obj);
-	pendingObjects.push_back(obj);
+	// The first object provides references to everything
+	SerializeObjectPtr(&rootObj, rootObjClass);
 
-	std::map<creg::Class*, int> classSizes;
 	// Save until all the referenced objects have been stored
 	while (!pendingObjects.empty())
 	{
-		const std::vector<ObjectRef*> po = pendingObjects;
-		pendingObjects.clear();
+		std::vector<unsigned int> po;
+		po.swap(pendingObjects);
 
-		for (std::vector<ObjectRef*>::const_iterator i = po.begin(); i != po.end(); ++i)
+		for (std::vector<unsigned int>::const_iterator i = po.begin(); i != po.end(); ++i)
 		{
-			ObjectRef* obj = *i;
-			const unsigned objstart = stream->tellp();
-			SerializeObject(obj->class_, obj->ptr, obj);
-			const unsigned objend = stream->tellp();
-			const int sz = objend - objstart;
-			classSizes[obj->class_] += sz;
-			LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Serialized %s size:%i", obj->class_->name.c_str(), sz);
-		}
-	}
+			// may have been embedded in the meantime
+			if (!objects[*i].isPending)
+				continue;
 
-	// Collect a set of all used classes
-	std::map<creg::Class*, ClassRef> classMap;
-	std::vector<ClassRef*> classRefs;
-	std::map<int, int> classObjects;
-	for (std::list<ObjectRef>::iterator i = objects.begin(); i != objects.end(); ++i) {
-		if (i->ptr == NULL) continue;
+			objects[*i].isPending = false;
 
-		creg::Class* c = i->class_;
-		while (c) {
-			std::map<creg::Class*, ClassRef>::iterator cr = classMap.find(c);
-			if (cr == classMap.end()) {
-				ClassRef* pRef = &classMap[c];
-				pRef->index = classRefs.size();
-				pRef->class_ = c;
-				classRefs.push_back(pRef);
-			}
-			c = c->base;
+			Class* cls = objects[*i].class_;
+			const size_t objstart = GetPosition();
+			WriteVarSizeUInt(*i);
+			SerializeObject(cls, objects[*i].ptr);
+			LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Serialized %s size:%i", cls->name.c_str(), int(GetPosition() - objstart));
 		}
-
-		std::map<creg::Class*, ClassRef>::iterator cr = classMap.find(i->class_);
-		i->classIndex = cr->second.index;
-		classObjects[i->classIndex]++;
 	}
 
-/*
-	if (LOG_IS_ENABLED(L_DEBUG)) {
-		for (std::map<int, int>::iterator i = classObjects.begin(); i != classObjects.end(); i++) {
-			LOG_L(L_DEBUG, "%20s %10u %10u",
-					classRefs[i->first]->class_->name.c_str(),
-					i->second,
-					classSizes[classRefs[i->first]->class_]);
-		}
-	}
-*/
-
-	// Write the class references & calc their checksum
-	ph.numObjClassRefs = classRefs.size();
-	ph.objClassRefOffset = (int)stream->tellp();
-	for (uint a = 0; a < classRefs.size(); a++) {
-		creg::Class* c =  classRefs[a]->class_;
-		WriteZStr(*stream, c->name);
-	};
-
-	// Write object info
-	ph.objTableOffset = (int)stream->tellp();
-	ph.numObjects = objects.size();
-	for (std::list<ObjectRef>::iterator i = objects.begin(); i != objects.end(); ++i) {
-		int classRefIndex = i->classIndex;
-		char isEmbedded = i->isEmbedded ? 1 : 0;
-		WriteVarSizeUInt(stream, classRefIndex);
-		stream->write((char*)&isEmbedded, sizeof(char));
-
-		char mgcnt = i->memberGroups.size();
-		WriteVarSizeUInt(stream, mgcnt);
-
-		std::vector<COutputStreamSerializer::ObjectMemberGroup>::iterator j;
-		for (j = i->memberGroups.begin(); j != i->memberGroups.end(); ++j) {
-			std::map<creg::Class*, ClassRef>::iterator cr = classMap.find(j->membersClass);
-			if (cr == classMap.end()) throw "Cannot find member class ref";
-			int cid = cr->second.index;
-			WriteVarSizeUInt(stream, cid);
-
-			unsigned int mcnt = j->members.size();
-			WriteVarSizeUInt(stream, mcnt);
-
-			bool hasSerializerMember = false;
-			char groupFlags = 0;
-			if (!j->members.empty() && (j->members.back().memberId == -1)) {
-				groupFlags |= 0x01;
-				hasSerializerMember = true;
-			}
-			stream->write((char*)&groupFlags, sizeof(char));
-
-			int midx = 0;
-			std::vector<COutputStreamSerializer::ObjectMember>::iterator k;
-			for (k = j->members.begin(); k != j->members.end(); ++k, ++midx) {
-				if ((k->memberId != midx) && (!hasSerializerMember || k != (j->members.end() - 1))) {
-					throw "Invalid member id";
-				}
-				WriteVarSizeUInt(stream, k->size);
-			}
-		}
-	}
-
-	// Calculate a checksum for metadata verification
-	ph.metadataChecksum = 0;
-	for (uint a = 0; a < classRefs.size(); a++)
-	{
-		Class* c = classRefs[a]->class_;
-		c->CalculateChecksum(ph.metadataChecksum);
-	}
-
-	int endOffset = stream->tellp();
-	stream->seekp(startOffset);
-	memcpy(ph.magic, CREG_PACKAGE_FILE_ID, 4);
-	ph.SwapBytes();
-	stream->write((const char*)&ph, sizeof(PackageHeader));
+	WriteVarSizeUInt(0);
+	FlushBuffer();
 
 	LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG,
-			"Checksum: %X\nNumber of objects saved: %i\nNumber of classes involved: %i",
-			ph.metadataChecksum, int(objects.size()), int(classRefs.size()));
+			"Number of objects saved: %i\nNumber of classes involved: %i",
+			int(objects.size()), int(classIndices.size()));
 
-	stream->seekp(endOffset);
-	ptrToId.clear();
-	pendingObjects.clear();
 	objects.clear();
+	ptrTable.clear();
+	ptrTableBits = 0;
+	pendingObjects.clear();
+	classIndices.clear();
 }
 
 //-------------------------------------------------------------------------
@@ -427,11 +417,12 @@ CInputStreamSerializer::CInputStreamSerializer()
 
 CInputStreamSerializer::~CInputStreamSerializer()
 {
+	// only left when loading failed
 	for (std::vector<StoredObject>::iterator it = objects.begin(); it != objects.end(); ++it) {
-		if (it->obj) {
-			ClassBinder* binder = classRefs[it->classRef]->binder;
-			binder->class_->DeleteInstance(it->obj);
-		}
+		if (it->obj == NULL || it->isEmbedded)
+			continue;
+
+		it->class_->DeleteInstance(it->obj);
 	}
 }
 
@@ -440,6 +431,36 @@ bool CInputStreamSerializer::IsWriting()
 	return false;
 }
 
+Class* CInputStreamSerializer::ReadClassRef()
+{
+	unsigned int index;
+	ReadVarSizeUInt(stream, &index);
+
+	if (index < classRefs.size())
+		return classRefs[index];
+
+	if (index > classRefs.size() || stream->fail())
+		throw std::runtime_error("Package file contains an invalid class reference");
+
+	const std::string className = ReadZStr(*stream);
+	creg::Class* class_ = System::GetClass(className);
+	if (!class_)
+		throw std::runtime_error("Package file contains reference to unknown class " + className);
+
+	// Calculate metadata checksum and compare with stored checksum
+	unsigned int savedChecksum = 0;
+	unsigned int checksum = 0;
+	stream->read((char*)&savedChecksum, sizeof(savedChecksum));
+	swabDWordInPlace(savedChecksum);
+	class_->CalculateChecksum(checksum);
+	LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Checksum of %s: %X (savegame: %X)", className.c_str(), checksum, savedChecksum);
+	if (checksum != savedChecksum)
+		throw std::runtime_error("Metadata checksum error: Package file was saved with a different version");
+
+	classRefs.push_back(class_);
+	return class_;
+}
+
 void CInputStreamSerializer::SerializeObject(Class* c, void* ptr)
 {
 	if (c->base)
@@ -451,10 +472,9 @@ void CInputStreamSerializer::SerializeObject(Class* c, void* ptr)
 		if (m->flags & CM_NoSerialize)
 			continue;
 
-		const unsigned oldPos = stream->tellg();
 		void* memberAddr = ((char*)ptr) + m->offset;
 		m->type->Serialize(this, memberAddr);
-		LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Deserialized %s::%s type:%s size:%u", c->name.c_str(), m->name, m->type->GetName().c_str(), unsigned(stream->tellg()) - oldPos);
+		LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Deserialized %s::%s type:%s", c->name.c_str(), m->name, m->type->GetName().c_str());
 	}
 
 	if (c->HasSerialize()) {
@@ -469,18 +489,27 @@ void CInputStreamSerializer::Serialize(void* data, int byteSize)
 
 void CInputStreamSerializer::SerializeInt(void* data, int byteSize)
 {
-	// always save ints as 64bit
-	// cause of int-types might differ in size depending on platforms
-	// to make savegames compatible between those we need to so
-	boost::int64_t x = 0;
-	stream->read((char*)&x, 8);
-	switch (byteSize) {
-		case 1: { *(boost::int8_t* )data = x; break; }
-		case 2: { *(boost::int16_t*)data = x; break; }
-		case 4: { *(boost::int32_t*)data = x; break; }
-		case 8: { *(boost::int64_t*)data = x; break; }
-		default: {
-			throw "Unknown int type";
+	SerializeIntArray(data, byteSize, 1);
+}
+
+void CInputStreamSerializer::SerializeIntArray(void* data, int byteSize, int count)
+{
+	boost::int64_t chunk[INT_ARRAY_CHUNK_SIZE];
+
+	for (int first = 0; first < count; first += INT_ARRAY_CHUNK_SIZE) {
+		const int chunkSize = std::min(count - first, INT_ARRAY_CHUNK_SIZE);
+		void* dst = ((char*)data) + first * byteSize;
+
+		stream->read((char*)chunk, chunkSize * sizeof(boost::int64_t));
+
+		switch (byteSize) {
+			case 1: { NarrowInts<boost::int8_t >(chunk, dst, chunkSize); break; }
+			case 2: { NarrowInts<boost::int16_t>(chunk, dst, chunkSize); break; }
+			case 4: { NarrowInts<boost::int32_t>(chunk, dst, chunkSize); break; }
+			case 8: { NarrowInts<boost::int64_t>(chunk, dst, chunkSize); break; }
+			default: {
+				throw "Unknown int type";
+			}
 		}
 	}
 }
@@ -489,19 +518,36 @@ void CInputStreamSerializer::SerializeObjectPtr(void** ptr, creg::Class* cls)
 {
 	unsigned int id;
 	ReadVarSizeUInt(stream, &id);
-	if (id) {
-		StoredObject& o = objects [id];
-		if (o.obj) *ptr = o.obj;
-		else {
-			// The object is not yet available, so it needs fixing afterwards
-			*ptr = (void*) 1;
-			UnfixedPtr ufp;
-			ufp.objID = id;
-			ufp.ptrAddr = ptr;
-			unfixedPointers.push_back(ufp);
-		}
-	} else
+
+	if (id == 0) {
 		*ptr = NULL;
+		return;
+	}
+
+	if (id == objects.size()) {
+		// first reference, create the object so the pointer can be set right away;
+		// it is constructed here because containers (eg. sets ordered by unit-id)
+		// may already look at it before its own data is read
+		StoredObject o;
+		o.class_ = ReadClassRef();
+		o.obj = o.class_->CreateInstance();
+		o.isEmbedded = false;
+		o.isLoaded = false;
+		objects.push_back(o);
+	} else if (id > objects.size() || stream->fail()) {
+		throw std::runtime_error("Package file contains an invalid object reference");
+	}
+
+	const StoredObject& o = objects[id];
+	*ptr = o.obj;
+
+	if (!o.isLoaded) {
+		// the object might still turn out to be embedded
+		UnfixedPtr ufp;
+		ufp.objID = id;
+		ufp.ptrAddr = ptr;
+		unfixedPointers.push_back(ufp);
+	}
 }
 
 // Serialize an instance of an object embedded into another object
@@ -513,11 +559,21 @@ void CInputStreamSerializer::SerializeObjectInstance(void* inst, creg::Class* cl
 	if (id == 0)
 		return; // this is old save game and it has not this object - skip it
 
-	StoredObject& o = objects[id];
-	assert(!o.obj);
-	assert(o.isEmbedded);
+	if (id == objects.size()) {
+		objects.push_back(StoredObject());
+	} else if (id > objects.size() || objects[id].isLoaded || stream->fail()) {
+		throw std::runtime_error("Package file contains an invalid embedded object");
+	} else {
+		// pointers referenced it before, they get fixed once everything is loaded
+		objects[id].class_->DeleteInstance(objects[id].obj);
+	}
 
+	StoredObject& o = objects[id];
 	o.obj = inst;
+	o.class_ = cls;
+	o.isEmbedded = true;
+	o.isLoaded = true;
+
 	SerializeObject(cls, inst);
 }
 
@@ -538,81 +594,58 @@ void CInputStreamSerializer::LoadPackage(std::istream* s, void*& root, creg::Cla
 	stream = s;
 	s->read((char*)&ph, sizeof(PackageHeader));
 
-	if (memcmp(ph.magic, CREG_PACKAGE_FILE_ID, 4))
+	if (s->fail() || memcmp(ph.magic, CREG_PACKAGE_FILE_ID, 4))
 		throw std::runtime_error("Incorrect object package file ID");
 
-	// Load references
-	classRefs.resize(ph.numObjClassRefs);
-	s->seekg(ph.objClassRefOffset);
-	for (int a = 0; a < ph.numObjClassRefs; a++)
-	{
-		const std::string className = ReadZStr(*s);
-		creg::Class* class_ = System::GetClass(className);
-		if (!class_)
-			throw std::runtime_error("Package file contains reference to unknown class " + className);
-		classRefs[a] = class_;
-	}
+	// Insert dummy object with id 0
+	StoredObject nullObj;
+	nullObj.obj = NULL;
+	nullObj.class_ = NULL;
+	nullObj.isEmbedded = true;
+	nullObj.isLoaded = true;
+	objects.push_back(nullObj);
 
-	// Calculate metadata checksum and compare with stored checksum
-	unsigned int checksum = 0;
-	for (uint a = 0; a < classRefs.size(); a++)
-		classRefs[a]->CalculateChecksum(checksum);
-	LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Checksum: %X (savegame: %X)\n", checksum, ph.metadataChecksum);
-	if (checksum != ph.metadataChecksum)
-		throw std::runtime_error("Metadata checksum error: Package file was saved with a different version");
+	SerializeObjectPtr(&root, NULL);
 
-	// Create all non-embedded objects
-	s->seekg(ph.objTableOffset);
-	objects.resize(ph.numObjects);
-	for (int a = 0; a < ph.numObjects; a++)
+	if (root == NULL)
+		throw std::runtime_error("Package file has no root object");
+
+	// Read the objects in the order they were saved, up to the end marker
+	for (;;)
 	{
-		unsigned int classRefIndex;
-		char isEmbedded;
-		unsigned int mgcnt;
-		ReadVarSizeUInt(stream, &classRefIndex);
-		stream->read((char*)&isEmbedded, sizeof(char));
-		ReadVarSizeUInt(stream, &mgcnt);
-
-		for (unsigned int b = 0; b < mgcnt; b++) {
-			unsigned int cid, mcnt;
-			char groupFlags;
-			ReadVarSizeUInt(stream, &cid);
-			ReadVarSizeUInt(stream, &mcnt);
-			stream->read((char*)&groupFlags, sizeof(char));
-			for (unsigned int c = 0; c < mcnt; c++) {
-				unsigned int size;
-				ReadVarSizeUInt(stream, &size);
-			}
-		}
+		unsigned int id;
+		ReadVarSizeUInt(stream, &id);
 
-		objects[a].obj = NULL;
-		if (!isEmbedded) {
-			// Allocate and construct
-			ClassBinder* binder = classRefs[classRefIndex]->binder;
-			void* inst = binder->class_->CreateInstance();
-			objects[a].obj = inst;
-		}
-		objects[a].isEmbedded = !!isEmbedded;
-		objects[a].classRef = classRefIndex;
+		if (id == 0)
+			break;
+
+		if (id >= objects.size() || objects[id].isLoaded || stream->fail())
+			throw std::runtime_error("Package file contains an invalid object");
+
+		// objects may be appended while reading, copy before
+		creg::Class* cls = objects[id].class_;
+		void* obj = objects[id].obj;
+
+		objects[id].isLoaded = true;
+
+		SerializeObject(cls, obj);
+		LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Deserialized %s size:%i", cls->name.c_str(), cls->size);
 	}
 
-	int endOffset = s->tellg();
+	if (stream->fail())
+		throw std::runtime_error("Package file is truncated");
 
-	// Read the object data using serialization
-	s->seekg(ph.objDataOffset);
-	for (uint a = 0; a < objects.size(); a++)
-	{
-		if (!objects[a].isEmbedded) {
-			creg::Class* cls = classRefs[objects[a].classRef];
-			SerializeObject(cls, objects[a].obj);
-			LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Deserialized %s size:%i", cls->name.c_str(), cls->size);
-		}
+	for (uint a = 1; a < objects.size(); a++) {
+		if (!objects[a].isLoaded)
+			throw std::runtime_error("Package file is missing objects");
 	}
 
-	// Fix pointers to embedded objects
+	// Fix pointers to objects that turned out to be embedded
 	for (uint a = 0; a < unfixedPointers.size(); a++) {
-		void* p = objects[unfixedPointers[a].objID].obj;
-		*unfixedPointers[a].ptrAddr = p;
+		const StoredObject& o = objects[unfixedPointers[a].objID];
+
+		if (o.isEmbedded)
+			*unfixedPointers[a].ptrAddr = o.obj;
 	}
 
 	// Run all registered post load callbacks
@@ -623,7 +656,7 @@ void CInputStreamSerializer::LoadPackage(std::istream* s, void*& root, creg::Cla
 	// Run post load functions on `all` objects (exclude root object)
 	for (uint a = 1; a < objects.size(); a++) {
 		StoredObject& o = objects[a];
-		creg::Class* oc = classRefs[objects[a].classRef];
+		creg::Class* oc = o.class_;
 		creg::Class* c = oc;
 		while (c) {
 			if (c->HasPostLoad()) {
@@ -636,16 +669,22 @@ void CInputStreamSerializer::LoadPackage(std::istream* s, void*& root, creg::Cla
 
 	// The first object is the root object
 	root = objects[1].obj;
-	rootCls = classRefs[objects[1].classRef];
+	rootCls = objects[1].class_;
 
 	LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG,
 			"SaveGame loaded.\nNumber of objects loaded: %i\nNumber of classes involved: %i\n",
 			int(objects.size()), int(classRefs.size()));
 
-	s->seekg(endOffset);
 	unfixedPointers.clear();
 	objects.clear();
 }
 
 ISerializer::~ISerializer() {
 }
+
+void ISerializer::SerializeIntArray(void* data, int byteSize, int count)
+{
+	for (int a = 0; a < count; a++) {
+		SerializeInt(((char*)data) + a * byteSize, byteSize);
+	}
+}
@@ -7,8 +7,8 @@
 #include "creg_cond.h"
 #include <map>
 #include <vector>
-#include <list>
 #include <istream>
+#include <ostream>
 
 namespace creg {
 
@@ -20,43 +20,20 @@ namespace creg {
 	class COutputStreamSerializer : public ISerializer
 	{
 	protected:
-		struct ObjectMember {
-			Class::Member* member;
-			int memberId;
-			int size;
-		};
-		struct ObjectMemberGroup {
-			Class* membersClass;
-			std::vector<COutputStreamSerializer::ObjectMember> members;
-			int size;
-		};
 		struct ObjectRef {
-			ObjectRef() {
-				ptr = 0;
-				id=0;
-				classIndex=0;
-				isEmbedded=false;
-				class_=0;
-			}
-			ObjectRef(void* ptr, int id, bool isEmbedded, Class* class_) {
-				this->ptr = ptr;
-				this->id=id;
-				classIndex=0;
-				this->isEmbedded=isEmbedded;
-				this->class_=class_;
-			}
-			ObjectRef(const ObjectRef&src) :memberGroups(src.memberGroups){
-				ptr=src.ptr;
-				id=src.id;
-				classIndex=src.classIndex;
-				isEmbedded=src.isEmbedded;
-				class_=src.class_;
-			}
+			ObjectRef(void* ptr, Class* class_, bool isEmbedded)
+				: ptr(ptr)
+				, class_(class_)
+				, isEmbedded(isEmbedded)
+				, isPending(!isEmbedded)
+				, nextSamePtr(0)
+			{}
 			void* ptr;
-			int id, classIndex;
-			bool isEmbedded;
 			Class* class_;
-			std::vector<COutputStreamSerializer::ObjectMemberGroup> memberGroups;
+			bool isEmbedded;
+			bool isPending; // referenced by a pointer but not written yet
+			unsigned int nextSamePtr; // ID of the next object at the same address, 0 if none
+
 			bool isThisObject(void* objPtr, Class* objClass, bool objEmbedded) const
 			{
 				if (ptr != objPtr) return false;
@@ -74,28 +51,39 @@ namespace creg {
 			}
 		};
 
-		// Temporary class reference
-		struct ClassRef;
-
 		std::ostream* stream;
-		std::map<void*,std::vector<ObjectRef*> > ptrToId;
-		std::list<ObjectRef> objects;
-		std::vector<ObjectRef*> pendingObjects; // these objects still have to be saved
-
-		// Serialize all class names
-		void WriteObjectInfo();
-		// Helper for instance/ptr saving
-		void WriteObjectRef(void* inst, Class* cls, bool embedded);
+		// written to stream in large blocks
+		std::vector<char> buffer;
+		size_t flushedSize;
+
+		// indexed by object ID, 0 is the null object
+		std::vector<ObjectRef> objects;
+		// open addressing table of the first object ID at each address, 0 marks a free slot
+		std::vector<unsigned int> ptrTable;
+		unsigned int ptrTableBits;
+		std::vector<unsigned int> pendingObjects; // these objects still have to be saved
+
+		std::map<Class*, unsigned int> classIndices;
+
+		void Write(const void* data, size_t size);
+		void WriteVarSizeUInt(unsigned int val);
+		void WriteClassRef(Class* cls);
+		void FlushBuffer();
+		size_t GetPosition() const { return flushedSize + buffer.size(); }
+
+		/// @return the ID of the object, 0 if it was not registered yet
+		unsigned int FindObjectRef(void* inst, Class* objClass, bool isEmbedded);
+		unsigned int AddObjectRef(void* inst, Class* objClass, bool isEmbedded);
+		size_t GetPtrTableSlot(void* inst) const;
+		void GrowPtrTable();
 
-		ObjectRef* FindObjectRef(void* inst, Class* objClass, bool isEmbedded);
-
-		void SerializeObject(Class* c, void* ptr, ObjectRef* objr);
+		void SerializeObject(Class* c, void* ptr);
 
 	public:
 		COutputStreamSerializer();
 
 		/** Create a package of the given root object and all the objects that it references
-		 * @param s stream to serialize the data to
+		 * @param s stream to serialize the data to, written sequentially (no seeking)
 		 * @param rootObj the rootObj: the starting point for finding all the objects to save
 		 * @param cls the class of the root object
 		 * This method throws an std::runtime_error when something goes wrong
@@ -117,6 +105,9 @@ namespace creg {
 		/** @see ISerializer::SerializeInt */
 		void SerializeInt(void* data, int byteSize);
 
+		/** @see ISerializer::SerializeIntArray */
+		void SerializeIntArray(void* data, int byteSize, int count);
+
 		/** Empty function, only applies to loading */
 		void AddPostLoadCallback(void (*cb)(void* d), void* d) {}
 	};
@@ -135,13 +126,14 @@ namespace creg {
 			void** ptrAddr;
 			int objID;
 		};
-		std::vector<UnfixedPtr> unfixedPointers; // pointers to embedded objects that haven't been filled yet, because they are not yet loaded
+		std::vector<UnfixedPtr> unfixedPointers; // pointers to objects that were not loaded yet, they might turn out to be embedded
 
 		struct StoredObject
 		{
 			void* obj;
-			int classRef;
+			Class* class_;
 			bool isEmbedded;
+			bool isLoaded; // read (non-embedded objects are created on their first reference)
 		};
 		std::vector<StoredObject> objects;
 
@@ -152,6 +144,7 @@ namespace creg {
 		};
 		std::vector<PostLoadCallback> callbacks;
 
+		Class* ReadClassRef();
 		void SerializeObject(Class* c, void* ptr);
 	public:
 		CInputStreamSerializer();
@@ -172,11 +165,14 @@ namespace creg {
 		/** @see ISerializer::SerializeInt */
 		void SerializeInt(void* data, int byteSize);
 
+		/** @see ISerializer::SerializeIntArray */
+		void SerializeIntArray(void* data, int byteSize, int count);
+
 		/** @see ISerializer::AddPostLoadCallback */
 		void AddPostLoadCallback(void (*cb)(void* userdata), void* userdata);
 
-		/** Load a package that is saved by CInputStreamSerializer
-		 * @param s the input stream to read from
+		/** Load a package that is saved by COutputStreamSerializer
+		 * @param s the input stream to read from, read sequentially up to the end of the package
 		 * @param root the root object address will be assigned to this
 		 * @param rootCls the root object class will be assigned to this
 		 * This method throws an std::runtime_error when something goes wrong */
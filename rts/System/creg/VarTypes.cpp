@@ -23,6 +23,16 @@ void BasicType::Serialize(ISerializer* s, void* inst)
 	s->SerializeInt(inst, GetSize());
 }
 
+void BasicType::SerializeArray(ISerializer* s, void* first, int count, size_t stride)
+{
+	if (stride != size) {
+		IType::SerializeArray(s, first, count, stride);
+		return;
+	}
+
+	s->SerializeIntArray(first, size, count);
+}
+
 std::string BasicType::GetName() const
 {
 	switch(id) {
@@ -19,6 +19,7 @@ namespace creg
 		~BasicType() {}
 
 		void Serialize(ISerializer* s, void* instance);
+		void SerializeArray(ISerializer* s, void* first, int count, size_t stride);
 		std::string GetName() const;
 		size_t GetSize() const;
 
@@ -282,6 +282,13 @@ void Class::CalculateChecksum(unsigned int& checksum)
 IType::~IType() {
 }
 
+void IType::SerializeArray(ISerializer* s, void* first, int count, size_t stride)
+{
+	for (int a = 0; a < count; a++) {
+		Serialize(s, ((char*)first) + a * stride);
+	}
+}
+
 IMemberRegistrator::~IMemberRegistrator() {
 }
 
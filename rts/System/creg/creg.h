@@ -40,6 +40,8 @@ namespace creg {
 		virtual ~IType();
 
 		virtual void Serialize(ISerializer* s, void* instance) = 0;
+		/// Serialize count instances of this type, stride bytes apart
+		virtual void SerializeArray(ISerializer* s, void* first, int count, size_t stride);
 		virtual std::string GetName() const = 0;
 		virtual size_t GetSize() const = 0;
 
@@ -219,6 +221,11 @@ namespace creg {
 // Container Type templates
 // -------------------------------------------------------------------
 
+	/// containers storing their elements contiguously, these are serialized as one array
+	template<typename T> struct IsContiguousContainer { static const bool value = false; };
+	template<typename T, typename A> struct IsContiguousContainer< std::vector<T, A> > { static const bool value = true; };
+	template<typename C, typename Tr, typename A> struct IsContiguousContainer< std::basic_string<C, Tr, A> > { static const bool value = true; };
+
 	// vector,deque container
 	template<typename T>
 	class DynamicArrayType : public IType
@@ -238,20 +245,28 @@ namespace creg {
 			if (s->IsWriting()) {
 				int size = (int)ct.size();
 				s->SerializeInt(&size, sizeof(int));
-				for (int a = 0; a < size; a++) {
-					elemType->Serialize(s, &ct[a]);
-				}
+				SerializeElements(s, ct, size);
 			} else {
 				int size;
 				s->SerializeInt(&size, sizeof(int));
 				ct.resize(size);
+				SerializeElements(s, ct, size);
+			}
+		}
+		std::string GetName() const { return elemType->GetName() + "[]"; }
+		size_t GetSize() const { return sizeof(T); }
+
+	private:
+		void SerializeElements(ISerializer* s, T& ct, int size) {
+			if (IsContiguousContainer<T>::value) {
+				if (size > 0)
+					elemType->SerializeArray(s, &ct[0], size, sizeof(ElemT));
+			} else {
 				for (int a = 0; a < size; a++) {
 					elemType->Serialize(s, &ct[a]);
 				}
 			}
 		}
-		std::string GetName() const { return elemType->GetName() + "[]"; }
-		size_t GetSize() const { return sizeof(T); }
 	};
 
 	class StaticArrayBaseType : public IType
@@ -277,9 +292,7 @@ namespace creg {
 			: StaticArrayBaseType(et, Size, sizeof(ArrayType)/Size) {}
 		void Serialize(ISerializer* s, void* instance)
 		{
-			T* array = (T*)instance;
-			for (int a = 0; a < Size; a++)
-				elemType->Serialize(s, &array[a]);
+			elemType->SerializeArray(s, instance, Size, sizeof(T));
 		}
 	};
 
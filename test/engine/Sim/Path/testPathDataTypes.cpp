@@ -0,0 +1,75 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Sim/Path/Default/PathDataTypes.h"
+
+#include <vector>
+
+#define BOOST_TEST_MODULE PathDataTypes
+#include <boost/test/unit_test.hpp>
+
+// NOTE:
+//   the PF itself needs a loaded map, it can be benchmarked in-game with
+//   requests recorded through the PathRecordFile and PathBenchmarkFile
+//   config settings
+
+
+BOOST_AUTO_TEST_CASE( BucketQueueOrder )
+{
+	std::vector<PathNode> nodes(20000);
+	PathPriorityQueue heapQueue;
+	PathBucketQueue bucketQueue;
+
+	unsigned int seed = 7;
+	unsigned int numPushed = 0;
+	float minCost = 0.0f;
+
+	// interleave pushes and pops with slowly increasing costs, like A* does;
+	// some nodes land below the active bucket and some overflow the range
+	while (numPushed < nodes.size()) {
+		for (unsigned int i = 0; i < 4 && numPushed < nodes.size(); i++) {
+			seed = seed * 1103515245 + 12345;
+
+			PathNode& n = nodes[numPushed++];
+			n.fCost = minCost + ((seed >> 8) % 4096) / 64.0f - 2.0f;
+			n.nodeNum = numPushed;
+
+			heapQueue.push(&n);
+			bucketQueue.push(&n);
+		}
+
+		for (unsigned int i = 0; i < 3 && !heapQueue.empty(); i++) {
+			BOOST_REQUIRE(!bucketQueue.empty());
+			BOOST_CHECK_EQUAL(heapQueue.top()->fCost, bucketQueue.top()->fCost);
+
+			minCost = heapQueue.top()->fCost;
+
+			heapQueue.pop();
+			bucketQueue.pop();
+		}
+	}
+
+	while (!heapQueue.empty()) {
+		BOOST_REQUIRE(!bucketQueue.empty());
+		BOOST_CHECK_EQUAL(heapQueue.top()->fCost, bucketQueue.top()->fCost);
+
+		heapQueue.pop();
+		bucketQueue.pop();
+	}
+
+	BOOST_CHECK(bucketQueue.empty());
+}
+
+
+BOOST_AUTO_TEST_CASE( SearchStateGenerations )
+{
+	PathSearchStateBuffer states(16);
+
+	// cross the generation wrap-around; stale masks must never leak through
+	for (unsigned int n = 0; n < (1 << 16) + 8; n++) {
+		states.NextSearch();
+
+		BOOST_REQUIRE_EQUAL(int(states.GetNodeMask(n % 16)), 0);
+		states.GetNodeState(n % 16).nodeMask = PATHOPT_OPEN;
+		BOOST_REQUIRE_EQUAL(int(states.GetNodeMask(n % 16)), int(PATHOPT_OPEN));
+	}
+}
@@ -0,0 +1,173 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/FileSystem/Archives/BufferedArchive.h"
+
+#include <atomic>
+#include <boost/thread/thread.hpp>
+
+#define BOOST_TEST_MODULE BufferedArchive
+#include <boost/test/unit_test.hpp>
+
+
+namespace {
+	/// file <n> is <n * 100> bytes of (n & 0xff)
+	class CTestArchive : public CBufferedArchive {
+	public:
+		CTestArchive(unsigned int numFiles, size_t cacheSize, bool threadSafe)
+			: CBufferedArchive("test", true, cacheSize)
+			, numFiles(numFiles)
+			, numReads(0)
+			, numConcurrentReads(0)
+			, maxConcurrentReads(0)
+			, threadSafe(threadSafe)
+		{
+			for (unsigned int fid = 0; fid < numFiles; ++fid) {
+				lcNameIndex["file" + std::to_string(fid)] = fid;
+			}
+		}
+
+		bool IsOpen() { return true; }
+		unsigned int NumFiles() const { return numFiles; }
+		void FileInfo(unsigned int fid, std::string& name, int& size) const {
+			name = "file" + std::to_string(fid);
+			size = fid * 100;
+		}
+
+		unsigned int GetNumReads() const { return numReads; }
+		int GetMaxConcurrentReads() const { return maxConcurrentReads; }
+
+	protected:
+		bool GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer) {
+			const int concurrentReads = ++numConcurrentReads;
+
+			for (int n = maxConcurrentReads; n < concurrentReads && !maxConcurrentReads.compare_exchange_weak(n, concurrentReads); ) {}
+
+			boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+			buffer.assign(fid * 100, fid & 0xff);
+
+			--numConcurrentReads;
+			++numReads;
+			return true;
+		}
+		bool IsThreadSafe() const { return threadSafe; }
+
+	private:
+		unsigned int numFiles;
+
+		std::atomic<unsigned int> numReads;
+		std::atomic<int> numConcurrentReads;
+		std::atomic<int> maxConcurrentReads;
+
+		bool threadSafe;
+	};
+}
+
+
+BOOST_AUTO_TEST_CASE(SharedViews)
+{
+	CTestArchive archive(10, 10000, false);
+
+	const FileViewPtr view = archive.GetFileView(5);
+	BOOST_REQUIRE(view);
+	BOOST_CHECK_EQUAL(view->GetSize(), 500);
+	BOOST_CHECK_EQUAL(view->GetData()[499], 5);
+
+	// read once, then shared
+	BOOST_CHECK(archive.GetFileView(5) == view);
+	BOOST_CHECK_EQUAL(archive.GetNumReads(), 1);
+
+	std::vector<boost::uint8_t> buffer;
+	BOOST_CHECK(archive.GetFile(5, buffer));
+	BOOST_CHECK_EQUAL(buffer.size(), 500);
+	BOOST_CHECK_EQUAL(archive.GetNumReads(), 1);
+
+	IArchive& iarchive = archive;
+	BOOST_CHECK(iarchive.GetFileView("file5") == view);
+	BOOST_CHECK(!iarchive.GetFileView("nofile"));
+}
+
+BOOST_AUTO_TEST_CASE(BoundedCache)
+{
+	// room for files 1..4 (1000 bytes)
+	CTestArchive archive(10, 1000, false);
+
+	for (unsigned int fid = 1; fid <= 4; ++fid) {
+		archive.GetFileView(fid);
+	}
+	BOOST_CHECK_EQUAL(archive.GetNumReads(), 4);
+
+	// touch 2 and 1, then 5 needs 500 bytes: 3 and 4 are the least recently used
+	const FileViewPtr view3 = archive.GetFileView(3);
+	archive.GetFileView(2);
+	archive.GetFileView(1);
+	archive.GetFileView(5);
+	BOOST_CHECK_EQUAL(archive.GetNumReads(), 5);
+
+	archive.GetFileView(1);
+	archive.GetFileView(2);
+	archive.GetFileView(5);
+	BOOST_CHECK_EQUAL(archive.GetNumReads(), 5);
+
+	archive.GetFileView(4);
+	BOOST_CHECK_EQUAL(archive.GetNumReads(), 6);
+
+	// evicted views stay valid for whoever holds them
+	BOOST_CHECK_EQUAL(view3->GetSize(), 300);
+	BOOST_CHECK_EQUAL(view3->GetData()[0], 3);
+
+	// too large to keep at all
+	CTestArchive small(20, 1000, false);
+	small.GetFileView(11);
+	small.GetFileView(11);
+	BOOST_CHECK_EQUAL(small.GetNumReads(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentReaders)
+{
+	for (int threadSafe = 0; threadSafe < 2; ++threadSafe) {
+		CTestArchive archive(64, 1 << 20, threadSafe != 0);
+		std::vector<boost::thread*> threads;
+		std::atomic<int> numBadViews(0);
+
+		for (int t = 0; t < 4; ++t) {
+			threads.push_back(new boost::thread([&archive, &numBadViews, t]() {
+				for (unsigned int n = 0; n < archive.NumFiles(); ++n) {
+					const unsigned int fid = (n + t * 16) % archive.NumFiles();
+					const FileViewPtr view = archive.GetFileView(fid);
+
+					// BOOST_CHECK is not thread safe
+					numBadViews += (!view || view->GetSize() != (fid * 100));
+				}
+			}));
+		}
+		for (boost::thread* thread: threads) {
+			thread->join();
+			delete thread;
+		}
+
+		BOOST_CHECK_EQUAL(numBadViews, 0);
+
+		// archives that are not thread safe read one file at a time
+		if (threadSafe == 0)
+			BOOST_CHECK_EQUAL(archive.GetMaxConcurrentReads(), 1);
+
+		// files read by several threads at once may be read twice, but not more
+		BOOST_CHECK_GE(archive.GetNumReads(), archive.NumFiles());
+		BOOST_CHECK_LE(archive.GetNumReads(), archive.NumFiles() * 4);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(Prefetch)
+{
+	CTestArchive archive(10, 10000, true);
+
+	archive.PrefetchFile(3);
+	archive.PrefetchFile(3);
+	BOOST_CHECK_EQUAL(archive.GetNumReads(), 1);
+
+	// served from the cache
+	const FileViewPtr view = archive.GetFileView(3);
+	BOOST_REQUIRE(view);
+	BOOST_CHECK_EQUAL(view->GetSize(), 300);
+	BOOST_CHECK_EQUAL(archive.GetNumReads(), 1);
+}
@@ -2,7 +2,11 @@
 
 #include "System/creg/creg_cond.h"
 #include "System/creg/Serializer.h"
+#include "System/creg/STL_Set.h"
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -78,6 +82,63 @@ CR_REG_METADATA(TestObj, (
 ));
 
 
+// a synthetic state for the save/load benchmark
+struct BenchNode {
+	CR_DECLARE_STRUCT(BenchNode);
+
+	BenchNode() : next(NULL), other(NULL), value(0) {
+		pos[0] = pos[1] = pos[2] = 0.f;
+	}
+
+	BenchNode* next;
+	BenchNode* other;
+	int value;
+	float pos[3];
+	std::vector<int> ints;
+	std::string name;
+};
+
+CR_BIND(BenchNode, );
+CR_REG_METADATA(BenchNode, (
+	CR_MEMBER(next),
+	CR_MEMBER(other),
+	CR_MEMBER(value),
+	CR_MEMBER(pos),
+	CR_MEMBER(ints),
+	CR_MEMBER(name)
+));
+
+// dereferences the nodes, like CUnitSet does with unit ids
+struct BenchNodeComparator {
+	bool operator() (const BenchNode* a, const BenchNode* b) const { return (a->value < b->value); }
+};
+
+struct BenchState {
+	CR_DECLARE_STRUCT(BenchState);
+
+	BenchState() : embeddedPtr(&embedded) {}
+	~BenchState() {
+		for (size_t n = 0; n < nodes.size(); n++) delete nodes[n];
+	}
+
+	// serialized first, so it references nodes before they are read
+	std::set<BenchNode*, BenchNodeComparator> sorted;
+	std::vector<BenchNode*> nodes;
+
+	// referenced before it is serialized as embedded object
+	EmbeddedObj* embeddedPtr;
+	EmbeddedObj embedded;
+};
+
+CR_BIND(BenchState, );
+CR_REG_METADATA(BenchState, (
+	CR_MEMBER(sorted),
+	CR_MEMBER(nodes),
+	CR_MEMBER(embeddedPtr),
+	CR_MEMBER(embedded)
+));
+
+
 static void savetest(std::ostream* os)
 {
 	// root obj
@@ -172,3 +233,87 @@ BOOST_AUTO_TEST_CASE( BOOST_TEST_MODULE )
 
 	delete root;
 }
+
+
+BOOST_AUTO_TEST_CASE( SaveLoadBenchmark )
+{
+	creg::System::InitializeClasses();
+
+	const int numNodes = 20000;
+
+	BenchState* state = new BenchState();
+	state->nodes.resize(numNodes);
+
+	for (int n = 0; n < numNodes; n++) {
+		state->nodes[n] = new BenchNode();
+	}
+	for (int n = 0; n < numNodes; n++) {
+		BenchNode* node = state->nodes[n];
+		node->next = state->nodes[(n + 1) % numNodes];
+		node->other = state->nodes[(n * 7919) % numNodes];
+		node->value = n;
+		node->pos[0] = n * 0.5f;
+		node->ints.resize(8, n);
+		node->name = "node";
+	}
+	for (int n = numNodes - 1; n >= 0; n -= 10) {
+		state->sorted.insert(state->nodes[n]);
+	}
+
+	typedef std::chrono::high_resolution_clock Clock;
+
+	std::stringstream ss(std::ios::in | std::ios::out | std::ios::binary);
+	ss << "prefix";
+
+	const Clock::time_point t0 = Clock::now();
+	{
+		creg::COutputStreamSerializer os;
+		os.SavePackage(&ss, state, state->GetClass());
+	}
+	ss << "suffix";
+
+	const Clock::time_point t1 = Clock::now();
+
+	void* root = NULL;
+	creg::Class* rootCls = NULL;
+	std::string marker(6, 0);
+	ss.read(&marker[0], marker.size());
+	{
+		creg::CInputStreamSerializer is;
+		is.LoadPackage(&ss, root, rootCls);
+	}
+
+	const Clock::time_point t2 = Clock::now();
+
+	BOOST_TEST_MESSAGE("state size: " << ss.str().size() << " bytes");
+	BOOST_TEST_MESSAGE("save: " << std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() << "ms");
+	BOOST_TEST_MESSAGE("load: " << std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count() << "ms");
+
+	BenchState* loaded = static_cast<BenchState*>(root);
+
+	// the package ends where it was written
+	ss.read(&marker[0], marker.size());
+	BOOST_CHECK(marker == "suffix");
+
+	BOOST_CHECK(rootCls == BenchState::StaticClass());
+	BOOST_CHECK(loaded->embeddedPtr == &loaded->embedded);
+	BOOST_REQUIRE(loaded->nodes.size() == numNodes);
+
+	bool nodesEqual = true;
+	for (int n = 0; n < numNodes; n++) {
+		const BenchNode* node = loaded->nodes[n];
+		nodesEqual = nodesEqual && (node->value == n) && (node->pos[0] == n * 0.5f);
+		nodesEqual = nodesEqual && (node->next == loaded->nodes[(n + 1) % numNodes]);
+		nodesEqual = nodesEqual && (node->other == loaded->nodes[(n * 7919) % numNodes]);
+		nodesEqual = nodesEqual && (node->ints.size() == 8) && (node->ints[7] == n) && (node->name == "node");
+	}
+	BOOST_CHECK_MESSAGE(nodesEqual, "test loaded nodes");
+
+	BOOST_REQUIRE(loaded->sorted.size() == state->sorted.size());
+	BOOST_CHECK(std::equal(loaded->sorted.begin(), loaded->sorted.end(), state->sorted.begin(), [](const BenchNode* a, const BenchNode* b) {
+		return (a->value == b->value);
+	}));
+
+	delete loaded;
+	delete state;
+}
@@ -0,0 +1,240 @@
+#include "System/Net/FrameBundle.h"
+#include "System/Net/RawPacket.h"
+#include "Net/Protocol/BaseNetProtocol.h"
+
+#include <cstring>
+#include <vector>
+
+#define BOOST_TEST_MODULE FrameBundle
+#include <boost/test/unit_test.hpp>
+
+typedef boost::shared_ptr<const netcode::RawPacket> PacketType;
+
+
+/// what a server sends during <numFrames> frames of a 4 player game
+static std::vector< std::vector<PacketType> > MakeFrames(int numFrames)
+{
+	CBaseNetProtocol& proto = CBaseNetProtocol::Get();
+	std::vector< std::vector<PacketType> > frames(numFrames);
+
+	for (int f = 1; f <= numFrames; ++f) {
+		std::vector<PacketType>& msgs = frames[f - 1];
+
+		if ((f % 16) == 0) {
+			msgs.push_back(proto.SendKeyFrame(f));
+		} else {
+			msgs.push_back(proto.SendNewFrame());
+		}
+
+		if ((f % 60) == 0) {
+			for (int p = 0; p < 4; ++p) {
+				msgs.push_back(proto.SendSyncResponse(p, f - 2, 0x12345678u * f + p));
+				msgs.push_back(proto.SendPlayerInfo(p, 0.25f * p, 40 + p * 100));
+			}
+		}
+		if ((f % 45) == 0) {
+			msgs.push_back(proto.SendSystemMessage(f & 3, "a system message"));
+			msgs.push_back(proto.SendPlayerName(f & 3, "name"));
+			msgs.push_back(proto.SendPause(f & 3, 0));
+		}
+	}
+
+	return frames;
+}
+
+/// expand bundles back into the messages they contain
+static std::vector<PacketType> Unpack(const std::vector<PacketType>& packets)
+{
+	std::vector<PacketType> msgs;
+
+	for (const PacketType& pkt: packets) {
+		if (pkt->data[0] != NETMSG_FRAMEBUNDLE) {
+			msgs.push_back(pkt);
+			continue;
+		}
+
+		netcode::FrameBundleReader reader(pkt->data, pkt->length);
+		PacketType msg;
+
+		while (reader.Next(msg)) {
+			msgs.push_back(msg);
+		}
+
+		BOOST_CHECK(!reader.Failed());
+	}
+
+	return msgs;
+}
+
+static void CheckEqual(const std::vector<PacketType>& a, const std::vector<PacketType>& b)
+{
+	BOOST_REQUIRE_EQUAL(a.size(), b.size());
+
+	for (size_t n = 0; n < a.size(); ++n) {
+		BOOST_REQUIRE_EQUAL(a[n]->length, b[n]->length);
+		BOOST_CHECK(std::memcmp(a[n]->data, b[n]->data, a[n]->length) == 0);
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(PerFrameBundles)
+{
+	const std::vector< std::vector<PacketType> > frames = MakeFrames(600);
+
+	netcode::FrameBundleWriter writer;
+	std::vector<PacketType> sent;
+	std::vector<PacketType> packets;
+
+	// the server flushes after each update, usually one frame
+	for (const std::vector<PacketType>& msgs: frames) {
+		for (const PacketType& msg: msgs) {
+			writer.Add(msg);
+			sent.push_back(msg);
+		}
+
+		writer.Flush(packets);
+	}
+
+	CheckEqual(Unpack(packets), sent);
+	BOOST_CHECK(writer.Empty());
+	BOOST_CHECK_LT(writer.GetNumFlushedBytes(), writer.GetNumRawBytes());
+
+	BOOST_TEST_MESSAGE("per frame: " << writer.GetNumRawBytes() << " -> " << writer.GetNumFlushedBytes() << " bytes");
+}
+
+BOOST_AUTO_TEST_CASE(CatchupBundles)
+{
+	const std::vector< std::vector<PacketType> > frames = MakeFrames(30 * 60 * 5);
+
+	netcode::FrameBundleWriter writer;
+	std::vector<PacketType> sent;
+	std::vector<PacketType> packets;
+
+	for (const std::vector<PacketType>& msgs: frames) {
+		for (const PacketType& msg: msgs) {
+			writer.Add(msg);
+			sent.push_back(msg);
+		}
+	}
+
+	writer.Flush(packets);
+
+	CheckEqual(Unpack(packets), sent);
+
+	for (const PacketType& pkt: packets) {
+		BOOST_CHECK_LE(pkt->length, netcode::FrameBundleWriter::maxBundleSize);
+	}
+
+	// NEWFRAME runs and keyframe deltas shrink the most, checksums not at all
+	BOOST_CHECK_LT(writer.GetNumFlushedBytes() * 10, writer.GetNumRawBytes() * 7);
+
+	BOOST_TEST_MESSAGE("catch-up: " << writer.GetNumRawBytes() << " -> " << writer.GetNumFlushedBytes() << " bytes in " << packets.size() << " packets");
+}
+
+BOOST_AUTO_TEST_CASE(LongNewFrameRuns)
+{
+	CBaseNetProtocol& proto = CBaseNetProtocol::Get();
+
+	netcode::FrameBundleWriter writer;
+	std::vector<PacketType> sent;
+	std::vector<PacketType> packets;
+
+	for (unsigned n = 0; n < (netcode::FrameBundleWriter::maxNewFrameRun * 5 + 7); ++n) {
+		sent.push_back(proto.SendNewFrame());
+		writer.Add(sent.back());
+	}
+
+	writer.Flush(packets);
+
+	BOOST_REQUIRE_EQUAL(packets.size(), 1);
+	CheckEqual(Unpack(packets), sent);
+}
+
+BOOST_AUTO_TEST_CASE(PassThrough)
+{
+	CBaseNetProtocol& proto = CBaseNetProtocol::Get();
+
+	netcode::FrameBundleWriter writer;
+	std::vector<PacketType> packets;
+
+	// a single message is not worth a bundle
+	const PacketType keyFrame = proto.SendKeyFrame(1234);
+	writer.Add(keyFrame);
+	writer.Flush(packets);
+
+	BOOST_REQUIRE_EQUAL(packets.size(), 1);
+	BOOST_CHECK(packets[0] == keyFrame);
+
+	// unknown message types end the open bundle and keep their place
+	const unsigned char unknown[] = {NETMSG_LAST, 1, 2, 3};
+	const PacketType unknownMsg(new netcode::RawPacket(unknown, sizeof(unknown)));
+
+	std::vector<PacketType> sent;
+
+	for (int n = 0; n < 10; ++n) {
+		sent.push_back(proto.SendNewFrame());
+	}
+
+	sent.push_back(unknownMsg);
+	sent.push_back(proto.SendNewFrame());
+
+	packets.clear();
+
+	for (const PacketType& msg: sent) {
+		writer.Add(msg);
+	}
+
+	writer.Flush(packets);
+
+	BOOST_REQUIRE_EQUAL(packets.size(), 3);
+	BOOST_CHECK_EQUAL(packets[0]->data[0], NETMSG_FRAMEBUNDLE);
+	BOOST_CHECK(packets[1] == unknownMsg);
+	BOOST_CHECK_EQUAL(packets[2]->data[0], NETMSG_NEWFRAME);
+	CheckEqual(Unpack(packets), sent);
+}
+
+BOOST_AUTO_TEST_CASE(MalformedBundles)
+{
+	CBaseNetProtocol& proto = CBaseNetProtocol::Get();
+
+	netcode::FrameBundleWriter writer;
+	std::vector<PacketType> packets;
+
+	writer.Add(proto.SendKeyFrame(16));
+	writer.Add(proto.SendSystemMessage(0, "truncated"));
+	writer.Flush(packets);
+
+	BOOST_REQUIRE_EQUAL(packets.size(), 1);
+	BOOST_REQUIRE_EQUAL(packets[0]->data[0], NETMSG_FRAMEBUNDLE);
+
+	// cut off the system message
+	netcode::FrameBundleReader reader(packets[0]->data, packets[0]->length - 4);
+	PacketType msg;
+
+	BOOST_CHECK(reader.Next(msg));
+	BOOST_CHECK_EQUAL(msg->data[0], NETMSG_KEYFRAME);
+	BOOST_CHECK(!reader.Next(msg));
+	BOOST_CHECK(reader.Failed());
+
+	// bundles do not nest
+	const unsigned char nested[] = {NETMSG_FRAMEBUNDLE, 6, 0, NETMSG_FRAMEBUNDLE, 3, 0};
+	netcode::FrameBundleReader nestedReader(nested, sizeof(nested));
+
+	BOOST_CHECK(!nestedReader.Next(msg));
+	BOOST_CHECK(nestedReader.Failed());
+
+	// NEWFRAME runs beyond maxNewFrameRun are not expanded
+	const unsigned char longRun[] = {NETMSG_FRAMEBUNDLE, 9, 0, NETMSG_NEWFRAME, 0xFF, 0xFF, 0xFF, 0xFF, 0x0F};
+	netcode::FrameBundleReader longRunReader(longRun, sizeof(longRun));
+
+	BOOST_CHECK(!longRunReader.Next(msg));
+	BOOST_CHECK(longRunReader.Failed());
+
+	// neither are bundles larger than a writer produces
+	std::vector<unsigned char> large(netcode::FrameBundleWriter::maxBundleSize + 1, NETMSG_NEWFRAME);
+	large[0] = NETMSG_FRAMEBUNDLE;
+	netcode::FrameBundleReader largeReader(&large[0], large.size());
+
+	BOOST_CHECK(!largeReader.Next(msg));
+	BOOST_CHECK(largeReader.Failed());
+}
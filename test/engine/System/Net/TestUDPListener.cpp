@@ -1,9 +1,30 @@
 
 #include "System/Net/UDPListener.h"
+#include "System/Net/FrameBundle.h"
+#include "System/Net/UDPBatch.h"
+#include "System/Net/UDPConnection.h"
+#include "System/Net/Socket.h"
+#include "System/GlobalConfig.h"
+#include "Net/Protocol/BaseNetProtocol.h"
+
+#include <boost/asio/ip/udp.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/chrono/thread_clock.hpp>
 
 #define BOOST_TEST_MODULE UDPListener
 #include <boost/test/unit_test.hpp>
 
+struct InitFixture {
+	InitFixture() {
+		// the timer can only be initialized once per process
+		spring_clock::PushTickRate();
+		spring_time::setstarttime(spring_time::gettime(true));
+	}
+};
+
+BOOST_GLOBAL_FIXTURE(InitFixture);
+
+
 static inline bool TryBindAddr(netcode::SocketPtr& socket, const char* address) {
 	return netcode::UDPListener::TryBindSocket(11111, &socket, address).empty();
 }
@@ -62,3 +83,256 @@ BOOST_AUTO_TEST_CASE(TryBindSocket)
 	BOOST_CHECK(!TryBindPort(socket, 65537));
 	BOOST_CHECK(!TryBindPort(socket, -1));
 }
+
+
+BOOST_AUTO_TEST_CASE(WaitForNetEvents)
+{
+	using boost::asio::ip::udp;
+
+	udp::socket receiver(netcode::serverservice, udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+	udp::socket sender(netcode::netservice, udp::v4());
+	spring_time t;
+
+	// nothing happens: wait (about) as long as we were told
+	t = spring_gettime();
+	BOOST_CHECK(!netcode::WaitForNetEvents(&receiver, spring_msecs(50)));
+	BOOST_CHECK((spring_gettime() - t) >= spring_msecs(40));
+
+	// a wakeup that came in before we started waiting
+	netcode::WakeupNetService();
+	t = spring_gettime();
+	BOOST_CHECK(!netcode::WaitForNetEvents(&receiver, spring_msecs(5000)));
+	BOOST_CHECK((spring_gettime() - t) < spring_msecs(1000));
+
+	// a wakeup from another thread while waiting
+	boost::thread waker([]() { boost::this_thread::sleep(boost::posix_time::milliseconds(50)); netcode::WakeupNetService(); });
+	t = spring_gettime();
+	BOOST_CHECK(!netcode::WaitForNetEvents(&receiver, spring_msecs(5000)));
+	BOOST_CHECK((spring_gettime() - t) < spring_msecs(1000));
+	waker.join();
+
+	// incoming data
+	const char msg[] = "ping";
+	sender.send_to(boost::asio::buffer(msg), receiver.local_endpoint());
+	t = spring_gettime();
+	BOOST_CHECK(netcode::WaitForNetEvents(&receiver, spring_msecs(5000)));
+	BOOST_CHECK((spring_gettime() - t) < spring_msecs(1000));
+
+	// no socket at all
+	t = spring_gettime();
+	BOOST_CHECK(!netcode::WaitForNetEvents(NULL, spring_msecs(20)));
+	BOOST_CHECK((spring_gettime() - t) >= spring_msecs(10));
+}
+
+
+BOOST_AUTO_TEST_CASE(SharedChunkBuffers)
+{
+	using boost::asio::ip::udp;
+
+	GlobalConfig::Instantiate();
+
+	netcode::SocketPtr sender(new udp::socket(netcode::netservice, udp::endpoint(boost::asio::ip::address_v4::loopback(), 0)));
+	netcode::SocketPtr receiver(new udp::socket(netcode::serverservice, udp::endpoint(boost::asio::ip::address_v4::loopback(), 0)));
+
+	// two links to the same peer sharing one socket, as the server does
+	netcode::UDPConnection conn1(sender, receiver->local_endpoint());
+	netcode::UDPConnection conn2(sender, receiver->local_endpoint());
+	// and the other end of the first one
+	netcode::UDPConnection peer(receiver, sender->local_endpoint());
+	conn1.Unmute();
+	conn2.Unmute();
+
+	// broadcast one message larger than a chunk and one small one
+	const boost::shared_ptr<const netcode::RawPacket> bigMsg(CBaseNetProtocol::Get().SendSystemMessage(0, std::string(600, 'x')));
+	const boost::shared_ptr<const netcode::RawPacket> smallMsg(CBaseNetProtocol::Get().SendKeyFrame(42));
+
+	conn1.SendData(bigMsg); conn1.SendData(smallMsg);
+	conn2.SendData(bigMsg); conn2.SendData(smallMsg);
+	conn1.Flush(true);
+	conn2.Flush(true);
+
+	// the (unacked) chunks of both links refer to the original buffers
+	BOOST_CHECK(bigMsg.use_count() > 2);
+	BOOST_CHECK(smallMsg.use_count() > 2);
+	BOOST_CHECK(conn1.Statistics().find(" 0 bytes copied") != std::string::npos);
+
+	// both links must have sent the same byte-stream
+	for (int n = 0; n < 2; ++n) {
+		std::vector<boost::uint8_t> stream;
+
+		while (stream.size() < (bigMsg->length + smallMsg->length)) {
+			BOOST_REQUIRE(netcode::WaitForNetEvents(receiver.get(), spring_msecs(1000)));
+
+			std::vector<boost::uint8_t> buf(4096);
+			const size_t len = receiver->receive(boost::asio::buffer(buf));
+			netcode::Packet pkt(&buf[0], len);
+
+			BOOST_CHECK_EQUAL(pkt.GetChecksum(), pkt.checksum);
+			BOOST_CHECK_EQUAL(pkt.GetSize(), len);
+
+			for (auto ci = pkt.chunks.begin(); ci != pkt.chunks.end(); ++ci) {
+				const size_t pos = stream.size();
+				stream.resize(pos + (*ci)->chunkSize);
+				(*ci)->CopyTo(&stream[pos]);
+			}
+
+			if (n == 0)
+				peer.ProcessRawPacket(pkt);
+		}
+
+		BOOST_REQUIRE_EQUAL(stream.size(), bigMsg->length + smallMsg->length);
+		BOOST_CHECK(std::equal(bigMsg->data, bigMsg->data + bigMsg->length, stream.begin()));
+		BOOST_CHECK(std::equal(smallMsg->data, smallMsg->data + smallMsg->length, stream.begin() + bigMsg->length));
+	}
+
+	// which reassembles the original messages
+	const boost::shared_ptr<const netcode::RawPacket> recvBigMsg = peer.GetData();
+	const boost::shared_ptr<const netcode::RawPacket> recvSmallMsg = peer.GetData();
+
+	BOOST_REQUIRE(recvBigMsg && recvSmallMsg);
+	BOOST_REQUIRE_EQUAL(recvBigMsg->length, bigMsg->length);
+	BOOST_REQUIRE_EQUAL(recvSmallMsg->length, smallMsg->length);
+	BOOST_CHECK(std::equal(bigMsg->data, bigMsg->data + bigMsg->length, recvBigMsg->data));
+	BOOST_CHECK(std::equal(smallMsg->data, smallMsg->data + smallMsg->length, recvSmallMsg->data));
+	BOOST_CHECK(!peer.HasIncomingData());
+
+	conn1.Close(false);
+	conn2.Close(false);
+	peer.Close(false);
+}
+
+
+BOOST_AUTO_TEST_CASE(FrameBundleUnpacking)
+{
+	using boost::asio::ip::udp;
+
+	GlobalConfig::Instantiate();
+
+	netcode::SocketPtr sender(new udp::socket(netcode::netservice, udp::endpoint(boost::asio::ip::address_v4::loopback(), 0)));
+	netcode::SocketPtr receiver(new udp::socket(netcode::serverservice, udp::endpoint(boost::asio::ip::address_v4::loopback(), 0)));
+
+	netcode::UDPConnection conn(sender, receiver->local_endpoint());
+	netcode::UDPConnection peer(receiver, sender->local_endpoint());
+	conn.Unmute();
+
+	std::vector< boost::shared_ptr<const netcode::RawPacket> > msgs;
+	std::vector< boost::shared_ptr<const netcode::RawPacket> > bundles;
+	netcode::FrameBundleWriter writer;
+
+	for (int f = 1; f <= 32; ++f) {
+		msgs.push_back((f == 16)? CBaseNetProtocol::Get().SendKeyFrame(f): CBaseNetProtocol::Get().SendNewFrame());
+		writer.Add(msgs.back());
+	}
+
+	writer.Flush(bundles);
+	BOOST_REQUIRE_EQUAL(bundles.size(), 1);
+
+	conn.SendData(bundles[0]);
+	conn.Flush(true);
+
+	BOOST_REQUIRE(netcode::WaitForNetEvents(receiver.get(), spring_msecs(1000)));
+
+	std::vector<boost::uint8_t> buf(4096);
+	const size_t len = receiver->receive(boost::asio::buffer(buf));
+	netcode::Packet pkt(&buf[0], len);
+	peer.ProcessRawPacket(pkt);
+
+	// the connection hands out the bundled messages, not the bundle
+	for (size_t n = 0; n < msgs.size(); ++n) {
+		const boost::shared_ptr<const netcode::RawPacket> msg = peer.GetData();
+
+		BOOST_REQUIRE(msg);
+		BOOST_REQUIRE_EQUAL(msg->length, msgs[n]->length);
+		BOOST_CHECK(std::equal(msgs[n]->data, msgs[n]->data + msgs[n]->length, msg->data));
+	}
+
+	BOOST_CHECK(!peer.HasIncomingData());
+
+	conn.Close(false);
+	peer.Close(false);
+}
+
+
+// sends and receives <numRounds> batches of datagrams over loopback on the
+// calling thread, returns the datagrams per second of (thread) cpu time
+static float RunLoopbackBenchmark(bool batched, unsigned numRounds)
+{
+	using boost::asio::ip::udp;
+
+	netcode::SocketPtr sender(new udp::socket(netcode::netservice, udp::endpoint(boost::asio::ip::address_v4::loopback(), 0)));
+	udp::socket receiver(netcode::serverservice, udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+	const udp::endpoint receiverAddr = receiver.local_endpoint();
+
+	netcode::UDPSendBatch sendBatch(sender);
+	netcode::UDPRecvBatch recvBatch;
+
+	// about the size of a typical server->client packet
+	const std::vector<boost::uint8_t> bytes(100, 0x42);
+	const boost::shared_ptr<const netcode::RawPacket> payload(new netcode::RawPacket(&bytes[0], bytes.size()));
+
+	netcode::ChunkPtr chunk(new netcode::Chunk());
+	chunk->chunkNumber = 0;
+	chunk->chunkSize = payload->length;
+	chunk->AddSlice(payload, 0, payload->length);
+
+	netcode::Packet pkt(0, 0);
+	pkt.chunks.push_back(chunk);
+	pkt.checksum = pkt.GetChecksum();
+
+	netcode::EnableBatchedIO(batched);
+
+	typedef boost::chrono::thread_clock Clock;
+
+	const unsigned batchSize = netcode::UDPSendBatch::maxDatagrams;
+	const Clock::time_point t0 = Clock::now();
+	unsigned numReceived = 0;
+
+	for (unsigned r = 0; r < numRounds; ++r) {
+		sendBatch.Begin();
+
+		for (unsigned n = 0; n < batchSize; ++n) {
+			sendBatch.Add(receiverAddr, pkt);
+		}
+
+		sendBatch.Flush();
+
+		for (unsigned roundReceived = 0; roundReceived < batchSize; ) {
+			boost::system::error_code err;
+			const unsigned num = recvBatch.Receive(receiver, err);
+
+			BOOST_REQUIRE(!err);
+
+			// loopback should not lose anything, but do not hang if it does
+			if (num == 0 && !netcode::WaitForNetEvents(&receiver, spring_msecs(100)))
+				break;
+
+			for (unsigned n = 0; n < num; ++n) {
+				BOOST_CHECK_EQUAL(recvBatch.GetSize(n), pkt.GetSize());
+				BOOST_CHECK(recvBatch.GetSender(n) == sender->local_endpoint());
+			}
+
+			roundReceived += num;
+			numReceived += num;
+		}
+	}
+
+	const Clock::time_point t1 = Clock::now();
+	const float secs = boost::chrono::duration_cast<boost::chrono::microseconds>(t1 - t0).count() * 1e-6f;
+
+	BOOST_CHECK_EQUAL(numReceived, numRounds * batchSize);
+
+	netcode::EnableBatchedIO(true);
+	return (numReceived / std::max(secs, 1e-6f));
+}
+
+BOOST_AUTO_TEST_CASE(BatchedLoopbackThroughput)
+{
+	const unsigned numRounds = 2000;
+
+	const float batchedRate = RunLoopbackBenchmark(true, numRounds);
+	const float singleRate = RunLoopbackBenchmark(false, numRounds);
+
+	BOOST_TEST_MESSAGE("batched I/O: " << (netcode::IsBatchedIOEnabled() ? "available" : "unavailable"));
+	BOOST_TEST_MESSAGE("batched: " << batchedRate << " packets/s/core");
+	BOOST_TEST_MESSAGE("single:  " << singleRate << " packets/s/core");
+}
@@ -0,0 +1,144 @@
+#ifndef SYNCCHECK
+	#error "This test requires SYNCCHECK to be defined on the compiler command line."
+#endif
+#include "System/Sync/SyncChecker.h"
+
+#include <vector>
+
+#define BOOST_TEST_MODULE SyncChecker
+#include <boost/test/unit_test.hpp>
+
+
+static std::vector<unsigned char> MakeData(unsigned size, unsigned seed)
+{
+	std::vector<unsigned char> data(size);
+
+	for (unsigned n = 0; n < size; ++n) {
+		data[n] = (n * 31 + seed * 7) ^ (n >> 3);
+	}
+
+	return data;
+}
+
+
+BOOST_AUTO_TEST_CASE(CRC32C)
+{
+	// the standard check value (pre- and post-inverted)
+	const char* check = "123456789";
+	BOOST_CHECK_EQUAL(~CSyncChecker::UpdateCRC32C(~0u, check, 9), 0xE3069283u);
+
+	// updating piecewise must not change the result
+	const std::vector<unsigned char> data = MakeData(1000, 1);
+	const unsigned whole = CSyncChecker::UpdateCRC32C(0x12345678, &data[0], data.size());
+
+	for (unsigned split = 0; split < 20; ++split) {
+		unsigned crc = CSyncChecker::UpdateCRC32C(0x12345678, &data[0], split);
+		crc = CSyncChecker::UpdateCRC32C(crc, &data[split], data.size() - split);
+		BOOST_CHECK_EQUAL(crc, whole);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(BufferedWrites)
+{
+	const std::vector<unsigned char> data = MakeData(5000, 2);
+
+	// all at once (larger than the buffer)
+	CSyncChecker::NewFrame();
+	CSyncChecker::Sync(&data[0], data.size());
+	const unsigned whole = CSyncChecker::GetChecksum();
+
+	// as primitives, reading the checksum in between
+	CSyncChecker::NewFrame();
+	for (unsigned n = 0; n < data.size(); n += 4) {
+		CSyncChecker::Sync(&data[n], 4);
+
+		if ((n % 1000) == 0)
+			CSyncChecker::GetChecksum();
+	}
+	BOOST_CHECK_EQUAL(CSyncChecker::GetChecksum(), whole);
+
+	// odd sizes
+	CSyncChecker::NewFrame();
+	for (unsigned n = 0, size = 1; n < data.size(); n += size, size = (size % 13) + 1) {
+		CSyncChecker::Sync(&data[n], std::min(size, unsigned(data.size()) - n));
+	}
+	BOOST_CHECK_EQUAL(CSyncChecker::GetChecksum(), whole);
+
+	// every byte counts
+	std::vector<unsigned char> changed = data;
+	changed[4321] ^= 1;
+
+	CSyncChecker::NewFrame();
+	CSyncChecker::Sync(&changed[0], changed.size());
+	BOOST_CHECK(CSyncChecker::GetChecksum() != whole);
+}
+
+BOOST_AUTO_TEST_CASE(Sections)
+{
+	const std::vector<unsigned char> units = MakeData(300, 3);
+	const std::vector<unsigned char> projectiles = MakeData(300, 4);
+
+	CSyncChecker::NewFrame();
+	const unsigned seedChecksum = CSyncChecker::GetSectionChecksum(CSyncChecker::SECTION_UNITS);
+
+	{
+		CSyncChecker::ScopedSection section(CSyncChecker::SECTION_UNITS);
+		CSyncChecker::Sync(&units[0], 100);
+
+		{
+			CSyncChecker::ScopedSection section(CSyncChecker::SECTION_PROJECTILES);
+			CSyncChecker::Sync(&projectiles[0], projectiles.size());
+		}
+
+		CSyncChecker::Sync(&units[100], 200);
+	}
+
+	// nested writes go to their own section, the outer section continues
+	BOOST_CHECK_EQUAL(CSyncChecker::GetSectionChecksum(CSyncChecker::SECTION_UNITS), CSyncChecker::UpdateCRC32C(seedChecksum, &units[0], units.size()));
+	BOOST_CHECK_EQUAL(CSyncChecker::GetSectionChecksum(CSyncChecker::SECTION_PROJECTILES), CSyncChecker::UpdateCRC32C(seedChecksum, &projectiles[0], projectiles.size()));
+	BOOST_CHECK_EQUAL(CSyncChecker::GetSectionChecksum(CSyncChecker::SECTION_LOS), seedChecksum);
+
+	const unsigned checksum = CSyncChecker::GetChecksum();
+
+	// a difference in one section shows up there and in the overall checksum only
+	CSyncChecker::NewFrame();
+	{
+		CSyncChecker::ScopedSection section(CSyncChecker::SECTION_UNITS);
+		CSyncChecker::Sync(&units[0], units.size());
+	}
+	{
+		CSyncChecker::ScopedSection section(CSyncChecker::SECTION_PROJECTILES);
+		CSyncChecker::Sync(&projectiles[1], projectiles.size() - 1);
+	}
+
+	BOOST_CHECK(CSyncChecker::GetChecksum() != checksum);
+	BOOST_CHECK_EQUAL(CSyncChecker::GetSectionChecksum(CSyncChecker::SECTION_UNITS), CSyncChecker::UpdateCRC32C(seedChecksum, &units[0], units.size()));
+	BOOST_CHECK(CSyncChecker::GetSectionChecksum(CSyncChecker::SECTION_PROJECTILES) != CSyncChecker::UpdateCRC32C(seedChecksum, &projectiles[0], projectiles.size()));
+}
+
+BOOST_AUTO_TEST_CASE(RestoreSections)
+{
+	const std::vector<unsigned char> data = MakeData(500, 5);
+
+	// what a game loaded from a snapshot does to continue the frame it was taken in
+	CSyncChecker::NewFrame();
+	{
+		CSyncChecker::ScopedSection section(CSyncChecker::SECTION_UNITS);
+		CSyncChecker::Sync(&data[0], 200);
+	}
+	const unsigned partial = CSyncChecker::GetSectionChecksum(CSyncChecker::SECTION_UNITS);
+	{
+		CSyncChecker::ScopedSection section(CSyncChecker::SECTION_UNITS);
+		CSyncChecker::Sync(&data[200], 300);
+	}
+	const unsigned checksum = CSyncChecker::GetChecksum();
+
+	CSyncChecker::NewFrame();
+	{
+		CSyncChecker::ScopedSection section(CSyncChecker::SECTION_UNITS);
+		CSyncChecker::Sync(&data[0], 10);
+		CSyncChecker::SetSectionChecksum(CSyncChecker::SECTION_UNITS, partial);
+		CSyncChecker::Sync(&data[200], 300);
+	}
+	BOOST_CHECK_EQUAL(CSyncChecker::GetChecksum(), checksum);
+}
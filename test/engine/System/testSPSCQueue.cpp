@@ -0,0 +1,120 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/Threading/SPSCQueue.h"
+
+#include <boost/thread/thread.hpp>
+#include <boost/shared_ptr.hpp>
+
+#define BOOST_TEST_MODULE SPSCQueue
+#include <boost/test/unit_test.hpp>
+
+
+BOOST_AUTO_TEST_CASE(Bounded)
+{
+	spring::SPSCQueue<int> queue(5);
+	int value = 0;
+
+	BOOST_CHECK_EQUAL(queue.Capacity(), 8);
+	BOOST_CHECK(queue.Empty());
+	BOOST_CHECK(!queue.Pop(value));
+
+	for (int n = 0; n < 8; ++n) {
+		BOOST_CHECK(queue.TryPush(n));
+	}
+
+	BOOST_CHECK(!queue.TryPush(8));
+	BOOST_CHECK_EQUAL(queue.SizeApprox(), 8);
+
+	// wrap around a few times
+	for (int n = 8; n < 100; ++n) {
+		BOOST_CHECK(queue.Pop(value));
+		BOOST_CHECK_EQUAL(value, n - 8);
+		BOOST_CHECK(queue.TryPush(n));
+	}
+
+	queue.Clear();
+	BOOST_CHECK(queue.Empty());
+}
+
+BOOST_AUTO_TEST_CASE(PeekAndErase)
+{
+	spring::SPSCQueue<int> queue(16);
+
+	for (int n = 0; n < 10; ++n) {
+		queue.TryPush(n);
+	}
+
+	BOOST_REQUIRE(queue.Peek(9) != NULL);
+	BOOST_CHECK_EQUAL(*queue.Peek(9), 9);
+	BOOST_CHECK(queue.Peek(10) == NULL);
+
+	// the order of the other elements is kept
+	queue.Erase(4);
+	queue.Erase(0);
+	queue.Erase(42);
+
+	const int expected[] = {1, 2, 3, 5, 6, 7, 8, 9};
+	int value = 0;
+
+	for (int n: expected) {
+		BOOST_CHECK(queue.Pop(value));
+		BOOST_CHECK_EQUAL(value, n);
+	}
+
+	BOOST_CHECK(queue.Empty());
+}
+
+BOOST_AUTO_TEST_CASE(ProducerConsumer)
+{
+	typedef boost::shared_ptr<const int> ItemType;
+
+	static const int numItems = 200000;
+
+	spring::SPSCQueue<ItemType> queue(64);
+
+	boost::thread producer([&queue]() {
+		for (int n = 0; n < numItems; ++n) {
+			const ItemType item(new int(n));
+
+			while (!queue.TryPush(item)) {
+				boost::this_thread::yield();
+			}
+		}
+	});
+
+	// consume like the client does: look ahead, sometimes remove from the middle
+	int next = 0;
+	int numErased = 0;
+	ItemType item;
+
+	while (next < numItems) {
+		const ItemType* ahead = queue.Peek(1);
+
+		// wait until we can see past the front
+		if (ahead == NULL && next < (numItems - 1)) {
+			boost::this_thread::yield();
+			continue;
+		}
+
+		if (ahead != NULL && (**ahead % 1000) == 1) {
+			BOOST_CHECK_EQUAL(**ahead, next + 1);
+			queue.Erase(1);
+			numErased++;
+			continue;
+		}
+
+		if (!queue.Pop(item)) {
+			boost::this_thread::yield();
+			continue;
+		}
+
+		BOOST_CHECK_EQUAL(*item, next);
+		next += (((next + 1) % 1000) == 1)? 2: 1;
+	}
+
+	producer.join();
+
+	BOOST_CHECK(queue.Empty());
+	BOOST_CHECK_GT(numErased, 0);
+	BOOST_CHECK_LE(numErased, numItems / 1000);
+}
@@ -125,6 +125,46 @@ BOOST_AUTO_TEST_CASE( testThreadPool7 )
 	});
 }
 
+BOOST_AUTO_TEST_CASE( testThreadPool8 )
+{
+	LOG_L(L_WARNING, "testThreadPool8");
+
+	// evaluate-in-parallel then apply-in-order
+	// has to give bit-identical results regardless of the number of threads
+	static const int NUM_ITEMS = 100000;
+
+	const auto RunBatch = [](const int numThreads) -> float {
+		std::vector<float> evals(NUM_ITEMS, 0.0f);
+
+		ThreadPool::SetThreadCount(numThreads);
+
+		for_mt(0, NUM_ITEMS, [&](const int i) {
+			evals[i] = math::sqrt(i * 1.5f) / (1.0f + (i % 7));
+		});
+
+		// order-dependent accumulation, like team resource transfers
+		float pool = 0.0f;
+
+		for (int i = 0; i < NUM_ITEMS; i++) {
+			if (pool >= evals[i]) {
+				pool -= evals[i];
+			} else {
+				pool += evals[i] * 2.0f;
+			}
+		}
+
+		return pool;
+	};
+
+	const float refPool = RunBatch(1);
+
+	for (int n = 2; n <= NUM_THREADS; n++) {
+		BOOST_CHECK(RunBatch(n) == refPool);
+	}
+
+	ThreadPool::SetThreadCount(NUM_THREADS);
+}
+
 struct do_once {
 	do_once()   {}
 	~do_once()  {
@@ -19,9 +19,18 @@ do
 		sync
 		sleep 1
 		LOG=$(mktemp)
+		# the client runs all parallel sections of the sim on one thread while
+		# the host uses its workers, so the server's sync checks compare serial
+		# and parallel updates of the same game state (a desync makes the host
+		# exit with an error)
+		CFG=$(mktemp)
+		if [ -s ~/.config/spring/springsettings.cfg ]; then
+			cat ~/.config/spring/springsettings.cfg >$CFG
+		fi
+		echo "WorkerThreadCount = 1" >>$CFG
 		echo "Starting $HEADLESS client"
 		set +e
-		$HEADLESS connect.txt &>$LOG
+		$HEADLESS --config $CFG connect.txt &>$LOG
 		EXIT=$?
 		# dump log file at exit, to not mix client + server output
 		# FIXME: this merges stdout + stderr
@@ -29,7 +38,7 @@ do
 		cat $LOG
 		echo "=========== Dump of client log file end"
 		set -e
-		rm -f $LOG
+		rm -f $LOG $CFG
 		exit $EXIT
 	fi
 	# don't use 100% cpu in polling
@@ -1,5 +1,6 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include <boost/program_options.hpp>
@@ -9,6 +10,7 @@
 
 #include "Net/Protocol/BaseNetProtocol.h"
 #include "System/LoadSave/DemoReader.h"
+#include "System/Net/FrameBundle.h"
 #include "System/Net/RawPacket.h"
 #include "Sim/Units/CommandAI/Command.h"
 
@@ -25,8 +27,9 @@ When compiling for windows with MinGW, make sure to use the
 no console output (you still could use this.exe > z.tzt though).
 */
 
-void TrafficDump(CDemoReader& reader, bool trafficStats);
+void TrafficDump(CDemoReader& reader, bool trafficStats, int frame);
 void WriteTeamstatHistory(CDemoReader& reader, unsigned team, const std::string& file);
+void BundleStats(CDemoReader& reader);
 
 int main (int argc, char* argv[])
 {
@@ -39,6 +42,8 @@ int main (int argc, char* argv[])
 	p.add("demofile", 1);
 	all.add_options()("help,h", "This one");
 	all.add_options()("dump,d", "Only dump networc traffic saved in demo");
+	all.add_options()("skipto", po::value<int>(), "Start the dump at the closest indexed position before this frame");
+	all.add_options()("bundlestats,b", "Print how much smaller the demo's traffic gets with frame bundles");
 	all.add_options()("stats,s", "Print all game, player and team stats");
 	all.add_options()("header,H", "Print demoheader content");
 	all.add_options()("playerstats,p", "Print playerstats");
@@ -72,7 +77,22 @@ int main (int argc, char* argv[])
 	reader.LoadStats();
 	if (vm.count("dump"))
 	{
-		TrafficDump(reader, true);
+		int frame = 0;
+		if (vm.count("skipto"))
+		{
+			frame = reader.SeekToFrame(vm["skipto"].as<int>());
+			if (frame < 0)
+			{
+				std::cout << "Demo has no seek index, dumping from the start" << std::endl;
+				frame = 0;
+			}
+		}
+		TrafficDump(reader, true, frame);
+		return 0;
+	}
+	if (vm.count("bundlestats"))
+	{
+		BundleStats(reader);
 		return 0;
 	}
 	if (vm.count("teamsstatcsv"))
@@ -203,11 +223,10 @@ void PrintBinary(void* buf, int len)
 	std::cout << std::dec; //reset to decimal
 }
 
-void TrafficDump(CDemoReader& reader, bool trafficStats)
+void TrafficDump(CDemoReader& reader, bool trafficStats, int frame)
 {
 	InitCommandNames();
 	std::vector<unsigned> trafficCounter(NETMSG_LAST, 0);
-	int frame = 0;
 	int cmdId = 0;
 	while (!reader.ReachedEnd())
 	{
@@ -407,6 +426,61 @@ void TrafficDump(CDemoReader& reader, bool trafficStats)
 	}
 }
 
+/*
+Demos contain the messages the server broadcast, each with the time of
+the server update that sent it. Bundle them like the server does (one
+bundle per update), and like a midgame join's catch-up (all at once).
+Chunk and UDP headers are not included.
+*/
+void BundleStats(CDemoReader& reader)
+{
+	CBaseNetProtocol::Get(); // registers the message types
+
+	netcode::FrameBundleWriter updateBundles;
+	netcode::FrameBundleWriter catchupBundles;
+	std::vector< boost::shared_ptr<const netcode::RawPacket> > updatePackets;
+	std::vector< boost::shared_ptr<const netcode::RawPacket> > catchupPackets;
+
+	size_t numMessages = 0;
+	size_t numUpdates = 0;
+	float updateTime = -1.0f;
+
+	while (!reader.ReachedEnd())
+	{
+		const float msgTime = reader.GetNextDemoReadTime();
+		netcode::RawPacket* packet = reader.GetData(3.402823466e+38f);
+		if (packet == NULL)
+			continue;
+
+		if (msgTime != updateTime)
+		{
+			updateBundles.Flush(updatePackets);
+			updateTime = msgTime;
+			++numUpdates;
+		}
+
+		const boost::shared_ptr<const netcode::RawPacket> msg(packet);
+		updateBundles.Add(msg);
+		catchupBundles.Add(msg);
+		++numMessages;
+
+		// only the sizes are of interest
+		updatePackets.clear();
+	}
+
+	updateBundles.Flush(updatePackets);
+	catchupBundles.Flush(catchupPackets);
+
+	const size_t rawBytes = updateBundles.GetNumRawBytes();
+	const double rawDiv = std::max<size_t>(rawBytes, 1) * 0.01;
+
+	std::cout << "messages: " << numMessages << " in " << numUpdates << " updates, " << rawBytes << " bytes" << std::endl;
+	std::cout << "bundled per update: " << updateBundles.GetNumFlushedBytes() << " bytes ("
+		<< std::setprecision(3) << (updateBundles.GetNumFlushedBytes() / rawDiv) << "%)" << std::endl;
+	std::cout << "bundled catch-up: " << catchupBundles.GetNumFlushedBytes() << " bytes in " << catchupPackets.size() << " packets ("
+		<< std::setprecision(3) << (catchupBundles.GetNumFlushedBytes() / rawDiv) << "%)" << std::endl;
+}
+
 template<typename T>
 void PrintSep(std::ofstream& file, T value)
 {
@@ -48,6 +48,21 @@ static bool TestLuaParser();
 /******************************************************************************/
 /******************************************************************************/
 
+static string GetListJSON(int (*getList)(char*, int))
+{
+    int size = getList(NULL, 0);
+    if (size < 0) {
+      return "";
+    }
+    std::vector<char> buf(size + 1);
+    // the list may have grown in between
+    while ((size = getList(&buf[0], buf.size())) >= (int) buf.size()) {
+      buf.resize(size + 1);
+    }
+    return (size < 0)? "": string(&buf[0], size);
+}
+
+
 static void PrintMapInfo(const string& mapName)
 {
     const int map_count = GetMapCount();
@@ -165,6 +180,12 @@ int main(int argc, char** argv)
     }
   }
 
+  // the same, as JSON documents
+  const string mapList = GetListJSON(GetMapListJSON);
+  const string modList = GetListJSON(GetPrimaryModListJSON);
+  printf("  MAP LIST JSON:  %u bytes\n", (unsigned) mapList.size());
+  printf("  GAME LIST JSON: %u bytes\n", (unsigned) modList.size());
+
   // load the mod archives
   AddAllArchives(mod.c_str());
 
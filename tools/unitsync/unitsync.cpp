@@ -7,6 +7,7 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <boost/thread/mutex.hpp>
 
 // shared with spring:
 #include "lib/lua/include/LuaInclude.h"
@@ -26,6 +27,7 @@
 #include "System/FileSystem/DataDirsAccess.h"
 #include "System/FileSystem/DataDirLocater.h"
 #include "System/FileSystem/FileHandler.h"
+#include "System/FileSystem/FileQueryFlags.h"
 #include "System/FileSystem/VFSHandler.h"
 #include "System/FileSystem/FileSystem.h"
 #include "System/FileSystem/FileSystemInitializer.h"
@@ -200,10 +202,13 @@ void LoadGameDataUnitDefs() {
 // error handling
 
 static std::string lastError;
+static boost::mutex lastErrorMutex;
 
 static void _SetLastError(const std::string& err)
 {
 	LOG_L(L_ERROR, "%s", err.c_str());
+
+	boost::mutex::scoped_lock lck(lastErrorMutex);
 	lastError = err;
 }
 
@@ -225,11 +230,15 @@ EXPORT(const char*) GetNextError()
 {
 	try {
 		// queue is only 1 element long now for simplicity :-)
+		std::string err;
+
+		{
+			boost::mutex::scoped_lock lck(lastErrorMutex);
+			std::swap(err, lastError);
+		}
 
-		if (lastError.empty()) return NULL;
+		if (err.empty()) return NULL;
 
-		std::string err = lastError;
-		lastError.clear();
 		return GetStr(err);
 	}
 	UNITSYNC_CATCH_BLOCKS;
@@ -313,10 +322,12 @@ EXPORT(bool) IsSpringReleaseVersion()
 
 
 static void internal_deleteMapInfos();
+static void internal_deleteBatchMapInfos();
 
 static void _Cleanup()
 {
 	internal_deleteMapInfos();
+	internal_deleteBatchMapInfos();
 
 	lpClose();
 	LOG("deinitialized");
@@ -987,24 +998,164 @@ EXPORT(float) GetMapPosZ(int index, int posIndex) {
 }
 
 
+//////////////////////////
+//////////////////////////
+
+// map section cache
+//
+// The SMF header, minimaps and info maps of maps are kept in the cache-dir,
+// keyed by the complete checksum of the map. Once a map has been seen,
+// browsing it only reads these small files instead of loading its archives
+// and the whole map file.
+
+static const char MAP_CACHE_MAGIC[8] = {'S', 'P', 'R', 'I', 'N', 'G', 'M', 'S'};
+static const boost::uint32_t MAP_CACHE_FORMAT_VER = 1;
+
+/// minimap mip levels cached along with any other (256x256 and smaller)
+static const int MAP_CACHE_THUMBNAIL_MIP = 2;
+
+static std::string GetMapCacheFileName(const std::string& mapName, const std::string& section)
+{
+	const unsigned int checksum = archiveScanner->GetArchiveCompleteChecksum(mapName);
+	const std::string cacheDir = dataDirsAccess.LocateDir(FileSystem::GetCacheDir() + "/maps/", FileQueryFlags::WRITE | FileQueryFlags::CREATE_DIRS);
+
+	if (checksum == 0 || cacheDir.empty())
+		return "";
+
+	char fileName[32];
+	SNPRINTF(fileName, sizeof(fileName), "%08x.", checksum);
+
+	return (cacheDir + fileName + section);
+}
+
+/// @return false if the section is not cached
+static bool ReadMapCache(const std::string& mapName, const std::string& section, std::vector<boost::uint8_t>& data)
+{
+	const std::string fileName = GetMapCacheFileName(mapName, section);
+
+	if (fileName.empty())
+		return false;
+
+	FILE* in = fopen(fileName.c_str(), "rb");
+
+	if (in == NULL)
+		return false;
+
+	char magic[sizeof(MAP_CACHE_MAGIC)];
+	boost::uint32_t version = 0;
+	boost::uint32_t size = 0;
+
+	bool valid = true;
+	valid = valid && (fread(magic, sizeof(magic), 1, in) == 1) && (memcmp(magic, MAP_CACHE_MAGIC, sizeof(magic)) == 0);
+	valid = valid && (fread(&version, sizeof(version), 1, in) == 1) && (version == MAP_CACHE_FORMAT_VER);
+	valid = valid && (fread(&size, sizeof(size), 1, in) == 1);
+
+	if (valid) {
+		data.resize(size);
+		valid = (size == 0) || (fread(&data[0], size, 1, in) == 1);
+	}
+
+	fclose(in);
+	return valid;
+}
+
+static void WriteMapCache(const std::string& mapName, const std::string& section, const void* data, size_t size)
+{
+	const std::string fileName = GetMapCacheFileName(mapName, section);
+
+	if (fileName.empty())
+		return;
+
+	// write to a temporary first, an interrupted write must not leave a partial entry behind
+	const std::string tmpFileName = fileName + ".tmp";
+	const boost::uint32_t size32 = size;
+
+	FILE* out = fopen(tmpFileName.c_str(), "wb");
+	if (out == NULL) {
+		LOG_L(L_WARNING, "failed to write map cache entry \"%s\"", tmpFileName.c_str());
+		return;
+	}
+
+	bool written = true;
+	written = written && (fwrite(MAP_CACHE_MAGIC, sizeof(MAP_CACHE_MAGIC), 1, out) == 1);
+	written = written && (fwrite(&MAP_CACHE_FORMAT_VER, sizeof(MAP_CACHE_FORMAT_VER), 1, out) == 1);
+	written = written && (fwrite(&size32, sizeof(size32), 1, out) == 1);
+	written = written && ((size == 0) || (fwrite(data, size, 1, out) == 1));
+
+	if ((fclose(out) == EOF) || !written) {
+		LOG_L(L_WARNING, "failed to write map cache entry \"%s\"", tmpFileName.c_str());
+		remove(tmpFileName.c_str());
+		return;
+	}
+
+#ifdef _WIN32
+	// rename does not replace existing files there
+	remove(fileName.c_str());
+#endif
+
+	if (rename(tmpFileName.c_str(), fileName.c_str()) != 0) {
+		LOG_L(L_WARNING, "failed to write map cache entry \"%s\"", fileName.c_str());
+		remove(tmpFileName.c_str());
+	}
+}
+
+
+static SMFHeader GetMapHeader(const std::string& mapName)
+{
+	std::vector<boost::uint8_t> data;
+	SMFHeader header;
+
+	if (ReadMapCache(mapName, "header", data) && data.size() == sizeof(header)) {
+		memcpy(&header, &data[0], sizeof(header));
+		return header;
+	}
+
+	const std::string mapFile = GetMapFile(mapName);
+	ScopedMapLoader mapLoader(mapName, mapFile);
+	CSMFMapFile file(mapFile);
+
+	header = file.GetHeader();
+	WriteMapCache(mapName, "header", &header, sizeof(header));
+	return header;
+}
+
+/// @return the height range of a map, including overrides from its mapinfo
+static std::pair<float, float> GetMapHeightRange(const std::string& mapName)
+{
+	std::vector<boost::uint8_t> data;
+	std::pair<float, float> range;
+
+	if (ReadMapCache(mapName, "heightrange", data) && data.size() == sizeof(float) * 2) {
+		memcpy(&range.first,  &data[0],             sizeof(float));
+		memcpy(&range.second, &data[sizeof(float)], sizeof(float));
+		return range;
+	}
+
+	const std::string mapFile = GetMapFile(mapName);
+	ScopedMapLoader loader(mapName, mapFile);
+	CSMFMapFile file(mapFile);
+	MapParser parser(mapFile);
+
+	const SMFHeader& header = file.GetHeader();
+	const LuaTable rootTable = parser.GetRoot();
+	const LuaTable smfTable = rootTable.SubTable("smf");
+
+	// the mapinfo overrides the header's values
+	range.first  = smfTable.GetFloat("minHeight", header.minHeight);
+	range.second = smfTable.GetFloat("maxHeight", header.maxHeight);
+
+	const float values[2] = {range.first, range.second};
+	WriteMapCache(mapName, "heightrange", values, sizeof(values));
+	return range;
+}
+
+
 EXPORT(float) GetMapMinHeight(const char* mapName) {
 	try {
 		CheckInit();
-		const std::string mapFile = GetMapFile(mapName);
-		ScopedMapLoader loader(mapName, mapFile);
-		CSMFMapFile file(mapFile);
-		MapParser parser(mapFile);
-
-		const SMFHeader& header = file.GetHeader();
-		const LuaTable rootTable = parser.GetRoot();
-		const LuaTable smfTable = rootTable.SubTable("smf");
+		CheckNullOrEmpty(mapName);
 
-		if (smfTable.KeyExists("minHeight")) {
-			// override the header's minHeight value
-			return (smfTable.GetFloat("minHeight", 0.0f));
-		} else {
-			return (header.minHeight);
-		}
+		return (GetMapHeightRange(mapName).first);
 	}
 	UNITSYNC_CATCH_BLOCKS;
 	return 0.0f;
@@ -1013,21 +1164,9 @@ EXPORT(float) GetMapMinHeight(const char* mapName) {
 EXPORT(float) GetMapMaxHeight(const char* mapName) {
 	try {
 		CheckInit();
-		const std::string mapFile = GetMapFile(mapName);
-		ScopedMapLoader loader(mapName, mapFile);
-		CSMFMapFile file(mapFile);
-		MapParser parser(mapFile);
-
-		const SMFHeader& header = file.GetHeader();
-		const LuaTable rootTable = parser.GetRoot();
-		const LuaTable smfTable = rootTable.SubTable("smf");
+		CheckNullOrEmpty(mapName);
 
-		if (smfTable.KeyExists("maxHeight")) {
-			// override the header's maxHeight value
-			return (smfTable.GetFloat("maxHeight", 0.0f));
-		} else {
-			return (header.maxHeight);
-		}
+		return (GetMapHeightRange(mapName).second);
 	}
 	UNITSYNC_CATCH_BLOCKS;
 	return 0.0f;
@@ -1145,16 +1284,12 @@ static unsigned short* GetMinimapSM3(std::string mapFileName, int mipLevel)
 	*/
 }
 
-static unsigned short* GetMinimapSMF(std::string mapFileName, int mipLevel)
+/// decodes a DXT1 compressed minimap of size mipsize*mipsize into imgbuf
+static unsigned short* DecodeMinimapSMF(const std::vector<boost::uint8_t>& buffer, int mipsize)
 {
-	CSMFMapFile in(mapFileName);
-	std::vector<uint8_t> buffer;
-	const int mipsize = in.ReadMinimap(buffer, mipLevel);
-
-	// Do stuff
 	unsigned short* colors = (unsigned short*)((void*)imgbuf);
 
-	unsigned char* temp = &buffer[0];
+	const unsigned char* temp = &buffer[0];
 
 	const int numblocks = buffer.size()/8;
 	for ( int i = 0; i < numblocks; i++ ) {
@@ -1205,6 +1340,37 @@ static unsigned short* GetMinimapSMF(std::string mapFileName, int mipLevel)
 	return colors;
 }
 
+/**
+ * Reads the DXT1 data of a minimap mip level, from the map cache if possible.
+ * When the map has to be opened, the small mip levels are cached too, as
+ * lobbies usually ask for thumbnails of all maps.
+ */
+static int ReadMinimapSMF(const std::string& mapName, int mipLevel, std::vector<boost::uint8_t>& buffer)
+{
+	const int mipsize = 1024 >> mipLevel;
+
+	if (ReadMapCache(mapName, "minimap" + IntToString(mipLevel), buffer) && buffer.size() == ((mipsize + 3) / 4) * ((mipsize + 3) / 4) * 8)
+		return mipsize;
+
+	const std::string mapFile = GetMapFile(mapName);
+	ScopedMapLoader mapLoader(mapName, mapFile);
+	CSMFMapFile in(mapFile);
+
+	std::vector<boost::uint8_t> mipBuffer;
+
+	for (int level = MAP_CACHE_THUMBNAIL_MIP; level < MINIMAP_NUM_MIPMAP; ++level) {
+		if (level == mipLevel)
+			continue;
+
+		in.ReadMinimap(mipBuffer, level);
+		WriteMapCache(mapName, "minimap" + IntToString(level), &mipBuffer[0], mipBuffer.size());
+	}
+
+	in.ReadMinimap(buffer, mipLevel);
+	WriteMapCache(mapName, "minimap" + IntToString(mipLevel), &buffer[0], buffer.size());
+	return mipsize;
+}
+
 EXPORT(unsigned short*) GetMinimap(const char* mapName, int mipLevel)
 {
 	try {
@@ -1215,13 +1381,15 @@ EXPORT(unsigned short*) GetMinimap(const char* mapName, int mipLevel)
 			throw std::out_of_range("Miplevel must be between 0 and 8 (inclusive) in GetMinimap.");
 
 		const std::string mapFile = GetMapFile(mapName);
-		ScopedMapLoader mapLoader(mapName, mapFile);
 
 		unsigned short* ret = NULL;
 		const std::string extension = FileSystem::GetExtension(mapFile);
 		if (extension == "smf") {
-			ret = GetMinimapSMF(mapFile, mipLevel);
+			std::vector<boost::uint8_t> buffer;
+			const int mipsize = ReadMinimapSMF(mapName, mipLevel, buffer);
+			ret = DecodeMinimapSMF(buffer, mipsize);
 		} else if (extension == "sm3") {
+			ScopedMapLoader mapLoader(mapName, mapFile);
 			ret = GetMinimapSM3(mapFile, mipLevel);
 		}
 
@@ -1232,6 +1400,42 @@ EXPORT(unsigned short*) GetMinimap(const char* mapName, int mipLevel)
 }
 
 
+/**
+ * Reads an info map in its native format (16 bit for the heightmap, else 8 bit),
+ * from the map cache if possible.
+ * @return false if the map has no info map of that name (e.g. no grass)
+ */
+static bool ReadInfoMapSMF(const std::string& mapName, const std::string& name, std::vector<boost::uint8_t>& data)
+{
+	MapBitmapInfo bmInfo;
+	CSMFMapFile::GetInfoMapSize(GetMapHeader(mapName), name, &bmInfo);
+
+	const size_t size = bmInfo.width * bmInfo.height * ((name == "height")? sizeof(unsigned short): 1);
+
+	if (size == 0)
+		return false;
+
+	// an empty entry records that the map lacks this info map
+	if (ReadMapCache(mapName, "infomap-" + name, data) && (data.empty() || data.size() == size))
+		return !data.empty();
+
+	const std::string mapFile = GetMapFile(mapName);
+	ScopedMapLoader mapLoader(mapName, mapFile);
+	CSMFMapFile file(mapFile);
+
+	data.resize(size);
+
+	if (!file.ReadInfoMap(name, &data[0])) {
+		data.clear();
+		WriteMapCache(mapName, "infomap-" + name, NULL, 0);
+		return false;
+	}
+
+	WriteMapCache(mapName, "infomap-" + name, &data[0], data.size());
+	return true;
+}
+
+
 EXPORT(int) GetInfoMapSize(const char* mapName, const char* name, int* width, int* height)
 {
 	try {
@@ -1241,12 +1445,9 @@ EXPORT(int) GetInfoMapSize(const char* mapName, const char* name, int* width, in
 		CheckNull(width);
 		CheckNull(height);
 
-		const std::string mapFile = GetMapFile(mapName);
-		ScopedMapLoader mapLoader(mapName, mapFile);
-		CSMFMapFile file(mapFile);
 		MapBitmapInfo bmInfo;
 
-		file.GetInfoMapSize(name, &bmInfo);
+		CSMFMapFile::GetInfoMapSize(GetMapHeader(mapName), name, &bmInfo);
 
 		*width = bmInfo.width;
 		*height = bmInfo.height;
@@ -1272,33 +1473,30 @@ EXPORT(int) GetInfoMap(const char* mapName, const char* name, unsigned char* dat
 		CheckNullOrEmpty(name);
 		CheckNull(data);
 
-		const std::string mapFile = GetMapFile(mapName);
-		ScopedMapLoader mapLoader(mapName, mapFile);
-		CSMFMapFile file(mapFile);
-
 		const std::string n = name;
 		int actualType = (n == "height" ? bm_grayscale_16 : bm_grayscale_8);
 
 		if (actualType == typeHint) {
-			ret = file.ReadInfoMap(n, data);
+			std::vector<boost::uint8_t> infoMap;
+
+			if (ReadInfoMapSMF(mapName, n, infoMap)) {
+				memcpy(data, &infoMap[0], infoMap.size());
+				ret = 1;
+			} else {
+				ret = 0;
+			}
 		} else if (actualType == bm_grayscale_16 && typeHint == bm_grayscale_8) {
 			// convert from 16 bits per pixel to 8 bits per pixel
-			MapBitmapInfo bmInfo;
-			file.GetInfoMapSize(name, &bmInfo);
-
-			const int size = bmInfo.width * bmInfo.height;
-			if (size > 0) {
-				unsigned short* temp = new unsigned short[size];
-				if (file.ReadInfoMap(n, temp)) {
-					const unsigned short* inp = temp;
-					const unsigned short* inp_end = temp + size;
-					unsigned char* outp = data;
-					for (; inp < inp_end; ++inp, ++outp) {
-						*outp = *inp >> 8;
-					}
-					ret = 1;
+			std::vector<boost::uint8_t> infoMap;
+
+			if (ReadInfoMapSMF(mapName, n, infoMap)) {
+				const unsigned short* inp = (const unsigned short*)((const void*)&infoMap[0]);
+				const unsigned short* inp_end = inp + infoMap.size() / sizeof(unsigned short);
+				unsigned char* outp = data;
+				for (; inp < inp_end; ++inp, ++outp) {
+					*outp = *inp >> 8;
 				}
-				delete[] temp;
+				ret = 1;
 			}
 		} else if (actualType == bm_grayscale_8 && typeHint == bm_grayscale_16) {
 			throw content_error("converting from 8 bits per pixel to 16 bits per pixel is unsupported");
@@ -1533,6 +1731,318 @@ EXPORT(unsigned int) GetPrimaryModChecksumFromName(const char* name)
 }
 
 
+//////////////////////////
+//////////////////////////
+
+// batch queries
+//
+// These describe all maps or games in one JSON document, written into a
+// buffer of the caller. Besides the archive scanner, which locks itself, they
+// only share the map info cache below, so they may be called from several
+// threads at once.
+
+struct BatchMapInfo
+{
+	unsigned int checksum;    ///< complete checksum of the map when parsed
+	bool valid;
+	std::string error;
+	InternalMapInfo info;
+};
+
+/// parsed map infos by map name, reparsed when the checksum changes
+static std::map<std::string, BatchMapInfo> batchMapInfos;
+/// guards batchMapInfos, and the VFS while a map is parsed for it
+static boost::mutex batchMapInfosMutex;
+
+static void internal_deleteBatchMapInfos()
+{
+	boost::mutex::scoped_lock lck(batchMapInfosMutex);
+	batchMapInfos.clear();
+}
+
+static BatchMapInfo internal_getBatchMapInfo(const std::string& mapName, unsigned int checksum)
+{
+	// internal_GetMapInfo replaces the global VFS while it runs, so only
+	// one map is parsed at a time; they are cached after that
+	boost::mutex::scoped_lock lck(batchMapInfosMutex);
+
+	const std::map<std::string, BatchMapInfo>::const_iterator it = batchMapInfos.find(mapName);
+
+	if (it != batchMapInfos.end() && it->second.checksum == checksum)
+		return it->second;
+
+	BatchMapInfo& bmi = batchMapInfos[mapName];
+	bmi.checksum = checksum;
+	bmi.info = InternalMapInfo();
+
+	try {
+		bmi.valid = internal_GetMapInfo(mapName.c_str(), &bmi.info);
+		bmi.error = (bmi.valid)? "": bmi.info.description;
+	} catch (const std::exception& ex) {
+		bmi.valid = false;
+		bmi.error = ex.what();
+	}
+
+	return bmi;
+}
+
+
+/// @return the length of the valid UTF-8 sequence at <pos>, 0 if there is none
+static size_t GetUTF8SequenceLength(const std::string& str, size_t pos)
+{
+	const unsigned char c = str[pos];
+
+	if (c < 0x80)
+		return 1;
+
+	size_t len = 0;
+	unsigned int cp = 0;
+	unsigned int minCp = 0;
+
+	if ((c & 0xE0) == 0xC0) { len = 2; cp = c & 0x1F; minCp = 0x80;    } else
+	if ((c & 0xF0) == 0xE0) { len = 3; cp = c & 0x0F; minCp = 0x800;   } else
+	if ((c & 0xF8) == 0xF0) { len = 4; cp = c & 0x07; minCp = 0x10000; } else
+		return 0;
+
+	if ((pos + len) > str.size())
+		return 0;
+
+	for (size_t n = 1; n < len; n++) {
+		const unsigned char cc = str[pos + n];
+
+		if ((cc & 0xC0) != 0x80)
+			return 0;
+
+		cp = (cp << 6) | (cc & 0x3F);
+	}
+
+	// overlong encodings, UTF-16 surrogates and code points beyond Unicode
+	if (cp < minCp || (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF)
+		return 0;
+
+	return len;
+}
+
+static void JsonAppendString(std::string& json, const std::string& str)
+{
+	json += '"';
+
+	for (size_t pos = 0; pos < str.size(); ) {
+		const char c = str[pos];
+
+		if ((unsigned char) c >= 0x80) {
+			// map descriptions come in whatever encoding the author used,
+			// bytes that are not UTF-8 become replacement characters
+			const size_t len = GetUTF8SequenceLength(str, pos);
+
+			if (len == 0) {
+				json += "\\ufffd";
+				pos += 1;
+			} else {
+				json.append(str, pos, len);
+				pos += len;
+			}
+
+			continue;
+		}
+
+		pos += 1;
+
+		switch (c) {
+			case '"':  { json += "\\\""; } break;
+			case '\\': { json += "\\\\"; } break;
+			case '\n': { json += "\\n";  } break;
+			case '\r': { json += "\\r";  } break;
+			case '\t': { json += "\\t";  } break;
+			default: {
+				if ((unsigned char) c < 0x20) {
+					char buf[8];
+					SNPRINTF(buf, sizeof(buf), "\\u%04x", (unsigned char) c);
+					json += buf;
+				} else {
+					json += c;
+				}
+			} break;
+		}
+	}
+
+	json += '"';
+}
+
+static void JsonAppendKey(std::string& json, const char* key)
+{
+	if (json[json.size() - 1] != '{')
+		json += ',';
+
+	JsonAppendString(json, key);
+	json += ':';
+}
+
+static void JsonAppendNumber(std::string& json, double value)
+{
+	// JSON has no literals for these
+	if (math::isinf(value) || math::isnan(value)) {
+		json += "null";
+		return;
+	}
+
+	char buf[32];
+	SNPRINTF(buf, sizeof(buf), "%.9g", value);
+	json += buf;
+}
+
+static void JsonAppendNumber(std::string& json, unsigned int value)
+{
+	char buf[16];
+	SNPRINTF(buf, sizeof(buf), "%u", value);
+	json += buf;
+}
+
+static void JsonAppendNumber(std::string& json, int value)
+{
+	json += IntToString(value);
+}
+
+static void JsonAppendStrings(std::string& json, const std::vector<std::string>& strs, size_t first = 0)
+{
+	json += '[';
+
+	for (size_t n = first; n < strs.size(); n++) {
+		if (n > first)
+			json += ',';
+
+		JsonAppendString(json, strs[n]);
+	}
+
+	json += ']';
+}
+
+/// copies the document like snprintf does, @return its length
+static int CopyJson(const std::string& json, char* buffer, int bufferSize)
+{
+	if (buffer != NULL && bufferSize > 0) {
+		const size_t size = std::min(json.size(), size_t(bufferSize - 1));
+
+		memcpy(buffer, json.data(), size);
+		buffer[size] = 0;
+	}
+
+	return json.size();
+}
+
+
+EXPORT(int) GetMapListJSON(char* buffer, int bufferSize)
+{
+	try {
+		CheckInit();
+
+		std::vector<std::string> scannedNames = archiveScanner->GetMaps();
+		std::sort(scannedNames.begin(), scannedNames.end());
+
+		std::string json = "[";
+
+		for (const std::string& mapName: scannedNames) {
+			const unsigned int checksum = archiveScanner->GetArchiveCompleteChecksum(mapName);
+			const BatchMapInfo bmi = internal_getBatchMapInfo(mapName, checksum);
+			const InternalMapInfo& mi = bmi.info;
+
+			if (json.size() > 1)
+				json += ',';
+
+			json += '{';
+			JsonAppendKey(json, "name");            JsonAppendString(json, mapName);
+			JsonAppendKey(json, "fileName");        JsonAppendString(json, archiveScanner->MapNameToMapFile(mapName));
+			JsonAppendKey(json, "archive");         JsonAppendString(json, archiveScanner->ArchiveFromName(mapName));
+			JsonAppendKey(json, "checksum");        JsonAppendNumber(json, checksum);
+
+			if (!bmi.valid) {
+				JsonAppendKey(json, "error");       JsonAppendString(json, bmi.error);
+				json += '}';
+				continue;
+			}
+
+			JsonAppendKey(json, "description");     JsonAppendString(json, mi.description);
+			JsonAppendKey(json, "author");          JsonAppendString(json, mi.author);
+			JsonAppendKey(json, "width");           JsonAppendNumber(json, mi.width);
+			JsonAppendKey(json, "height");          JsonAppendNumber(json, mi.height);
+			JsonAppendKey(json, "tidalStrength");   JsonAppendNumber(json, mi.tidalStrength);
+			JsonAppendKey(json, "gravity");         JsonAppendNumber(json, mi.gravity);
+			JsonAppendKey(json, "maxMetal");        JsonAppendNumber(json, mi.maxMetal);
+			JsonAppendKey(json, "extractorRadius"); JsonAppendNumber(json, mi.extractorRadius);
+			JsonAppendKey(json, "minWind");         JsonAppendNumber(json, mi.minWind);
+			JsonAppendKey(json, "maxWind");         JsonAppendNumber(json, mi.maxWind);
+			JsonAppendKey(json, "startPositions");
+
+			json += '[';
+
+			for (size_t p = 0; p < mi.xPos.size(); p++) {
+				if (p > 0)
+					json += ',';
+
+				json += '{';
+				JsonAppendKey(json, "x"); JsonAppendNumber(json, mi.xPos[p]);
+				JsonAppendKey(json, "z"); JsonAppendNumber(json, mi.zPos[p]);
+				json += '}';
+			}
+
+			json += "]}";
+		}
+
+		json += ']';
+		return CopyJson(json, buffer, bufferSize);
+	}
+	UNITSYNC_CATCH_BLOCKS;
+	return -1;
+}
+
+EXPORT(int) GetPrimaryModListJSON(char* buffer, int bufferSize)
+{
+	try {
+		CheckInit();
+
+		const std::vector<CArchiveScanner::ArchiveData> mods = archiveScanner->GetPrimaryMods();
+
+		std::string json = "[";
+
+		for (const CArchiveScanner::ArchiveData& mod: mods) {
+			// GetPrimaryMods puts the archive of the game first
+			const std::vector<std::string>& deps = mod.GetDependencies();
+			const std::vector<InfoItem> infoItems = mod.GetInfoItems();
+
+			if (json.size() > 1)
+				json += ',';
+
+			json += '{';
+			JsonAppendKey(json, "name");         JsonAppendString(json, mod.GetNameVersioned());
+			JsonAppendKey(json, "archive");      JsonAppendString(json, deps[0]);
+			JsonAppendKey(json, "checksum");     JsonAppendNumber(json, archiveScanner->GetArchiveCompleteChecksum(deps[0]));
+			JsonAppendKey(json, "dependencies"); JsonAppendStrings(json, deps, 1);
+			JsonAppendKey(json, "info");
+
+			json += '{';
+
+			for (const InfoItem& infoItem: infoItems) {
+				JsonAppendKey(json, infoItem.key.c_str());
+
+				switch (infoItem.valueType) {
+					case INFO_VALUE_TYPE_STRING:  { JsonAppendString(json, infoItem.valueTypeString); } break;
+					case INFO_VALUE_TYPE_INTEGER: { JsonAppendNumber(json, infoItem.value.typeInteger); } break;
+					case INFO_VALUE_TYPE_FLOAT:   { JsonAppendNumber(json, infoItem.value.typeFloat); } break;
+					case INFO_VALUE_TYPE_BOOL:    { json += ((infoItem.value.typeBool)? "true": "false"); } break;
+				}
+			}
+
+			json += "}}";
+		}
+
+		json += ']';
+		return CopyJson(json, buffer, bufferSize);
+	}
+	UNITSYNC_CATCH_BLOCKS;
+	return -1;
+}
+
+
 //////////////////////////
 //////////////////////////
 
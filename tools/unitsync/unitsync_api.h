@@ -649,6 +649,52 @@ EXPORT(unsigned int) GetPrimaryModChecksum(int index);
  */
 EXPORT(unsigned int) GetPrimaryModChecksumFromName(const char* name);
 
+/**
+ * @brief Retrieve all maps and their meta-data in one call
+ * @param buffer receives the document, NUL terminated; may be NULL
+ * @param bufferSize size of buffer in bytes; the document is truncated
+ *   to bufferSize - 1 bytes if it does not fit
+ * @return negative integer (< 0) on error;
+ *   the length of the whole document (>= 0) on success
+ *
+ * The document is a JSON array with one object per map, sorted by name:
+ * name, fileName, archive, checksum, description, author, width, height,
+ * tidalStrength, gravity, maxMetal, extractorRadius, minWind, maxWind and
+ * startPositions (an array of {x, z} objects). Maps that could not be parsed
+ * have an error member instead of the meta-data.
+ *
+ * Maps are parsed once and cached until their checksum changes, so the first
+ * call is as expensive as querying every map, later ones are not.
+ * Unlike the index based functions, this does not depend on earlier calls
+ * and may be called from several threads at the same time, though not
+ * concurrently with Init or UnInit.
+ *
+ * Example:
+ *		@code
+ *		int size = GetMapListJSON(NULL, 0);
+ *		std::vector<char> buf(size + 1);
+ *		// the list may have grown in between
+ *		while ((size = GetMapListJSON(&buf[0], buf.size())) >= (int) buf.size())
+ *			buf.resize(size + 1);
+ *		@endcode
+ */
+EXPORT(int         ) GetMapListJSON(char* buffer, int bufferSize);
+/**
+ * @brief Retrieve all games and their meta-data in one call
+ * @param buffer receives the document, NUL terminated; may be NULL
+ * @param bufferSize size of buffer in bytes; the document is truncated
+ *   to bufferSize - 1 bytes if it does not fit
+ * @return negative integer (< 0) on error;
+ *   the length of the whole document (>= 0) on success
+ *
+ * The document is a JSON array with one object per primary mod, sorted by
+ * name: name, archive, checksum, dependencies (an array of archive or game
+ * names) and info (an object with the mod info items, see
+ * GetPrimaryModInfoCount).
+ * Like GetMapListJSON, this may be called from several threads at once.
+ */
+EXPORT(int         ) GetPrimaryModListJSON(char* buffer, int bufferSize);
+
 /**
  * @brief Retrieve the number of available sides
  * @return negative integer (< 0) on error;